@@ -0,0 +1,311 @@
+#include "bench_harness.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <thread>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+static int OpenCounter(uint64_t config, int group) {
+  perf_event_attr attr = {};
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = group < 0; // The leader starts and stops the group
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+#endif
+
+PerfCounters::PerfCounters() {
+#ifdef __linux__
+  const uint64_t configs[4] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES};
+  leader = OpenCounter(configs[0], -1);
+  if (leader < 0)
+    return;
+  events[0] = leader;
+  // Members the PMU lacks (common in VMs) are left out of the group
+  for (int i = 1; i < 4; i++)
+    events[i] = OpenCounter(configs[i], leader);
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : events)
+    if (fd >= 0)
+      close(fd);
+#endif
+}
+
+void PerfCounters::Start() {
+#ifdef __linux__
+  if (leader < 0)
+    return;
+  ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+}
+
+void PerfCounters::Stop() {
+#ifdef __linux__
+  if (leader < 0)
+    return;
+  ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  uint64_t buffer[1 + 4] = {};
+  if (read(leader, buffer, sizeof(buffer)) <= 0)
+    return;
+  // Values come in the order the events joined the group
+  uint64_t value = 1;
+  for (int i = 0; i < 4 && value <= buffer[0]; i++) {
+    if (events[i] >= 0)
+      totals[i] += buffer[value++];
+  }
+#endif
+}
+
+void PerfCounters::Reset() { fill(begin(totals), end(totals), 0); }
+
+// Linear interpolation between order statistics of sorted samples
+static double Percentile(const vector<double> &sorted, double fraction) {
+  if (sorted.empty())
+    return 0.0;
+  double position = fraction * (sorted.size() - 1);
+  size_t below = (size_t)position;
+  size_t above = min(below + 1, sorted.size() - 1);
+  double t = position - below;
+  return sorted[below] * (1.0 - t) + sorted[above] * t;
+}
+
+BenchResult RunBenchmark(const Benchmark &benchmark,
+                         const BenchOptions &options, PerfCounters &perf) {
+  using Clock = chrono::steady_clock;
+  BenchResult result;
+  result.name = benchmark.name;
+  result.params = benchmark.params;
+  result.unit = benchmark.unit;
+  function<double()> run = benchmark.setup();
+
+  // Warm-up and calibration: double the iterations until a sample lasts
+  // sampleTime, so short kernels are not dominated by clock overhead
+  int iterations = 1;
+  double items = 0.0;
+  while (true) {
+    auto start = Clock::now();
+    items = 0.0;
+    for (int i = 0; i < iterations; i++)
+      items += run();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    if (seconds >= options.sampleTime || iterations >= (1 << 20))
+      break;
+    double scale = seconds > 0.0 ? options.sampleTime / seconds : 16.0;
+    iterations = (int)min<double>(iterations * clamp(scale, 2.0, 16.0),
+                                  1 << 20);
+  }
+  result.items = items / iterations;
+  result.iterations = iterations;
+
+  bool counting = options.counters && perf.Available();
+  perf.Reset();
+  vector<double> samples;
+  double elapsed = 0.0;
+  while ((int)samples.size() < options.maxSamples &&
+         (elapsed < options.minTime ||
+          (int)samples.size() < options.minSamples)) {
+    if (counting)
+      perf.Start();
+    auto start = Clock::now();
+    for (int i = 0; i < iterations; i++)
+      run();
+    double seconds = chrono::duration<double>(Clock::now() - start).count();
+    if (counting)
+      perf.Stop();
+    samples.push_back(seconds * 1e9 / iterations);
+    elapsed += seconds;
+  }
+
+  sort(samples.begin(), samples.end());
+  result.samples = (int)samples.size();
+  result.median = Percentile(samples, 0.5);
+  result.p10 = Percentile(samples, 0.1);
+  result.p90 = Percentile(samples, 0.9);
+  result.min = samples.front();
+  result.max = samples.back();
+  result.itemsPerSecond =
+      result.median > 0.0 ? result.items * 1e9 / result.median : 0.0;
+
+  if (counting) {
+    double processed = result.items * iterations * samples.size();
+    const uint64_t *totals = perf.Totals();
+    result.counters.available = totals[0] > 0 && processed > 0.0;
+    if (result.counters.available) {
+      result.counters.cycles = totals[0] / processed;
+      result.counters.instructions = totals[1] / processed;
+      result.counters.cacheMisses = totals[2] / processed;
+      result.counters.branchMisses = totals[3] / processed;
+    }
+  }
+  return result;
+}
+
+// Durations with a unit that keeps three significant digits readable
+static string FormatTime(double ns) {
+  char text[32];
+  if (ns < 1e3)
+    snprintf(text, sizeof(text), "%.1f ns", ns);
+  else if (ns < 1e6)
+    snprintf(text, sizeof(text), "%.2f us", ns / 1e3);
+  else if (ns < 1e9)
+    snprintf(text, sizeof(text), "%.2f ms", ns / 1e6);
+  else
+    snprintf(text, sizeof(text), "%.2f s", ns / 1e9);
+  return text;
+}
+
+static string FormatRate(double rate) {
+  char text[32];
+  if (rate >= 1e9)
+    snprintf(text, sizeof(text), "%.2fG", rate / 1e9);
+  else if (rate >= 1e6)
+    snprintf(text, sizeof(text), "%.2fM", rate / 1e6);
+  else if (rate >= 1e3)
+    snprintf(text, sizeof(text), "%.2fk", rate / 1e3);
+  else
+    snprintf(text, sizeof(text), "%.1f", rate);
+  return text;
+}
+
+void PrintResult(const BenchResult &result, const BenchResult *baseline) {
+  string rate = FormatRate(result.itemsPerSecond) + " " + result.unit + "/s";
+  printf("%-36s %11s %11s %11s %20s", result.name.c_str(),
+         FormatTime(result.median).c_str(), FormatTime(result.p10).c_str(),
+         FormatTime(result.p90).c_str(), rate.c_str());
+  if (result.counters.available) {
+    double ipc = result.counters.cycles > 0.0
+                     ? result.counters.instructions / result.counters.cycles
+                     : 0.0;
+    printf("  %8.1f cyc %5.2f IPC", result.counters.cycles, ipc);
+  }
+  if (baseline && baseline->median > 0.0)
+    printf("  x%.2f", baseline->median / result.median);
+  printf("\n");
+}
+
+static string JsonString(const string &text) {
+  string quoted = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      quoted += '\\';
+      quoted += c;
+    } else if ((unsigned char)c < 0x20) {
+      char escape[8];
+      snprintf(escape, sizeof(escape), "\\u%04x", c);
+      quoted += escape;
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+bool WriteJson(const string &path, const vector<BenchResult> &results) {
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+
+  char date[32];
+  time_t now = time(nullptr);
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+#ifdef NDEBUG
+  const char *build = "release";
+#else
+  const char *build = "debug";
+#endif
+#ifdef __VERSION__
+  const char *compiler = __VERSION__;
+#else
+  const char *compiler = "unknown";
+#endif
+  fprintf(file,
+          "{\n  \"context\": {\"date\": \"%s\", \"build\": \"%s\", "
+          "\"compiler\": %s, \"threads\": %u},\n  \"benchmarks\": [\n",
+          date, build, JsonString(compiler).c_str(),
+          thread::hardware_concurrency());
+
+  for (size_t i = 0; i < results.size(); i++) {
+    const BenchResult &r = results[i];
+    string params;
+    for (size_t p = 0; p < r.params.size(); p++) {
+      params += (p ? ", " : "") + JsonString(r.params[p].first) + ": " +
+                JsonString(r.params[p].second);
+    }
+    fprintf(file,
+            "    {\"name\": %s, \"params\": {%s}, \"unit\": %s, "
+            "\"items\": %.6g, \"iterations\": %d, \"samples\": %d, "
+            "\"median_ns\": %.6g, \"p10_ns\": %.6g, \"p90_ns\": %.6g, "
+            "\"min_ns\": %.6g, \"max_ns\": %.6g, \"items_per_second\": %.6g",
+            JsonString(r.name).c_str(), params.c_str(),
+            JsonString(r.unit).c_str(), r.items, r.iterations, r.samples,
+            r.median, r.p10, r.p90, r.min, r.max, r.itemsPerSecond);
+    if (r.counters.available) {
+      fprintf(file,
+              ", \"counters_per_item\": {\"cycles\": %.6g, "
+              "\"instructions\": %.6g, \"cache_misses\": %.6g, "
+              "\"branch_misses\": %.6g}",
+              r.counters.cycles, r.counters.instructions,
+              r.counters.cacheMisses, r.counters.branchMisses);
+    }
+    fprintf(file, "}%s\n", i + 1 < results.size() ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return fclose(file) == 0;
+}
+
+// Value following "key": on a line written by WriteJson
+static bool FindField(const string &line, const string &key, string &value) {
+  string marker = "\"" + key + "\": ";
+  size_t at = line.find(marker);
+  if (at == string::npos)
+    return false;
+  at += marker.size();
+  if (line[at] == '"') {
+    size_t end = line.find('"', at + 1);
+    value = line.substr(at + 1, end - at - 1);
+  } else {
+    size_t end = line.find_first_of(",}", at);
+    value = line.substr(at, end - at);
+  }
+  return true;
+}
+
+vector<BenchResult> ReadJson(const string &path) {
+  vector<BenchResult> results;
+  ifstream file(path);
+  string line, value;
+  while (getline(file, line)) {
+    BenchResult result;
+    if (!FindField(line, "name", result.name) ||
+        !FindField(line, "median_ns", value))
+      continue;
+    result.median = atof(value.c_str());
+    if (FindField(line, "p10_ns", value))
+      result.p10 = atof(value.c_str());
+    if (FindField(line, "p90_ns", value))
+      result.p90 = atof(value.c_str());
+    results.push_back(result);
+  }
+  return results;
+}
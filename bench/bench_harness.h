@@ -0,0 +1,114 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// MICRO-BENCHMARKS : MESURE, COMPTEURS MATÉRIELS, RAPPORTS
+
+/// Options de mesure communes à tous les benchmarks
+struct BenchOptions {
+  string filter;            // Sous-chaîne du nom (vide : tous)
+  double minTime = 0.5;     // Durée mesurée minimale par benchmark (s)
+  double sampleTime = 0.01; // Durée visée d'un échantillon (s)
+  int minSamples = 5;
+  int maxSamples = 200;
+  bool counters = true; // Compteurs matériels si le noyau les autorise
+};
+
+/// Compteurs matériels d'un benchmark, par élément traité
+struct BenchCounters {
+  bool available = false;
+  double cycles = 0.0;
+  double instructions = 0.0;
+  double cacheMisses = 0.0;
+  double branchMisses = 0.0;
+};
+
+/// Résultat d'un benchmark ; les durées sont par itération (ns)
+struct BenchResult {
+  string name;
+  vector<pair<string, string>> params;
+  string unit;        // Nature des éléments traités ("atoms", "flips"...)
+  double items = 0.0; // Éléments par itération
+  int iterations = 0; // Itérations par échantillon
+  int samples = 0;
+  double median = 0.0, p10 = 0.0, p90 = 0.0, min = 0.0, max = 0.0;
+  double itemsPerSecond = 0.0; // Au temps médian
+  BenchCounters counters;
+};
+
+/**
+ * @brief Benchmark paramétré
+ *
+ * setup() construit l'état mesuré (réseau, spins...) et rend la fonction
+ * d'une itération, qui renvoie le nombre d'éléments traités. L'état n'est
+ * construit que pour les benchmarks retenus et libéré après leur mesure ;
+ * sa construction n'est pas chronométrée.
+ */
+struct Benchmark {
+  string name;
+  vector<pair<string, string>> params;
+  string unit;
+  function<function<double()>()> setup;
+};
+
+/**
+ * @brief Compteurs perf_event_open du thread appelant
+ *
+ * Cycles, instructions, défauts de cache et mauvaises prédictions de
+ * branche, lus en groupe. Indisponibles hors Linux ou si
+ * perf_event_paranoid l'interdit ; les benchmarks tournent alors sans.
+ */
+class PerfCounters {
+public:
+  PerfCounters();
+  ~PerfCounters();
+  PerfCounters(const PerfCounters &) = delete;
+  PerfCounters &operator=(const PerfCounters &) = delete;
+
+  bool Available() const { return leader >= 0; }
+  void Start();
+  /// Arrête le comptage et ajoute les valeurs lues à total
+  void Stop();
+  void Reset();
+  /// Totaux accumulés : cycles, instructions, cache, branches
+  const uint64_t *Totals() const { return totals; }
+
+private:
+  int leader = -1;
+  int events[4] = {-1, -1, -1, -1};
+  uint64_t totals[4] = {0, 0, 0, 0};
+};
+
+BenchResult RunBenchmark(const Benchmark &benchmark,
+                         const BenchOptions &options, PerfCounters &perf);
+/**
+ * Mesure un benchmark : calibre le nombre d'itérations par échantillon
+ * (durée sampleTime), puis prend des échantillons jusqu'à minTime
+ * @return Médiane, percentiles 10 / 90 et extrêmes par itération
+ */
+
+void PrintResult(const BenchResult &result, const BenchResult *baseline);
+/**
+ * Affiche une ligne de tableau (avec le rapport à la référence si fournie)
+ */
+
+bool WriteJson(const string &path, const vector<BenchResult> &results);
+/**
+ * Écrit les résultats en JSON, un benchmark par ligne pour des diffs
+ * lisibles entre commits
+ * @return Faux si le fichier ne peut pas être écrit
+ */
+
+vector<BenchResult> ReadJson(const string &path);
+/**
+ * Relit un fichier produit par WriteJson (nom et durées seulement)
+ * @return Résultats de référence (vide si le fichier est absent)
+ */
+
+#endif // BENCH_HARNESS_H
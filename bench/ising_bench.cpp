@@ -0,0 +1,512 @@
+#include "atom_picker.h"
+#include "bench_harness.h"
+#include "dipolar.h"
+#include "disorder.h"
+#include "ising_moves.h"
+#include "numa.h"
+#include "simulation.h"
+#include "spin_model.h"
+#include "stencil.h"
+#include "time_series.h"
+#include <cfloat>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+
+// Headless benchmark driver: no window and no GL context, so the mesh
+// benchmark times the CPU baking step of CreateChunkedCylinderLines
+
+static const float benchTemperature = 4.0f; // Near Tc: mixed acceptance
+static const float benchJ = 1.0f;
+static const float benchB = 0.0f;
+
+struct LatticeKind {
+  StructureType type;
+  const char *name;
+};
+
+static const LatticeKind latticeKinds[] = {
+    {StructureType::CUBIC, "cubic"},
+    {StructureType::HEXAGONAL, "hexagonal"},
+    {StructureType::FCC, "fcc"},
+    {StructureType::BCC, "bcc"}};
+
+static vector<Atome> Build(StructureType type, int size) {
+  switch (type) {
+  case StructureType::HEXAGONAL:
+    return make_hexagonal_struc(size, size, size, 1.0f);
+  case StructureType::FCC:
+    return make_fcc_struc(size, size, size, 1.0f);
+  case StructureType::BCC:
+    return make_bcc_struc(size, size, size, 1.0f);
+  default:
+    return make_cubic_struc(size, size, size, 1.0f);
+  }
+}
+
+// Infinite-temperature start, the same for every run
+static vector<Atome> RandomStructure(StructureType type, int size) {
+  vector<Atome> structure = Build(type, size);
+  mt19937 rng(1);
+  for (auto &atom : structure)
+    atom.spin = (rng() & 1) ? Spin::UP : Spin::DOWN;
+  UpdateEnergies(structure, benchJ, benchB);
+  return structure;
+}
+
+static Benchmark MakeBenchmark(const char *group, const char *variant,
+                               const LatticeKind &kind, int size,
+                               const char *unit,
+                               function<function<double()>()> setup) {
+  Benchmark benchmark;
+  benchmark.name = string(group) + "/" + variant + "/" + kind.name + "/" +
+                   to_string(size);
+  benchmark.params = {{"kernel", variant},
+                      {"lattice", kind.name},
+                      {"size", to_string(size)}};
+  benchmark.unit = unit;
+  benchmark.setup = move(setup);
+  return benchmark;
+}
+
+static void AddBuilders(vector<Benchmark> &benchmarks,
+                        const vector<int> &sizes) {
+  for (const LatticeKind &kind : latticeKinds) {
+    for (int size : sizes) {
+      StructureType type = kind.type;
+      benchmarks.push_back(
+          MakeBenchmark("build", "struc", kind, size, "atoms", [type, size] {
+            return function<double()>(
+                [type, size] { return (double)Build(type, size).size(); });
+          }));
+    }
+  }
+}
+
+static void AddUpdateEnergies(vector<Benchmark> &benchmarks,
+                              const vector<int> &sizes) {
+  for (const LatticeKind &kind : latticeKinds) {
+    for (int size : sizes) {
+      StructureType type = kind.type;
+      benchmarks.push_back(MakeBenchmark(
+          "energy", "rescan", kind, size, "atoms", [type, size] {
+            auto structure =
+                make_shared<vector<Atome>>(RandomStructure(type, size));
+            return function<double()>([structure] {
+              UpdateEnergies(*structure, benchJ, benchB);
+              return (double)structure->size();
+            });
+          }));
+    }
+  }
+}
+
+// Reference kernel: one attempt per call, full rescan on acceptance
+static void AddLegacyKernel(vector<Benchmark> &benchmarks, int size) {
+  for (const LatticeKind &kind : latticeKinds) {
+    StructureType type = kind.type;
+    benchmarks.push_back(MakeBenchmark(
+        "flips", "legacy", kind, size, "updates", [type, size] {
+          auto structure =
+              make_shared<vector<Atome>>(RandomStructure(type, size));
+          auto rng = make_shared<mt19937>(1);
+          return function<double()>([structure, rng] {
+            int attempts = (int)structure->size();
+            for (int i = 0; i < attempts; i++)
+              MonteCarloStep(*structure, benchTemperature, benchJ, benchB,
+                             *rng);
+            return (double)attempts;
+          });
+        }));
+  }
+}
+
+static void AddKernels(vector<Benchmark> &benchmarks,
+                       const vector<int> &sizes) {
+  for (int size : sizes) {
+    for (const LatticeKind &kind : latticeKinds) {
+      StructureType type = kind.type;
+
+      // Periodic stencil kernels, with and without dipolar coupling
+      if (SupportsStencil(type)) {
+        benchmarks.push_back(MakeBenchmark(
+            "flips", "stencil", kind, size, "updates", [type, size] {
+              auto lattice = make_shared<StencilLattice>(
+                  MakeStencilLattice(type, size, size, size));
+              CopySpins(RandomStructure(type, size), *lattice);
+              auto rng = make_shared<mt19937>(1);
+              return function<double()>([lattice, rng] {
+                int cells = (int)lattice->spins.size() / lattice->basisCount;
+                StencilSweep(*lattice, 0, cells, benchTemperature, benchJ,
+                             benchB, *rng);
+                return (double)lattice->spins.size();
+              });
+            }));
+        benchmarks.push_back(MakeBenchmark(
+            "flips", "dipolar", kind, size, "updates", [type, size] {
+              auto lattice = make_shared<StencilLattice>(
+                  MakeStencilLattice(type, size, size, size));
+              CopySpins(RandomStructure(type, size), *lattice);
+              auto dipolar = make_shared<DipolarField>();
+              dipolar->Setup(*lattice, DipolarBoundary::OPEN);
+              auto rng = make_shared<mt19937>(1);
+              return function<double()>([lattice, dipolar, rng] {
+                DipolarSweep(*lattice, *dipolar, 0.1f, benchTemperature,
+                             benchJ, benchB, *rng);
+                return (double)lattice->spins.size();
+              });
+            }));
+      }
+
+      // CSR kernels: integer bonds (acceptance table) and real bonds
+      for (bool integer : {true, false}) {
+        benchmarks.push_back(MakeBenchmark(
+            "flips", integer ? "csr-int" : "csr-float", kind, size,
+            "updates", [type, size, integer] {
+              DisorderParams params;
+              if (!integer) {
+                params.bonds = BondDisorder::GAUSSIAN;
+                params.mean = 1.0f;
+                params.spread = 0.3f;
+              }
+              auto lattice = make_shared<DisorderedLattice>(
+                  MakeDisorderedLattice(RandomStructure(type, size), params));
+              auto rng = make_shared<mt19937>(1);
+              return function<double()>([lattice, rng] {
+                int sites = (int)lattice->spins.size();
+                DisorderSweep(*lattice, 0, sites, benchTemperature, benchJ,
+                              benchB, *rng);
+                return (double)sites;
+              });
+            }));
+      }
+
+      // Cluster and rejection-free moves, per site visited or attempt
+      benchmarks.push_back(MakeBenchmark(
+          "flips", "wolff", kind, size, "updates", [type, size] {
+            auto lattice = make_shared<DisorderedLattice>(MakeDisorderedLattice(
+                RandomStructure(type, size), DisorderParams()));
+            auto wolff = make_shared<WolffUpdater>();
+            auto rng = make_shared<mt19937>(1);
+            return function<double()>([lattice, wolff, rng] {
+              double sites = (double)lattice->spins.size();
+              wolff->Advance(*lattice, sites, benchTemperature, benchJ,
+                             benchB, *rng);
+              return sites;
+            });
+          }));
+      benchmarks.push_back(MakeBenchmark(
+          "flips", "rejection-free", kind, size, "updates", [type, size] {
+            auto lattice = make_shared<DisorderedLattice>(MakeDisorderedLattice(
+                RandomStructure(type, size), DisorderParams()));
+            auto updater = make_shared<RejectionFreeUpdater>();
+            auto rng = make_shared<mt19937>(1);
+            return function<double()>([lattice, updater, rng] {
+              double sites = (double)lattice->spins.size();
+              updater->Advance(*lattice, sites, benchTemperature, benchJ,
+                               benchB, *rng);
+              return sites;
+            });
+          }));
+
+      // Generic spin models on the same topology
+      const pair<SpinModelType, const char *> models[] = {
+          {SpinModelType::ISING, "ising"},
+          {SpinModelType::POTTS, "potts3"},
+          {SpinModelType::XY, "xy"},
+          {SpinModelType::HEISENBERG, "heisenberg"}};
+      for (auto [model, variant] : models) {
+        benchmarks.push_back(MakeBenchmark(
+            "flips", variant, kind, size, "updates", [type, size, model] {
+              auto topology = make_shared<const SpinTopology>(
+                  MakeSpinTopology(Build(type, size)));
+              shared_ptr<SpinSystem> system =
+                  MakeSpinSystem(model, topology, 3);
+              auto rng = make_shared<mt19937>(1);
+              system->Randomize(*rng);
+              SpinModelParams params;
+              params.temperature = benchTemperature;
+              params.J = benchJ;
+              params.B = benchB;
+              return function<double()>([system, params, rng] {
+                int sites = (int)system->Size();
+                system->Update(0, sites, params, *rng);
+                return (double)sites;
+              });
+            }));
+      }
+    }
+  }
+}
+
+static void AddMeshBaking(vector<Benchmark> &benchmarks,
+                          const vector<int> &sizes) {
+  for (const LatticeKind &kind : latticeKinds) {
+    for (int size : sizes) {
+      StructureType type = kind.type;
+      benchmarks.push_back(
+          MakeBenchmark("mesh", "bake", kind, size, "bonds", [type, size] {
+            auto structure = make_shared<vector<Atome>>(Build(type, size));
+            size_t bonds = 0;
+            for (size_t i = 0; i < structure->size(); i++)
+              for (int j : (*structure)[i].neigh)
+                bonds += (size_t)j > i;
+            return function<double()>([structure, bonds] {
+              vector<Mesh> meshes = BakeChunkedCylinderLines(*structure);
+              for (Mesh &mesh : meshes)
+                FreeMeshData(mesh);
+              return (double)bonds;
+            });
+          }));
+    }
+  }
+}
+
+// History store: the per-frame append and the plot path (gather + LTTB),
+// which should not depend on the history length
+static void AddHistory(vector<Benchmark> &benchmarks,
+                       const vector<long long> &lengths) {
+  Benchmark append;
+  append.name = "history/append";
+  append.params = {{"kernel", "append"}};
+  append.unit = "samples";
+  append.setup = [] {
+    auto series = make_shared<TimeSeries>();
+    return function<double()>([series] {
+      const int samples = 100000;
+      for (int i = 0; i < samples; i++)
+        series->Append((float)(i & 1023));
+      return (double)samples;
+    });
+  };
+  benchmarks.push_back(move(append));
+
+  const size_t pixels = 800;
+  for (long long length : lengths) {
+    Benchmark plot;
+    plot.name = "history/plot/" + to_string(length);
+    plot.params = {{"kernel", "plot"}, {"samples", to_string(length)}};
+    plot.unit = "points";
+    plot.setup = [length, pixels] {
+      auto series = make_shared<TimeSeries>();
+      mt19937 rng(1);
+      normal_distribution<float> noise(0.0f, 1.0f);
+      for (long long i = 0; i < length; i++)
+        series->Append(noise(rng));
+      auto gathered = make_shared<vector<SeriesPoint>>();
+      auto line = make_shared<vector<SeriesPoint>>();
+      return function<double()>([series, gathered, line, pixels] {
+        series->Gather(series->First(), series->Count(), 4 * pixels,
+                       *gathered);
+        DownsampleLTTB(*gathered, pixels, *line);
+        return (double)line->size();
+      });
+    };
+    benchmarks.push_back(move(plot));
+  }
+}
+
+// Mouse picking: the grid index against the linear scan it replaces, for
+// rays from outside the lattice aimed at random points of its box
+static void AddPicking(vector<Benchmark> &benchmarks,
+                       const vector<int> &sizes) {
+  const float radius = 0.3f; // Lattice distance 1, as the other fixtures
+  const int rayCount = 1024;
+  for (int size : sizes) {
+    auto makeRays = [size] {
+      auto rays = make_shared<vector<Ray>>();
+      mt19937 rng(1);
+      uniform_real_distribution<float> unit(0.0f, 1.0f);
+      float extent = (float)size;
+      for (int i = 0; i < rayCount; i++) {
+        Vector3 target = {unit(rng) * extent, unit(rng) * extent,
+                          unit(rng) * extent};
+        Vector3 from = {-extent, 0.5f * extent + unit(rng) * extent,
+                        2.0f * extent};
+        rays->push_back({from, Vector3Subtract(target, from)});
+      }
+      return rays;
+    };
+    const LatticeKind &kind = latticeKinds[0];
+    benchmarks.push_back(MakeBenchmark(
+        "pick", "grid", kind, size, "rays", [size, radius, makeRays] {
+          auto picker = make_shared<AtomPicker>();
+          picker->Build(Build(StructureType::CUBIC, size), radius);
+          auto rays = makeRays();
+          auto hits = make_shared<long>(0); // Keeps the results observable
+          return function<double()>([picker, rays, hits] {
+            for (const Ray &ray : *rays)
+              *hits += picker->Pick(ray) >= 0;
+            return (double)rays->size();
+          });
+        }));
+    if (size != sizes.front())
+      continue; // Seconds per sample on the large lattice
+    benchmarks.push_back(MakeBenchmark(
+        "pick", "linear", kind, size, "rays", [size, radius, makeRays] {
+          auto structure =
+              make_shared<vector<Atome>>(Build(StructureType::CUBIC, size));
+          auto rays = makeRays();
+          auto hits = make_shared<long>(0);
+          return function<double()>([structure, rays, hits, radius] {
+            for (const Ray &ray : *rays) {
+              Vector3 d = Vector3Normalize(ray.direction);
+              float best = FLT_MAX;
+              for (const Atome &atom : *structure) {
+                Vector3 oc = Vector3Subtract(ray.position, atom.pos);
+                float b = Vector3DotProduct(oc, d);
+                float disc = b * b - Vector3DotProduct(oc, oc) +
+                             radius * radius;
+                if (disc >= 0.0f)
+                  best = min(best, -b - sqrtf(disc));
+              }
+              *hits += best < FLT_MAX;
+            }
+            return (double)rays->size();
+          });
+        }));
+  }
+}
+
+// Parallel sweeps: spins touched by the calling thread on unpinned workers,
+// against first-touch slabs on pinned workers, with and without huge pages.
+// The placement line shows where the pages went (nodes in MB).
+struct NumaFixture {
+  ThreadPool pool; // Declared first: the lattice sweeps on it
+  NumaLattice lattice;
+};
+
+static void AddNuma(vector<Benchmark> &benchmarks, const vector<int> &sizes) {
+  struct Variant {
+    const char *name;
+    NumaOptions options;
+  };
+  const Variant variants[] = {
+      {"shared-touch", {false, false, HugePages::NONE}},
+      {"first-touch", {true, true, HugePages::NONE}},
+      {"first-touch-thp", {true, true, HugePages::TRANSPARENT}}};
+  for (int size : sizes) {
+    for (const Variant &variant : variants) {
+      string name = string("numa/") + variant.name + "/cubic/" +
+                    to_string(size);
+      NumaOptions options = variant.options;
+      benchmarks.push_back(MakeBenchmark(
+          "numa", variant.name, latticeKinds[0], size, "updates",
+          [name, options, size] {
+            auto fixture = make_shared<NumaFixture>();
+            string error;
+            if (!fixture->lattice.Create(fixture->pool, size, size, size, 1,
+                                         options, error)) {
+              fprintf(stderr, "%s: %s\n", name.c_str(), error.c_str());
+              exit(1);
+            }
+            NumaPlacement placement = fixture->lattice.Placement();
+            printf("%s: placement", name.c_str());
+            if (!placement.available)
+              printf(" unknown");
+            for (size_t node = 0; node < placement.nodeBytes.size(); node++)
+              printf(" node%zu %.1f", node, placement.nodeBytes[node] / 1e6);
+            printf(", huge pages %.1f MB\n", placement.hugeBytes / 1e6);
+            return function<double()>([fixture] {
+              fixture->lattice.Sweep(benchTemperature, benchJ, benchB);
+              return (double)fixture->lattice.Sites();
+            });
+          }));
+    }
+  }
+}
+
+static void PrintUsage(const char *program) {
+  printf("Usage: %s [options]\n"
+         "  --filter TEXT     Run benchmarks whose name contains TEXT\n"
+         "  --list            List benchmark names and exit\n"
+         "  --json FILE       Write results as JSON\n"
+         "  --baseline FILE   Compare medians with an earlier JSON file\n"
+         "  --min-time SEC    Measured time per benchmark (default 0.5)\n"
+         "  --quick           Small sizes only\n"
+         "  --no-counters     Skip hardware counters\n",
+         program);
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options;
+  string jsonPath, baselinePath;
+  bool list = false, quick = false;
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (!strcmp(arg, "--filter") && hasValue)
+      options.filter = argv[++i];
+    else if (!strcmp(arg, "--json") && hasValue)
+      jsonPath = argv[++i];
+    else if (!strcmp(arg, "--baseline") && hasValue)
+      baselinePath = argv[++i];
+    else if (!strcmp(arg, "--min-time") && hasValue)
+      options.minTime = atof(argv[++i]);
+    else if (!strcmp(arg, "--list"))
+      list = true;
+    else if (!strcmp(arg, "--quick"))
+      quick = true;
+    else if (!strcmp(arg, "--no-counters"))
+      options.counters = false;
+    else {
+      PrintUsage(argv[0]);
+      return strcmp(arg, "--help") ? 1 : 0;
+    }
+  }
+  SetTraceLogLevel(LOG_WARNING);
+
+  vector<int> sizes = quick ? vector<int>{8} : vector<int>{8, 16, 32};
+  vector<int> kernelSizes = quick ? vector<int>{8} : vector<int>{16, 32};
+  vector<int> meshSizes = quick ? vector<int>{4} : vector<int>{8, 16};
+  vector<Benchmark> benchmarks;
+  AddBuilders(benchmarks, sizes);
+  AddUpdateEnergies(benchmarks, sizes);
+  AddLegacyKernel(benchmarks, quick ? 4 : 8);
+  AddKernels(benchmarks, kernelSizes);
+  AddMeshBaking(benchmarks, meshSizes);
+  AddHistory(benchmarks, quick ? vector<long long>{100000}
+                               : vector<long long>{100000, 10000000});
+  AddPicking(benchmarks, quick ? vector<int>{8} : vector<int>{16, 64});
+  AddNuma(benchmarks, quick ? vector<int>{32} : vector<int>{64, 256});
+
+  vector<Benchmark> selected;
+  for (Benchmark &benchmark : benchmarks)
+    if (benchmark.name.find(options.filter) != string::npos)
+      selected.push_back(move(benchmark));
+  if (list) {
+    for (const Benchmark &benchmark : selected)
+      printf("%s\n", benchmark.name.c_str());
+    return 0;
+  }
+
+  vector<BenchResult> baseline;
+  if (!baselinePath.empty())
+    baseline = ReadJson(baselinePath);
+
+  PerfCounters perf;
+  if (options.counters && !perf.Available())
+    printf("Hardware counters unavailable (perf_event_paranoid?)\n");
+  printf("%-36s %11s %11s %11s %20s\n", "benchmark", "median", "p10", "p90",
+         "throughput");
+
+  vector<BenchResult> results;
+  for (const Benchmark &benchmark : selected) {
+    BenchResult result = RunBenchmark(benchmark, options, perf);
+    const BenchResult *reference = nullptr;
+    for (const BenchResult &r : baseline)
+      if (r.name == result.name)
+        reference = &r;
+    PrintResult(result, reference);
+    fflush(stdout);
+    results.push_back(result);
+  }
+
+  if (!jsonPath.empty() && !WriteJson(jsonPath, results)) {
+    fprintf(stderr, "Cannot write %s\n", jsonPath.c_str());
+    return 1;
+  }
+  return 0;
+}
@@ -11,6 +11,7 @@ build_linux() {
     mkdir -p dist/linux
     cp build/crist-project dist/linux/
     cp -r assets dist/linux/
+    cp -r lattices dist/linux/
     echo "Linux build completed. Output in dist/linux/"
     # Create a ZIP archive of the Linux build
     echo "Creating ZIP archive of Linux build..."
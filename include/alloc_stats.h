@@ -0,0 +1,53 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+#include <cstddef>
+#include <cstdint>
+
+using namespace std;
+
+// COMPTAGE DES ALLOCATIONS DU TAS
+
+/// Allocations cumulées depuis le lancement (operator new seulement)
+struct AllocationCounts {
+  uint64_t count = 0; // Appels à operator new, toutes formes
+  uint64_t bytes = 0; // Octets demandés
+};
+
+/// Différence entre deux relevés
+inline AllocationCounts operator-(const AllocationCounts &a,
+                                  const AllocationCounts &b) {
+  return {a.count - b.count, a.bytes - b.bytes};
+}
+
+/// Fonction appelée à chaque allocation, sur le thread qui alloue
+using AllocationHook = void (*)(size_t bytes);
+
+AllocationCounts ThreadAllocations();
+/**
+ * Allocations faites par le thread appelant
+ * Un relevé en début et en fin d'image donne le coût de l'image.
+ */
+
+AllocationCounts TotalAllocations();
+/**
+ * Allocations faites par tous les threads (pool, reconstruction...)
+ */
+
+AllocationHook SetAllocationHook(AllocationHook hook);
+/**
+ * Installe l'observateur des allocations (nullptr : aucun)
+ * Sert à poser un point d'arrêt ou à tracer l'origine d'une allocation
+ * inattendue ; l'observateur ne doit pas lui-même allouer.
+ * @return L'observateur remplacé
+ */
+
+/// Vrai si operator new est remplacé (option CMake ISING_ALLOC_STATS)
+constexpr bool AllocationStatsEnabled() {
+#ifdef ISING_ALLOC_STATS
+  return true;
+#else
+  return false;
+#endif
+}
+
+#endif // ALLOC_STATS_H
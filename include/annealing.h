@@ -0,0 +1,119 @@
+#ifndef ANNEALING_H
+#define ANNEALING_H
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// RECUIT SIMULÉ ET TREMPES
+
+/// Forme du programme de température
+enum class AnnealSchedule {
+  LINEAR,      // T décroît linéairement de startT à endT
+  EXPONENTIAL, // T = startT (endT / startT)^(t / durée)
+  QUENCH,      // T = endT dès le départ
+  ADAPTIVE     // Paliers à vitesse thermodynamique constante
+};
+
+/// Paramètres d'un protocole
+struct AnnealSettings {
+  AnnealSchedule schedule = AnnealSchedule::LINEAR;
+  float startTemperature = 5.0f;
+  float endTemperature = 0.1f;
+  int coolingSweeps = 2000; // Durée de la descente (linéaire, exponentiel)
+  int holdSweeps = 200;     // Maintien final à endTemperature
+  float tableTolerance = 0.01f; // Écart relatif de T avant changement de table
+  // Adaptatif : palier de stageSweeps balayages, puis
+  // dT = speed * T² / sigma_E (sigma_E : écart type de l'énergie totale)
+  float speed = 0.5f;
+  int stageSweeps = 20;
+};
+
+/// Point de la trace d'un protocole
+struct AnnealSample {
+  float sweeps = 0.0f;      // Temps Monte-Carlo écoulé
+  float seconds = 0.0f;     // Temps réel écoulé
+  float temperature = 0.0f; // Température du noyau pendant ce pas
+  float energy = 0.0f;      // Énergie par site à la fin du pas
+};
+
+/// Trace complète d'un protocole, gardée pour comparaison
+struct AnnealTrace {
+  string label;
+  vector<AnnealSample> samples;
+  int tableChanges = 0; // Changements de la température du noyau
+  bool finished = false;
+};
+
+/**
+ * @brief Pilote la température de la simulation selon un protocole
+ *
+ * La boucle de simulation lit Temperature() avant ses balayages puis
+ * appelle Advance() avec le nombre de balayages effectués et l'énergie
+ * obtenue ; aucune intervention de l'interface n'est nécessaire. La
+ * température rendue ne change que lorsque le programme s'en écarte de
+ * plus de tableTolerance (en relatif) : les noyaux qui gardent leur table
+ * d'acceptation en cache ne la reconstruisent qu'à ces paliers, quel que
+ * soit le nombre de pas par image.
+ */
+class Annealer {
+public:
+  /// Démarre un protocole (la trace précédente passe dans l'historique)
+  void Start(const AnnealSettings &settings, int siteCount);
+
+  /// Interrompt le protocole en cours (sa trace est gardée)
+  void Stop();
+
+  bool Active() const { return active; }
+
+  /// Température à utiliser pour les prochains balayages
+  float Temperature() const { return kernelTemperature; }
+
+  /// Température exacte du programme (avant paliers de table)
+  float ScheduleTemperature() const { return scheduleTemperature; }
+
+  /**
+   * Avance le programme après des balayages
+   * @param sweeps Balayages effectués (mises à jour / nombre de sites)
+   * @param energyPerSite Énergie par site après ces balayages
+   * @param seconds Durée réelle de ces balayages
+   */
+  void Advance(float sweeps, float energyPerSite, float seconds);
+
+  /// Avancement dans [0, 1]
+  float Progress() const;
+
+  /// Protocoles terminés ou interrompus, le plus récent en dernier
+  const vector<AnnealTrace> &History() const { return history; }
+
+  /// Trace du protocole en cours (vide si aucun)
+  const AnnealTrace &Current() const { return current; }
+
+  void ClearHistory() { history.clear(); }
+
+private:
+  void UpdateSchedule();
+  void Finish();
+
+  AnnealSettings settings;
+  bool active = false;
+  int siteCount = 1;
+  float elapsedSweeps = 0.0f, elapsedSeconds = 0.0f;
+  float coolingEnd = 0.0f; // Temps où endTemperature est atteinte (-1 : inconnu)
+  float scheduleTemperature = 0.0f, kernelTemperature = 0.0f;
+
+  // Palier adaptatif : moments de l'énergie par site
+  float stageStart = 0.0f;
+  double stageSum = 0.0, stageSquares = 0.0;
+  int stageCount = 0;
+
+  AnnealTrace current;
+  vector<AnnealTrace> history;
+};
+
+const char *AnnealScheduleName(AnnealSchedule schedule);
+/**
+ * Nom affichable d'un programme ("Linear", "Exponential"...)
+ */
+
+#endif // ANNEALING_H
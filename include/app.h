@@ -0,0 +1,45 @@
+#ifndef APP_H
+#define APP_H
+#include "font_cache.h"
+
+// CYCLE DE VIE DE L'APPLICATION : UNE FENÊTRE POUR TOUS LES ÉCRANS
+
+/// Écran affiché dans l'unique fenêtre
+enum class AppState { LOGIN, SIMULATION, QUIT };
+
+/// Temps de démarrage, affichés par l'écran de connexion et la simulation
+struct StartupReport {
+  double windowMs = 0.0;      // Fenêtre, contexte OpenGL et ImGui
+  FontAtlasStatus font;       // Police : cache disque ou rastérisation
+  double interactiveMs = 0.0; // Lancement -> première image présentée
+  double simulationMs = 0.0;  // Connexion -> première image de simulation
+};
+
+double MillisecondsSinceLaunch();
+/**
+ * Temps écoulé depuis l'initialisation statique du programme
+ */
+
+StartupReport &Startup();
+/**
+ * Mesures du lancement en cours
+ */
+
+void InitApplication();
+/**
+ * Crée la fenêtre, le contexte ImGui, la police et le style, une seule
+ * fois pour tous les écrans
+ */
+
+void ShutdownApplication();
+/**
+ * Détruit le contexte ImGui puis la fenêtre
+ */
+
+void MarkInteractive();
+/**
+ * À appeler après la présentation d'une image de l'écran de connexion :
+ * la première fixe Startup().interactiveMs
+ */
+
+#endif // APP_H
@@ -0,0 +1,59 @@
+#ifndef ATOM_PICKER_H
+#define ATOM_PICKER_H
+#include "simulation.h"
+#include <vector>
+
+using namespace std;
+
+// SÉLECTION D'ATOMES À LA SOURIS
+
+/**
+ * @brief Index de lancer de rayons sur les sphères des atomes
+ *
+ * Grille uniforme sur la boîte englobante des sphères, de pas au moins
+ * égal à leur diamètre : chaque atome est inscrit dans les cellules que
+ * touche sa sphère (au plus 8). Pick parcourt les cellules traversées par
+ * le rayon dans l'ordre (3D-DDA d'Amanatides et Woo) et s'arrête dans la
+ * première qui contient un impact plus proche que sa sortie ; le coût ne
+ * dépend que du nombre de cellules traversées, pas du nombre d'atomes.
+ * À reconstruire quand les positions ou le rayon changent.
+ */
+class AtomPicker {
+public:
+  void Build(const vector<Atome> &structure, float radius);
+  /**
+   * Construit la grille, en O(N)
+   * @param structure Atomes (seules les positions sont lues)
+   * @param radius Rayon des sphères affichées
+   */
+
+  int Pick(Ray ray, float *hitDistance = nullptr) const;
+  /**
+   * Premier atome touché par le rayon
+   * @param ray Rayon (direction quelconque, normalisée ici)
+   * @param hitDistance Distance de l'impact le long du rayon (optionnel)
+   * @return Indice de l'atome, ou -1 si le rayon ne touche rien
+   */
+
+  void Clear();
+  bool Empty() const { return centers.empty(); }
+  /// Nombre de cellules de la grille
+  size_t CellCount() const {
+    return cellStart.empty() ? 0 : cellStart.size() - 1;
+  }
+
+private:
+  int CellIndex(int x, int y, int z) const {
+    return (x * ny + y) * nz + z;
+  }
+
+  Vector3 origin = {0, 0, 0}; // Coin minimal de la grille
+  float cellSize = 1.0f;
+  int nx = 0, ny = 0, nz = 0;
+  float radius = 0.5f;
+  vector<int> cellStart;   // Atomes de la cellule c : cellAtoms[start[c]..]
+  vector<int> cellAtoms;   // Indices d'atomes, concaténés par cellule
+  vector<Vector3> centers; // Copie des positions, lue par Pick
+};
+
+#endif // ATOM_PICKER_H
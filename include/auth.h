@@ -1,6 +1,13 @@
 #ifndef AUTH_H
 #define AUTH_H
+#include <string>
 
-bool runAuthentication();
+bool runAuthentication(std::string &user);
+/**
+ * Écran de connexion et d'inscription (comptes de users.db, voir
+ * user_store.h)
+ * @param user Reçoit le nom de l'utilisateur connecté
+ * @return false si la fenêtre a été fermée avant une connexion
+ */
 
 #endif
@@ -0,0 +1,114 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+#include "simulation.h"
+#include "stencil.h"
+#include <string>
+#include <vector>
+
+// CHOIX AUTOMATIQUE DE L'ALGORITHME DE MONTE-CARLO (modèle d'Ising)
+
+/// Algorithmes et noyaux comparés
+enum class UpdateEngine {
+  METROPOLIS_STENCIL, // StencilSweep (bords périodiques)
+  METROPOLIS_CSR,     // DisorderSweep, couplages uniformes (bords ouverts)
+  WOLFF,              // Amas de Wolff (WolffUpdater)
+  REJECTION_FREE,     // Temps continu (RejectionFreeUpdater)
+  PARALLEL_STENCIL,   // NumaLattice : cubique périodique, dimensions paires
+};
+
+const char *UpdateEngineName(UpdateEngine engine);
+/**
+ * Nom court et stable ("wolff", "parallel-stencil"...), aussi utilisé dans
+ * le fichier de cache
+ */
+
+/// Situation pour laquelle un choix reste valable
+struct TuneKey {
+  StructureType type = StructureType::CUBIC;
+  int x = 0, y = 0, z = 0; // Cellules par axe
+  int sites = 0;
+  bool periodic = false;
+  int temperatureBucket = 0; // floor(T / (0.25 |J|))
+  bool field = false;        // B non nul : Wolff doit rejeter des amas
+
+  /// Nom stable (ex. "0-32x32x32-32768-pbc-t18-b0")
+  string Name() const;
+  /// Même réseau, quelle que soit la température
+  bool SameLattice(const TuneKey &other) const;
+  /// Champ par champ : comparée à chaque image, sans passer par Name()
+  bool operator==(const TuneKey &other) const {
+    return SameLattice(other) &&
+           temperatureBucket == other.temperatureBucket &&
+           field == other.field;
+  }
+};
+
+TuneKey MakeTuneKey(StructureType type, int x, int y, int z, int sites,
+                    bool periodic, float temperature, float J, float B);
+/**
+ * Tranches de température de largeur 0.25 |J| : Tc ≈ 4.51 |J| pour le
+ * cubique tombe dans la tranche 18
+ */
+
+/// Mesure d'un candidat
+struct TuneResult {
+  UpdateEngine engine = UpdateEngine::METROPOLIS_CSR;
+  int threads = 1;
+  double updatesPerSecond = 0.0; // Sites mis à jour ou parcourus
+  double autocorrelation = 0.0;  // τ_int en balayages, max sur E et |m|
+  double samplesPerSecond = 0.0; // Échantillons indépendants par seconde
+};
+
+/// Choix retenu pour une clé
+struct TuneDecision {
+  TuneKey key;
+  TuneResult best;
+  vector<TuneResult> candidates; // Tous les essais (vide si relu du cache)
+};
+
+TuneDecision CalibrateEngines(vector<Atome> structure, StencilLattice periodic,
+                              TuneKey key, float temperature, float J,
+                              float B, double secondsPerCandidate = 0.3);
+/**
+ * Essaie chaque candidat applicable sur une copie de la configuration
+ * courante : thermalisation (un cinquième du temps), puis un échantillon
+ * (E, |m|) par balayage ou équivalent. Le critère est le nombre
+ * d'échantillons décorrélés par seconde, balayages/s / (2 τ_int), et non
+ * le débit brut : un amas de Wolff coûte plus qu'un balayage mais en
+ * remplace des centaines près de Tc. τ_int est estimé avec la fenêtre
+ * automatique de Sokal ; une fenêtre qui ne se ferme pas donne une borne
+ * basse pessimiste.
+ * @param structure Atomes (voisins et spins) si key.periodic est faux
+ * @param periodic Réseau implicite avec les spins courants sinon
+ * @param secondsPerCandidate Durée de chaque essai
+ */
+
+/**
+ * @brief Choix déjà mesurés, en mémoire et dans un fichier texte
+ *
+ * Une ligne par clé : nom, moteur, threads et mesures. Un choix demandant
+ * plus de threads que la machine n'en a est ignoré à la relecture.
+ */
+class TuneCache {
+public:
+  explicit TuneCache(string path) : path(move(path)) {}
+
+  /// Choix pour key, ou nullptr s'il faut calibrer
+  const TuneDecision *Find(const TuneKey &key);
+
+  /**
+   * Ajoute ou remplace le choix et réécrit le fichier
+   * @return false si le fichier n'a pas pu être écrit (choix gardé en
+   *         mémoire)
+   */
+  bool Store(const TuneDecision &decision);
+
+private:
+  void Load();
+
+  string path;
+  bool loaded = false;
+  vector<TuneDecision> decisions;
+};
+
+#endif // AUTOTUNE_H
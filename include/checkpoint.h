@@ -0,0 +1,46 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include "simulation.h"
+#include <string>
+
+// POINTS DE REPRISE DE LA CONFIGURATION DE SPINS
+
+/// Paramètres enregistrés avec les spins
+struct CheckpointParams {
+  float temperature = 0.0f;
+  float J = 0.0f;
+  float B = 0.0f;
+  unsigned long long frame = 0; // Image de la sauvegarde
+};
+
+bool WriteCheckpoint(const string &path, const vector<Atome> &structure,
+                     const CheckpointParams &params, string &error);
+/**
+ * Écrit un fichier texte : en-tête "clé valeur", puis une ligne de spins
+ * ('+' / '-') et une ligne de sites figés ('1' / '0'), un caractère par
+ * atome. Le fichier est écrit à côté puis renommé : une lecture concurrente
+ * ne voit jamais de fichier partiel.
+ * @param error Message en cas d'échec
+ * @return true si le fichier est complet
+ */
+
+bool ReadCheckpoint(const string &path, vector<Atome> &structure,
+                    CheckpointParams &params, string &error);
+/**
+ * Recharge les spins et les sites figés d'un point de reprise
+ * @param structure Réseau courant, qui doit avoir le même nombre d'atomes ;
+ *        inchangé en cas d'échec (énergies à recalculer par l'appelant)
+ * @param error Message en cas d'échec
+ */
+
+string NextCheckpointPath(const string &directory, unsigned long long frame);
+/**
+ * Chemin directory/frame-<frame>.ising, dossier créé si besoin
+ */
+
+string LatestCheckpointPath(const string &directory);
+/**
+ * Fichier .ising le plus récent du dossier, ou chaîne vide
+ */
+
+#endif // CHECKPOINT_H
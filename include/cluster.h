@@ -0,0 +1,83 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+#include "lattice_cache.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+// ANALYSE DES AMAS (domaines de même état connectés)
+
+/// Géométrie d'un amas suivi
+struct ClusterGeometry {
+  int root = 0;   // Plus petit indice de site de l'amas
+  int size = 0;   // Nombre de sites
+  Vector3 centroid = {0, 0, 0};
+  Vector3 min = {0, 0, 0}, max = {0, 0, 0}; // Boîte englobante
+  bool spans[3] = {false, false, false};    // Touche les deux faces en x, y, z
+};
+
+/// Résultats d'une analyse
+struct ClusterStats {
+  int occupiedSites = 0;     // Sites d'état non nul
+  int clusterCount = 0;
+  int largestSize = 0;
+  float largestFraction = 0; // largestSize / occupiedSites
+  bool percolates = false;   // Le plus grand amas traverse un axe
+  vector<int> sizeHistogram; // Case b : amas de taille [2^b, 2^(b+1))
+  vector<ClusterGeometry> largest; // Amas suivis, par taille décroissante
+};
+
+/**
+ * @brief Étiquetage des amas par union-find parallèle (Hoshen-Kopelman)
+ *
+ * Deux sites voisins de même état non nul appartiennent au même amas.
+ * Chaque thread unit d'abord les liaisons internes à sa tranche de sites,
+ * puis les liaisons entre tranches ; l'union se fait par compare-and-swap
+ * sur un tableau de parents atomiques, la racine étant toujours le plus
+ * petit indice. Les tampons sont gardés entre deux appels : aucune
+ * allocation tant que le nombre de sites ne grandit pas.
+ */
+class ClusterAnalyzer {
+public:
+  static constexpr int maxTrackedClusters = 64;
+
+  /// @param trackedClusters Nombre d'amas dont on calcule la géométrie
+  explicit ClusterAnalyzer(int trackedClusters = 16);
+
+  /**
+   * Étiquette les amas et calcule leurs statistiques
+   * @param topology Positions et voisins (voir ToTopology)
+   * @param states État par site (0 : site vide, ignoré)
+   * @return Statistiques, valides jusqu'au prochain appel
+   */
+  const ClusterStats &Analyze(const LatticeTopology &topology,
+                              const int8_t *states);
+
+  /// Racine de l'amas de chaque site (-1 pour un site vide)
+  const vector<int> &Labels() const { return labels; }
+
+  const ClusterStats &Stats() const { return stats; }
+
+private:
+  int Find(int site);
+  void UniteLocal(int a, int b);
+  void Unite(int a, int b);
+  void InsertTracked(int root, int rank);
+  int TrackedSlot(int root) const;
+  void ClearTracked();
+  void EnsureCapacity(int siteCount);
+
+  int trackedClusters;
+  unique_ptr<atomic<int>[]> parent;
+  int capacity = 0;
+  vector<int> labels;
+  unique_ptr<atomic<int>[]> sizes; // Taille par racine
+  static constexpr int trackedTableSize = 128; // Table racine -> rang
+  int trackedRoots[trackedTableSize];
+  int trackedRanks[trackedTableSize];
+  vector<pair<int, int>> clusters; // (taille, racine)
+  mutex mergeMutex;
+  ClusterStats stats;
+};
+
+#endif // CLUSTER_H
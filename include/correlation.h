@@ -0,0 +1,109 @@
+#ifndef CORRELATION_H
+#define CORRELATION_H
+#include "fft.h"
+#include "simulation.h"
+#include <mutex>
+
+// CORRÉLATIONS SPIN-SPIN ET FACTEUR DE STRUCTURE
+
+/// Méthode de calcul choisie par CorrelationAnalyzer::Setup
+enum class CorrelationMethod {
+  GRID_FFT, // Sites sur une grille cubique d'indices : FFT 3D
+  CELL_LIST // Autres réseaux : paires jusqu'à maxRadius par listes de cellules
+};
+
+/// Moyennes sur les échantillons accumulés
+struct CorrelationResult {
+  int samples = 0;
+  vector<float> radii;           // Distance moyenne des paires de chaque classe
+  vector<float> correlation;     // G(r) = <s_i.s_j> - |<s>|², connexe
+  vector<float> wavenumbers;     // |k| au centre de chaque classe
+  vector<float> structureFactor; // S(|k|) connexe, moyenne sphérique
+  float susceptibility = 0;      // S(0) = N (<m²> - |<m>|²)
+  float correlationLength = 0;   // Estimateur du second moment (0 : indéfini)
+};
+
+/**
+ * @brief Fonction de corrélation G(r) et facteur de structure S(k)
+ *
+ * Les spins sont des vecteurs (Ising : axe y, Potts : vecteur plan de
+ * l'état) ; une lacune a un vecteur nul. Si les positions tombent sur une
+ * grille cubique de pas step (cubique, BCC et FCC avec step = a/2), S(k)
+ * vient d'une FFT 3D par composante, et G(r) de la transformée inverse de
+ * la moyenne de |s(k)|², divisée par le nombre de paires à chaque
+ * déplacement. Sinon les paires à moins de maxRadius sont parcourues par
+ * listes de cellules et S(k) suit de la formule de Debye. G(r), S(k),
+ * S(0) et la longueur de corrélation sont tous connexes : le spin moyen
+ * <s> des échantillons est retiré de chaque paire.
+ */
+class CorrelationAnalyzer {
+public:
+  /**
+   * Prépare l'analyse d'un réseau et vide l'accumulation
+   * @param positions Position de chaque site
+   * @param step Pas de la grille d'indices (0 : listes de cellules)
+   * @param periodic Bords périodiques (grille seulement)
+   * @param binWidth Largeur des classes de distance
+   * @param maxRadius Portée de G(r) (0 : moitié de la plus petite arête)
+   */
+  void Setup(const vector<Vector3> &positions, float step, bool periodic,
+             float binWidth, float maxRadius = 0.0f);
+
+  /// Oublie les échantillons accumulés (géométrie conservée)
+  void Reset();
+
+  /**
+   * Ajoute une configuration à la moyenne
+   * @param spins Vecteur de spin par site, dans l'ordre de Setup
+   */
+  void Accumulate(const vector<Vector3> &spins);
+
+  /// Moyennes courantes (recalculées seulement après un Accumulate)
+  const CorrelationResult &Result();
+
+  CorrelationMethod Method() const { return method; }
+  int Samples() const { return samples; }
+
+private:
+  void SetupGrid(const vector<Vector3> &positions, Vector3 origin);
+  void SetupCells(const vector<Vector3> &positions, Vector3 origin,
+                  Vector3 extent);
+  void AccumulateGrid(const vector<Vector3> &spins, int components);
+  void AccumulateCells(const vector<Vector3> &spins);
+  void ResultGrid(double meanSquare);
+  void ResultCells(double meanSquare);
+
+  CorrelationMethod method = CorrelationMethod::CELL_LIST;
+  int siteCount = 0;
+  float step = 0, binWidth = 1, maxRadius = 0;
+  bool periodic = false;
+  int samples = 0;
+  double magnetizationSums[3] = {}; // Somme de sum s_i / N par composante
+  vector<double> pairCounts;        // Paires (ordonnées) par classe de r
+  vector<double> radiusSums;        // Somme des distances par classe
+  CorrelationResult result;
+  bool dirty = false;
+  // Tampons de Result(), gardés pour ne pas allouer à chaque image
+  vector<double> shellSums;   // Grille : somme de S(k) par couche de |k|
+  vector<int> shellCounts;    // Grille : vecteurs k par couche
+  vector<float> binRadii;     // Listes : distance moyenne par classe
+  vector<double> binProducts; // Listes : G connexe par classe, pondéré
+
+  // Grille : indice de grille par site, spectres et comptage de paires
+  int nx = 0, ny = 0, nz = 0;      // Étendue des sites sur la grille
+  FFT3D fft;
+  vector<int> gridIndex;
+  vector<Complex> packed[2];       // (x + iy) et z
+  vector<double> power;            // Somme de sum_c |s_c(k)|²
+  vector<double> occupancy;        // |o(k)|² des sites occupés
+  vector<Complex> transform;       // Tampon de la transformée inverse
+
+  // Listes de cellules : sites triés par cellule
+  int cx = 0, cy = 0, cz = 0;
+  vector<int> cellStart, cellSites;
+  vector<Vector3> sortedPositions, sortedSpins;
+  vector<double> products;         // Somme de s_i.s_j par classe
+  mutex mergeMutex;
+};
+
+#endif // CORRELATION_H
@@ -0,0 +1,71 @@
+#ifndef DIPOLAR_H
+#define DIPOLAR_H
+#include "fft.h"
+#include "stencil.h"
+
+/// Conditions aux limites du champ dipolaire
+enum class DipolarBoundary {
+  OPEN,    // Échantillon fini (champ démagnétisant), grille doublée
+  PERIODIC // Boîte répétée : somme sur les 26 images voisines
+};
+
+/**
+ * @brief Champ dipolaire à longue portée d'un réseau périodique
+ *
+ * Moments d'Ising portés par l'axe z. Pour une paire i, j à distance r
+ * (en unités de cellule) : E = g s_i s_j (1 - 3 cos²θ) / r³. Le champ
+ * effectif h_i = -dE/ds_i est une convolution des spins par un noyau fixe,
+ * évaluée par FFT en O(N log N) pour tous les sites à la fois. Un réseau à
+ * B sites par cellule donne B sous-grilles et B(B+1)/2 noyaux transformés,
+ * calculés une fois par géométrie.
+ */
+class DipolarField {
+public:
+  /**
+   * Prépare les noyaux si la géométrie ou les bords ont changé
+   * @param lattice Réseau (cubique, BCC ou FCC)
+   * @param boundary Conditions aux limites
+   * @return Faux si le type de réseau n'est pas supporté
+   */
+  bool Setup(const StencilLattice &lattice, DipolarBoundary boundary);
+
+  /**
+   * Recalcule le champ de tous les sites pour les spins actuels
+   * @param lattice Réseau passé à Setup
+   * @param strength Intensité g du couplage dipolaire (unités de J)
+   */
+  void Update(const StencilLattice &lattice, float strength);
+
+  /// Champ effectif par site (même indice que lattice.spins)
+  const float *Data() const { return field.data(); }
+
+  /// Énergie dipolaire du champ courant : -1/2 sum s_i h_i
+  float Energy(const StencilLattice &lattice) const;
+
+private:
+  StructureType type = StructureType::CUBIC;
+  int lx = 0, ly = 0, lz = 0, basisCount = 0;
+  DipolarBoundary boundary = DipolarBoundary::OPEN;
+  FFT3D fft;
+  vector<vector<Complex>> kernels; // Paires a <= b, rangées ligne par ligne
+  vector<vector<Complex>> spinGrids;
+  vector<Complex> accumulator;
+  vector<float> field;
+};
+
+int DipolarSweep(StencilLattice &lattice, DipolarField &dipolar,
+                 float strength, float temperature, float J, float B,
+                 mt19937 &rng);
+/**
+ * Balayage complet en damier avec interaction dipolaire
+ * Le champ dipolaire est recalculé avant chaque couleur et reste figé
+ * pendant la demi-passe : un coût O(log N) amorti par retournement.
+ * @param lattice Réseau à mettre à jour
+ * @param dipolar Champ préparé par Setup pour ce réseau
+ * @param strength Intensité g du couplage dipolaire
+ * @param temperature,J,B Paramètres du modèle d'Ising
+ * @param rng Générateur du thread appelant
+ * @return Nombre de retournements acceptés
+ */
+
+#endif // DIPOLAR_H
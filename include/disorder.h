@@ -0,0 +1,139 @@
+#ifndef DISORDER_H
+#define DISORDER_H
+#include "stencil.h"
+#include <cstdint>
+#include <string>
+
+// DÉSORDRE GELÉ : COUPLAGES ALÉATOIRES ET DILUTION
+
+/// Distribution des couplages J_ij (en unités de J)
+enum class BondDisorder {
+  UNIFORM,    // J_ij = 1
+  PLUS_MINUS, // J_ij = -1 avec la probabilité antiferroFraction, +1 sinon
+  GAUSSIAN    // J_ij ~ N(mean, spread²)
+};
+
+/// Paramètres d'une réalisation du désordre
+struct DisorderParams {
+  BondDisorder bonds = BondDisorder::UNIFORM;
+  float antiferroFraction = 0.5f; // ±J
+  float mean = 0.0f;              // Gaussienne
+  float spread = 1.0f;            // Gaussienne
+  float vacancyFraction = 0.0f;   // Proportion de sites vides
+  uint32_t seed = 1;              // Même graine : même réalisation
+};
+
+/**
+ * @brief Réseau d'Ising avec couplage par liaison et lacunes
+ *
+ * Voisins au format CSR. Les couplages entiers (±J, uniforme) sont
+ * stockés en int8 à côté des indices et le champ local reste entier, ce
+ * qui permet une table d'acceptation ; les autres en float. Une lacune a
+ * un spin 0 : elle ne contribue à aucun champ sans test dans la boucle des
+ * voisins, et n'est jamais comptée comme retournement.
+ */
+struct DisorderedLattice {
+  vector<int> offsets;   // Voisins de i : neighbors[offsets[i]..[i+1]]
+  vector<int> neighbors; // Indices des voisins, concaténés
+  vector<int8_t> signs;  // Couplages entiers par liaison (si integerBonds)
+  vector<float> weights; // Couplages réels par liaison (sinon)
+  vector<int8_t> spins;  // +1 / -1, 0 pour une lacune
+  vector<uint8_t> pinned; // 1 : site figé (vide : aucun, voir CopyPinned)
+  bool integerBonds = true;
+  int maxDegree = 0;
+
+  // Table d'acceptation du dernier (T, J, B), reconstruite s'ils changent
+  AcceptanceTable table;
+  float tableT = -1.0f, tableJ = 0.0f, tableB = 0.0f;
+};
+
+DisorderedLattice MakeDisorderedLattice(const vector<Atome> &structure,
+                                        const DisorderParams &params);
+/**
+ * Tire une réalisation du désordre sur la topologie d'un réseau
+ * Le tirage est une fonction de hachage de (graine, i, j) : J_ij = J_ji
+ * sans table de paires, et la réalisation ne dépend pas de l'ordre.
+ * Les couplages par couche (Atome::coupling) multiplient J_ij.
+ * @param structure Atomes (voisins, couplages, spins initiaux et sites
+ *        figés)
+ * @param params Distribution et graine
+ * @return Réseau avec les spins des atomes, lacunes à 0
+ */
+
+DisorderedLattice MakeDisorderedLattice(const StencilLattice &lattice);
+/**
+ * Liste les voisins périodiques d'un réseau à voisins implicites
+ * Couplages uniformes, sans lacune, même ordre des sites : les noyaux CSR
+ * (amas, temps continu) simulent alors le même système que StencilSweep.
+ * @param lattice Réseau source (spins et sites figés copiés)
+ */
+
+bool HasDisorder(const DisorderParams &params);
+/**
+ * Vrai si les paramètres s'écartent du réseau uniforme sans lacune
+ */
+
+int DisorderSweep(DisorderedLattice &lattice, int first, int count,
+                  float temperature, float J, float B, mt19937 &rng);
+/**
+ * Mises à jour de Metropolis des sites [first, first + count), avec repli
+ * @return Nombre de retournements acceptés (lacunes exclues)
+ */
+
+void CopySpins(const vector<Atome> &structure, DisorderedLattice &lattice);
+/**
+ * Copie les spins et les sites figés des atomes, les lacunes restent à 0
+ */
+
+void CopySpins(const DisorderedLattice &lattice, vector<Atome> &structure,
+               float J, float B);
+/**
+ * Recopie les spins vers les atomes et met à jour leur énergie
+ * (énergie nulle pour une lacune, dont le spin affiché est sans objet)
+ */
+
+double DisorderEnergy(const DisorderedLattice &lattice, float J, float B);
+/**
+ * Énergie totale, chaque liaison comptée une fois (lacunes exclues)
+ */
+
+/// Moyennes sur plusieurs réalisations du désordre
+struct DisorderAverage {
+  int realizations = 0;
+  float magnetization = 0.0f;      // <|m|> par site occupé
+  float magnetizationError = 0.0f; // Erreur type entre réalisations
+  float energy = 0.0f;             // <E> par site occupé
+  float overlap2 = 0.0f;           // <q²>, q recouvrement de deux répliques
+  float binder = 0.0f;             // g = (3 - <q⁴>/<q²>²) / 2
+};
+
+DisorderAverage AverageOverDisorder(const vector<Atome> &structure,
+                                    DisorderParams params, int realizations,
+                                    int sweeps, float temperature, float J,
+                                    float B);
+/**
+ * Simule des réalisations indépendantes en parallèle (groupe de threads
+ * partagé), deux répliques chacune ; la première moitié des balayages sert
+ * à la thermalisation. Réalisation r : graine params.seed + r.
+ * Ne pas appeler depuis une tâche du groupe partagé.
+ */
+
+/// Débit d'un noyau mesuré par MeasureDisorderPenalty
+struct KernelThroughput {
+  string name;
+  double nsPerUpdate = 0.0;
+  double penalty = 1.0; // Rapport au premier noyau de la liste
+};
+
+vector<KernelThroughput> MeasureDisorderPenalty(const vector<Atome> &structure,
+                                                StencilLattice stencil,
+                                                float temperature, float J,
+                                                float B);
+/**
+ * Compare le coût d'une mise à jour : noyau à voisins implicites (si
+ * stencil correspond à structure), CSR uniforme, ±J int8, ±J dilué et
+ * gaussien float
+ * @return Un résultat par noyau, le premier sert de référence
+ */
+
+#endif // DISORDER_H
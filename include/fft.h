@@ -0,0 +1,79 @@
+#ifndef FFT_H
+#define FFT_H
+#include <complex>
+#include <vector>
+
+using namespace std;
+
+using Complex = complex<float>;
+
+/**
+ * @brief Transformée de Fourier 1D d'une taille fixe
+ *
+ * Radix-2 itératif pour les puissances de deux ; les autres tailles passent
+ * par l'algorithme de Bluestein (convolution de taille puissance de deux).
+ * Les tables (bit-reverse, facteurs de rotation, chirp) sont calculées une
+ * seule fois à la construction.
+ */
+class FFTPlan {
+public:
+  FFTPlan() = default;
+  explicit FFTPlan(int size);
+
+  int Size() const { return size; }
+
+  /**
+   * Transforme data en place (non normalisé)
+   * @param data size valeurs contiguës
+   * @param inverse Transformée inverse (exposant positif)
+   * @param scratch Tampon de travail réutilisable (Bluestein seulement)
+   */
+  void Transform(Complex *data, bool inverse, vector<Complex> &scratch) const;
+
+private:
+  void Radix2(Complex *data, bool inverse) const;
+
+  int size = 0;
+  bool powerOfTwo = true;
+  vector<int> bitReverse;
+  vector<Complex> twiddles; // exp(-2i pi k / size), k < size/2
+
+  // Bluestein : chirp exp(-i pi k^2 / size) et son noyau transformé
+  vector<FFTPlan> padded;   // Plan de taille puissance de deux (0 ou 1)
+  vector<Complex> chirp;
+  vector<Complex> chirpKernel;
+};
+
+/**
+ * @brief Transformée 3D sur une grille nx*ny*nz (z contigu)
+ *
+ * Chaque axe est traité en parallèle sur le groupe de threads partagé.
+ * Les axes non contigus sont copiés par tuiles de lignes dans un tampon
+ * local pour rester dans le cache.
+ */
+class FFT3D {
+public:
+  FFT3D() = default;
+  FFT3D(int nx, int ny, int nz);
+
+  int NX() const { return nx; }
+  int NY() const { return ny; }
+  int NZ() const { return nz; }
+
+  /// Transformée directe en place
+  void Forward(vector<Complex> &grid) const;
+
+  /// Transformée inverse en place, normalisée par nx*ny*nz
+  void Inverse(vector<Complex> &grid) const;
+
+private:
+  void Apply(vector<Complex> &grid, bool inverse) const;
+
+  int nx = 0, ny = 0, nz = 0;
+  FFTPlan planX, planY, planZ;
+};
+
+/// Plus petite puissance de deux supérieure ou égale à n
+int NextPowerOfTwo(int n);
+
+#endif // FFT_H
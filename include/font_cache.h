@@ -0,0 +1,34 @@
+#ifndef FONT_CACHE_H
+#define FONT_CACHE_H
+#include <string>
+
+using namespace std;
+
+// POLICE DE L'INTERFACE ET CACHE DE L'ATLAS RASTÉRISÉ
+
+/// Origine de la police chargée par LoadInterfaceFont
+struct FontAtlasStatus {
+  string fontPath;   // Fichier TTF trouvé ("" : police par défaut d'ImGui)
+  string cachePath;  // Fichier de l'atlas en cache
+  bool fromCache = false;
+  double milliseconds = 0.0; // Chargement ou rastérisation, envoi compris
+};
+
+string FindAssetFile(const char *name);
+/**
+ * Cherche assets/name à côté de l'exécutable, dans son dossier parent
+ * (exécutable dans build/), puis depuis le dossier courant
+ * @return Chemin du fichier, ou chaîne vide s'il est introuvable
+ */
+
+FontAtlasStatus LoadInterfaceFont(const char *fileName, float sizePixels);
+/**
+ * Remplace les polices d'ImGui par fileName à la taille sizePixels
+ * L'atlas (pixels et métriques des glyphes) est relu depuis le cache
+ * disque quand sa clé correspond (chemin, taille et date du TTF, taille
+ * demandée, version d'ImGui) ; sinon la police est rastérisée et le cache
+ * réécrit. La texture de rlImGui est rechargée dans les deux cas.
+ * À appeler une fois, après rlImGuiSetup.
+ */
+
+#endif // FONT_CACHE_H
@@ -0,0 +1,62 @@
+#ifndef FRAME_BUDGET_H
+#define FRAME_BUDGET_H
+#include <cstddef>
+
+// BUDGET DE TEMPS PAR IMAGE POUR LE MONTE-CARLO
+
+/**
+ * @brief Choisit le nombre de mises à jour qui tient dans une tranche
+ * de l'image
+ *
+ * Le coût d'une mise à jour est mesuré à chaque image (durée totale du
+ * bloc de simulation / mises à jour faites) et lissé ; les frais fixes
+ * par image (copies, énergies) y sont inclus, si bien que l'itération
+ * converge vers une durée de bloc égale au budget. Le coût est oublié
+ * quand le noyau ou la taille du réseau change, et la croissance est
+ * limitée d'une image à l'autre pour ne pas dépasser le budget après une
+ * mesure trop optimiste.
+ */
+class FrameBudget {
+public:
+  /**
+   * Nombre de mises à jour pour l'image qui commence
+   * @param kernel Identifiant du noyau actif (modèle, bords, désordre...)
+   * @param siteCount Nombre de sites du réseau
+   * @param budgetSeconds Durée visée du bloc de simulation
+   */
+  int Plan(int kernel, size_t siteCount, double budgetSeconds);
+
+  /**
+   * Enregistre le bloc de simulation de l'image
+   * @param updates Mises à jour de spin effectuées
+   * @param seconds Durée du bloc
+   * @param now Horloge murale (secondes), pour les débits affichés
+   */
+  void Record(double updates, double seconds, double now);
+
+  /// Mises à jour par seconde de calcul (débit du noyau)
+  double KernelRate() const { return kernelRate; }
+
+  /// Mises à jour par seconde murale, moyenne sur la dernière seconde
+  double AchievedRate() const { return achievedRate; }
+
+  /// Balayages par seconde murale (pas MC par site et par seconde)
+  double SweepsPerSecond() const {
+    return siteCount ? achievedRate / siteCount : 0.0;
+  }
+
+  /// Durée lissée du bloc de simulation (secondes)
+  double BlockSeconds() const { return blockSeconds; }
+
+private:
+  int kernel = -1;
+  size_t siteCount = 0;
+  double secondsPerUpdate = 0.0; // 0 : pas encore mesuré
+  double blockSeconds = 0.0;
+  int lastPlan = 1;
+
+  double kernelRate = 0.0, achievedRate = 0.0;
+  double windowStart = -1.0, windowUpdates = 0.0;
+};
+
+#endif // FRAME_BUDGET_H
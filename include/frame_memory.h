@@ -0,0 +1,104 @@
+#ifndef FRAME_MEMORY_H
+#define FRAME_MEMORY_H
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+// MÉMOIRE DE L'IMAGE : ARÈNE REMISE À ZÉRO ET HISTORIQUE CIRCULAIRE
+
+/**
+ * @brief Allocateur linéaire pour les données qui ne vivent qu'une image
+ *
+ * Allocate() avance un curseur dans un bloc unique et Reset() le ramène au
+ * début : rien n'est libéré un par un. Une image qui dépasse le bloc
+ * alloue des blocs de débordement ; le Reset() suivant les remplace par un
+ * seul bloc assez grand, si bien que le régime établi n'alloue plus.
+ */
+class FrameArena {
+public:
+  explicit FrameArena(size_t capacity = 64 * 1024);
+
+  void Reset();
+  /**
+   * Libère tout ce qui a été alloué depuis le dernier Reset()
+   * Les pointeurs rendus auparavant deviennent invalides.
+   */
+
+  void *Allocate(size_t size, size_t alignment);
+  /**
+   * Réserve size octets alignés, valables jusqu'au prochain Reset()
+   */
+
+  /// Tableau non initialisé de count éléments (types triviaux seulement)
+  template <typename T> T *Allocate(size_t count) {
+    static_assert(is_trivially_destructible<T>::value,
+                  "Reset() never runs destructors");
+    return static_cast<T *>(Allocate(count * sizeof(T), alignof(T)));
+  }
+
+  const char *Format(const char *format, ...);
+  /**
+   * Chaîne formatée comme printf, valable jusqu'au prochain Reset()
+   * Remplace les std::string construites pour un libellé ImGui.
+   */
+
+  /// Octets utilisés depuis le dernier Reset()
+  size_t Used() const { return used + overflowBytes; }
+  /// Taille du bloc principal
+  size_t Capacity() const { return capacity; }
+
+private:
+  unique_ptr<max_align_t[]> block;
+  size_t capacity = 0;
+  size_t used = 0;
+  vector<unique_ptr<max_align_t[]>> overflow; // Blocs de l'image en cours
+  size_t overflowBytes = 0;
+  size_t overflowUsed = 0; // Curseur dans overflow.back()
+  size_t overflowSize = 0; // Taille de overflow.back()
+};
+
+/**
+ * @brief File de capacité fixe qui écrase ses plus anciens éléments
+ *
+ * Le stockage est alloué une fois à la construction. Data() et Offset()
+ * se passent tels quels à ImGui::PlotLines (values_offset), sans copie :
+ * tant que la file n'est pas pleine, Offset() vaut 0.
+ */
+template <typename T> class RingBuffer {
+public:
+  explicit RingBuffer(size_t capacity) : items(capacity > 0 ? capacity : 1) {}
+
+  /// Ajoute un élément, en écrasant le plus ancien si la file est pleine
+  void Push(const T &value) {
+    items[(start + count) % items.size()] = value;
+    if (count < items.size())
+      count++;
+    else
+      start = (start + 1) % items.size();
+  }
+
+  void Clear() { start = count = 0; }
+  bool Empty() const { return count == 0; }
+  size_t Size() const { return count; }
+  size_t Capacity() const { return items.size(); }
+
+  /// i-ème élément, du plus ancien (0) au plus récent (Size() - 1)
+  const T &operator[](size_t i) const {
+    return items[(start + i) % items.size()];
+  }
+  const T &Back() const { return (*this)[count - 1]; }
+
+  /// Stockage brut : Size() éléments, le plus ancien à l'indice Offset()
+  const T *Data() const { return items.data(); }
+  size_t Offset() const { return start; }
+
+private:
+  vector<T> items;
+  size_t start = 0;
+  size_t count = 0;
+};
+
+#endif // FRAME_MEMORY_H
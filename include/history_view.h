@@ -0,0 +1,33 @@
+#ifndef HISTORY_VIEW_H
+#define HISTORY_VIEW_H
+#include "imgui.h"
+#include "time_series.h"
+
+/**
+ * @brief Tracé ImGui d'une TimeSeries sur toute sa longueur
+ *
+ * Les points du niveau adapté à la largeur du tracé sont réduits par LTTB
+ * à un point par pixel ; l'enveloppe min/max de chaque point est dessinée
+ * en transparence sous la courbe des moyennes. Le coût ne dépend que de la
+ * largeur, pas de la durée de l'historique. Les tableaux de travail sont
+ * gardés d'un tracé à l'autre.
+ */
+class HistoryView {
+public:
+  /**
+   * Dessine une série dans la fenêtre courante
+   * @param label Titre affiché au-dessus du tracé
+   * @param series Série à tracer
+   * @param height Hauteur du tracé (pixels)
+   * @param color Couleur de la courbe
+   */
+  void Draw(const char *label, const TimeSeries &series, float height,
+            ImU32 color);
+
+private:
+  vector<SeriesPoint> gathered; // Points du niveau choisi
+  vector<SeriesPoint> line;     // Après LTTB
+  vector<ImVec2> polyline;
+};
+
+#endif // HISTORY_VIEW_H
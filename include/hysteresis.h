@@ -0,0 +1,123 @@
+#ifndef HYSTERESIS_H
+#define HYSTERESIS_H
+#include "disorder.h"
+#include "thread_pool.h"
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+
+// BOUCLES D'HYSTÉRÉSIS M(B)
+
+/// Programme du champ et règle d'arrêt de chaque point
+struct HysteresisSettings {
+  float maxField = 4.0f;  // Le champ va de +maxField à -maxField et retour
+  float fieldStep = 0.2f; // Pas du champ (unités de J)
+  int cycles = 1;         // Nombre d'allers-retours
+  int minSweeps = 32;     // Balayages minimum par point
+  int maxSweeps = 4000;   // Plafond par point (états métastables)
+  float independentSamples = 20.0f; // Mesures indépendantes visées par point
+};
+
+/// Un point d'équilibre de la boucle
+struct HysteresisPoint {
+  float field = 0.0f;
+  float magnetization = 0.0f; // m par site occupé, moyenne de la mesure
+  float error = 0.0f;         // Erreur corrigée de l'autocorrélation
+  float tau = 0.0f;           // Temps d'autocorrélation intégré (balayages)
+  int sweeps = 0;             // Balayages effectués pour ce point
+  bool descending = true;     // Branche B décroissant
+};
+
+/// Boucle d'une température et d'une graine
+struct HysteresisLoop {
+  float temperature = 0.0f;
+  uint32_t seed = 0;
+  int plannedPoints = 0; // Taille du programme de champ
+  vector<HysteresisPoint> points;
+  float coerciveField = 0.0f; // |B| où m s'annule, moyenne des deux branches
+  float remanence = 0.0f;     // |m| à B = 0, moyenne des deux branches
+  bool complete = false;
+};
+
+float IntegratedAutocorrelationTime(const float *series, int count,
+                                    float window = 6.0f);
+/**
+ * Temps d'autocorrélation intégré tau = 1/2 + sum_t rho(t)
+ * La somme s'arrête à la première fenêtre t >= window * tau (Sokal).
+ * @param series Mesures successives (une par balayage)
+ * @param count Nombre de mesures
+ * @return tau en balayages (1/2 pour une série sans corrélation ou constante)
+ */
+
+void ExtractLoopFeatures(HysteresisLoop &loop);
+/**
+ * Champ coercitif et rémanence du dernier cycle, par interpolation linéaire
+ * entre les points qui encadrent m = 0 et B = 0 sur chaque branche
+ */
+
+/**
+ * @brief Balayages en champ de plusieurs boucles indépendantes
+ *
+ * Chaque boucle part de l'état saturé à +maxField et garde sa
+ * configuration d'un point à l'autre (démarrage à chaud). Un point est
+ * équilibré quand la seconde moitié de sa série contient assez de mesures
+ * indépendantes ; la première moitié sert de thermalisation. Les boucles
+ * tournent en parallèle sur un groupe de threads propre au balayage (un
+ * thread par boucle, un cœur laissé au rendu), une tâche par point :
+ * chaque tâche soumet le point suivant de sa boucle. Un point peut durer
+ * maxSweeps balayages ; sur le groupe partagé, il retarderait d'autant les
+ * ParallelFor du thread de rendu (dipolaire, amas, corrélations). Les
+ * points sont publiés au fur et à mesure.
+ */
+class HysteresisSweep {
+public:
+  HysteresisSweep();
+  ~HysteresisSweep();
+
+  /**
+   * Lance les boucles en arrière-plan (annule un calcul en cours)
+   * @param structure Réseau (voisins et couplages par couche)
+   * @param disorder Désordre ; boucle k : graine disorder.seed + k
+   * @param J Couplage
+   * @param temperatures Température de chaque boucle
+   * @param settings Programme de champ et règle d'arrêt
+   */
+  void Start(const vector<Atome> &structure, const DisorderParams &disorder,
+             float J, const vector<float> &temperatures,
+             const HysteresisSettings &settings);
+
+  /// Demande l'arrêt et attend la fin des boucles
+  void Cancel();
+
+  bool Running() const;
+
+  /**
+   * Copie des boucles, points publiés jusqu'ici compris
+   * @param out Remplacé ; ses tableaux sont réutilisés entre deux appels
+   */
+  void Snapshot(vector<HysteresisLoop> &out) const;
+
+private:
+  struct LoopState; // Réseau, générateur et position dans le programme
+
+  void SubmitPoint(int index);
+  void RunPoint(int index);
+  void FinishLoop();
+
+  vector<Atome> structure;
+  DisorderParams disorder;
+  float coupling = 1.0f;
+  HysteresisSettings settings;
+  vector<pair<float, bool>> schedule; // Champ et branche de chaque point
+  vector<unique_ptr<LoopState>> states;
+
+  mutable mutex loopsMutex;
+  condition_variable loopsDone;
+  vector<HysteresisLoop> loops;
+  int activeLoops = 0;
+  bool cancelled = false;
+  // Last: its workers are joined before the members they touch go away
+  unique_ptr<ThreadPool> pool;
+};
+
+#endif // HYSTERESIS_H
@@ -6,21 +6,8 @@
 
 inline void SetCustomImGuiStyle(float scaling = 1.5f) {
   ImGuiStyle &style = ImGui::GetStyle();
-  ImGuiIO &io = ImGui::GetIO();
 
-  io.Fonts->Clear();
-
-  // Configure font settings for better rendering
-  ImFontConfig fontConfig;
-  fontConfig.OversampleH = 2;   // Horizontal oversampling
-  fontConfig.OversampleV = 2;   // Vertical oversampling
-  fontConfig.PixelSnapH = true; // Snap to pixel boundaries
-
-  // Load font with improved settings
-  io.Fonts->AddFontFromFileTTF("/home/moad/desktop/cpp/crist-project/assets/"
-                               "JetBrainsMonoNLNerdFont-Regular.ttf",
-                               18.0f * scaling, // Scale the base font size
-                               &fontConfig);
+  // The font itself is loaded once by LoadInterfaceFont (font_cache.h)
   // Basic scaling (don't use FontGlobalScale when scaling the font directly)
   style.ScaleAllSizes(scaling);
   // io.FontGlobalScale = 1.0f; // Uncomment if you prefer using FontGlobalScale
@@ -125,11 +112,6 @@ inline void SetCustomImGuiStyle(float scaling = 1.5f) {
   style.Colors[ImGuiCol_TitleBg] = ImVec4(0.09f, 0.10f, 0.11f, 1.00f);
   style.Colors[ImGuiCol_TitleBgActive] = ImVec4(0.13f, 0.14f, 0.15f, 1.00f);
 
-  // Rebuild font atlas
-  unsigned char *pixels;
-  int width, height;
-  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
-  // rlImGui will handle the texture upload automatically
 }
 
 #endif // IMGUI_STYLE_H
@@ -0,0 +1,135 @@
+#ifndef ISING_H
+#define ISING_H
+#include <stddef.h>
+#include <stdint.h>
+
+// API C DU MOTEUR D'ISING (libising.so)
+//
+// Chaque simulation est un objet opaque sans état partagé : plusieurs
+// instances tournent en parallèle, une par thread. Une même instance n'est
+// pas protégée contre des appels concurrents.
+
+#if defined(_WIN32)
+#define ISING_API __declspec(dllexport)
+#else
+#define ISING_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Version de l'ABI, incrémentée à chaque changement incompatible
+#define ISING_API_VERSION 1
+
+typedef struct IsingSimulation IsingSimulation;
+
+/// Codes de retour (0 : succès)
+typedef enum IsingStatus {
+  ISING_OK = 0,
+  ISING_ERROR_ARGUMENT = -1,    // Pointeur nul, taille ou valeur invalide
+  ISING_ERROR_UNSUPPORTED = -2, // Réseau sans bords périodiques possibles
+  ISING_ERROR_MEMORY = -3,      // Allocation impossible
+} IsingStatus;
+
+/// Types de réseau (mêmes valeurs que StructureType)
+typedef enum IsingLattice {
+  ISING_LATTICE_CUBIC = 0,
+  ISING_LATTICE_HEXAGONAL = 1, // Bords ouverts uniquement
+  ISING_LATTICE_FCC = 2,
+  ISING_LATTICE_BCC = 3,
+} IsingLattice;
+
+/// Description du réseau à construire
+typedef struct IsingLatticeDesc {
+  IsingLattice lattice;
+  int nx, ny, nz; // Cellules par axe, comme make_*_struc
+  int periodic;   // 1 : bords périodiques (cubique, FCC, BCC)
+  uint64_t seed;  // Graine du générateur de l'instance
+} IsingLatticeDesc;
+
+/// Observables de la configuration courante
+typedef struct IsingObservables {
+  double energy;        // Énergie totale, chaque liaison comptée une fois
+  double magnetization; // Somme des spins / nombre de sites, dans [-1, 1]
+  double acceptance;    // Retournements acceptés / tentés depuis le début
+  uint64_t sweeps;      // Balayages effectués
+  int64_t sites;
+} IsingObservables;
+
+/**
+ * Vue sur les spins de la simulation, sans copie
+ * Le spin du site s (+1 ou -1) est l'octet data[s * stride]. Avec des bords
+ * périodiques, s = ((i * ny + j) * nz + k) * basis + b pour la cellule
+ * (i, j, k) et le site b de la base ; sinon l'ordre est celui de
+ * make_*_struc. Le pointeur reste valide jusqu'à ising_destroy ; les
+ * valeurs changent pendant ising_sweep.
+ */
+typedef struct IsingSpinView {
+  const int8_t *data;
+  size_t count;
+  ptrdiff_t stride; // En octets
+  int cells[3];     // nx, ny, nz
+  int basis;        // Sites par cellule
+} IsingSpinView;
+
+ISING_API int ising_api_version(void);
+/**
+ * ISING_API_VERSION de la bibliothèque chargée
+ */
+
+ISING_API IsingStatus ising_create(const IsingLatticeDesc *desc,
+                                   IsingSimulation **simulation);
+/**
+ * Construit le réseau, tous les spins à +1, T = 2.5, J = 1, B = 0
+ * @param simulation Reçoit la nouvelle instance (NULL en cas d'échec)
+ */
+
+ISING_API void ising_destroy(IsingSimulation *simulation);
+/**
+ * Libère l'instance (NULL accepté)
+ */
+
+ISING_API IsingStatus ising_set_parameters(IsingSimulation *simulation,
+                                           float temperature, float J,
+                                           float B);
+/**
+ * Température (>= 0), couplage et champ des balayages suivants
+ */
+
+ISING_API IsingStatus ising_randomize(IsingSimulation *simulation,
+                                      float upFraction);
+/**
+ * Tire chaque spin à +1 avec la probabilité upFraction (générateur de
+ * l'instance)
+ */
+
+ISING_API IsingStatus ising_sweep(IsingSimulation *simulation, int sweeps,
+                                  int64_t *accepted);
+/**
+ * Balayages de Metropolis : chaque site est visité une fois par balayage
+ * @param accepted Reçoit le nombre de retournements acceptés (optionnel)
+ */
+
+ISING_API IsingStatus ising_observables(const IsingSimulation *simulation,
+                                        IsingObservables *observables);
+/**
+ * Calcule énergie et aimantation (un parcours du réseau)
+ */
+
+ISING_API IsingStatus ising_spins(const IsingSimulation *simulation,
+                                  IsingSpinView *view);
+/**
+ * Pointeur et pas du tableau de spins (voir IsingSpinView)
+ */
+
+ISING_API const char *ising_status_string(IsingStatus status);
+/**
+ * Message lisible d'un code de retour (chaîne statique)
+ */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ISING_H
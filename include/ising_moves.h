@@ -0,0 +1,87 @@
+#ifndef ISING_MOVES_H
+#define ISING_MOVES_H
+#include "disorder.h"
+#include <cstdint>
+#include <random>
+#include <vector>
+
+// MOUVEMENTS D'ISING SUR RÉSEAU CSR : AMAS DE WOLFF ET TEMPS CONTINU
+
+/**
+ * @brief Retournements d'amas de Wolff sur un DisorderedLattice
+ *
+ * Un amas croît depuis un site tiré au hasard : chaque liaison satisfaite
+ * (J J_ij s_i s_j > 0) l'étend avec la probabilité 1 - exp(-2 |J J_ij| / T).
+ * Le champ B et les voisins figés, qui ne peuvent pas rejoindre l'amas,
+ * agissent comme un champ extérieur : l'amas n'est retourné qu'avec la
+ * probabilité min(1, exp(-ΔE / T)) de ce champ. Près de Tc, un amas
+ * décorrèle bien plus de sites qu'un balayage de Metropolis. Les tampons
+ * sont gardés d'un appel à l'autre.
+ */
+class WolffUpdater {
+public:
+  /**
+   * Construit environ updates / (taille moyenne) amas
+   * La taille moyenne est mesurée sur les estimateClusters premiers amas
+   * après un changement de (T, J, B), puis figée : le nombre d'amas d'un
+   * appel (partie fractionnaire reportée) ne dépend alors plus des
+   * configurations. S'arrêter dès updates sites parcourus, ou recalculer la
+   * moyenne en continu, biaiserait les configurations observées entre deux
+   * appels, les grands amas venant des configurations ordonnées.
+   * @return Spins retournés
+   */
+  long long Advance(DisorderedLattice &lattice, double updates,
+                    float temperature, float J, float B, mt19937 &rng);
+
+private:
+  int Step(DisorderedLattice &lattice, float temperature, float J, float B,
+           mt19937 &rng, bool &flipped);
+
+  vector<int> cluster;       // Sites de l'amas, aussi pile de croissance
+  vector<uint32_t> mark;     // generation : site déjà dans l'amas
+  uint32_t generation = 0;
+  static constexpr double estimateClusters = 256.0;
+  double clusterSites = 0.0, clusterCount = 0.0; // Amas de l'estimation
+  double pendingClusters = 0.0; // Fraction d'amas reportée à l'appel suivant
+  uint32_t addThreshold = 0; // Ajout d'une liaison |J_ij| = 1, sur 2^32
+  float thresholdT = -1.0f, thresholdJ = 0.0f, thresholdB = 0.0f;
+};
+
+/**
+ * @brief Metropolis sans rejet (n-fold way de Bortz, Kalos et Lebowitz)
+ *
+ * Les sites sont rangés par classe (spin, champ local entier), chaque
+ * classe ayant la probabilité de retournement de Metropolis. Un événement
+ * tire une classe au prorata de (taille × probabilité), puis un site de la
+ * classe, le retourne et reclasse ses voisins ; le temps avance du nombre
+ * de tentatives de Metropolis (site tiré au hasard) qu'il aurait fallu, de
+ * loi exponentielle. À basse température, où presque toutes les tentatives
+ * échouent, chaque événement est un retournement. Couplages entiers
+ * uniquement ; sites figés et lacunes ne changent jamais de classe.
+ */
+class RejectionFreeUpdater {
+public:
+  /// Reclasse tous les sites ; à rappeler quand les spins changent ailleurs
+  void Reset(const DisorderedLattice &lattice);
+
+  /**
+   * Retourne des spins jusqu'à ce que updates tentatives se soient écoulées
+   * (Reset automatique si le réseau a changé de taille)
+   * @return Spins retournés
+   */
+  long long Advance(DisorderedLattice &lattice, double updates,
+                    float temperature, float J, float B, mt19937 &rng);
+
+private:
+  int ClassOf(const DisorderedLattice &lattice, int site) const;
+  void Move(int site, int newClass);
+
+  int maxField = 0;
+  vector<vector<int>> members; // Sites de chaque classe
+  vector<int> classOf;         // -1 : jamais retourné (figé, lacune)
+  vector<int> position;        // Rang du site dans members[classOf]
+  vector<double> rates;        // Probabilité de retournement par classe
+  float ratesT = -1.0f, ratesJ = 0.0f, ratesB = 0.0f;
+};
+
+#endif // ISING_MOVES_H
@@ -0,0 +1,192 @@
+#ifndef LATTICE_H
+#define LATTICE_H
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#ifdef ISING_HEADLESS
+// libising et ising_mpi se compilent sans les en-têtes de raylib : un
+// Vector3 de même disposition et les fonctions de raymath utilisées ici
+struct Vector3 {
+  float x, y, z;
+};
+
+inline float Vector3Distance(Vector3 a, Vector3 b) {
+  float dx = b.x - a.x, dy = b.y - a.y, dz = b.z - a.z;
+  return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+inline Vector3 Vector3Scale(Vector3 v, float scale) {
+  return {v.x * scale, v.y * scale, v.z * scale};
+}
+#else
+#include "raylib.h"
+#include "raymath.h"
+#endif
+
+using namespace std;
+
+// RÉSEAUX ET MONTE CARLO SANS RENDU
+// Vector3 et raymath ne sont que des types et des fonctions inline : ce
+// fichier ne demande ni fenêtre ni contexte OpenGL, ni même raylib avec
+// ISING_HEADLESS (voir libising)
+
+enum class Spin : int {
+  UP = 1,    // Spin orienté vers le haut
+  DOWN = -1, // Spin orienté vers le bas
+};
+
+/// Type de structure cristalline supportée
+enum class StructureType {
+  CUBIC,     // Cubique simple
+  HEXAGONAL, // Hexagonal compact (HCP)
+  FCC,       // Cubique à faces centrées
+  BCC,       // Cubique centré
+  CUSTOM,    // Maille décrite par un fichier (voir unit_cell.h)
+};
+
+// STRUCTURES DE DONNÉES
+
+/// Représente un atome dans le réseau
+struct Atome {
+  Vector3 pos;
+  Spin spin = Spin::UP;
+  vector<int> neigh;
+  vector<float> coupling; // Multiplicateur de J par voisin (vide : 1)
+  float energy = 0.0f;
+  float radius = 0.5f;
+  bool pinned = false; // Spin figé : aucun noyau d'Ising ne le retourne
+};
+
+/// Suivi d'une construction de réseau, partagé avec un thread de fond
+struct BuildProgress {
+  atomic<float> fraction{0.0f};  // Avancement global dans [0, 1]
+  atomic<bool> cancelled{false}; // Demande d'annulation (vérifiée par boucle)
+  float phaseStart = 0.0f;       // Début de l'étape courante (thread de fond)
+  float phaseSpan = 1.0f;        // Part de l'étape courante dans le total
+};
+
+bool ReportProgress(BuildProgress *progress, float fraction);
+/**
+ * Publie l'avancement de l'étape courante
+ * @param progress Suivi optionnel (nullptr : rien à faire)
+ * @param fraction Avancement de l'étape dans [0, 1]
+ * @return true si l'annulation est demandée
+ */
+
+// FONCTIONS DE CONSTRUCTION DES RÉSEAUX
+vector<Atome> make_cubic_struc(int x, int y, int z, float distance,
+                               BuildProgress *progress = nullptr);
+/**
+ * Crée un réseau cubique simple
+ * @param x,y,z Dimensions du réseau en nombre d'atomes
+ * @param distance Distance interatomique
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Vecteur contenant tous les atomes positionnés (vide si annulé)
+ */
+
+vector<Atome> make_hexagonal_struc(int x, int y, int z, float distance,
+                                   BuildProgress *progress = nullptr);
+/**
+ * Crée un réseau hexagonal compact (HCP)
+ * @param x,y,z Dimensions du réseau
+ * @param distance Distance entre atomes voisins
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Vecteur des atomes avec empilement ABAB
+ */
+
+vector<Atome> make_fcc_struc(int x, int y, int z, float distance,
+                             BuildProgress *progress = nullptr);
+/**
+ * Crée un réseau cubique à faces centrées (FCC)
+ * @param x,y,z Dimensions du réseau
+ * @param distance Paramètre de maille
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Vecteur des atomes avec leurs 12 voisins
+ */
+
+vector<Atome> make_bcc_struc(int x, int y, int z, float distance,
+                             BuildProgress *progress = nullptr);
+/**
+ * Crée un réseau cubique centré (BCC)
+ * @param x,y,z Dimensions du réseau
+ * @param distance Paramètre de maille
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Vecteur des atomes avec leurs 8 voisins
+ */
+
+float NeighborCutoff(StructureType type, float distance);
+/**
+ * Distance maximale entre deux voisins, identique à celle des constructeurs
+ * @param type Type de structure
+ * @param distance Distance interatomique / paramètre de maille
+ */
+
+vector<Vector3> MakeLatticeSites(StructureType type, int x, int y, int z,
+                                 float distance);
+/**
+ * Positions des sites, dans l'ordre produit par make_*_struc
+ * @param type Type de structure
+ * @param x,y,z Dimensions du réseau
+ * @param distance Distance interatomique / paramètre de maille
+ * @return Une position par atome (sans voisins)
+ */
+
+void RescaleStructure(vector<Atome> &structure, float factor);
+/**
+ * Change l'échelle des positions sans toucher aux voisins ni aux spins
+ * @param structure Vecteur d'atomes
+ * @param factor Rapport nouvelle distance / ancienne distance
+ */
+
+vector<int> ResizeStructure(vector<Atome> &structure, float oldDistance,
+                            StructureType type, int x, int y, int z,
+                            float distance, BuildProgress *progress = nullptr);
+/**
+ * Agrandit ou réduit un réseau existant sans le régénérer
+ * Les atomes communs gardent leur spin et leurs voisins ; seuls les sites
+ * ajoutés (à la nouvelle frontière) font l'objet d'une recherche de voisins.
+ * @param structure Réseau existant, remplacé par le réseau redimensionné
+ * @param oldDistance Distance avec laquelle structure a été construite
+ * @param type Type de structure (identique à celui du réseau existant)
+ * @param x,y,z Nouvelles dimensions
+ * @param distance Nouvelle distance interatomique
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Pour chaque nouvel atome, l'indice de l'ancien (-1 si ajouté) ;
+ *         vide si annulé (structure est alors inchangée)
+ */
+
+// FONCTIONS DE SIMULATION
+float CalculateTotalEnergy(const vector<Atome> &structure);
+/**
+ * Calcule l'énergie totale du système
+ * @param structure Vecteur d'atomes
+ * @return Énergie totale (divisée par 2 pour éviter double comptage)
+ */
+
+void UpdateEnergies(vector<Atome> &structure, float J, float B);
+/**
+ * Met à jour les énergies de tous les atomes
+ * @param structure Vecteur d'atomes à mettre à jour
+ * @param params Paramètres courants (B, J implicite)
+ */
+
+bool MonteCarloStep(vector<Atome> &structure, float temperature, float J,
+                    float B, mt19937 &rng);
+/**
+ * Effectue un pas Monte Carlo (algorithme de Metropolis)
+ * @param structure Référence au vecteur d'atomes
+ * @param temperature,J,B Paramètres du modèle d'Ising
+ * @param rng Générateur de l'appelant (aucun état global)
+ * @return true si le retournement a été accepté (jamais pour un site figé)
+ */
+
+void CopyPinned(const vector<Atome> &structure, vector<uint8_t> &pinned);
+/**
+ * Masque des sites figés (Atome::pinned) pour les noyaux sans atomes
+ * @param pinned Un octet par atome (1 : figé), vidé si aucun ne l'est
+ */
+
+#endif // LATTICE_H
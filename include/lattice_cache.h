@@ -0,0 +1,89 @@
+#ifndef LATTICE_CACHE_H
+#define LATTICE_CACHE_H
+#include "simulation.h"
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/// Identifie un réseau : type, dimensions et distance
+struct LatticeKey {
+  StructureType type = StructureType::CUBIC;
+  int x = 0, y = 0, z = 0;
+  float distance = 0.0f;
+
+  /// Nom stable dérivé du contenu de la clé (ex. "fcc-64x64x64-d2000")
+  string Name() const;
+};
+
+/// Topologie compacte : positions + voisins au format CSR
+struct LatticeTopology {
+  vector<Vector3> positions; // Une position par site
+  vector<int> offsets;       // Voisins de i : neighbors[offsets[i]..[i+1]]
+  vector<int> neighbors;     // Indices des voisins, concaténés
+  vector<uint8_t> shells;    // Couche de chaque liaison (vide : une seule)
+};
+
+/**
+ * Convertit un réseau d'atomes en topologie CSR
+ * @param structure Vecteur d'atomes
+ * @return Positions et voisins (les spins ne sont pas conservés)
+ */
+LatticeTopology ToTopology(const vector<Atome> &structure);
+
+/**
+ * Reconstruit un vecteur d'atomes depuis une topologie CSR
+ * @param topology Topologie source
+ * @return Atomes positionnés avec leurs voisins (spins à initialiser)
+ */
+vector<Atome> ToAtoms(const LatticeTopology &topology);
+
+/**
+ * @brief Cache de topologies indexé par LatticeKey
+ *
+ * Un LRU en mémoire garde les derniers réseaux construits ; chaque entrée
+ * est aussi écrite dans un fichier binaire (en-tête + positions + CSR) qui
+ * est projeté en mémoire (mmap) au prochain accès, y compris après un
+ * redémarrage. Un fichier dont l'en-tête ou le CSR est incohérent (décalages
+ * non croissants, voisin hors du réseau) est traité comme absent. Les
+ * méthodes peuvent être appelées depuis n'importe quel thread.
+ */
+class LatticeCache {
+public:
+  /**
+   * @param directory Dossier des fichiers de cache (créé si besoin), chemin
+   *        absolu de préférence : un chemin relatif dépend du dossier courant
+   * @param capacity Nombre de réseaux gardés en mémoire
+   */
+  explicit LatticeCache(string directory, size_t capacity = 8);
+
+  /**
+   * Cherche un réseau en mémoire puis sur disque
+   * @param key Clé du réseau
+   * @return La topologie, ou nullptr si absente
+   */
+  shared_ptr<const LatticeTopology> Find(const LatticeKey &key);
+
+  /**
+   * Ajoute un réseau au cache mémoire et l'écrit sur disque
+   * @param key Clé du réseau
+   * @param topology Topologie construite
+   */
+  void Store(const LatticeKey &key, shared_ptr<const LatticeTopology> topology);
+
+private:
+  using Entry = pair<string, shared_ptr<const LatticeTopology>>;
+
+  void Touch(const string &name, shared_ptr<const LatticeTopology> topology);
+  string PathFor(const LatticeKey &key) const;
+
+  string directory;
+  size_t capacity;
+  mutex cacheMutex;
+  list<Entry> recent; // Du plus récent au plus ancien
+  unordered_map<string, list<Entry>::iterator> index;
+};
+
+#endif // LATTICE_CACHE_H
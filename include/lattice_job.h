@@ -0,0 +1,98 @@
+#ifndef LATTICE_JOB_H
+#define LATTICE_JOB_H
+#include "lattice_cache.h"
+#include "simulation.h"
+#include "unit_cell.h"
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/// Paramètres d'une reconstruction de réseau
+struct LatticeRequest {
+  StructureType type = StructureType::CUBIC;
+  int x = 10, y = 10, z = 10;
+  float distance = 2.0f;
+  float bondRadius = 0.05f;
+  int segments = 8;
+  shared_ptr<const UnitCell> unitCell; // Maille si type == CUSTOM
+  bool periodic = false;               // Bords périodiques (CUSTOM)
+  // CUSTOM : même maille et mêmes nombres de cellules, donc mêmes sites
+  // dans le même ordre ; les spins affichés sont gardés
+  bool keepSites = false;
+  // Réseau existant du même type à redimensionner au lieu de le régénérer
+  shared_ptr<const vector<Atome>> previous;
+  float previousDistance = 0.0f; // Distance des positions de previous
+};
+
+/// Réseau complet prêt à être échangé avec celui affiché
+struct LatticeResult {
+  LatticeRequest request;
+  vector<Atome> structure;         // Atomes avec spins aléatoires
+  vector<Matrix> sphereTransforms; // Une translation par atome
+  vector<Mesh> cylinderMeshes;     // Liaisons non chargées sur le GPU
+  vector<int> previousIndex; // Atome d'origine dans previous (-1 si ajouté)
+};
+
+/**
+ * @brief Reconstruction de réseau en tâche de fond, annulable
+ *
+ * Le constructeur make_*_struc (ou le cache de topologies), l'initialisation
+ * des spins, les transformations et la géométrie des liaisons sont calculés
+ * sur un thread dédié. Le thread de rendu interroge TakeResult() à chaque image et échange
+ * le résultat d'un bloc ; seul UploadMeshes() reste sur le thread OpenGL.
+ */
+class LatticeBuildJob {
+public:
+  LatticeBuildJob() = default;
+  LatticeBuildJob(const LatticeBuildJob &) = delete;
+  LatticeBuildJob &operator=(const LatticeBuildJob &) = delete;
+  ~LatticeBuildJob();
+
+  /**
+   * Lance une reconstruction (annule celle en cours s'il y en a une)
+   * @param request Paramètres du nouveau réseau
+   */
+  void Start(const LatticeRequest &request);
+
+  /// Annule la reconstruction en cours et attend la fin du thread
+  void Cancel();
+
+  /// Vrai tant qu'une reconstruction n'a pas été récupérée ou annulée
+  bool IsRunning() const;
+
+  /// Avancement de la reconstruction en cours dans [0, 1]
+  float Progress() const;
+
+  /**
+   * Récupère le réseau terminé (une seule fois par reconstruction)
+   * @param out Reçoit le réseau ; ses meshs doivent passer par UploadMeshes
+   * @return true si un résultat était disponible
+   */
+  bool TakeResult(LatticeResult &out);
+
+  /**
+   * Rend les tableaux du réseau remplacé pour la prochaine reconstruction
+   * Un redimensionnement recopie le réseau dans ces atomes et réutilise
+   * ainsi leurs listes de voisins ; les transformations sont réécrites
+   * en place.
+   * @param structure Atomes du réseau qui n'est plus affiché
+   * @param transforms Ses transformations de sphères
+   */
+  void Recycle(vector<Atome> &&structure, vector<Matrix> &&transforms);
+
+private:
+  void Run(LatticeRequest request, shared_ptr<BuildProgress> tracker);
+
+  // Topologies déjà construites (mémoire + disque, à côté de l'exécutable)
+  LatticeCache cache{string(GetApplicationDirectory()) + "lattice_cache"};
+  thread worker;
+  shared_ptr<BuildProgress> progress;
+  mutable mutex resultMutex;
+  unique_ptr<LatticeResult> result;
+  atomic<bool> running{false};
+  // Tableaux rendus par Recycle(), pris par le prochain Run (resultMutex)
+  vector<Atome> spareStructure;
+  vector<Matrix> spareTransforms;
+};
+
+#endif // LATTICE_JOB_H
@@ -0,0 +1,161 @@
+#ifndef NUMA_H
+#define NUMA_H
+#include "stencil.h"
+#include "thread_pool.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// PLACEMENT NUMA, THREADS FIXÉS ET PAGES ÉNORMES
+
+/// Cœurs de chaque nœud NUMA, lus dans /sys (un seul nœud à défaut)
+struct NumaTopology {
+  vector<vector<int>> nodeCpus;
+
+  /// Cœurs nœud par nœud : des threads consécutifs partagent un nœud
+  vector<int> CpuOrder() const;
+};
+
+NumaTopology ReadNumaTopology();
+/**
+ * Nœuds de /sys/devices/system/node ; hors Linux ou sans ce dossier, un
+ * nœud unique avec tous les cœurs
+ */
+
+/// Support des pages d'un PageBuffer
+enum class HugePages {
+  NONE,        // Pages de base, pages énormes transparentes refusées
+  TRANSPARENT, // madvise(MADV_HUGEPAGE) : le noyau les fournit s'il peut
+  EXPLICIT,    // MAP_HUGETLB : pages réservées (vm.nr_hugepages)
+};
+
+/**
+ * @brief Zone anonyme projetée (mmap), jamais touchée à l'allocation
+ *
+ * Contrairement à un vector, aucun octet n'est écrit : chaque page est
+ * placée sur le nœud du premier thread qui l'écrit. Alignée sur 2 Mo pour
+ * que les pages énormes couvrent toute la zone.
+ */
+class PageBuffer {
+public:
+  PageBuffer() = default;
+  PageBuffer(PageBuffer &&other) noexcept;
+  PageBuffer &operator=(PageBuffer &&other) noexcept;
+  PageBuffer(const PageBuffer &) = delete;
+  PageBuffer &operator=(const PageBuffer &) = delete;
+  ~PageBuffer();
+
+  /**
+   * Libère la zone précédente et en projette une nouvelle
+   * EXPLICIT se replie sur TRANSPARENT sans pages réservées (voir Backing).
+   * @param error Message en cas d'échec
+   */
+  bool Allocate(size_t bytes, HugePages mode, string &error);
+
+  void *Data() const { return data; }
+  size_t Size() const { return size; }
+  /// Support obtenu, qui peut différer du mode demandé
+  HugePages Backing() const { return backing; }
+
+private:
+  void Release();
+
+  void *mapping = nullptr; // Début de la projection, avant alignement
+  size_t mappedBytes = 0;
+  void *data = nullptr;
+  size_t size = 0;
+  HugePages backing = HugePages::NONE;
+};
+
+/// Répartition d'une zone mémoire entre nœuds
+struct NumaPlacement {
+  bool available = false;   // move_pages a répondu
+  vector<size_t> nodeBytes; // Octets résidents par nœud (estimés)
+  size_t absentBytes = 0;   // Jamais touchés ou déplacés sur disque
+  size_t hugeBytes = 0;     // Pages énormes de la projection (smaps)
+};
+
+NumaPlacement MeasurePlacement(const void *data, size_t bytes,
+                               size_t samples = 4096);
+/**
+ * Interroge le nœud d'au plus samples pages régulièrement espacées
+ * (move_pages sans déplacement) et extrapole à toute la zone
+ */
+
+/// Réglages de NumaLattice
+struct NumaOptions {
+  bool pin = true;        // Fixe les threads nœud par nœud (CpuOrder)
+  bool firstTouch = true; // Chaque thread initialise sa propre tranche
+  HugePages hugePages = HugePages::NONE;
+};
+
+/// Observables d'un NumaLattice
+struct NumaObservables {
+  double energy = 0.0; // Chaque liaison comptée une fois
+  double magnetization = 0.0;
+};
+
+/**
+ * @brief Réseau cubique périodique balayé en parallèle par tranches x
+ *
+ * Le thread w du groupe garde toujours la même tranche de plans x
+ * (ParallelForWorkers) : il l'initialise, donc ses pages restent sur son
+ * nœud, puis la balaye en damier avec son propre générateur. Les plans
+ * voisins d'une autre tranche ne sont lus qu'aux deux bords. Avec des pages
+ * énormes, le placement se fait par blocs de 2 Mo : les tranches doivent
+ * être nettement plus grandes pour en profiter. Les spins initiaux
+ * dépendent du nombre de threads.
+ */
+class NumaLattice {
+public:
+  /**
+   * Projette le réseau et tire les spins à ±1
+   * Les dimensions doivent être paires (damier périodique). Les threads
+   * restent fixés après la destruction du réseau.
+   * @param pool Groupe qui fera tous les balayages (doit survivre au réseau)
+   * @param error Message en cas d'échec
+   */
+  bool Create(ThreadPool &pool, int lx, int ly, int lz, uint32_t seed,
+              const NumaOptions &options, string &error);
+
+  /**
+   * Balayage de Metropolis en damier, une barrière par couleur
+   * @return Retournements acceptés
+   */
+  long long Sweep(float temperature, float J, float B);
+
+  /// Énergie et aimantation, sommées par les threads propriétaires
+  NumaObservables Measure(float J, float B);
+
+  /// Placement courant des spins et support obtenu
+  NumaPlacement Placement() const;
+  HugePages Backing() const { return buffer.Backing(); }
+
+  size_t Sites() const { return (size_t)lx * ly * lz; }
+  /// Spins dans l'ordre de StencilLattice, modifiables entre deux balayages
+  int8_t *Spins() { return static_cast<int8_t *>(buffer.Data()); }
+  const int8_t *Spins() const { return static_cast<int8_t *>(buffer.Data()); }
+
+private:
+  // Alignés sur les lignes de cache : pas de faux partage des compteurs
+  struct alignas(64) WorkerState {
+    mt19937 rng;
+    long long sums[2] = {0, 0};
+  };
+
+  int8_t *Plane(int i) const {
+    return static_cast<int8_t *>(buffer.Data()) + (size_t)i * ly * lz;
+  }
+
+  ThreadPool *pool = nullptr;
+  PageBuffer buffer;
+  int lx = 0, ly = 0, lz = 0;
+  vector<WorkerState> workers;
+
+  // Table d'acceptation du dernier (T, J, B), reconstruite s'ils changent
+  AcceptanceTable table;
+  float tableT = -1.0f, tableJ = 0.0f, tableB = 0.0f;
+};
+
+#endif // NUMA_H
@@ -0,0 +1,40 @@
+#ifndef PROFILER_VIEW_H
+#define PROFILER_VIEW_H
+#include "trace.h"
+
+/**
+ * @brief Fenêtre ImGui du profileur : chronologie de la dernière image
+ *
+ * Affiche, pour chaque thread, les zones TRACE_SCOPE qui recouvrent la
+ * dernière zone "Frame" terminée du thread principal, empilées par niveau
+ * d'imbrication (lecture en flamme), puis le total par zone de ce thread.
+ * La pause fige l'image affichée ; l'export écrit tout le contenu des
+ * tampons au format Chrome trace.
+ */
+class ProfilerView {
+public:
+  /**
+   * Dessine la fenêtre
+   * @param open Fermée par l'utilisateur : passe à faux
+   */
+  void Draw(bool *open);
+
+private:
+  void Capture();
+
+  struct ZoneTotal {
+    const char *name;
+    double milliseconds;
+    int calls;
+  };
+
+  bool paused = false;
+  // Zones recouvrant [frameStart, frameEnd], un élément par tampon ;
+  // conservé d'une image à l'autre pour ne pas réallouer
+  vector<TraceThread> threads;
+  vector<ZoneTotal> totals; // Temps inclusif par zone de la première bande
+  int64_t frameStart = 0, frameEnd = 0;
+  string exportStatus;
+};
+
+#endif // PROFILER_VIEW_H
@@ -2,17 +2,21 @@
 #define SIMULATION_APP_H
 #include "imgui_style.h"
 #include "simulation.h"
+#include <string>
 /**
  * @brief Lance la simulation principale avec paramètres configurables
- * @param initialParams Paramètres initiaux de la simulation
+ * @param user Utilisateur connecté : son espace de travail (réseau,
+ *        paramètres, spins) est repris à l'ouverture et enregistré à la
+ *        fermeture (voir workspace.h)
  * @return Code de sortie (0 si succès)
  *
  * Cette fonction gère :
- * - L'initialisation de la fenêtre et de la caméra
+ * - L'initialisation de la caméra (la fenêtre est créée par
+ *   InitApplication, voir app.h)
  * - La boucle principale de rendu
  * - L'interface utilisateur ImGui
  * - La gestion des entrées utilisateur
  */
-int runSimulation();
+int runSimulation(const string &user);
 
 #endif
@@ -0,0 +1,40 @@
+#ifndef SITE_INSPECTOR_H
+#define SITE_INSPECTOR_H
+#include "simulation.h"
+#include "spin_model.h"
+
+// INSPECTEUR DE SITE
+
+/// Site affiché par l'inspecteur et ce que l'appelant permet d'en faire
+struct SiteContext {
+  const vector<Atome> *structure = nullptr;
+  const SpinSystem *spinSystem = nullptr; // Moteur générique, ou nullptr
+  int site = -1;
+  bool vacancy = false;  // Lacune du réseau désordonné
+  bool editable = false; // Retournement et épinglage (noyaux d'Ising)
+  int pinnedCount = 0;
+};
+
+/// Demandes de l'utilisateur, appliquées par l'appelant au noyau actif
+struct InspectorAction {
+  int select = -1; // Voisin choisi dans la liste
+  bool flip = false;
+  bool togglePin = false;
+  bool unpinAll = false;
+};
+
+InspectorAction DrawSiteInspector(bool *open, const SiteContext &context);
+/**
+ * Fenêtre ImGui du site sélectionné : position, spin, énergie, champ local
+ * et coût du retournement (Ising), puis la liste des voisins avec leur
+ * spin et leur couplage. Les valeurs sont relues à chaque image.
+ * @param open Fermée par l'utilisateur : passe à faux
+ * @return Actions demandées pendant cette image
+ */
+
+void DrawSiteTooltip(const SiteContext &context);
+/**
+ * Bulle d'aide résumant le site survolé (indice, spin, énergie)
+ */
+
+#endif // SITE_INSPECTOR_H
@@ -0,0 +1,514 @@
+#ifndef SPIN_MODEL_H
+#define SPIN_MODEL_H
+#include "simulation.h"
+#include "trace.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <random>
+
+// MODÈLES DE SPIN GÉNÉRIQUES (Ising, Potts, XY, Heisenberg)
+
+/// Modèle de spin simulé
+enum class SpinModelType {
+  ISING,     // s = +1 / -1
+  POTTS,     // s dans {0, ..., q-1}
+  XY,        // Vecteur unitaire du plan (x, y)
+  HEISENBERG // Vecteur unitaire 3D
+};
+
+/// Paramètres communs aux modèles
+struct SpinModelParams {
+  float temperature = 2.0f;
+  float J = 1.0f;
+  float B = 0.0f;          // Ising : champ ; Potts : favorise l'état 0 ;
+                           // XY : selon x ; Heisenberg : selon z
+  float anisotropy = 0.0f; // D : terme -D (S.axe)², même axe que B
+  float stepSize = 0.5f;   // Amplitude des propositions continues
+};
+
+/// Voisins au format CSR avec couplage par liaison
+struct SpinTopology {
+  vector<int> offsets;    // Voisins de i : neighbors[offsets[i]..[i+1]]
+  vector<int> neighbors;  // Indices des voisins, concaténés
+  vector<float> coupling; // Multiplicateur de J par liaison (vide : 1)
+};
+
+/**
+ * Extrait la topologie d'un réseau construit par make_*_struc ou ToAtoms
+ * @param structure Vecteur d'atomes
+ * @return Voisins et couplages (Atome::coupling) au format CSR
+ */
+SpinTopology MakeSpinTopology(const vector<Atome> &structure);
+
+/// Tirage uniforme dans [0, 1) sur 24 bits
+inline float RandomUnit(mt19937 &rng) {
+  return (rng() >> 8) * (1.0f / 16777216.0f);
+}
+
+/*
+ * Politiques de modèle : stockage (State), proposition, accumulation du
+ * champ local et variation d'énergie. SpinEngine n'appelle que ces
+ * fonctions non virtuelles, le compilateur les intègre dans la boucle.
+ * L'énergie d'un site suit la convention de UpdateEnergies :
+ * E_i = -J S_i.h_i - B S_i(axe) - D S_i(axe)², chaque liaison comptée
+ * deux fois dans la somme des sites.
+ */
+
+/// Spins d'Ising (+1 / -1)
+struct IsingModel {
+  static constexpr SpinModelType type = SpinModelType::ISING;
+  struct State {
+    vector<int8_t> s;
+  };
+  struct Proposal {
+    int8_t s;
+  };
+  struct Field {
+    float h = 0.0f;
+  };
+
+  void Resize(State &state, size_t n) const { state.s.assign(n, 1); }
+  void Randomize(State &state, mt19937 &rng) const {
+    for (auto &s : state.s)
+      s = (rng() & 1) ? 1 : -1;
+  }
+  Proposal Current(const State &state, int i) const { return {state.s[i]}; }
+  Proposal Propose(const State &state, int i, const SpinModelParams &,
+                   mt19937 &) const {
+    return {static_cast<int8_t>(-state.s[i])};
+  }
+  Field Begin(const State &, int, const Proposal &) const { return {}; }
+  void Accumulate(Field &field, const State &state, int j, float c) const {
+    field.h += c * state.s[j];
+  }
+  float SiteEnergy(const State &state, int i, const Field &field,
+                   const SpinModelParams &p) const {
+    return -state.s[i] * (p.J * field.h + p.B);
+  }
+  float DeltaE(const State &state, int i, const Proposal &next,
+               const Field &field, const SpinModelParams &p) const {
+    return (state.s[i] - next.s) * (p.J * field.h + p.B);
+  }
+  void Apply(State &state, int i, const Proposal &next) const {
+    state.s[i] = next.s;
+  }
+  Vector3 Direction(const State &state, int i) const {
+    return {0.0f, (float)state.s[i], 0.0f};
+  }
+  int Label(const State &state, int i) const { return state.s[i]; }
+  float OrderParameter(const State &state) const {
+    double m = 0.0;
+    for (auto s : state.s)
+      m += s;
+    return state.s.empty() ? 0.0f : (float)fabs(m / state.s.size());
+  }
+};
+
+/// Potts à q états : E = -J sum delta(s_i, s_j) - B delta(s_i, 0)
+struct PottsModel {
+  static constexpr SpinModelType type = SpinModelType::POTTS;
+  int q = 3;
+
+  struct State {
+    vector<uint8_t> s;
+  };
+  struct Proposal {
+    uint8_t s;
+  };
+  struct Field {
+    uint8_t current, target;
+    float same = 0.0f, toTarget = 0.0f; // Voisins dans l'état actuel / visé
+  };
+
+  void Resize(State &state, size_t n) const { state.s.assign(n, 0); }
+  void Randomize(State &state, mt19937 &rng) const {
+    for (auto &s : state.s)
+      s = static_cast<uint8_t>(rng() % q);
+  }
+  Proposal Current(const State &state, int i) const { return {state.s[i]}; }
+  Proposal Propose(const State &state, int i, const SpinModelParams &,
+                   mt19937 &rng) const {
+    // Uniform over the q-1 other states, symmetric
+    return {static_cast<uint8_t>((state.s[i] + 1 + rng() % (q - 1)) % q)};
+  }
+  Field Begin(const State &state, int i, const Proposal &next) const {
+    Field field;
+    field.current = state.s[i];
+    field.target = next.s;
+    return field;
+  }
+  void Accumulate(Field &field, const State &state, int j, float c) const {
+    field.same += (state.s[j] == field.current) * c;
+    field.toTarget += (state.s[j] == field.target) * c;
+  }
+  float SiteEnergy(const State &state, int i, const Field &field,
+                   const SpinModelParams &p) const {
+    return -p.J * field.same - p.B * (state.s[i] == 0);
+  }
+  float DeltaE(const State &state, int i, const Proposal &next,
+               const Field &field, const SpinModelParams &p) const {
+    return -p.J * (field.toTarget - field.same) -
+           p.B * ((next.s == 0) - (state.s[i] == 0));
+  }
+  void Apply(State &state, int i, const Proposal &next) const {
+    state.s[i] = next.s;
+  }
+  Vector3 Direction(const State &state, int i) const {
+    float angle = 2.0f * PI * state.s[i] / q;
+    return {cosf(angle), sinf(angle), 0.0f};
+  }
+  int Label(const State &state, int i) const { return state.s[i]; }
+  float OrderParameter(const State &state) const {
+    // (q * max fraction - 1) / (q - 1): 0 when disordered, 1 when ordered
+    if (state.s.empty())
+      return 0.0f;
+    // uint8_t states: a fixed array, no allocation in the per-frame stats
+    array<size_t, 256> counts{};
+    for (auto s : state.s)
+      counts[s]++;
+    size_t largest = *max_element(counts.begin(), counts.begin() + q);
+    return (q * (float)largest / state.s.size() - 1.0f) / (q - 1);
+  }
+};
+
+/// Rotateurs plans : composantes x, y en SoA
+struct XYModel {
+  static constexpr SpinModelType type = SpinModelType::XY;
+  struct State {
+    vector<float> x, y;
+  };
+  struct Proposal {
+    float x, y;
+  };
+  struct Field {
+    float hx = 0.0f, hy = 0.0f;
+  };
+
+  void Resize(State &state, size_t n) const {
+    state.x.assign(n, 1.0f);
+    state.y.assign(n, 0.0f);
+  }
+  void Randomize(State &state, mt19937 &rng) const {
+    for (size_t i = 0; i < state.x.size(); i++) {
+      float angle = 2.0f * PI * RandomUnit(rng);
+      state.x[i] = cosf(angle);
+      state.y[i] = sinf(angle);
+    }
+  }
+  Proposal Current(const State &state, int i) const {
+    return {state.x[i], state.y[i]};
+  }
+  Proposal Propose(const State &state, int i, const SpinModelParams &p,
+                   mt19937 &rng) const {
+    // Rotation by a uniform angle in [-pi step, pi step], symmetric
+    float delta = PI * p.stepSize * (2.0f * RandomUnit(rng) - 1.0f);
+    float c = cosf(delta), s = sinf(delta);
+    return {c * state.x[i] - s * state.y[i], s * state.x[i] + c * state.y[i]};
+  }
+  Field Begin(const State &, int, const Proposal &) const { return {}; }
+  void Accumulate(Field &field, const State &state, int j, float c) const {
+    field.hx += c * state.x[j];
+    field.hy += c * state.y[j];
+  }
+  float SiteEnergy(const State &state, int i, const Field &field,
+                   const SpinModelParams &p) const {
+    float x = state.x[i], y = state.y[i];
+    return -p.J * (x * field.hx + y * field.hy) - p.B * x -
+           p.anisotropy * x * x;
+  }
+  float DeltaE(const State &state, int i, const Proposal &next,
+               const Field &field, const SpinModelParams &p) const {
+    float x = state.x[i], y = state.y[i];
+    return -p.J * ((next.x - x) * field.hx + (next.y - y) * field.hy) -
+           p.B * (next.x - x) - p.anisotropy * (next.x * next.x - x * x);
+  }
+  void Apply(State &state, int i, const Proposal &next) const {
+    // Renormalize so rounding errors do not pile up over rotations
+    float norm = 1.0f / sqrtf(next.x * next.x + next.y * next.y);
+    state.x[i] = next.x * norm;
+    state.y[i] = next.y * norm;
+  }
+  Vector3 Direction(const State &state, int i) const {
+    return {state.x[i], state.y[i], 0.0f};
+  }
+  int Label(const State &state, int i) const {
+    return state.x[i] >= 0 ? 1 : -1;
+  }
+  float OrderParameter(const State &state) const {
+    double mx = 0.0, my = 0.0;
+    for (size_t i = 0; i < state.x.size(); i++) {
+      mx += state.x[i];
+      my += state.y[i];
+    }
+    return state.x.empty() ? 0.0f
+                           : (float)(sqrt(mx * mx + my * my) / state.x.size());
+  }
+};
+
+/// Spins de Heisenberg : composantes x, y, z en SoA
+struct HeisenbergModel {
+  static constexpr SpinModelType type = SpinModelType::HEISENBERG;
+  struct State {
+    vector<float> x, y, z;
+  };
+  struct Proposal {
+    float x, y, z;
+  };
+  struct Field {
+    float hx = 0.0f, hy = 0.0f, hz = 0.0f;
+  };
+
+  void Resize(State &state, size_t n) const {
+    state.x.assign(n, 0.0f);
+    state.y.assign(n, 0.0f);
+    state.z.assign(n, 1.0f);
+  }
+  void Randomize(State &state, mt19937 &rng) const {
+    for (size_t i = 0; i < state.x.size(); i++) {
+      // Uniform on the sphere: z uniform, azimuth uniform
+      float z = 2.0f * RandomUnit(rng) - 1.0f;
+      float angle = 2.0f * PI * RandomUnit(rng);
+      float r = sqrtf(max(0.0f, 1.0f - z * z));
+      state.x[i] = r * cosf(angle);
+      state.y[i] = r * sinf(angle);
+      state.z[i] = z;
+    }
+  }
+  Proposal Current(const State &state, int i) const {
+    return {state.x[i], state.y[i], state.z[i]};
+  }
+  Proposal Propose(const State &state, int i, const SpinModelParams &p,
+                   mt19937 &rng) const {
+    // S + step * (point in the unit ball), projected back on the sphere
+    float dx, dy, dz;
+    do {
+      dx = 2.0f * RandomUnit(rng) - 1.0f;
+      dy = 2.0f * RandomUnit(rng) - 1.0f;
+      dz = 2.0f * RandomUnit(rng) - 1.0f;
+    } while (dx * dx + dy * dy + dz * dz > 1.0f);
+    float x = state.x[i] + p.stepSize * dx;
+    float y = state.y[i] + p.stepSize * dy;
+    float z = state.z[i] + p.stepSize * dz;
+    float norm = sqrtf(x * x + y * y + z * z);
+    if (norm < 1e-6f)
+      return Current(state, i);
+    return {x / norm, y / norm, z / norm};
+  }
+  Field Begin(const State &, int, const Proposal &) const { return {}; }
+  void Accumulate(Field &field, const State &state, int j, float c) const {
+    field.hx += c * state.x[j];
+    field.hy += c * state.y[j];
+    field.hz += c * state.z[j];
+  }
+  float SiteEnergy(const State &state, int i, const Field &field,
+                   const SpinModelParams &p) const {
+    float x = state.x[i], y = state.y[i], z = state.z[i];
+    return -p.J * (x * field.hx + y * field.hy + z * field.hz) - p.B * z -
+           p.anisotropy * z * z;
+  }
+  float DeltaE(const State &state, int i, const Proposal &next,
+               const Field &field, const SpinModelParams &p) const {
+    float x = state.x[i], y = state.y[i], z = state.z[i];
+    return -p.J * ((next.x - x) * field.hx + (next.y - y) * field.hy +
+                   (next.z - z) * field.hz) -
+           p.B * (next.z - z) - p.anisotropy * (next.z * next.z - z * z);
+  }
+  void Apply(State &state, int i, const Proposal &next) const {
+    state.x[i] = next.x;
+    state.y[i] = next.y;
+    state.z[i] = next.z;
+  }
+  Vector3 Direction(const State &state, int i) const {
+    return {state.x[i], state.y[i], state.z[i]};
+  }
+  int Label(const State &state, int i) const {
+    return state.z[i] >= 0 ? 1 : -1;
+  }
+  float OrderParameter(const State &state) const {
+    double mx = 0.0, my = 0.0, mz = 0.0;
+    for (size_t i = 0; i < state.x.size(); i++) {
+      mx += state.x[i];
+      my += state.y[i];
+      mz += state.z[i];
+    }
+    return state.x.empty()
+               ? 0.0f
+               : (float)(sqrt(mx * mx + my * my + mz * mz) / state.x.size());
+  }
+};
+
+/**
+ * @brief Moteur de Metropolis générique sur une topologie CSR
+ *
+ * Toute la boucle chaude (proposition, champ local, acceptation) est
+ * instanciée pour chaque politique Model, sans appel virtuel.
+ */
+template <class Model> class SpinEngine {
+public:
+  SpinEngine(shared_ptr<const SpinTopology> topology, Model model = Model())
+      : model(model), topology(std::move(topology)) {
+    this->model.Resize(state, Size());
+  }
+
+  size_t Size() const {
+    return topology->offsets.empty() ? 0 : topology->offsets.size() - 1;
+  }
+
+  /**
+   * Mises à jour de Metropolis des sites [first, first + count), avec repli
+   * @return Nombre de propositions acceptées
+   */
+  int Update(int first, int count, const SpinModelParams &params,
+             mt19937 &rng) {
+    int n = (int)Size();
+    int accepted = 0;
+    for (int step = 0; step < count && n > 0; step++) {
+      int i = (first + step) % n;
+      auto next = model.Propose(state, i, params, rng);
+      auto field = LocalField(i, next);
+      float deltaE = model.DeltaE(state, i, next, field, params);
+      if (deltaE > 0) {
+        if (params.temperature <= 0 ||
+            RandomUnit(rng) >= expf(-deltaE / params.temperature))
+          continue;
+      }
+      model.Apply(state, i, next);
+      accepted++;
+    }
+    return accepted;
+  }
+
+  /// Énergie de chaque site (convention de UpdateEnergies)
+  void SiteEnergies(const SpinModelParams &params, float *energies) const {
+    for (int i = 0; i < (int)Size(); i++) {
+      auto field = LocalField(i, model.Current(state, i));
+      energies[i] = model.SiteEnergy(state, i, field, params);
+    }
+  }
+
+  Model model;
+  typename Model::State state;
+
+private:
+  typename Model::Field LocalField(int i,
+                                   const typename Model::Proposal &next) const {
+    auto field = model.Begin(state, i, next);
+    int begin = topology->offsets[i], end = topology->offsets[i + 1];
+    const int *neighbors = topology->neighbors.data();
+    if (topology->coupling.empty()) {
+      for (int n = begin; n < end; n++)
+        model.Accumulate(field, state, neighbors[n], 1.0f);
+    } else {
+      const float *coupling = topology->coupling.data();
+      for (int n = begin; n < end; n++)
+        model.Accumulate(field, state, neighbors[n], coupling[n]);
+    }
+    return field;
+  }
+
+  shared_ptr<const SpinTopology> topology;
+};
+
+/**
+ * @brief Interface commune aux moteurs, appelée une fois par lot de mises
+ * à jour (jamais dans la boucle chaude)
+ */
+class SpinSystem {
+public:
+  virtual ~SpinSystem() = default;
+  virtual SpinModelType Type() const = 0;
+  virtual size_t Size() const = 0;
+  /// Voir SpinEngine::Update
+  virtual int Update(int first, int count, const SpinModelParams &params,
+                     mt19937 &rng) = 0;
+  /// Tire des spins aléatoires (température infinie)
+  virtual void Randomize(mt19937 &rng) = 0;
+  /**
+   * Reprend les spins d'un moteur du même modèle après une reconstruction
+   * du réseau ; les autres sites gardent leur valeur
+   * @param previousIndex Pour chaque site, l'ancien indice (-1 : nouveau),
+   *        comme LatticeResult::previousIndex
+   * @return false si previous n'est pas du même modèle (Potts : même q)
+   */
+  virtual bool CarryOver(const SpinSystem &previous,
+                         const vector<int> &previousIndex) = 0;
+  virtual void SiteEnergies(const SpinModelParams &params,
+                            float *energies) const = 0;
+  /// |aimantation| par site (Potts : (q f_max - 1)/(q - 1))
+  virtual float OrderParameter() const = 0;
+  /// Orientation unitaire du site (Potts : angle 2 pi s / q)
+  virtual Vector3 Direction(int site) const = 0;
+  /// Ising : +-1 ; Potts : état ; XY / Heisenberg : signe selon l'axe de B
+  virtual int Label(int site) const = 0;
+};
+
+// Spins of one model can seed another only with the same parameters
+template <class Model> bool SameModel(const Model &, const Model &) {
+  return true;
+}
+inline bool SameModel(const PottsModel &a, const PottsModel &b) {
+  return a.q == b.q;
+}
+
+template <class Model> class SpinSystemOf : public SpinSystem {
+public:
+  SpinSystemOf(shared_ptr<const SpinTopology> topology, Model model)
+      : engine(std::move(topology), model) {}
+
+  SpinModelType Type() const override { return Model::type; }
+  size_t Size() const override { return engine.Size(); }
+  int Update(int first, int count, const SpinModelParams &params,
+             mt19937 &rng) override {
+    TRACE_SCOPE("SpinSystem::Update");
+    return engine.Update(first, count, params, rng);
+  }
+  void Randomize(mt19937 &rng) override {
+    engine.model.Randomize(engine.state, rng);
+  }
+  bool CarryOver(const SpinSystem &previous,
+                 const vector<int> &previousIndex) override {
+    auto *source = dynamic_cast<const SpinSystemOf<Model> *>(&previous);
+    if (!source || !SameModel(source->engine.model, engine.model))
+      return false;
+    int oldSize = (int)source->Size();
+    for (size_t i = 0; i < previousIndex.size() && i < Size(); i++) {
+      int old = previousIndex[i];
+      if (old >= 0 && old < oldSize)
+        engine.model.Apply(engine.state, (int)i,
+                           source->engine.model.Current(source->engine.state,
+                                                        old));
+    }
+    return true;
+  }
+  void SiteEnergies(const SpinModelParams &params,
+                    float *energies) const override {
+    engine.SiteEnergies(params, energies);
+  }
+  float OrderParameter() const override {
+    return engine.model.OrderParameter(engine.state);
+  }
+  Vector3 Direction(int site) const override {
+    return engine.model.Direction(engine.state, site);
+  }
+  int Label(int site) const override {
+    return engine.model.Label(engine.state, site);
+  }
+
+  SpinEngine<Model> engine;
+};
+
+unique_ptr<SpinSystem> MakeSpinSystem(SpinModelType type,
+                                      shared_ptr<const SpinTopology> topology,
+                                      int pottsStates = 3);
+/**
+ * Crée le moteur d'un modèle sur une topologie
+ * @param type Modèle de spin
+ * @param topology Voisins partagés (voir MakeSpinTopology)
+ * @param pottsStates Nombre d'états q du modèle de Potts (>= 2)
+ * @return Moteur avec les spins alignés (appeler Randomize si besoin)
+ */
+
+#endif // SPIN_MODEL_H
@@ -0,0 +1,47 @@
+#ifndef SPIN_VIEW_H
+#define SPIN_VIEW_H
+#include "spin_model.h"
+
+/**
+ * Crée une flèche de longueur 1 le long de +Y, centrée sur l'origine
+ * (tige cylindrique + pointe conique), chargée sur le GPU
+ * @param slices Nombre de facettes autour de l'axe
+ */
+Mesh GenMeshArrow(int slices = 12);
+
+/**
+ * @brief Rendu des spins vectoriels par flèches orientées
+ *
+ * Les flèches sont regroupées par couleur (12 teintes) et chaque groupe
+ * est dessiné en un seul appel DrawMeshInstanced avec un shader
+ * d'instancing. Si le shader ne compile pas, chaque flèche est dessinée
+ * séparément.
+ */
+class SpinArrows {
+public:
+  /// Charge le mesh et le shader (contexte OpenGL requis)
+  void Load();
+  void Unload();
+
+  /**
+   * Dessine une flèche par site, orientée selon system.Direction
+   * XY : teinte selon l'angle dans le plan ; Heisenberg : dégradé
+   * downColor -> upColor selon la composante z.
+   * @param structure Atomes (positions)
+   * @param system Moteur de spins de même taille
+   * @param length Longueur des flèches
+   */
+  void Draw(const vector<Atome> &structure, const SpinSystem &system,
+            float length, Color upColor, Color downColor);
+
+private:
+  static constexpr int colorBins = 12;
+  Mesh arrow = {0};
+  Shader shader = {0};
+  Material material = {0};
+  bool loaded = false;
+  bool instanced = false;
+  vector<Matrix> bins[colorBins]; // Transformations par couleur, réutilisées
+};
+
+#endif // SPIN_VIEW_H
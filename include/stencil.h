@@ -0,0 +1,421 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+#include "lattice.h"
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <utility>
+
+// NOYAUX À VOISINS IMPLICITES (réseaux de Bravais périodiques)
+
+/// Voisin d'un site : décalage de cellule (-1, 0 ou 1) et site de la base
+struct StencilOffset {
+  int dx, dy, dz;
+  int basis;
+};
+
+/**
+ * Motif de voisinage d'un type de structure, connu à la compilation
+ * basisCount sites par cellule cubique, dans l'ordre de make_*_struc ;
+ * offsets[b] liste les neighborCount voisins du site b de la base.
+ */
+template <StructureType Type> struct Stencil;
+
+template <> struct Stencil<StructureType::CUBIC> {
+  static constexpr int basisCount = 1;
+  static constexpr int neighborCount = 6;
+  static constexpr StencilOffset offsets[basisCount][neighborCount] = {
+      {{-1, 0, 0, 0},
+       {1, 0, 0, 0},
+       {0, -1, 0, 0},
+       {0, 1, 0, 0},
+       {0, 0, -1, 0},
+       {0, 0, 1, 0}}};
+};
+
+template <> struct Stencil<StructureType::BCC> {
+  // Base : coin (0,0,0), centre (1/2,1/2,1/2)
+  static constexpr int basisCount = 2;
+  static constexpr int neighborCount = 8;
+  static constexpr StencilOffset offsets[basisCount][neighborCount] = {
+      {{-1, -1, -1, 1},
+       {-1, -1, 0, 1},
+       {-1, 0, -1, 1},
+       {-1, 0, 0, 1},
+       {0, -1, -1, 1},
+       {0, -1, 0, 1},
+       {0, 0, -1, 1},
+       {0, 0, 0, 1}},
+      {{0, 0, 0, 0},
+       {0, 0, 1, 0},
+       {0, 1, 0, 0},
+       {0, 1, 1, 0},
+       {1, 0, 0, 0},
+       {1, 0, 1, 0},
+       {1, 1, 0, 0},
+       {1, 1, 1, 0}}};
+};
+
+template <> struct Stencil<StructureType::FCC> {
+  // Base : coin (0,0,0), faces (1/2,1/2,0), (1/2,0,1/2), (0,1/2,1/2)
+  static constexpr int basisCount = 4;
+  static constexpr int neighborCount = 12;
+  static constexpr StencilOffset offsets[basisCount][neighborCount] = {
+      {{-1, -1, 0, 1},
+       {-1, 0, 0, 1},
+       {0, -1, 0, 1},
+       {0, 0, 0, 1},
+       {-1, 0, -1, 2},
+       {-1, 0, 0, 2},
+       {0, 0, -1, 2},
+       {0, 0, 0, 2},
+       {0, -1, -1, 3},
+       {0, -1, 0, 3},
+       {0, 0, -1, 3},
+       {0, 0, 0, 3}},
+      {{0, 0, 0, 0},
+       {0, 1, 0, 0},
+       {1, 0, 0, 0},
+       {1, 1, 0, 0},
+       {0, 0, -1, 2},
+       {0, 0, 0, 2},
+       {0, 1, -1, 2},
+       {0, 1, 0, 2},
+       {0, 0, -1, 3},
+       {0, 0, 0, 3},
+       {1, 0, -1, 3},
+       {1, 0, 0, 3}},
+      {{0, 0, 0, 0},
+       {0, 0, 1, 0},
+       {1, 0, 0, 0},
+       {1, 0, 1, 0},
+       {0, -1, 0, 1},
+       {0, -1, 1, 1},
+       {0, 0, 0, 1},
+       {0, 0, 1, 1},
+       {0, -1, 0, 3},
+       {0, 0, 0, 3},
+       {1, -1, 0, 3},
+       {1, 0, 0, 3}},
+      {{0, 0, 0, 0},
+       {0, 0, 1, 0},
+       {0, 1, 0, 0},
+       {0, 1, 1, 0},
+       {-1, 0, 0, 1},
+       {-1, 0, 1, 1},
+       {0, 0, 0, 1},
+       {0, 0, 1, 1},
+       {-1, 0, 0, 2},
+       {-1, 1, 0, 2},
+       {0, 0, 0, 2},
+       {0, 1, 0, 2}}};
+};
+
+/// Table d'acceptation de Metropolis pour un champ local entier
+struct AcceptanceTable {
+  int maxField = 0;           // Nombre de voisins z
+  vector<uint32_t> threshold; // [2*(2z+1)] : seuils sur 2^32 par (s, h)
+
+  void Build(int neighborCount, float temperature, float J, float B);
+  uint32_t Get(int spin, int field) const {
+    return threshold[(spin > 0) * (2 * maxField + 1) + field + maxField];
+  }
+};
+
+/// Réseau périodique dont les voisins sont calculés, pas stockés
+struct StencilLattice {
+  StructureType type = StructureType::CUBIC;
+  int lx = 0, ly = 0, lz = 0; // Nombre de cellules par axe
+  int basisCount = 1;
+  vector<int8_t> spins; // +1 / -1, indice ((i*ly + j)*lz + k)*base + b
+  vector<uint8_t> pinned; // 1 : site figé (vide : aucun, voir CopyPinned)
+
+  // Table d'acceptation du dernier (T, J, B), reconstruite s'ils changent
+  AcceptanceTable table;
+  float tableT = -1.0f, tableJ = 0.0f, tableB = 0.0f;
+};
+
+// Index voisin le long d'un axe périodique, décalage connu à la compilation
+template <int D> inline int WrapAxis(int i, int length) {
+  if constexpr (D == 0)
+    return i;
+  else if constexpr (D > 0)
+    return (i + 1 == length) ? 0 : i + 1;
+  else
+    return (i == 0) ? length - 1 : i - 1;
+}
+
+template <class S, int Basis, size_t Neighbor>
+inline int StencilNeighbor(const StencilLattice &lattice, int i, int j,
+                           int k) {
+  constexpr StencilOffset o = S::offsets[Basis][Neighbor];
+  int ni = WrapAxis<o.dx>(i, lattice.lx);
+  int nj = WrapAxis<o.dy>(j, lattice.ly);
+  int nk = WrapAxis<o.dz>(k, lattice.lz);
+  return ((ni * lattice.ly + nj) * lattice.lz + nk) * S::basisCount + o.basis;
+}
+
+// Somme des spins voisins, entièrement déroulée par expansion de paramètres
+template <class S, int Basis, size_t... N>
+inline int StencilField(const StencilLattice &lattice, int i, int j, int k,
+                        index_sequence<N...>) {
+  const int8_t *spins = lattice.spins.data();
+  return (spins[StencilNeighbor<S, Basis, N>(lattice, i, j, k)] + ...);
+}
+
+template <class S, int Basis>
+inline int StencilField(const StencilLattice &lattice, int i, int j, int k) {
+  return StencilField<S, Basis>(lattice, i, j, k,
+                                make_index_sequence<S::neighborCount>{});
+}
+
+// Mise à jour de Metropolis des sites Basis.. de la cellule (i, j, k)
+// (pinned : masque des sites figés, ou nullptr)
+template <class S, int Basis>
+inline int StencilUpdateCell(StencilLattice &lattice, int cell, int i, int j,
+                             int k, const AcceptanceTable &table,
+                             const uint8_t *pinned, mt19937 &rng) {
+  int site = cell * S::basisCount + Basis;
+  int spin = lattice.spins[site];
+  int field = StencilField<S, Basis>(lattice, i, j, k);
+  int accepted = 0;
+  if ((!pinned || !pinned[site]) && rng() < table.Get(spin, field)) {
+    lattice.spins[site] = static_cast<int8_t>(-spin);
+    accepted = 1;
+  }
+  if constexpr (Basis + 1 < S::basisCount)
+    accepted += StencilUpdateCell<S, Basis + 1>(lattice, cell, i, j, k, table,
+                                                pinned, rng);
+  return accepted;
+}
+
+/**
+ * Balayage de Metropolis des cellules [firstCell, firstCell + cellCount)
+ * @return Nombre de retournements acceptés
+ */
+template <StructureType Type>
+int StencilSweepCells(StencilLattice &lattice, int firstCell, int cellCount,
+                      const AcceptanceTable &table, mt19937 &rng) {
+  using S = Stencil<Type>;
+  const uint8_t *pinned =
+      lattice.pinned.empty() ? nullptr : lattice.pinned.data();
+  int accepted = 0;
+  int i = firstCell / (lattice.ly * lattice.lz);
+  int j = (firstCell / lattice.lz) % lattice.ly;
+  int k = firstCell % lattice.lz;
+  for (int cell = firstCell; cell < firstCell + cellCount; cell++) {
+    accepted +=
+        StencilUpdateCell<S, 0>(lattice, cell, i, j, k, table, pinned, rng);
+    if (++k == lattice.lz) {
+      k = 0;
+      if (++j == lattice.ly) {
+        j = 0;
+        i++;
+      }
+    }
+  }
+  return accepted;
+}
+
+// Mise à jour de Metropolis d'un site avec un champ supplémentaire par site
+// (champ réel : probabilité calculée à la volée, pas de table)
+template <class S, int Basis>
+inline int StencilUpdateSiteField(StencilLattice &lattice, int cell, int i,
+                                  int j, int k, float temperature, float J,
+                                  float B, const float *extraField,
+                                  const uint8_t *pinned, mt19937 &rng) {
+  int site = cell * S::basisCount + Basis;
+  if (pinned && pinned[site])
+    return 0;
+  int spin = lattice.spins[site];
+  float local = J * StencilField<S, Basis>(lattice, i, j, k) + B;
+  if (extraField)
+    local += extraField[site];
+  float deltaE = 2.0f * spin * local;
+  if (deltaE > 0) {
+    if (temperature <= 0)
+      return 0;
+    float u = (rng() >> 8) * (1.0f / 16777216.0f);
+    if (u >= expf(-deltaE / temperature))
+      return 0;
+  }
+  lattice.spins[site] = static_cast<int8_t>(-spin);
+  return 1;
+}
+
+template <class S, int Basis>
+inline int StencilUpdateColor(StencilLattice &lattice, int cell, int i, int j,
+                              int k, int color, float temperature, float J,
+                              float B, const float *extraField,
+                              const uint8_t *pinned, mt19937 &rng) {
+  if (Basis == color)
+    return StencilUpdateSiteField<S, Basis>(lattice, cell, i, j, k,
+                                            temperature, J, B, extraField,
+                                            pinned, rng);
+  if constexpr (Basis + 1 < S::basisCount)
+    return StencilUpdateColor<S, Basis + 1>(lattice, cell, i, j, k, color,
+                                            temperature, J, B, extraField,
+                                            pinned, rng);
+  return 0;
+}
+
+/**
+ * Demi-balayage en damier : seuls les sites de la couleur donnée sont visités
+ * Cubique : parité de i+j+k ; BCC et FCC : site de la base (aucun voisin
+ * de même couleur). extraField (optionnel) s'ajoute à B site par site.
+ * @return Nombre de retournements acceptés
+ */
+template <StructureType Type>
+int StencilSweepColorCells(StencilLattice &lattice, int color,
+                           float temperature, float J, float B,
+                           const float *extraField, mt19937 &rng) {
+  using S = Stencil<Type>;
+  const uint8_t *pinned =
+      lattice.pinned.empty() ? nullptr : lattice.pinned.data();
+  int accepted = 0;
+  int cell = 0;
+  for (int i = 0; i < lattice.lx; i++)
+    for (int j = 0; j < lattice.ly; j++)
+      for (int k = 0; k < lattice.lz; k++, cell++) {
+        if constexpr (S::basisCount == 1) {
+          if (((i + j + k) & 1) == color)
+            accepted += StencilUpdateSiteField<S, 0>(lattice, cell, i, j, k,
+                                                     temperature, J, B,
+                                                     extraField, pinned, rng);
+        } else {
+          accepted += StencilUpdateColor<S, 0>(lattice, cell, i, j, k, color,
+                                               temperature, J, B, extraField,
+                                               pinned, rng);
+        }
+      }
+  return accepted;
+}
+
+template <class S, int Basis>
+inline float StencilCellEnergy(const StencilLattice &lattice, int cell, int i,
+                               int j, int k, float J, float B,
+                               float *siteEnergy) {
+  int site = cell * S::basisCount + Basis;
+  int spin = lattice.spins[site];
+  float energy =
+      -J * spin * StencilField<S, Basis>(lattice, i, j, k) - B * spin;
+  if (siteEnergy)
+    siteEnergy[site] = energy;
+  if constexpr (Basis + 1 < S::basisCount)
+    energy += StencilCellEnergy<S, Basis + 1>(lattice, cell, i, j, k, J, B,
+                                              siteEnergy);
+  return energy;
+}
+
+/**
+ * Énergie de chaque site (optionnelle) et somme des énergies de site
+ * (chaque liaison comptée deux fois, comme CalculateTotalEnergy)
+ */
+template <StructureType Type>
+float StencilEnergies(const StencilLattice &lattice, float J, float B,
+                      float *siteEnergy) {
+  using S = Stencil<Type>;
+  float total = 0.0f;
+  int cell = 0;
+  for (int i = 0; i < lattice.lx; i++)
+    for (int j = 0; j < lattice.ly; j++)
+      for (int k = 0; k < lattice.lz; k++, cell++)
+        total +=
+            StencilCellEnergy<S, 0>(lattice, cell, i, j, k, J, B, siteEnergy);
+  return total;
+}
+
+/**
+ * Demi-balayage en damier d'un plan x d'un réseau cubique périodique
+ * Les plans voisins sont passés à part : plans fantômes d'une tranche MPI
+ * ou repli périodique d'un réseau partagé entre threads.
+ * @param plane,previous,next Plans x, x - 1 et x + 1 (ly × lz spins)
+ * @param parity Parité de l'indice x global du plan
+ * @param color Sites visités : parité de i + j + k
+ * @return Nombre de retournements acceptés
+ */
+inline int CubicPlaneSweep(int8_t *plane, const int8_t *previous,
+                           const int8_t *next, int ly, int lz, int parity,
+                           int color, const AcceptanceTable &table,
+                           mt19937 &rng) {
+  int accepted = 0;
+  for (int j = 0; j < ly; j++) {
+    size_t row = (size_t)j * lz;
+    size_t down = (size_t)(j == 0 ? ly - 1 : j - 1) * lz;
+    size_t up = (size_t)(j + 1 == ly ? 0 : j + 1) * lz;
+    for (int k = (color ^ parity ^ j) & 1; k < lz; k += 2) {
+      int field = previous[row + k] + next[row + k] + plane[down + k] +
+                  plane[up + k] + plane[row + (k == 0 ? lz - 1 : k - 1)] +
+                  plane[row + (k + 1 == lz ? 0 : k + 1)];
+      int spin = plane[row + k];
+      if (rng() < table.Get(spin, field)) {
+        plane[row + k] = static_cast<int8_t>(-spin);
+        accepted++;
+      }
+    }
+  }
+  return accepted;
+}
+
+// FONCTIONS NON GÉNÉRIQUES (dispatch selon lattice.type)
+
+bool SupportsStencil(StructureType type);
+/**
+ * Vrai si le type a un motif de voisinage implicite (cubique, BCC, FCC)
+ */
+
+StencilLattice MakeStencilLattice(StructureType type, int x, int y, int z);
+/**
+ * Crée un réseau périodique aux dimensions de make_*_struc(x, y, z)
+ * Les sites ont le même ordre que les atomes du constructeur.
+ * @param type Type de structure (voir SupportsStencil)
+ * @param x,y,z Nombre de cellules par axe
+ * @return Réseau avec tous les spins UP
+ */
+
+int StencilNeighborCount(StructureType type);
+/**
+ * Nombre de voisins par site (6, 8 ou 12)
+ */
+
+int StencilSweep(StencilLattice &lattice, int firstCell, int cellCount,
+                 float temperature, float J, float B, mt19937 &rng);
+/**
+ * Balayage de Metropolis avec conditions aux limites périodiques
+ * @param lattice Réseau à mettre à jour
+ * @param firstCell,cellCount Plage de cellules à visiter (sans repli)
+ * @param temperature,J,B Paramètres du modèle d'Ising
+ * @param rng Générateur du thread appelant
+ * @return Nombre de retournements acceptés
+ */
+
+int StencilColorCount(StructureType type);
+/**
+ * Nombre de couleurs du damier (2 pour cubique et BCC, 4 pour FCC)
+ * Avec un nombre impair de cellules, le repli périodique du cubique relie
+ * deux sites de même couleur ; le balayage reste séquentiel donc valide.
+ */
+
+int StencilSweepColor(StencilLattice &lattice, int color, float temperature,
+                      float J, float B, const float *extraField, mt19937 &rng);
+/**
+ * Demi-balayage de Metropolis en damier (voir StencilSweepColorCells)
+ * @param color Couleur à visiter, dans [0, StencilColorCount)
+ * @param extraField Champ supplémentaire par site, ou nullptr
+ * @return Nombre de retournements acceptés
+ */
+
+void CopySpins(const vector<Atome> &structure, StencilLattice &lattice);
+/**
+ * Copie les spins et les sites figés des atomes vers le réseau implicite
+ * (même ordre)
+ */
+
+void CopySpins(const StencilLattice &lattice, vector<Atome> &structure,
+               float J, float B);
+/**
+ * Recopie les spins vers les atomes et met à jour leur énergie
+ * avec les voisins périodiques
+ */
+
+#endif // STENCIL_H
@@ -0,0 +1,129 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+using namespace std;
+
+// SERVEUR LOCAL DE TÉLÉMÉTRIE ET DE COMMANDE
+
+/// Observables publiées une fois par image (champs de 8 octets)
+struct TelemetrySnapshot {
+  uint64_t frame = 0;
+  double time = 0.0; // Secondes depuis l'ouverture de la fenêtre
+  double temperature = 0.0;
+  double J = 0.0;
+  double B = 0.0;
+  double energy = 0.0;        // Énergie totale
+  double magnetization = 0.0; // Ou paramètre d'ordre des autres modèles
+  double acceptance = 0.0;    // Retournements acceptés / tentés
+  double sweepsPerSecond = 0.0;
+  double fps = 0.0;
+  int64_t atoms = 0;
+  int64_t pinned = 0;
+  int64_t running = 0; // 1 si la simulation avance
+  int64_t model = 0;   // SpinModelType
+};
+
+/// Commande reçue du réseau, appliquée par la boucle de simulation
+enum class TelemetryAction {
+  SET_TEMPERATURE,
+  SET_J,
+  SET_B,
+  RUN,
+  PAUSE,
+  STEP,
+  CHECKPOINT,
+};
+
+struct TelemetryCommand {
+  TelemetryAction action = TelemetryAction::PAUSE;
+  float value = 0.0f; // Valeur des SET_*
+};
+
+/**
+ * @brief Serveur HTTP sur 127.0.0.1, dans un thread dédié
+ *
+ * GET /observables renvoie le dernier instantané en JSON ; GET /stream
+ * l'envoie en continu (Server-Sent Events, ?hz= pour la cadence) ;
+ * POST /control (temperature=&J=&B=&action=run|pause|step|checkpoint, dans
+ * la requête ou le corps) met des commandes en file. Les requêtes portant
+ * un en-tête Origin sont refusées : une page web ne peut pas piloter la
+ * simulation, curl et les scripts locaux si.
+ *
+ * La boucle de rendu publie l'instantané par un seqlock : l'écriture ne
+ * prend aucun verrou et n'attend jamais le thread réseau, qui recommence
+ * sa copie si elle a croisé une publication. Les commandes passent par une
+ * file circulaire un producteur / un consommateur, elle aussi sans verrou.
+ * Arrêté, le serveur ne coûte rien : Publish et PollCommand ne sont pas
+ * appelés (voir Running).
+ */
+class TelemetryServer {
+public:
+  TelemetryServer() = default;
+  TelemetryServer(const TelemetryServer &) = delete;
+  TelemetryServer &operator=(const TelemetryServer &) = delete;
+  ~TelemetryServer();
+
+  /**
+   * Ouvre le port sur 127.0.0.1 et lance le thread réseau
+   * @param port Port TCP (0 : choisi par le système, voir Port)
+   * @param error Message en cas d'échec
+   * @return true si le serveur écoute
+   */
+  bool Start(int port, string &error);
+
+  /// Ferme les connexions et attend la fin du thread réseau
+  void Stop();
+
+  bool Running() const { return running.load(memory_order_relaxed); }
+  /// Port d'écoute effectif (0 si arrêté)
+  int Port() const { return boundPort; }
+  /// Clients abonnés à /stream
+  int StreamCount() const { return streams.load(memory_order_relaxed); }
+
+  /// Cadence par défaut de /stream (Hz), modifiable à tout moment
+  void SetStreamRate(float hz) { streamRate.store(hz); }
+
+  /**
+   * Publie l'instantané de l'image (thread de rendu uniquement)
+   * Sans attente : quelques écritures atomiques et deux barrières.
+   */
+  void Publish(const TelemetrySnapshot &snapshot);
+
+  /**
+   * Retire la plus ancienne commande reçue (thread de rendu uniquement)
+   * @return false si la file est vide
+   */
+  bool PollCommand(TelemetryCommand &command);
+
+private:
+  static constexpr size_t wordCount = sizeof(TelemetrySnapshot) / 8;
+  static constexpr uint32_t commandCapacity = 64; // Puissance de deux
+
+  void Serve();
+  bool ReadSnapshot(TelemetrySnapshot &snapshot) const;
+  bool PushCommand(const TelemetryCommand &command);
+
+  // Seqlock : sequence impaire pendant une écriture
+  atomic<uint64_t> sequence{0};
+  array<atomic<uint64_t>, wordCount> words{};
+
+  array<TelemetryCommand, commandCapacity> commands;
+  atomic<uint32_t> commandHead{0}; // Prochaine écriture (thread réseau)
+  atomic<uint32_t> commandTail{0}; // Prochaine lecture (thread de rendu)
+
+  atomic<bool> running{false};
+  atomic<bool> stopping{false};
+  atomic<float> streamRate{10.0f};
+  atomic<int> streams{0};
+  int listenSocket = -1;
+  int wakePipe[2] = {-1, -1}; // Réveille poll() pour l'arrêt
+  int boundPort = 0;
+  thread worker;
+};
+
+#endif // TELEMETRY_H
@@ -0,0 +1,133 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/**
+ * @brief Groupe de threads persistants pour les calculs parallèles
+ *
+ * Les tâches sont exécutées dans l'ordre de soumission. ParallelFor découpe
+ * un intervalle en tranches contiguës (une par thread) et attend leur fin ;
+ * l'appelant prend lui-même des tranches pendant l'attente, si bien qu'un
+ * appel depuis une tâche ou une tranche du même groupe ne bloque jamais.
+ * ParallelFor et ParallelForWorkers n'allouent rien : le travail est
+ * décrit sur la pile de l'appelant, et les threads y prennent les tranches
+ * avant les tâches.
+ */
+class ThreadPool {
+public:
+  /// @param threadCount Nombre de threads (0 : un par cœur)
+  explicit ThreadPool(unsigned threadCount = 0);
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+  ~ThreadPool();
+
+  /// Nombre de threads du groupe
+  unsigned Size() const { return static_cast<unsigned>(workers.size()); }
+
+  /**
+   * Ajoute une tâche à la file
+   * @param task Tâche à exécuter
+   * @return Futur signalant la fin de la tâche
+   */
+  future<void> Submit(function<void()> task);
+
+  /**
+   * Exécute body(first, last) sur des tranches de [begin, end) en parallèle
+   * L'appelant traite des tranches lui aussi. Les bornes de chaque tranche
+   * ne dépendent que de l'intervalle et du nombre de tranches.
+   * @param begin,end Intervalle à découper
+   * @param body Traitement d'une tranche [first, last), appelé par référence
+   * @param sliceCount Nombre de tranches (0 : une par thread)
+   */
+  template <class Body>
+  void ParallelFor(int begin, int end, const Body &body, int sliceCount = 0) {
+    RunSlices(begin, end, sliceCount, &body, [](const void *b, int f, int l) {
+      (*static_cast<const Body *>(b))(f, l);
+    });
+  }
+
+  /**
+   * Découpe [begin, end) en Size() tranches et confie toujours la tranche w
+   * au thread w, qui la reçoit avec son indice ; attend leur fin
+   * Avec des threads fixés (Pin), la mémoire touchée en premier par un
+   * thread reste sur son nœud NUMA et chaque tranche y est retraitée.
+   * Attend les tâches déjà en cours sur ces threads. Appelé depuis un
+   * thread du groupe, exécute toutes les tranches sur place (sans quoi la
+   * tranche de ce thread attendrait derrière l'appelant).
+   * @param body Traitement body(w, first, last), tranche éventuellement
+   *        vide, appelé par référence
+   */
+  template <class Body>
+  void ParallelForWorkers(int begin, int end, const Body &body) {
+    RunWorkerSlices(begin, end, &body,
+                    [](const void *b, unsigned w, int f, int l) {
+                      (*static_cast<const Body *>(b))(w, f, l);
+                    });
+  }
+
+  /**
+   * Fixe le thread i sur le i-ème cœur de cpus (modulo) parmi ceux que le
+   * processus a le droit d'utiliser (sched_getaffinity) ; Linux seulement
+   * @param cpus Cœurs dans l'ordre d'attribution ; vide, ou aucun autorisé :
+   *        tous les cœurs autorisés
+   * @return false si le système a refusé un des réglages
+   */
+  bool Pin(const vector<int> &cpus);
+
+  /// Vrai si l'appelant est un thread de ce groupe
+  bool OnWorker() const;
+
+private:
+  // One ParallelFor call, on the caller's stack; fields under queueMutex
+  struct SliceJob {
+    const void *body;
+    void (*run)(const void *body, int first, int last);
+    int begin, count, slices;
+    int claimed = 0, finished = 0;
+    SliceJob *next = nullptr;
+  };
+
+  // One ParallelForWorkers call: slice w belongs to worker w. Workers take
+  // these calls in sequence order, each keeping the last one it ran
+  struct WorkerJob {
+    const void *body;
+    void (*run)(const void *body, unsigned worker, int first, int last);
+    int begin, count;
+    unsigned long long sequence;
+    unsigned finished = 0;
+    WorkerJob *next = nullptr;
+  };
+
+  void RunSlices(int begin, int end, int sliceCount, const void *body,
+                 void (*run)(const void *, int, int));
+  void RunSlice(SliceJob &job, int slice);
+  void Unlink(SliceJob &job);
+  void RunWorkerSlices(int begin, int end, const void *body,
+                       void (*run)(const void *, unsigned, int, int));
+  WorkerJob *NextWorkerJob(unsigned index) const;
+  void WorkerLoop(unsigned index);
+
+  vector<thread> workers;
+  queue<packaged_task<void()>> tasks;
+  SliceJob *jobs = nullptr; // Dernier ParallelFor en tête
+  WorkerJob *workerJobs = nullptr;       // Plus ancien en tête
+  unsigned long long workerJobCount = 0; // Séquence du dernier appel
+  vector<unsigned long long> workerDone; // Dernière séquence traitée par i
+  mutex queueMutex;
+  condition_variable queueReady;
+  condition_variable sliceDone;
+  bool stopping = false;
+};
+
+/// Groupe partagé par les modules de calcul (créé au premier appel)
+ThreadPool &SharedThreadPool();
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,106 @@
+#ifndef TIME_SERIES_H
+#define TIME_SERIES_H
+#include "frame_memory.h"
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// HISTORIQUE MULTIRÉSOLUTION ET RÉDUCTION LTTB
+
+/// Résumé d'un intervalle d'échantillons
+struct SeriesRange {
+  float min = 0.0f;
+  float max = 0.0f;
+  float mean = 0.0f;
+  uint64_t count = 0; // Échantillons couverts (0 : intervalle vide)
+};
+
+/// Point à tracer : centre d'un groupe d'échantillons et son enveloppe
+struct SeriesPoint {
+  double x = 0.0;  // Indice d'échantillon (fractionnaire pour un groupe)
+  float y = 0.0f;  // Moyenne du groupe
+  float min = 0.0f;
+  float max = 0.0f;
+};
+
+/**
+ * @brief Série temporelle de longueur illimitée en mémoire bornée
+ *
+ * Le niveau k est une file circulaire de blocs de 2^k échantillons
+ * (min, max, moyenne) ; le niveau 0 contient les valeurs brutes. Un ajout
+ * complète au plus un bloc par niveau, en cascade : O(1) amorti. Chaque
+ * niveau garde ses capacity blocs les plus récents, si bien qu'une longue
+ * exécution conserve tout son début, à une résolution de plus en plus
+ * grossière. Avec 4096 blocs et 24 niveaux, une série occupe 1,2 Mo et
+ * couvre 3,4.10^10 échantillons.
+ */
+class TimeSeries {
+public:
+  explicit TimeSeries(size_t capacity = 4096, int levelCount = 24);
+
+  void Append(float value);
+  /**
+   * Ajoute un échantillon, sans allocation
+   */
+
+  void Clear();
+
+  /// Échantillons ajoutés depuis la création ou le dernier Clear()
+  uint64_t Count() const { return count; }
+  bool Empty() const { return count == 0; }
+  /// Dernier échantillon (Empty() doit être faux)
+  float Last() const { return levels[0].Back().mean; }
+
+  uint64_t First() const;
+  /**
+   * Plus ancien échantillon encore résumé par un niveau
+   * 0 tant que le niveau le plus grossier n'a pas fait le tour.
+   */
+
+  SeriesRange Query(uint64_t first, uint64_t last) const;
+  /**
+   * Min, max et moyenne de [first, last), en O(log n)
+   * L'intervalle est découpé en blocs alignés de 2^k ; une partie déjà
+   * sortie des niveaux fins est résumée par le bloc grossier qui la
+   * contient, qui peut déborder de l'intervalle.
+   */
+
+  void Gather(uint64_t first, uint64_t last, size_t maxPoints,
+              vector<SeriesPoint> &out) const;
+  /**
+   * Points de [first, last) au niveau le plus fin qui en donne au plus
+   * maxPoints (plus un point pour la fin du dernier bloc incomplet)
+   * Le coût ne dépend pas de la longueur de l'historique.
+   * @param out Remplacé ; sa capacité est réutilisée
+   */
+
+  /// Mémoire occupée par les niveaux (octets)
+  size_t MemoryBytes() const;
+
+private:
+  struct Bucket {
+    float min, max, mean;
+  };
+
+  bool Holds(int level, uint64_t bucket) const;
+  const Bucket &At(int level, uint64_t bucket) const;
+
+  vector<RingBuffer<Bucket>> levels; // levels[k] : blocs de 2^k échantillons
+  vector<Bucket> pending;            // Première moitié du bloc en cours
+  vector<bool> hasPending;
+  uint64_t count = 0;
+};
+
+void DownsampleLTTB(const vector<SeriesPoint> &points, size_t target,
+                    vector<SeriesPoint> &out);
+/**
+ * Réduit une polyligne à target points par Largest-Triangle-Three-Buckets
+ * Le premier et le dernier point sont gardés ; dans chaque groupe, le
+ * point retenu est celui qui forme le plus grand triangle avec le point
+ * précédent et la moyenne du groupe suivant. Le min et le max du point
+ * retenu deviennent l'enveloppe de tout son groupe.
+ * @param out Remplacé ; sa capacité est réutilisée
+ */
+
+#endif // TIME_SERIES_H
@@ -0,0 +1,101 @@
+#ifndef TRACE_H
+#define TRACE_H
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// ZONES DE PROFILAGE ET EXPORT CHROME TRACE
+
+/// Zone terminée, telle que lue dans un tampon
+struct TraceEvent {
+  const char *name = nullptr; // Littéral passé à TRACE_SCOPE
+  int64_t start = 0;          // ns depuis le lancement du programme
+  int64_t duration = 0;       // ns
+  int depth = 0;              // Niveau d'imbrication dans le thread
+};
+
+/// Zones d'un thread, dans l'ordre où elles se sont terminées
+struct TraceThread {
+  int id = 0;
+  string name;
+  vector<TraceEvent> events;
+};
+
+/// Horloge des zones (ns depuis le lancement)
+int64_t TraceNow();
+
+#ifdef ISING_TRACE
+
+void TraceBegin(const char *name);
+/**
+ * Ouvre une zone sur le thread appelant (voir TRACE_BEGIN)
+ * @param name Littéral : seul le pointeur est gardé
+ */
+
+void TraceEnd();
+/**
+ * Ferme la dernière zone ouverte par le thread appelant et l'enregistre
+ */
+
+/**
+ * @brief Zone chronométrée par portée (voir TRACE_SCOPE)
+ *
+ * Chaque thread écrit dans son propre tampon circulaire, sans verrou :
+ * une zone coûte deux lectures d'horloge et quatre écritures. Les zones
+ * les plus anciennes sont écrasées quand le tampon est plein.
+ */
+class TraceScope {
+public:
+  explicit TraceScope(const char *name) { TraceBegin(name); }
+  ~TraceScope() { TraceEnd(); }
+  TraceScope(const TraceScope &) = delete;
+  TraceScope &operator=(const TraceScope &) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+// Zone couvrant une portion de bloc ; chaque TRACE_BEGIN a son TRACE_END
+#define TRACE_BEGIN(name) TraceBegin(name)
+#define TRACE_END() TraceEnd()
+
+#else
+
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+
+#endif // ISING_TRACE
+
+/// Vrai si les zones sont compilées (option CMake ISING_TRACE)
+constexpr bool TraceEnabled() {
+#ifdef ISING_TRACE
+  return true;
+#else
+  return false;
+#endif
+}
+
+void TraceSetThreadName(const char *name);
+/**
+ * Nomme le thread appelant dans le profileur et l'export
+ */
+
+void TraceSnapshot(int64_t since, vector<TraceThread> &threads);
+/**
+ * Copie les zones terminées après since, pour tous les threads
+ * @param since Instant (ns, horloge de TraceNow) ; 0 : tout le tampon
+ * @param threads Un élément par tampon, events vide compris ; les tableaux
+ * d'un appel précédent sont réutilisés
+ */
+
+bool WriteChromeTrace(const string &path);
+/**
+ * Écrit le contenu des tampons au format Chrome trace (événements "X"),
+ * lisible par chrome://tracing ou Perfetto
+ * @return Faux si le fichier ne peut pas être écrit ou si rien n'est tracé
+ */
+
+#endif // TRACE_H
@@ -0,0 +1,77 @@
+#ifndef UNIT_CELL_H
+#define UNIT_CELL_H
+#include "lattice_cache.h"
+#include "simulation.h"
+#include <cstdint>
+#include <string>
+
+/// Voisin d'un site de la base : décalage de cellule, site cible et couche
+struct CellNeighbor {
+  int dx, dy, dz;
+  int basis;
+  int shell;
+};
+
+/**
+ * @brief Maille élémentaire décrite par un fichier texte
+ *
+ * Format (une directive par ligne, '#' commence un commentaire) :
+ *   name    <nom affiché>
+ *   vector  <x> <y> <z>            (trois fois : vecteurs de maille)
+ *   basis   <u> <v> <w>            (coordonnées réduites d'un atome)
+ *   shell   <distance> <couplage>  (couche de voisins, multiplicateur de J)
+ * Les longueurs sont en unités de la distance choisie dans l'interface.
+ */
+struct UnitCell {
+  string name;
+  Vector3 vectors[3] = {{1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+  vector<Vector3> basis;       // Coordonnées réduites
+  vector<float> shellDistance; // Rayon de chaque couche
+  vector<float> shellCoupling; // Multiplicateur de J de chaque couche
+
+  // Calculé une fois par DeriveNeighborOffsets
+  vector<vector<CellNeighbor>> neighbors; // Voisins de chaque site de base
+};
+
+bool LoadUnitCell(const string &path, UnitCell &cell, string &error);
+/**
+ * Lit un fichier de maille et calcule ses décalages de voisins
+ * @param path Chemin du fichier
+ * @param cell Maille remplie en cas de succès
+ * @param error Message d'erreur (ligne fautive) en cas d'échec
+ * @return true si le fichier est valide
+ */
+
+vector<string> ListUnitCellFiles(const string &directory);
+/**
+ * Liste les fichiers *.cell d'un dossier, triés par nom
+ */
+
+void DeriveNeighborOffsets(UnitCell &cell);
+/**
+ * Cherche, pour chaque site de la base, les sites des cellules proches
+ * dont la distance correspond à une couche (tolérance 1e-3)
+ */
+
+LatticeTopology BuildUnitCellLattice(const UnitCell &cell, int x, int y,
+                                     int z, float distance, bool periodic,
+                                     BuildProgress *progress = nullptr);
+/**
+ * Construit un réseau x*y*z mailles en O(N), sans calcul de distances
+ * Les sites et le CSR sont écrits en parallèle par tranches selon x ;
+ * un premier passage compte les voisins (variable aux bords ouverts),
+ * un second les écrit. Ordre des sites : ((i*y + j)*z + k)*base + b.
+ * @param cell Maille avec ses décalages de voisins
+ * @param x,y,z Nombre de mailles par axe
+ * @param distance Facteur d'échelle des positions
+ * @param periodic Conditions aux limites périodiques
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Topologie avec la couche de chaque liaison (vide si annulé)
+ */
+
+vector<Atome> ToAtoms(const LatticeTopology &topology, const UnitCell &cell);
+/**
+ * Variante de ToAtoms qui applique les couplages de chaque couche
+ */
+
+#endif // UNIT_CELL_H
@@ -0,0 +1,125 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// COMPTES UTILISATEURS : TABLE DE HACHAGE SUR DISQUE ET SCRYPT
+
+/// Coût de scrypt : N = 2^logN blocs de 128 r octets, p passes
+struct KdfCost {
+  uint8_t logN = 14; // 16 Mo avec r = 8, quelques dizaines de ms
+  uint8_t r = 8;
+  uint8_t p = 1;
+};
+
+bool ValidKdfCost(const KdfCost &cost);
+/**
+ * logN de 1 à 20, r et p de 1 à 16, au plus 1 Go pour ROMix : bornes
+ * appliquées aux coûts lus sur disque
+ */
+
+bool Scrypt(const string &password, const uint8_t *salt, size_t saltBytes,
+            const KdfCost &cost, uint8_t *key, size_t keyBytes);
+/**
+ * Dérivation de clé scrypt (RFC 7914) : PBKDF2-HMAC-SHA256 autour de
+ * ROMix, qui parcourt N blocs au hasard. La mémoire nécessaire
+ * (128 r N octets) rend les attaques parallèles coûteuses.
+ * @param key Reçoit keyBytes octets
+ * @return false, sans rien calculer, si le coût sort de ValidKdfCost
+ */
+
+KdfCost KdfCostFromEnvironment();
+/**
+ * Coût par défaut, logN remplacé par ISING_SCRYPT_LOGN (10 à 20) s'il est
+ * défini
+ */
+
+string LegacyPasswordHash(const string &password);
+/**
+ * Empreinte de l'ancien users.txt (8 chiffres hexadécimaux), pour vérifier
+ * les comptes importés jusqu'à leur prochaine connexion
+ */
+
+/**
+ * @brief Comptes indexés par nom dans un fichier users.db
+ *
+ * Le fichier est la table elle-même : un en-tête puis des enregistrements
+ * de taille fixe, adressage ouvert avec sondage linéaire. Il est lu une
+ * fois à l'ouverture ; une recherche est un hachage du nom, un ajout écrit
+ * un seul enregistrement et l'en-tête, sauf quand la table double (fichier
+ * réécrit à côté puis renommé).
+ *
+ * Plusieurs instances peuvent partager le fichier : chaque opération prend
+ * un verrou consultatif (flock sur path.lock) et relit la suite de sondage
+ * du nom, ou toute la table si elle a grandi, avant de lire ou d'écrire.
+ * Une table qui ne peut pas doubler sans tout réécrire est relue en entier
+ * sous le verrou.
+ */
+class UserStore {
+public:
+  /**
+   * Charge la table, ou la crée en important un ancien users.txt
+   * (nom:empreinte ; la première ligne d'un nom l'emporte). Les comptes
+   * importés passent à scrypt à leur première connexion réussie.
+   * @param path Fichier de la table
+   * @param legacyPath Ancien fichier texte, lu seulement si path n'existe pas
+   * @param error Message en cas d'échec
+   */
+  bool Open(const string &path, const string &legacyPath, string &error);
+
+  /// Coût des nouvelles empreintes ; les plus faibles sont refaites au login
+  void SetCost(const KdfCost &kdfCost) { cost = kdfCost; }
+
+  /**
+   * Vérifie un mot de passe (temps constant sur l'empreinte)
+   * Une empreinte ancienne ou moins coûteuse que SetCost est recalculée et
+   * réécrite en place après un succès.
+   * @param error Message en cas d'échec (inconnu et faux sont confondus)
+   */
+  bool Verify(const string &name, const string &password, string &error);
+
+  /**
+   * Ajoute un compte, refusé si le nom existe déjà
+   * @param error Message en cas d'échec
+   */
+  bool Add(const string &name, const string &password, string &error);
+
+  size_t Count() const { return count; }
+  /// Comptes encore à l'ancienne empreinte
+  size_t LegacyCount() const;
+
+  static constexpr size_t maxNameBytes = 31;
+
+private:
+  enum : uint8_t { FREE = 0, LEGACY = 1, SCRYPT = 2 };
+
+  // One slot of the table, written to the file as is
+  struct Record {
+    char name[maxNameBytes + 1];
+    uint8_t kind;
+    KdfCost cost;
+    uint8_t salt[16];
+    uint8_t hash[32]; // Legacy: the 8 hex characters
+  };
+
+  static bool ValidRecord(Record &record);
+  size_t Home(const string &name) const;
+  size_t Slot(const string &name) const;
+  bool Load(string &error);
+  bool Refresh(const string &name, string &error);
+  void Hash(Record &record, const string &password) const;
+  bool WriteRecord(size_t slot, string &error);
+  bool WriteAll(const string &target, string &error) const;
+  void Insert(const Record &record);
+
+  string path;
+  vector<Record> records; // Puissance de deux, au plus à moitié pleine
+  size_t count = 0;
+  KdfCost cost;
+};
+
+#endif // USER_STORE_H
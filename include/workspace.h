@@ -0,0 +1,47 @@
+#ifndef WORKSPACE_H
+#define WORKSPACE_H
+#include "simulation.h"
+#include <string>
+
+// ESPACE DE TRAVAIL DE CHAQUE UTILISATEUR, REPRIS À LA CONNEXION
+
+/// Réseau, paramètres et spins de la dernière session
+struct Workspace {
+  StructureType structure = StructureType::CUBIC;
+  string unitCell; // Nom de la maille si structure vaut CUSTOM
+  int x = 10, y = 10, z = 10;
+  float distance = 2.0f;
+  float temperature = 2.5f;
+  float J = 1.0f;
+  float B = 0.0f;
+  int spinModel = 0; // SpinModelType
+  int pottsStates = 3;
+  bool periodic = false;
+  Vector3 cameraPosition = {0, 10, 30};
+  Vector3 cameraTarget = {10, 10, 10};
+  string checkpoint; // Spins à la fermeture (WriteCheckpoint), vide : aucun
+};
+
+string WorkspacePath(const string &directory, const string &user,
+                     const char *extension);
+/**
+ * Chemin directory/<nom en hexadécimal><extension>, dossier créé si
+ * besoin : n'importe quel nom donne un fichier valide et distinct
+ */
+
+bool ReadWorkspace(const string &path, Workspace &workspace, string &error);
+/**
+ * Relit un fichier "clé valeur" ; les clés absentes gardent la valeur
+ * par défaut
+ * @param workspace Inchangé en cas d'échec
+ * @param error Message en cas d'échec (fichier absent compris)
+ */
+
+bool WriteWorkspace(const string &path, const Workspace &workspace,
+                    string &error);
+/**
+ * Écrit le fichier à côté puis le renomme, comme WriteCheckpoint
+ * @param error Message en cas d'échec
+ */
+
+#endif // WORKSPACE_H
@@ -0,0 +1,243 @@
+#include "slab_lattice.h"
+#include <cstring>
+
+static const char checkpointMagic[8] = {'I', 'S', 'I', 'N', 'G', 'S', 'L', 'B'};
+static const MPI_Offset checkpointHeaderBytes = 64;
+
+// On-disk header, padded to checkpointHeaderBytes
+struct SlabHeader {
+  char magic[8];
+  int32_t version;
+  int32_t lx, ly, lz;
+};
+
+// True on every rank only if it is true on all of them
+static bool AllRanks(MPI_Comm comm, bool ok) {
+  int local = ok ? 1 : 0, all = 0;
+  MPI_Allreduce(&local, &all, 1, MPI_INT, MPI_MIN, comm);
+  return all == 1;
+}
+
+bool MakeSlabLattice(MPI_Comm comm, int lx, int ly, int lz, uint32_t seed,
+                     SlabLattice &lattice, string &error) {
+  int rank = 0, ranks = 1;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &ranks);
+  if (lx <= 0 || ly <= 0 || lz <= 0 || lx % 2 || ly % 2 || lz % 2) {
+    error = "Dimensions must be positive and even (checkerboard)";
+    return false;
+  }
+  if (lx < ranks) {
+    error = to_string(ranks) + " ranks for " + to_string(lx) +
+            " planes: every rank needs one";
+    return false;
+  }
+
+  lattice = SlabLattice();
+  lattice.comm = comm;
+  lattice.rank = rank;
+  lattice.ranks = ranks;
+  lattice.left = (rank + ranks - 1) % ranks;
+  lattice.right = (rank + 1) % ranks;
+  lattice.lx = lx;
+  lattice.ly = ly;
+  lattice.lz = lz;
+  // The first lx % ranks ranks take one extra plane
+  int base = lx / ranks, extra = lx % ranks;
+  lattice.planeCount = base + (rank < extra);
+  lattice.firstPlane = rank * base + min(rank, extra);
+  lattice.spins.assign((lattice.planeCount + 2) * lattice.PlaneSize(), 1);
+  seed_seq streams = {seed, (uint32_t)rank};
+  lattice.rng.seed(streams);
+  return true;
+}
+
+void RandomizeSlab(SlabLattice &lattice) {
+  size_t plane = lattice.PlaneSize();
+  for (size_t s = plane; s < (lattice.planeCount + 1) * plane; s++)
+    lattice.spins[s] = (lattice.rng() >> 31) ? 1 : -1;
+}
+
+// Boundary planes out, halo planes in; tag 0 travels left, tag 1 right
+static void StartHaloExchange(SlabLattice &lattice, MPI_Request requests[4]) {
+  int plane = (int)lattice.PlaneSize();
+  int8_t *spins = lattice.spins.data();
+  int last = lattice.planeCount;
+  MPI_Irecv(spins, plane, MPI_INT8_T, lattice.left, 1, lattice.comm,
+            &requests[0]);
+  MPI_Irecv(spins + (size_t)(last + 1) * plane, plane, MPI_INT8_T,
+            lattice.right, 0, lattice.comm, &requests[1]);
+  MPI_Isend(spins + plane, plane, MPI_INT8_T, lattice.left, 0, lattice.comm,
+            &requests[2]);
+  MPI_Isend(spins + (size_t)last * plane, plane, MPI_INT8_T, lattice.right, 1,
+            lattice.comm, &requests[3]);
+}
+
+static void FinishHaloExchange(SlabLattice &lattice, MPI_Request requests[4]) {
+  double start = MPI_Wtime();
+  MPI_Waitall(4, requests, MPI_STATUSES_IGNORE);
+  lattice.waitSeconds += MPI_Wtime() - start;
+}
+
+// Metropolis on the sites of one color in local planes [first, last]
+static long long UpdatePlanes(SlabLattice &lattice, int first, int last,
+                              int color) {
+  const size_t plane = lattice.PlaneSize();
+  int8_t *spins = lattice.spins.data();
+  long long accepted = 0;
+  for (int p = first; p <= last; p++) {
+    int8_t *current = spins + p * plane;
+    accepted += CubicPlaneSweep(current, current - plane, current + plane,
+                                lattice.ly, lattice.lz,
+                                (lattice.firstPlane + p - 1) & 1, color,
+                                lattice.table, lattice.rng);
+  }
+  return accepted;
+}
+
+long long SlabSweep(SlabLattice &lattice, float temperature, float J,
+                    float B) {
+  if (temperature != lattice.tableT || J != lattice.tableJ ||
+      B != lattice.tableB || lattice.table.threshold.empty()) {
+    lattice.table.Build(6, temperature, J, B);
+    lattice.tableT = temperature;
+    lattice.tableJ = J;
+    lattice.tableB = B;
+  }
+  long long accepted = 0;
+  int last = lattice.planeCount;
+  for (int color = 0; color < 2; color++) {
+    // The halos must hold the other color as the previous half-sweep left it
+    MPI_Request requests[4];
+    StartHaloExchange(lattice, requests);
+    accepted += UpdatePlanes(lattice, 2, last - 1, color);
+    FinishHaloExchange(lattice, requests);
+    accepted += UpdatePlanes(lattice, 1, 1, color);
+    if (last > 1)
+      accepted += UpdatePlanes(lattice, last, last, color);
+  }
+  return accepted;
+}
+
+SlabObservables MeasureSlab(SlabLattice &lattice, float J, float B) {
+  MPI_Request requests[4];
+  StartHaloExchange(lattice, requests);
+  FinishHaloExchange(lattice, requests);
+
+  const int ly = lattice.ly, lz = lattice.lz;
+  const size_t plane = lattice.PlaneSize();
+  const int8_t *spins = lattice.spins.data();
+  // Bonds towards +x, +y and +z only, so each is counted once
+  long long sums[2] = {0, 0}; // Bond products, spins
+  for (int p = 1; p <= lattice.planeCount; p++)
+    for (int j = 0; j < ly; j++) {
+      size_t row = (p * (size_t)ly + j) * lz;
+      size_t up = (p * (size_t)ly + (j + 1 == ly ? 0 : j + 1)) * lz;
+      for (int k = 0; k < lz; k++) {
+        int spin = spins[row + k];
+        sums[0] += spin * (spins[row + k + plane] + spins[up + k] +
+                           spins[row + (k + 1 == lz ? 0 : k + 1)]);
+        sums[1] += spin;
+      }
+    }
+  long long totals[2];
+  MPI_Allreduce(sums, totals, 2, MPI_LONG_LONG, MPI_SUM, lattice.comm);
+
+  SlabObservables observables;
+  observables.sites = (long long)lattice.lx * ly * lz;
+  observables.energy = -(double)J * totals[0] - (double)B * totals[1];
+  observables.magnetization = (double)totals[1] / observables.sites;
+  return observables;
+}
+
+// One MPI element per plane, so counts stay small on huge slabs
+static MPI_Datatype PlaneType(const SlabLattice &lattice) {
+  MPI_Datatype type;
+  MPI_Type_contiguous((int)lattice.PlaneSize(), MPI_INT8_T, &type);
+  MPI_Type_commit(&type);
+  return type;
+}
+
+bool WriteSlabCheckpoint(SlabLattice &lattice, const string &path,
+                         string &error) {
+  MPI_File file;
+  if (MPI_File_open(lattice.comm, path.c_str(),
+                    MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                    &file) != MPI_SUCCESS) {
+    error = "Cannot open " + path;
+    return false;
+  }
+  bool ok = MPI_File_set_size(file, 0) == MPI_SUCCESS;
+  if (lattice.rank == 0) {
+    char bytes[checkpointHeaderBytes] = {};
+    SlabHeader header;
+    memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+    header.version = 1;
+    header.lx = lattice.lx;
+    header.ly = lattice.ly;
+    header.lz = lattice.lz;
+    memcpy(bytes, &header, sizeof(header));
+    ok &= MPI_File_write_at(file, 0, bytes, sizeof(bytes), MPI_BYTE,
+                            MPI_STATUS_IGNORE) == MPI_SUCCESS;
+  }
+  MPI_Datatype plane = PlaneType(lattice);
+  MPI_Offset offset =
+      checkpointHeaderBytes + (MPI_Offset)lattice.firstPlane *
+                                  (MPI_Offset)lattice.PlaneSize();
+  ok &= MPI_File_write_at_all(file, offset,
+                              lattice.spins.data() + lattice.PlaneSize(),
+                              lattice.planeCount, plane,
+                              MPI_STATUS_IGNORE) == MPI_SUCCESS;
+  MPI_Type_free(&plane);
+  ok &= MPI_File_close(&file) == MPI_SUCCESS;
+  if (!AllRanks(lattice.comm, ok)) {
+    error = "Cannot write " + path;
+    return false;
+  }
+  return true;
+}
+
+bool ReadSlabCheckpoint(SlabLattice &lattice, const string &path,
+                        string &error) {
+  MPI_File file;
+  if (MPI_File_open(lattice.comm, path.c_str(), MPI_MODE_RDONLY,
+                    MPI_INFO_NULL, &file) != MPI_SUCCESS) {
+    error = "Cannot open " + path;
+    return false;
+  }
+  SlabHeader header = {};
+  bool ok = MPI_File_read_at_all(file, 0, &header, sizeof(header), MPI_BYTE,
+                                 MPI_STATUS_IGNORE) == MPI_SUCCESS;
+  bool valid = ok && !memcmp(header.magic, checkpointMagic,
+                             sizeof(checkpointMagic)) &&
+               header.version == 1;
+  if (!valid || header.lx != lattice.lx || header.ly != lattice.ly ||
+      header.lz != lattice.lz) {
+    MPI_File_close(&file);
+    error = valid ? path + " holds a " + to_string(header.lx) + "x" +
+                        to_string(header.ly) + "x" + to_string(header.lz) +
+                        " lattice"
+                  : path + " is not a slab checkpoint";
+    return false;
+  }
+  MPI_Datatype plane = PlaneType(lattice);
+  MPI_Offset offset =
+      checkpointHeaderBytes + (MPI_Offset)lattice.firstPlane *
+                                  (MPI_Offset)lattice.PlaneSize();
+  MPI_Status status;
+  ok = MPI_File_read_at_all(file, offset,
+                            lattice.spins.data() + lattice.PlaneSize(),
+                            lattice.planeCount, plane,
+                            &status) == MPI_SUCCESS;
+  int planesRead = 0;
+  if (ok)
+    MPI_Get_count(&status, plane, &planesRead);
+  ok &= planesRead == lattice.planeCount;
+  MPI_Type_free(&plane);
+  MPI_File_close(&file);
+  if (!AllRanks(lattice.comm, ok)) {
+    error = path + " is truncated";
+    return false;
+  }
+  return true;
+}
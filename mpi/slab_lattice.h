@@ -0,0 +1,92 @@
+#ifndef SLAB_LATTICE_H
+#define SLAB_LATTICE_H
+#include "stencil.h"
+#include <mpi.h>
+#include <string>
+
+// RÉSEAU CUBIQUE PÉRIODIQUE RÉPARTI ENTRE PROCESSUS MPI
+
+/**
+ * @brief Tranche de plans x d'un réseau cubique lx × ly × lz
+ *
+ * Chaque rang garde planeCount plans consécutifs à partir de firstPlane,
+ * plus deux plans fantômes : spins[0] copie le dernier plan du voisin de
+ * gauche, spins[planeCount + 1] le premier plan du voisin de droite (repli
+ * périodique entre le dernier rang et le premier). Un plan compte ly × lz
+ * sites, dans l'ordre de StencilLattice : site (i, j, k) du rang à
+ * ((i - firstPlane + 1) * ly + j) * lz + k.
+ */
+struct SlabLattice {
+  MPI_Comm comm = MPI_COMM_NULL;
+  int rank = 0, ranks = 1;
+  int left = 0, right = 0; // Rangs voisins (périodiques)
+  int lx = 0, ly = 0, lz = 0;
+  int firstPlane = 0, planeCount = 0;
+  vector<int8_t> spins; // (planeCount + 2) plans, fantômes compris
+  mt19937 rng;          // Flux propre au rang
+
+  // Table d'acceptation du dernier (T, J, B), reconstruite s'ils changent
+  AcceptanceTable table;
+  float tableT = -1.0f, tableJ = 0.0f, tableB = 0.0f;
+
+  double waitSeconds = 0.0; // Attente des plans fantômes non recouverte
+
+  size_t PlaneSize() const { return (size_t)ly * lz; }
+};
+
+/// Observables réduites sur tous les rangs
+struct SlabObservables {
+  double energy = 0.0;        // Chaque liaison comptée une fois
+  double magnetization = 0.0; // Par site
+  long long sites = 0;
+};
+
+bool MakeSlabLattice(MPI_Comm comm, int lx, int ly, int lz, uint32_t seed,
+                     SlabLattice &lattice, string &error);
+/**
+ * Découpe le réseau en tranches de plans x presque égales (collectif)
+ * Tous les spins valent +1. Le damier n'est valide avec les bords
+ * périodiques que pour des dimensions paires, et chaque rang doit recevoir
+ * au moins un plan.
+ * @param seed Graine commune, combinée au rang
+ * @param error Message en cas d'échec (identique sur tous les rangs)
+ */
+
+void RandomizeSlab(SlabLattice &lattice);
+/**
+ * Spins tirés à ±1 avec le générateur du rang (local, sans communication)
+ */
+
+long long SlabSweep(SlabLattice &lattice, float temperature, float J,
+                    float B);
+/**
+ * Balayage de Metropolis en damier (collectif)
+ * Avant chaque demi-balayage, les plans de bord partent vers les voisins
+ * pendant la mise à jour des plans intérieurs, qui n'en dépendent pas ;
+ * les deux plans de bord sont mis à jour après réception.
+ * @return Retournements acceptés sur ce rang
+ */
+
+SlabObservables MeasureSlab(SlabLattice &lattice, float J, float B);
+/**
+ * Rafraîchit les plans fantômes puis somme énergie et aimantation sur tous
+ * les rangs (collectif, même résultat partout)
+ */
+
+bool WriteSlabCheckpoint(SlabLattice &lattice, const string &path,
+                         string &error);
+/**
+ * Écrit le réseau entier avec MPI-IO, chaque rang à l'emplacement de sa
+ * tranche (collectif). Après un en-tête de 64 octets, les spins suivent
+ * l'ordre de StencilLattice, un octet par site : le fichier ne dépend pas
+ * du nombre de rangs.
+ */
+
+bool ReadSlabCheckpoint(SlabLattice &lattice, const string &path,
+                        string &error);
+/**
+ * Relit un fichier de WriteSlabCheckpoint aux mêmes dimensions, avec un
+ * nombre de rangs quelconque (collectif)
+ */
+
+#endif // SLAB_LATTICE_H
@@ -0,0 +1,151 @@
+#include "alloc_stats.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+#ifdef ISING_ALLOC_STATS
+
+// Relaxed counters: the stats panel only needs a consistent total per frame
+static atomic<uint64_t> totalCount{0};
+static atomic<uint64_t> totalBytes{0};
+static thread_local uint64_t localCount = 0;
+static thread_local uint64_t localBytes = 0;
+static atomic<AllocationHook> hook{nullptr};
+
+static void Record(size_t size) {
+  totalCount.fetch_add(1, memory_order_relaxed);
+  totalBytes.fetch_add(size, memory_order_relaxed);
+  localCount++;
+  localBytes += size;
+  if (AllocationHook observer = hook.load(memory_order_relaxed))
+    observer(size);
+}
+
+static void *AllocateBlock(size_t size, size_t alignment) {
+  if (size == 0)
+    size = 1;
+  if (alignment <= alignof(max_align_t))
+    return malloc(size);
+#ifdef _WIN32
+  return _aligned_malloc(size, alignment);
+#else
+  void *block = nullptr;
+  return posix_memalign(&block, alignment, size) == 0 ? block : nullptr;
+#endif
+}
+
+static void FreeBlock(void *block, size_t alignment) {
+#ifdef _WIN32
+  if (alignment > alignof(max_align_t)) {
+    _aligned_free(block);
+    return;
+  }
+#endif
+  (void)alignment;
+  free(block);
+}
+
+// Same contract as the standard operator new: retry through the new
+// handler, throw once there is none
+static void *Allocate(size_t size, size_t alignment) {
+  Record(size);
+  for (;;) {
+    if (void *block = AllocateBlock(size, alignment))
+      return block;
+    new_handler handler = get_new_handler();
+    if (!handler)
+      throw bad_alloc();
+    handler();
+  }
+}
+
+static void *AllocateNoThrow(size_t size, size_t alignment) noexcept {
+  try {
+    return Allocate(size, alignment);
+  } catch (...) {
+    return nullptr;
+  }
+}
+
+static const size_t plain = alignof(max_align_t);
+
+void *operator new(size_t size) { return Allocate(size, plain); }
+void *operator new[](size_t size) { return Allocate(size, plain); }
+void *operator new(size_t size, const nothrow_t &) noexcept {
+  return AllocateNoThrow(size, plain);
+}
+void *operator new[](size_t size, const nothrow_t &) noexcept {
+  return AllocateNoThrow(size, plain);
+}
+void *operator new(size_t size, align_val_t alignment) {
+  return Allocate(size, (size_t)alignment);
+}
+void *operator new[](size_t size, align_val_t alignment) {
+  return Allocate(size, (size_t)alignment);
+}
+void *operator new(size_t size, align_val_t alignment,
+                   const nothrow_t &) noexcept {
+  return AllocateNoThrow(size, (size_t)alignment);
+}
+void *operator new[](size_t size, align_val_t alignment,
+                     const nothrow_t &) noexcept {
+  return AllocateNoThrow(size, (size_t)alignment);
+}
+
+void operator delete(void *block) noexcept { FreeBlock(block, plain); }
+void operator delete[](void *block) noexcept { FreeBlock(block, plain); }
+void operator delete(void *block, size_t) noexcept { FreeBlock(block, plain); }
+void operator delete[](void *block, size_t) noexcept {
+  FreeBlock(block, plain);
+}
+void operator delete(void *block, const nothrow_t &) noexcept {
+  FreeBlock(block, plain);
+}
+void operator delete[](void *block, const nothrow_t &) noexcept {
+  FreeBlock(block, plain);
+}
+void operator delete(void *block, align_val_t alignment) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+void operator delete[](void *block, align_val_t alignment) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+void operator delete(void *block, size_t, align_val_t alignment) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+void operator delete[](void *block, size_t, align_val_t alignment) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+void operator delete(void *block, align_val_t alignment,
+                     const nothrow_t &) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+void operator delete[](void *block, align_val_t alignment,
+                       const nothrow_t &) noexcept {
+  FreeBlock(block, (size_t)alignment);
+}
+
+AllocationCounts ThreadAllocations() { return {localCount, localBytes}; }
+
+AllocationCounts TotalAllocations() {
+  return {totalCount.load(memory_order_relaxed),
+          totalBytes.load(memory_order_relaxed)};
+}
+
+AllocationHook SetAllocationHook(AllocationHook observer) {
+  return hook.exchange(observer);
+}
+
+#else
+
+AllocationCounts ThreadAllocations() { return {}; }
+
+AllocationCounts TotalAllocations() { return {}; }
+
+AllocationHook SetAllocationHook(AllocationHook) { return nullptr; }
+
+#endif // ISING_ALLOC_STATS
@@ -0,0 +1,165 @@
+#include "annealing.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+static const size_t maxHistory = 8; // Traces kept for comparison
+
+const char *AnnealScheduleName(AnnealSchedule schedule) {
+  switch (schedule) {
+  case AnnealSchedule::LINEAR:
+    return "Linear";
+  case AnnealSchedule::EXPONENTIAL:
+    return "Exponential";
+  case AnnealSchedule::QUENCH:
+    return "Quench";
+  case AnnealSchedule::ADAPTIVE:
+    return "Adaptive";
+  }
+  return "";
+}
+
+void Annealer::Start(const AnnealSettings &settings, int siteCount) {
+  Stop();
+  this->settings = settings;
+  this->settings.startTemperature = max(settings.startTemperature, 1e-3f);
+  this->settings.endTemperature = max(settings.endTemperature, 1e-3f);
+  this->siteCount = max(siteCount, 1);
+  elapsedSweeps = 0.0f;
+  elapsedSeconds = 0.0f;
+  stageStart = 0.0f;
+  stageSum = stageSquares = 0.0;
+  stageCount = 0;
+
+  switch (settings.schedule) {
+  case AnnealSchedule::LINEAR:
+  case AnnealSchedule::EXPONENTIAL:
+    coolingEnd = (float)max(settings.coolingSweeps, 0);
+    break;
+  case AnnealSchedule::QUENCH:
+    coolingEnd = 0.0f;
+    break;
+  case AnnealSchedule::ADAPTIVE:
+    coolingEnd = -1.0f; // Known once endTemperature is reached
+    break;
+  }
+  scheduleTemperature = settings.schedule == AnnealSchedule::QUENCH
+                            ? this->settings.endTemperature
+                            : this->settings.startTemperature;
+  kernelTemperature = scheduleTemperature;
+
+  char label[96];
+  snprintf(label, sizeof(label), "%s %.2f -> %.2f",
+           AnnealScheduleName(settings.schedule),
+           this->settings.startTemperature, this->settings.endTemperature);
+  current = AnnealTrace();
+  current.label = label;
+  current.tableChanges = 1;
+  active = true;
+}
+
+void Annealer::Stop() {
+  if (active)
+    Finish();
+}
+
+void Annealer::Finish() {
+  active = false;
+  history.push_back(current);
+  if (history.size() > maxHistory)
+    history.erase(history.begin());
+}
+
+void Annealer::UpdateSchedule() {
+  float t0 = settings.startTemperature, t1 = settings.endTemperature;
+  switch (settings.schedule) {
+  case AnnealSchedule::LINEAR:
+  case AnnealSchedule::EXPONENTIAL: {
+    float x = coolingEnd > 0.0f ? min(elapsedSweeps / coolingEnd, 1.0f) : 1.0f;
+    scheduleTemperature = settings.schedule == AnnealSchedule::LINEAR
+                              ? t0 + (t1 - t0) * x
+                              : t0 * powf(t1 / t0, x);
+    if (x >= 1.0f)
+      scheduleTemperature = t1; // Exact, so the hold can start
+    break;
+  }
+  case AnnealSchedule::QUENCH:
+    scheduleTemperature = t1;
+    break;
+  case AnnealSchedule::ADAPTIVE: {
+    if (coolingEnd >= 0.0f || stageCount < 2 ||
+        elapsedSweeps - stageStart < settings.stageSweeps)
+      break;
+    // Constant thermodynamic speed: the mean energy moves by speed energy
+    // standard deviations per stage, dT = speed * sigma_E / C with
+    // C = sigma_E² / T², so steps shrink where the specific heat peaks
+    double mean = stageSum / stageCount;
+    double variance = max(0.0, stageSquares / stageCount - mean * mean);
+    double sigma = sqrt(variance) * siteCount;
+    double span = fabs(t0 - t1);
+    double step = settings.speed * scheduleTemperature * scheduleTemperature /
+                  max(sigma, 1e-9);
+    step = clamp(step, 1e-3 * span, 0.1 * span);
+    float next = t1 < t0 ? scheduleTemperature - (float)step
+                         : scheduleTemperature + (float)step;
+    if ((t1 < t0) ? next <= t1 : next >= t1) {
+      next = t1;
+      coolingEnd = elapsedSweeps;
+    }
+    scheduleTemperature = next;
+    stageStart = elapsedSweeps;
+    stageSum = stageSquares = 0.0;
+    stageCount = 0;
+    break;
+  }
+  }
+}
+
+void Annealer::Advance(float sweeps, float energyPerSite, float seconds) {
+  if (!active)
+    return;
+  elapsedSweeps += sweeps;
+  elapsedSeconds += seconds;
+  current.samples.push_back(
+      {elapsedSweeps, elapsedSeconds, kernelTemperature, energyPerSite});
+
+  // Stage statistics only at a fixed kernel temperature
+  stageSum += energyPerSite;
+  stageSquares += (double)energyPerSite * energyPerSite;
+  stageCount++;
+  UpdateSchedule();
+
+  // The kernel follows the schedule in relative steps of tableTolerance,
+  // and lands exactly on the final temperature
+  float end = settings.endTemperature;
+  bool reachedEnd = scheduleTemperature == end && kernelTemperature != end;
+  if (reachedEnd || fabsf(scheduleTemperature - kernelTemperature) >
+                        settings.tableTolerance * kernelTemperature) {
+    kernelTemperature = scheduleTemperature;
+    current.tableChanges++;
+  }
+
+  if (coolingEnd >= 0.0f && kernelTemperature == end &&
+      elapsedSweeps >= coolingEnd + settings.holdSweeps) {
+    current.finished = true;
+    Finish();
+  }
+}
+
+float Annealer::Progress() const {
+  if (!active)
+    return current.finished ? 1.0f : 0.0f;
+  float hold = (float)max(settings.holdSweeps, 0);
+  if (coolingEnd >= 0.0f && elapsedSweeps >= coolingEnd)
+    return coolingEnd + hold > 0.0f
+               ? min(elapsedSweeps / (coolingEnd + hold), 1.0f)
+               : 1.0f;
+  if (settings.schedule == AnnealSchedule::ADAPTIVE) {
+    // Unknown duration: fraction of the temperature range covered
+    float span = settings.startTemperature - settings.endTemperature;
+    return fabsf(span) > 0.0f
+               ? (settings.startTemperature - scheduleTemperature) / span
+               : 0.0f;
+  }
+  return elapsedSweeps / (coolingEnd + hold);
+}
@@ -0,0 +1,49 @@
+#include "app.h"
+#include "imgui_style.h"
+#include "raylib.h"
+#include "rlImGui.h"
+#include <chrono>
+
+static const float uiScale = 1.5f;
+static const char *fontFile = "JetBrainsMonoNLNerdFont-Regular.ttf";
+
+// Initialized before main, the closest portable mark of the launch
+static const chrono::steady_clock::time_point launchTime =
+    chrono::steady_clock::now();
+
+double MillisecondsSinceLaunch() {
+  return chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                         launchTime)
+      .count();
+}
+
+StartupReport &Startup() {
+  static StartupReport report;
+  return report;
+}
+
+void InitApplication() {
+  double start = MillisecondsSinceLaunch();
+  // Initialisation fenêtre en plein écran
+  int monitor = GetCurrentMonitor();
+  int screenWidth = GetMonitorWidth(monitor);
+  int screenHeight = GetMonitorHeight(monitor);
+  InitWindow(screenWidth, screenHeight, "3D Ising Model Simulation");
+  SetWindowPosition(screenWidth / 2, screenHeight / 2);
+  SetTargetFPS(60);
+  rlImGuiSetup(true);
+  Startup().windowMs = MillisecondsSinceLaunch() - start;
+
+  Startup().font = LoadInterfaceFont(fontFile, 18.0f * uiScale);
+  SetCustomImGuiStyle(uiScale);
+}
+
+void ShutdownApplication() {
+  rlImGuiShutdown();
+  CloseWindow();
+}
+
+void MarkInteractive() {
+  if (Startup().interactiveMs == 0.0)
+    Startup().interactiveMs = MillisecondsSinceLaunch();
+}
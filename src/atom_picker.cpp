@@ -0,0 +1,164 @@
+#include "atom_picker.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// Limits the grid when the atoms are sparse or lie in a plane
+static const size_t maxCellsPerAtom = 8;
+
+void AtomPicker::Clear() {
+  nx = ny = nz = 0;
+  cellStart.clear();
+  cellAtoms.clear();
+  centers.clear();
+}
+
+void AtomPicker::Build(const vector<Atome> &structure, float radius) {
+  Clear();
+  this->radius = radius;
+  if (structure.empty())
+    return;
+
+  centers.resize(structure.size());
+  Vector3 low = {FLT_MAX, FLT_MAX, FLT_MAX};
+  Vector3 high = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (size_t i = 0; i < structure.size(); i++) {
+    const Vector3 &p = structure[i].pos;
+    centers[i] = p;
+    low = {min(low.x, p.x), min(low.y, p.y), min(low.z, p.z)};
+    high = {max(high.x, p.x), max(high.y, p.y), max(high.z, p.z)};
+  }
+  origin = {low.x - radius, low.y - radius, low.z - radius};
+  Vector3 extent = {high.x - low.x + 2 * radius, high.y - low.y + 2 * radius,
+                    high.z - low.z + 2 * radius};
+
+  // About one atom per cell, never smaller than a sphere. A single atom, a
+  // flat lattice or a zero radius give no volume: at most 1024 cells along
+  // the longest edge then, or unit cells if every edge is empty
+  double volume = (double)extent.x * extent.y * extent.z;
+  float longest = max(extent.x, max(extent.y, extent.z));
+  float smallest = longest > 0.0f ? longest / 1024.0f : 1.0f;
+  cellSize = max({2.0f * radius, (float)cbrt(volume / structure.size()),
+                  smallest});
+  auto cells = [&](float size) {
+    return (size_t)max(1, (int)ceilf(extent.x / size)) *
+           max(1, (int)ceilf(extent.y / size)) *
+           max(1, (int)ceilf(extent.z / size));
+  };
+  while (cells(cellSize) > maxCellsPerAtom * structure.size())
+    cellSize *= 1.25f;
+  nx = max(1, (int)ceilf(extent.x / cellSize));
+  ny = max(1, (int)ceilf(extent.y / cellSize));
+  nz = max(1, (int)ceilf(extent.z / cellSize));
+
+  // Counting sort of (cell, atom) pairs into CSR
+  auto forCells = [&](const Vector3 &p, auto &&visit) {
+    float inv = 1.0f / cellSize;
+    int x0 = max(0, (int)((p.x - radius - origin.x) * inv));
+    int y0 = max(0, (int)((p.y - radius - origin.y) * inv));
+    int z0 = max(0, (int)((p.z - radius - origin.z) * inv));
+    int x1 = min(nx - 1, (int)((p.x + radius - origin.x) * inv));
+    int y1 = min(ny - 1, (int)((p.y + radius - origin.y) * inv));
+    int z1 = min(nz - 1, (int)((p.z + radius - origin.z) * inv));
+    for (int x = x0; x <= x1; x++)
+      for (int y = y0; y <= y1; y++)
+        for (int z = z0; z <= z1; z++)
+          visit(CellIndex(x, y, z));
+  };
+  cellStart.assign((size_t)nx * ny * nz + 1, 0);
+  for (const Vector3 &p : centers)
+    forCells(p, [&](int cell) { cellStart[cell + 1]++; });
+  for (size_t c = 1; c < cellStart.size(); c++)
+    cellStart[c] += cellStart[c - 1];
+  cellAtoms.resize(cellStart.back());
+  vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+  for (int i = 0; i < (int)centers.size(); i++)
+    forCells(centers[i], [&](int cell) { cellAtoms[fill[cell]++] = i; });
+}
+
+int AtomPicker::Pick(Ray ray, float *hitDistance) const {
+  if (centers.empty())
+    return -1;
+  Vector3 o = ray.position;
+  Vector3 d = Vector3Normalize(ray.direction);
+  float dir[3] = {d.x, d.y, d.z};
+  float start[3] = {o.x - origin.x, o.y - origin.y, o.z - origin.z};
+  int size[3] = {nx, ny, nz};
+
+  // Slab test against the grid box
+  float tEnter = 0.0f, tExit = FLT_MAX;
+  for (int a = 0; a < 3; a++) {
+    float extent = size[a] * cellSize;
+    if (fabsf(dir[a]) < 1e-12f) {
+      if (start[a] < 0.0f || start[a] > extent)
+        return -1;
+      continue;
+    }
+    float t0 = -start[a] / dir[a], t1 = (extent - start[a]) / dir[a];
+    if (t0 > t1)
+      swap(t0, t1);
+    tEnter = max(tEnter, t0);
+    tExit = min(tExit, t1);
+  }
+  if (tEnter > tExit)
+    return -1;
+
+  // First cell and per-axis crossing distances
+  int cell[3], step[3];
+  float tMax[3], tDelta[3];
+  for (int a = 0; a < 3; a++) {
+    float p = start[a] + tEnter * dir[a];
+    cell[a] = min(size[a] - 1, max(0, (int)(p / cellSize)));
+    if (dir[a] > 0.0f) {
+      step[a] = 1;
+      tMax[a] = ((cell[a] + 1) * cellSize - start[a]) / dir[a];
+      tDelta[a] = cellSize / dir[a];
+    } else if (dir[a] < 0.0f) {
+      step[a] = -1;
+      tMax[a] = (cell[a] * cellSize - start[a]) / dir[a];
+      tDelta[a] = -cellSize / dir[a];
+    } else {
+      step[a] = 0;
+      tMax[a] = tDelta[a] = FLT_MAX;
+    }
+  }
+
+  int best = -1;
+  float bestT = FLT_MAX;
+  float r2 = radius * radius;
+  while (true) {
+    int c = CellIndex(cell[0], cell[1], cell[2]);
+    for (int k = cellStart[c]; k < cellStart[c + 1]; k++) {
+      int i = cellAtoms[k];
+      // |o + t d - c|^2 = r^2 with |d| = 1
+      Vector3 oc = Vector3Subtract(o, centers[i]);
+      float b = Vector3DotProduct(oc, d);
+      float disc = b * b - (Vector3DotProduct(oc, oc) - r2);
+      if (disc < 0.0f)
+        continue;
+      float root = sqrtf(disc);
+      float t = -b - root;
+      if (t < 0.0f)
+        t = -b + root; // Ray starts inside the sphere
+      if (t >= 0.0f && t < bestT) {
+        bestT = t;
+        best = i;
+      }
+    }
+    // Hits are final once no later cell can hold a closer one
+    float cellExit = min(tMax[0], min(tMax[1], tMax[2]));
+    if (best >= 0 && bestT <= cellExit)
+      break;
+    int a = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2)
+                              : (tMax[1] < tMax[2] ? 1 : 2);
+    if (tMax[a] > tExit)
+      break;
+    cell[a] += step[a];
+    if (cell[a] < 0 || cell[a] >= size[a])
+      break;
+    tMax[a] += tDelta[a];
+  }
+  if (best >= 0 && hitDistance)
+    *hitDistance = bestT;
+  return best;
+}
@@ -1,33 +1,20 @@
 #include "auth.h"
+#include "app.h"
 #include "imgui.h"
-#include "imgui_style.h"
 #include "rlImGui.h"
-#include <fstream>
+#include "user_store.h"
+#include <cstring>
 #include <string>
 
 using namespace std;
 
-string simple_hash(const string &input) {
-  unsigned int hash = 0;
+bool runAuthentication(string &user) {
+  // Loaded once; earlier users.txt accounts are imported on first start
+  UserStore store;
+  string store_error;
+  bool store_ready = store.Open("users.db", "users.txt", store_error);
+  store.SetCost(KdfCostFromEnvironment());
 
-  // Seed value - can be changed to alter hash results
-  const unsigned int seed = 131; // 31, 131, 1313, 13131, etc..
-
-  // Process each character in the string
-  for (char c : input) {
-    hash = (hash * seed) + c;
-    // Add some bit rotation
-    hash = (hash << 3) | (hash >> 29);
-  }
-
-  // Convert to hex string
-  char hex_str[9];
-  snprintf(hex_str, sizeof(hex_str), "%08x", hash);
-
-  return string(hex_str);
-}
-
-bool runAuthentication() {
   // User data
   char username[32] = "";
   char password[32] = "";
@@ -38,8 +25,6 @@ bool runAuthentication() {
   bool show_register = false;
   string error_msg;
 
-  SetCustomImGuiStyle(1.5f);
-
   // Main authentication loop
   while (!WindowShouldClose() && !logged_in) {
     BeginDrawing();
@@ -55,30 +40,13 @@ bool runAuthentication() {
                        ImGuiInputTextFlags_Password);
 
       if (ImGui::Button("Login")) {
-        ifstream file("users.txt");
-        if (!file) {
-          error_msg = "No users file found!";
-        } else {
-          string line;
-          bool found = false;
-          string hashed_input = simple_hash(password);
-          while (getline(file, line)) {
-            size_t colon = line.find(':');
-            if (colon != string::npos &&
-                line.substr(0, colon) == username &&
-                line.substr(colon + 1) == hashed_input) {
-              found = true;
-              break;
-            }
-          }
-
-          if (found) {
-            logged_in = true;
-            error_msg.clear();
-          } else {
-            error_msg = "Invalid username or password!";
-          }
+        if (!store_ready) {
+          error_msg = store_error;
+        } else if (store.Verify(username, password, error_msg)) {
+          logged_in = true;
+          user = username;
         }
+        password[0] = '\0';
       }
 
       if (ImGui::Button("Register")) {
@@ -90,6 +58,12 @@ bool runAuthentication() {
         ImGui::TextColored(ImVec4(1, 0, 0, 1), "%s", error_msg.c_str());
       }
 
+      const StartupReport &startup = Startup();
+      ImGui::TextDisabled("Ready in %.0f ms (font %s, %.1f ms)",
+                          startup.interactiveMs,
+                          startup.font.fromCache ? "cached" : "rasterized",
+                          startup.font.milliseconds);
+
       ImGui::End();
     } else {
       // Registration Window
@@ -106,19 +80,14 @@ bool runAuthentication() {
           error_msg = "Username and password required!";
         } else if (strcmp(reg_password, confirm_password) != 0) {
           error_msg = "Passwords don't match!";
-        } else {
-          ofstream file("users.txt", ios::app);
-          if (file) {
-            string hashed_pw = simple_hash(reg_password);
-            file << reg_username << ":" << hashed_pw << "\n";
-            error_msg = "Registration successful!";
-            // Clear registration fields
-            reg_username[0] = '\0';
-            reg_password[0] = '\0';
-            confirm_password[0] = '\0';
-          } else {
-            error_msg = "Failed to save user!";
-          }
+        } else if (!store_ready) {
+          error_msg = store_error;
+        } else if (store.Add(reg_username, reg_password, error_msg)) {
+          error_msg = "Registration successful!";
+          // Clear registration fields
+          reg_username[0] = '\0';
+          reg_password[0] = '\0';
+          confirm_password[0] = '\0';
         }
       }
 
@@ -136,6 +105,7 @@ bool runAuthentication() {
 
     rlImGuiEnd();
     EndDrawing();
+    MarkInteractive();
   }
 
   return logged_in;
@@ -0,0 +1,336 @@
+#include "autotune.h"
+#include "disorder.h"
+#include "ising_moves.h"
+#include "numa.h"
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+
+static const float temperatureBucketWidth = 0.25f; // In units of |J|
+static const int maxSamples = 4000;
+
+static const UpdateEngine allEngines[] = {
+    UpdateEngine::METROPOLIS_STENCIL, UpdateEngine::METROPOLIS_CSR,
+    UpdateEngine::WOLFF, UpdateEngine::REJECTION_FREE,
+    UpdateEngine::PARALLEL_STENCIL};
+
+const char *UpdateEngineName(UpdateEngine engine) {
+  switch (engine) {
+  case UpdateEngine::METROPOLIS_STENCIL:
+    return "metropolis-stencil";
+  case UpdateEngine::METROPOLIS_CSR:
+    return "metropolis-csr";
+  case UpdateEngine::WOLFF:
+    return "wolff";
+  case UpdateEngine::REJECTION_FREE:
+    return "rejection-free";
+  case UpdateEngine::PARALLEL_STENCIL:
+    return "parallel-stencil";
+  }
+  return "unknown";
+}
+
+string TuneKey::Name() const {
+  char name[96];
+  snprintf(name, sizeof(name), "%d-%dx%dx%d-%d-%s-t%d-b%d",
+           static_cast<int>(type), x, y, z, sites, periodic ? "pbc" : "open",
+           temperatureBucket, field ? 1 : 0);
+  return name;
+}
+
+bool TuneKey::SameLattice(const TuneKey &other) const {
+  return type == other.type && x == other.x && y == other.y &&
+         z == other.z && sites == other.sites && periodic == other.periodic;
+}
+
+TuneKey MakeTuneKey(StructureType type, int x, int y, int z, int sites,
+                    bool periodic, float temperature, float J, float B) {
+  TuneKey key;
+  key.type = type;
+  key.x = x;
+  key.y = y;
+  key.z = z;
+  key.sites = sites;
+  key.periodic = periodic;
+  float scale = J != 0.0f ? fabsf(J) : 1.0f;
+  key.temperatureBucket =
+      (int)floorf(temperature / (temperatureBucketWidth * scale));
+  key.field = B != 0.0f;
+  return key;
+}
+
+// Integrated autocorrelation time, Sokal's automatic window (c = 6)
+static double IntegratedTime(const vector<double> &series) {
+  int n = (int)series.size();
+  if (n < 4)
+    return n / 2.0;
+  double mean = 0.0;
+  for (double x : series)
+    mean += x;
+  mean /= n;
+  double variance = 0.0;
+  for (double x : series)
+    variance += (x - mean) * (x - mean);
+  if (variance <= 0.0)
+    return 0.5; // Frozen observable: every sample is the same
+  double tau = 0.5;
+  for (int lag = 1; lag < n / 2; lag++) {
+    double sum = 0.0;
+    for (int t = 0; t + lag < n; t++)
+      sum += (series[t] - mean) * (series[t + lag] - mean);
+    tau += sum / variance * n / (n - lag);
+    if (lag >= 6.0 * tau)
+      return max(tau, 0.5);
+  }
+  // Window never closed: tau is at least what the run could resolve
+  return max(tau, n / 12.0);
+}
+
+// Energy (each bond once) and |m| of spins laid out as topology
+static pair<double, double> Observe(const DisorderedLattice &topology,
+                                    const int8_t *spins, float J, float B) {
+  double bonds = 0.0;
+  long long total = 0;
+  int n = (int)topology.spins.size();
+  for (int i = 0; i < n; i++) {
+    int field = 0;
+    for (int k = topology.offsets[i]; k < topology.offsets[i + 1]; k++)
+      field += spins[topology.neighbors[k]] *
+               (topology.integerBonds ? topology.signs[k]
+                                      : topology.weights[k]);
+    bonds += spins[i] * field;
+    total += spins[i];
+  }
+  return {-0.5 * J * bonds - (double)B * total,
+          n ? fabs((double)total / n) : 0.0};
+}
+
+// One candidate: sweep() does one sweep's worth of updates
+struct Probe {
+  TuneResult result;
+  function<double()> sweep;   // Returns the sites updated or visited
+  function<const int8_t *()> spins;
+};
+
+static void MeasureProbe(Probe &probe, const DisorderedLattice &topology,
+                         float J, float B, double seconds) {
+  using Clock = chrono::steady_clock;
+  auto elapsed = [](Clock::time_point since) {
+    return chrono::duration<double>(Clock::now() - since).count();
+  };
+  Clock::time_point start = Clock::now();
+  do
+    probe.sweep();
+  while (elapsed(start) < 0.2 * seconds);
+
+  vector<double> energies, magnetizations;
+  double sweepSeconds = 0.0, updates = 0.0;
+  start = Clock::now();
+  while ((elapsed(start) < 0.8 * seconds || energies.size() < 2) &&
+         energies.size() < (size_t)maxSamples) {
+    Clock::time_point sweepStart = Clock::now();
+    updates += probe.sweep();
+    sweepSeconds += elapsed(sweepStart);
+    auto [energy, magnetization] = Observe(topology, probe.spins(), J, B);
+    energies.push_back(energy);
+    magnetizations.push_back(magnetization);
+  }
+  double tau = max(IntegratedTime(energies), IntegratedTime(magnetizations));
+  sweepSeconds = max(sweepSeconds, 1e-9);
+  probe.result.updatesPerSecond = updates / sweepSeconds;
+  probe.result.autocorrelation = tau;
+  probe.result.samplesPerSecond = energies.size() / sweepSeconds / (2.0 * tau);
+}
+
+TuneDecision CalibrateEngines(vector<Atome> structure, StencilLattice periodic,
+                              TuneKey key, float temperature, float J,
+                              float B, double secondsPerCandidate) {
+  TRACE_SCOPE("CalibrateEngines");
+  TuneDecision decision;
+  decision.key = key;
+  bool stencil = key.periodic && SupportsStencil(periodic.type) &&
+                 !periodic.spins.empty();
+  // Shared topology: runs the CSR engines and measures every candidate
+  DisorderedLattice topology =
+      stencil ? MakeDisorderedLattice(periodic)
+              : MakeDisorderedLattice(structure, DisorderParams());
+  int n = (int)topology.spins.size();
+  if (n == 0)
+    return decision;
+  double sweepUpdates = n;
+
+  vector<Probe> probes;
+  if (stencil) {
+    auto lattice = make_shared<StencilLattice>(periodic);
+    auto rng = make_shared<mt19937>(1);
+    Probe probe;
+    probe.result.engine = UpdateEngine::METROPOLIS_STENCIL;
+    probe.sweep = [lattice, rng, temperature, J, B] {
+      int cells = (int)lattice->spins.size() / lattice->basisCount;
+      StencilSweep(*lattice, 0, cells, temperature, J, B, *rng);
+      return (double)lattice->spins.size();
+    };
+    probe.spins = [lattice] { return lattice->spins.data(); };
+    probes.push_back(probe);
+  } else {
+    auto lattice = make_shared<DisorderedLattice>(topology);
+    auto rng = make_shared<mt19937>(1);
+    Probe probe;
+    probe.result.engine = UpdateEngine::METROPOLIS_CSR;
+    probe.sweep = [lattice, rng, n, temperature, J, B] {
+      DisorderSweep(*lattice, 0, n, temperature, J, B, *rng);
+      return (double)n;
+    };
+    probe.spins = [lattice] { return lattice->spins.data(); };
+    probes.push_back(probe);
+  }
+  {
+    auto lattice = make_shared<DisorderedLattice>(topology);
+    auto wolff = make_shared<WolffUpdater>();
+    auto rng = make_shared<mt19937>(1);
+    Probe probe;
+    probe.result.engine = UpdateEngine::WOLFF;
+    probe.sweep = [lattice, wolff, rng, sweepUpdates, temperature, J, B] {
+      wolff->Advance(*lattice, sweepUpdates, temperature, J, B, *rng);
+      return sweepUpdates;
+    };
+    probe.spins = [lattice] { return lattice->spins.data(); };
+    probes.push_back(probe);
+  }
+  if (topology.integerBonds) {
+    auto lattice = make_shared<DisorderedLattice>(topology);
+    auto updater = make_shared<RejectionFreeUpdater>();
+    auto rng = make_shared<mt19937>(1);
+    Probe probe;
+    probe.result.engine = UpdateEngine::REJECTION_FREE;
+    probe.sweep = [lattice, updater, rng, sweepUpdates, temperature, J, B] {
+      updater->Advance(*lattice, sweepUpdates, temperature, J, B, *rng);
+      return sweepUpdates;
+    };
+    probe.spins = [lattice] { return lattice->spins.data(); };
+    probes.push_back(probe);
+  }
+  unsigned cores = thread::hardware_concurrency();
+  // NumaLattice has no pinned sites
+  if (stencil && periodic.type == StructureType::CUBIC &&
+      periodic.lx % 2 == 0 && periodic.ly % 2 == 0 && periodic.lz % 2 == 0 &&
+      periodic.pinned.empty()) {
+    // Powers of two up to the core count, then the core count itself
+    vector<int> counts;
+    for (unsigned threads = 2; threads <= cores; threads *= 2)
+      counts.push_back((int)threads);
+    if (cores > 2 && counts.back() != (int)cores)
+      counts.push_back((int)cores);
+    for (int threads : counts) {
+      struct Parallel {
+        ThreadPool pool; // Declared first: the lattice sweeps on it
+        NumaLattice lattice;
+        explicit Parallel(int threads) : pool(threads) {}
+      };
+      auto parallel = make_shared<Parallel>(threads);
+      string error;
+      if (!parallel->lattice.Create(parallel->pool, periodic.lx, periodic.ly,
+                                    periodic.lz, 1, NumaOptions(), error))
+        continue;
+      copy(periodic.spins.begin(), periodic.spins.end(),
+           parallel->lattice.Spins());
+      Probe probe;
+      probe.result.engine = UpdateEngine::PARALLEL_STENCIL;
+      probe.result.threads = threads;
+      probe.sweep = [parallel, temperature, J, B] {
+        parallel->lattice.Sweep(temperature, J, B);
+        return (double)parallel->lattice.Sites();
+      };
+      probe.spins = [parallel] { return parallel->lattice.Spins(); };
+      probes.push_back(probe);
+    }
+  }
+
+  for (Probe &probe : probes) {
+    MeasureProbe(probe, topology, J, B, secondsPerCandidate);
+    decision.candidates.push_back(probe.result);
+    // Release the candidate, and the threads of a parallel one, right away
+    probe = Probe();
+    if (decision.candidates.back().samplesPerSecond >
+        decision.best.samplesPerSecond)
+      decision.best = decision.candidates.back();
+  }
+  return decision;
+}
+
+void TuneCache::Load() {
+  loaded = true;
+  FILE *file = fopen(path.c_str(), "r");
+  if (!file)
+    return;
+  char line[256];
+  unsigned cores = max(1u, thread::hardware_concurrency());
+  while (fgets(line, sizeof(line), file)) {
+    TuneDecision decision;
+    TuneKey &key = decision.key;
+    TuneResult &best = decision.best;
+    int type = 0, periodic = 0, field = 0;
+    char engine[32];
+    if (sscanf(line, "%d %d %d %d %d %d %d %d %31s %d %lf %lf %lf", &type,
+               &key.x, &key.y, &key.z, &key.sites, &periodic,
+               &key.temperatureBucket, &field, engine, &best.threads,
+               &best.updatesPerSecond, &best.autocorrelation,
+               &best.samplesPerSecond) != 13)
+      continue;
+    key.type = static_cast<StructureType>(type);
+    key.periodic = periodic != 0;
+    key.field = field != 0;
+    bool known = false;
+    for (UpdateEngine candidate : allEngines)
+      if (!strcmp(engine, UpdateEngineName(candidate))) {
+        best.engine = candidate;
+        known = true;
+      }
+    // Copied from a bigger machine: tune again
+    if (!known || best.threads < 1 || (unsigned)best.threads > cores)
+      continue;
+    decisions.push_back(decision);
+  }
+  fclose(file);
+}
+
+const TuneDecision *TuneCache::Find(const TuneKey &key) {
+  if (!loaded)
+    Load();
+  for (const TuneDecision &decision : decisions)
+    if (decision.key == key)
+      return &decision;
+  return nullptr;
+}
+
+bool TuneCache::Store(const TuneDecision &decision) {
+  if (!loaded)
+    Load();
+  auto same = [&decision](const TuneDecision &other) {
+    return other.key == decision.key;
+  };
+  decisions.erase(remove_if(decisions.begin(), decisions.end(), same),
+                  decisions.end());
+  decisions.push_back(decision);
+
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+  for (const TuneDecision &entry : decisions) {
+    const TuneKey &key = entry.key;
+    const TuneResult &best = entry.best;
+    fprintf(file, "%d %d %d %d %d %d %d %d %s %d %.6g %.6g %.6g\n",
+            static_cast<int>(key.type), key.x, key.y, key.z, key.sites,
+            key.periodic ? 1 : 0, key.temperatureBucket, key.field ? 1 : 0,
+            UpdateEngineName(best.engine), best.threads,
+            best.updatesPerSecond, best.autocorrelation,
+            best.samplesPerSecond);
+  }
+  return fclose(file) == 0;
+}
@@ -0,0 +1,113 @@
+#include "checkpoint.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+static const char *checkpointHeader = "ising-checkpoint 1";
+
+bool WriteCheckpoint(const string &path, const vector<Atome> &structure,
+                     const CheckpointParams &params, string &error) {
+  string temporary = path + ".tmp";
+  {
+    ofstream file(temporary, ios::binary);
+    if (!file) {
+      error = "Cannot write " + temporary;
+      return false;
+    }
+    file << checkpointHeader << "\n";
+    file << "atoms " << structure.size() << "\n";
+    file << "frame " << params.frame << "\n";
+    file << "temperature " << params.temperature << "\n";
+    file << "J " << params.J << "\n";
+    file << "B " << params.B << "\n";
+    string line(structure.size(), '+');
+    for (size_t i = 0; i < structure.size(); i++)
+      line[i] = structure[i].spin == Spin::UP ? '+' : '-';
+    file << "spins " << line << "\n";
+    for (size_t i = 0; i < structure.size(); i++)
+      line[i] = structure[i].pinned ? '1' : '0';
+    file << "pinned " << line << "\n";
+    if (!file.flush()) {
+      error = "Cannot write " + temporary;
+      return false;
+    }
+  }
+  std::error_code code;
+  filesystem::rename(temporary, path, code);
+  if (code) {
+    error = "Cannot rename " + temporary + ": " + code.message();
+    return false;
+  }
+  return true;
+}
+
+bool ReadCheckpoint(const string &path, vector<Atome> &structure,
+                    CheckpointParams &params, string &error) {
+  ifstream file(path, ios::binary);
+  string line;
+  if (!file || !getline(file, line) || line != checkpointHeader) {
+    error = path + " is not a checkpoint";
+    return false;
+  }
+  size_t atoms = 0;
+  CheckpointParams read;
+  string spins, pinned;
+  while (getline(file, line)) {
+    istringstream fields(line);
+    string key;
+    fields >> key;
+    if (key == "atoms")
+      fields >> atoms;
+    else if (key == "frame")
+      fields >> read.frame;
+    else if (key == "temperature")
+      fields >> read.temperature;
+    else if (key == "J")
+      fields >> read.J;
+    else if (key == "B")
+      fields >> read.B;
+    else if (key == "spins")
+      fields >> spins;
+    else if (key == "pinned")
+      fields >> pinned;
+  }
+  if (atoms != structure.size()) {
+    error = path + ": " + to_string(atoms) + " atoms, lattice has " +
+            to_string(structure.size());
+    return false;
+  }
+  if (spins.size() != atoms || (!pinned.empty() && pinned.size() != atoms)) {
+    error = path + " is truncated";
+    return false;
+  }
+  for (size_t i = 0; i < atoms; i++) {
+    structure[i].spin = spins[i] == '-' ? Spin::DOWN : Spin::UP;
+    structure[i].pinned = !pinned.empty() && pinned[i] == '1';
+  }
+  params = read;
+  return true;
+}
+
+string NextCheckpointPath(const string &directory, unsigned long long frame) {
+  std::error_code code;
+  filesystem::create_directories(directory, code);
+  return directory + "/frame-" + to_string(frame) + ".ising";
+}
+
+string LatestCheckpointPath(const string &directory) {
+  std::error_code code;
+  string latest;
+  filesystem::file_time_type latestTime;
+  for (const auto &entry : filesystem::directory_iterator(directory, code)) {
+    if (entry.path().extension() != ".ising")
+      continue;
+    auto time = entry.last_write_time(code);
+    if (code)
+      continue;
+    if (latest.empty() || time > latestTime) {
+      latest = entry.path().string();
+      latestTime = time;
+    }
+  }
+  return latest;
+}
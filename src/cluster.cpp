@@ -0,0 +1,278 @@
+#include "cluster.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cfloat>
+
+ClusterAnalyzer::ClusterAnalyzer(int trackedClusters)
+    : trackedClusters(max(1, min(trackedClusters, maxTrackedClusters))) {
+  ClearTracked();
+}
+
+void ClusterAnalyzer::EnsureCapacity(int siteCount) {
+  if (siteCount > capacity) {
+    parent.reset(new atomic<int>[siteCount]);
+    sizes.reset(new atomic<int>[siteCount]);
+    capacity = siteCount;
+  }
+  labels.resize(siteCount);
+}
+
+// Path halving: every visited node skips to its grandparent
+int ClusterAnalyzer::Find(int site) {
+  while (true) {
+    int p = parent[site].load(memory_order_relaxed);
+    if (p == site)
+      return site;
+    int grandparent = parent[p].load(memory_order_relaxed);
+    if (grandparent != p)
+      parent[site].compare_exchange_weak(p, grandparent,
+                                         memory_order_relaxed);
+    site = grandparent;
+  }
+}
+
+// Slab-local find and union: only the owning thread touches these trees,
+// so plain loads and stores are enough
+static int FindLocal(atomic<int> *parent, int site) {
+  while (true) {
+    int p = parent[site].load(memory_order_relaxed);
+    if (p == site)
+      return site;
+    int grandparent = parent[p].load(memory_order_relaxed);
+    parent[site].store(grandparent, memory_order_relaxed);
+    site = grandparent;
+  }
+}
+
+void ClusterAnalyzer::UniteLocal(int a, int b) {
+  a = FindLocal(parent.get(), a);
+  b = FindLocal(parent.get(), b);
+  if (a != b)
+    parent[max(a, b)].store(min(a, b), memory_order_relaxed);
+}
+
+// Component-wise min / max without the NaN handling of fminf / fmaxf
+static inline Vector3 MinOf(Vector3 a, Vector3 b) {
+  return {a.x < b.x ? a.x : b.x, a.y < b.y ? a.y : b.y,
+          a.z < b.z ? a.z : b.z};
+}
+
+static inline Vector3 MaxOf(Vector3 a, Vector3 b) {
+  return {a.x > b.x ? a.x : b.x, a.y > b.y ? a.y : b.y,
+          a.z > b.z ? a.z : b.z};
+}
+
+// Tracked roots live in a small open-addressing table that stays in L1,
+// a per-site lookup in a root-indexed array would miss the cache
+static unsigned TrackedHash(int root) {
+  return ((unsigned)root * 2654435761u) >> 25; // 7 bits
+}
+
+void ClusterAnalyzer::InsertTracked(int root, int rank) {
+  unsigned h = TrackedHash(root);
+  while (trackedRoots[h] >= 0)
+    h = (h + 1) & (trackedTableSize - 1);
+  trackedRoots[h] = root;
+  trackedRanks[h] = rank;
+}
+
+int ClusterAnalyzer::TrackedSlot(int root) const {
+  unsigned h = TrackedHash(root);
+  while (trackedRoots[h] >= 0) {
+    if (trackedRoots[h] == root)
+      return trackedRanks[h];
+    h = (h + 1) & (trackedTableSize - 1);
+  }
+  return -1;
+}
+
+void ClusterAnalyzer::ClearTracked() {
+  fill(begin(trackedRoots), end(trackedRoots), -1);
+}
+
+// Lock-free union: link the larger root under the smaller one
+void ClusterAnalyzer::Unite(int a, int b) {
+  while (true) {
+    a = Find(a);
+    b = Find(b);
+    if (a == b)
+      return;
+    if (a < b)
+      swap(a, b);
+    int expected = a;
+    if (parent[a].compare_exchange_strong(expected, b, memory_order_relaxed))
+      return;
+  }
+}
+
+const ClusterStats &ClusterAnalyzer::Analyze(const LatticeTopology &topology,
+                                             const int8_t *states) {
+  TRACE_SCOPE("ClusterAnalyzer::Analyze");
+  int n = topology.offsets.empty() ? 0 : (int)topology.offsets.size() - 1;
+  n = min(n, (int)topology.positions.size());
+  EnsureCapacity(n);
+  ThreadPool &pool = SharedThreadPool();
+  const int *offsets = topology.offsets.data();
+  const int *neighbors = topology.neighbors.data();
+  const Vector3 *positions = topology.positions.data();
+
+  pool.ParallelFor(0, n, [&](int first, int last) {
+    for (int i = first; i < last; i++) {
+      parent[i].store(i, memory_order_relaxed);
+      sizes[i].store(0, memory_order_relaxed);
+    }
+  });
+
+  // Bonds inside each slab first, without atomics read-modify-write, then
+  // the bonds across slabs with the lock-free union. Slices are the same
+  // in both calls (same range, same thread count).
+  for (int crossing = 0; crossing < 2; crossing++) {
+    pool.ParallelFor(0, n, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        int state = states[i];
+        if (state == 0)
+          continue;
+        for (int k = offsets[i]; k < offsets[i + 1]; k++) {
+          int j = neighbors[k];
+          if (j >= i || states[j] != state)
+            continue;
+          bool inside = j >= first;
+          if (crossing == 0 && inside) {
+            // Sites after i are not linked yet: while i is a root it has
+            // no children and can be hooked directly
+            if (parent[i].load(memory_order_relaxed) == i)
+              parent[i].store(FindLocal(parent.get(), j), memory_order_relaxed);
+            else
+              UniteLocal(i, j);
+          }
+          else if (crossing == 1 && !inside)
+            Unite(i, j);
+        }
+      }
+    });
+  }
+
+  // Flatten: parents always have a smaller index, so within a slab the
+  // parent's label is already final; only links to earlier slabs need Find.
+  // Sites per root are counted one run at a time.
+  pool.ParallelFor(0, n, [&](int first, int last) {
+    int runRoot = -1, runLength = 0;
+    for (int i = first; i < last; i++) {
+      int root = -1;
+      if (states[i]) {
+        int p = parent[i].load(memory_order_relaxed);
+        root = p == i ? i : (p >= first ? labels[p] : Find(i));
+      }
+      labels[i] = root;
+      if (root != runRoot) {
+        if (runRoot >= 0)
+          sizes[runRoot].fetch_add(runLength, memory_order_relaxed);
+        runRoot = root;
+        runLength = 0;
+      }
+      runLength++;
+    }
+    if (runRoot >= 0)
+      sizes[runRoot].fetch_add(runLength, memory_order_relaxed);
+  });
+
+  stats.occupiedSites = 0;
+  stats.sizeHistogram.clear();
+  clusters.clear();
+  for (int i = 0; i < n; i++) {
+    if (labels[i] < 0)
+      continue;
+    stats.occupiedSites++;
+    if (labels[i] != i)
+      continue;
+    int size = sizes[i].load(memory_order_relaxed);
+    clusters.push_back({size, i});
+    int bin = 0;
+    while ((2 << bin) <= size)
+      bin++;
+    if ((int)stats.sizeHistogram.size() <= bin)
+      stats.sizeHistogram.resize(bin + 1, 0);
+    stats.sizeHistogram[bin]++;
+  }
+  stats.clusterCount = (int)clusters.size();
+
+  // Largest clusters first, only those get a geometry
+  int tracked = min(trackedClusters, (int)clusters.size());
+  partial_sort(clusters.begin(), clusters.begin() + tracked, clusters.end(),
+               greater<pair<int, int>>());
+  stats.largest.resize(tracked);
+  for (int c = 0; c < tracked; c++) {
+    ClusterGeometry &geometry = stats.largest[c];
+    geometry = ClusterGeometry();
+    geometry.size = clusters[c].first;
+    geometry.root = clusters[c].second;
+    geometry.min = {FLT_MAX, FLT_MAX, FLT_MAX};
+    geometry.max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    InsertTracked(geometry.root, c);
+  }
+  stats.largestSize = tracked ? stats.largest[0].size : 0;
+  stats.largestFraction =
+      stats.occupiedSites ? (float)stats.largestSize / stats.occupiedSites
+                          : 0.0f;
+
+  // Per-slab sums for the tracked clusters and the lattice bounds
+  Vector3 boundsMin = {FLT_MAX, FLT_MAX, FLT_MAX};
+  Vector3 boundsMax = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  pool.ParallelFor(0, n, [&](int first, int last) {
+    struct Accumulator {
+      double x = 0, y = 0, z = 0;
+      Vector3 min = {FLT_MAX, FLT_MAX, FLT_MAX};
+      Vector3 max = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    };
+    Accumulator accumulators[maxTrackedClusters];
+    Vector3 lo = {FLT_MAX, FLT_MAX, FLT_MAX};
+    Vector3 hi = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (int i = first; i < last; i++) {
+      if (labels[i] < 0)
+        continue;
+      Vector3 pos = positions[i];
+      lo = MinOf(lo, pos);
+      hi = MaxOf(hi, pos);
+      int c = TrackedSlot(labels[i]);
+      if (c < 0)
+        continue;
+      Accumulator &a = accumulators[c];
+      a.x += pos.x;
+      a.y += pos.y;
+      a.z += pos.z;
+      a.min = MinOf(a.min, pos);
+      a.max = MaxOf(a.max, pos);
+    }
+    lock_guard<mutex> lock(mergeMutex);
+    boundsMin = MinOf(boundsMin, lo);
+    boundsMax = MaxOf(boundsMax, hi);
+    for (int c = 0; c < tracked; c++) {
+      ClusterGeometry &geometry = stats.largest[c];
+      geometry.centroid.x += (float)(accumulators[c].x / geometry.size);
+      geometry.centroid.y += (float)(accumulators[c].y / geometry.size);
+      geometry.centroid.z += (float)(accumulators[c].z / geometry.size);
+      geometry.min = MinOf(geometry.min, accumulators[c].min);
+      geometry.max = MaxOf(geometry.max, accumulators[c].max);
+    }
+  });
+
+  // Spanning: the cluster reaches both faces of the lattice along an axis
+  float tolerance = 1e-3f * max(1.0f, Vector3Distance(boundsMin, boundsMax));
+  for (auto &geometry : stats.largest) {
+    const float lo[3] = {boundsMin.x, boundsMin.y, boundsMin.z};
+    const float hi[3] = {boundsMax.x, boundsMax.y, boundsMax.z};
+    const float gmin[3] = {geometry.min.x, geometry.min.y, geometry.min.z};
+    const float gmax[3] = {geometry.max.x, geometry.max.y, geometry.max.z};
+    for (int axis = 0; axis < 3; axis++) {
+      geometry.spans[axis] = hi[axis] > lo[axis] &&
+                             gmin[axis] <= lo[axis] + tolerance &&
+                             gmax[axis] >= hi[axis] - tolerance;
+    }
+  }
+  ClearTracked();
+  stats.percolates = !stats.largest.empty() &&
+                     (stats.largest[0].spans[0] || stats.largest[0].spans[1] ||
+                      stats.largest[0].spans[2]);
+  return stats;
+}
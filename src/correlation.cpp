@@ -0,0 +1,450 @@
+#include "correlation.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+
+// Signed offset of a grid index: minimum image on periodic grids; open
+// grids are padded to twice the extent, so the same rule never wraps a pair
+static int SignedOffset(int index, int size) {
+  return index <= size / 2 ? index : index - size;
+}
+
+static float Dot(Vector3 a, Vector3 b) {
+  return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// Calls visit(a, b, bin, r) once for every unordered pair a < b of sorted
+// sites closer than maxRadius, a in cells [firstCell, lastCell). Cells are
+// maxRadius / 2 wide: the 5x5x5 block around a cell holds every partner,
+// and only the half with higher cell indices is searched.
+template <class Visit>
+static void VisitPairs(const vector<int> &cellStart,
+                       const vector<Vector3> &positions, int cx, int cy,
+                       int cz, float maxRadius, float binWidth, int firstCell,
+                       int lastCell, Visit visit) {
+  float maxRadius2 = maxRadius * maxRadius;
+  for (int cell = firstCell; cell < lastCell; cell++) {
+    int i = cell / (cy * cz), j = (cell / cz) % cy, k = cell % cz;
+    for (int ni = i; ni <= min(i + 2, cx - 1); ni++) {
+      for (int nj = max(j - 2, 0); nj <= min(j + 2, cy - 1); nj++) {
+        if (ni == i && nj < j)
+          continue;
+        for (int nk = max(k - 2, 0); nk <= min(k + 2, cz - 1); nk++) {
+          int other = (ni * cy + nj) * cz + nk;
+          if (other < cell)
+            continue;
+          for (int a = cellStart[cell]; a < cellStart[cell + 1]; a++) {
+            Vector3 pa = positions[a];
+            int b = other == cell ? a + 1 : cellStart[other];
+            for (; b < cellStart[other + 1]; b++) {
+              float dx = positions[b].x - pa.x, dy = positions[b].y - pa.y,
+                    dz = positions[b].z - pa.z;
+              float r2 = dx * dx + dy * dy + dz * dz;
+              if (r2 > maxRadius2)
+                continue;
+              float r = sqrtf(r2);
+              visit(a, b, (int)(r / binWidth + 0.5f), r);
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+void CorrelationAnalyzer::Setup(const vector<Vector3> &positions, float step,
+                                bool periodic, float binWidth,
+                                float maxRadius) {
+  siteCount = (int)positions.size();
+  this->step = step;
+  this->periodic = periodic;
+  this->binWidth = max(binWidth, 1e-3f);
+  method = CorrelationMethod::CELL_LIST;
+  gridIndex.clear();
+  power.clear();
+  occupancy.clear();
+  cellStart.clear();
+  Reset();
+  if (positions.empty())
+    return;
+
+  Vector3 origin = positions[0], corner = positions[0];
+  for (const Vector3 &p : positions) {
+    origin = Vector3Min(origin, p);
+    corner = Vector3Max(corner, p);
+  }
+  Vector3 extent = Vector3Subtract(corner, origin);
+  if (maxRadius <= 0.0f) {
+    // Half the shortest non-flat edge: beyond it, few pairs per distance
+    float shortest = 0.0f;
+    for (float edge : {extent.x, extent.y, extent.z})
+      if (edge > this->binWidth && (shortest == 0.0f || edge < shortest))
+        shortest = edge;
+    maxRadius = shortest > 0.0f ? 0.5f * shortest : this->binWidth;
+  }
+  this->maxRadius = maxRadius;
+  int binCount = (int)(maxRadius / this->binWidth + 0.5f) + 1;
+  pairCounts.assign(binCount, 0.0);
+  radiusSums.assign(binCount, 0.0);
+  products.assign(binCount, 0.0);
+  binRadii.assign(binCount, 0.0f);
+  binProducts.assign(binCount, 0.0);
+
+  if (step > 0.0f)
+    SetupGrid(positions, origin);
+  if (method != CorrelationMethod::GRID_FFT)
+    SetupCells(positions, origin, extent);
+}
+
+void CorrelationAnalyzer::SetupGrid(const vector<Vector3> &positions,
+                                    Vector3 origin) {
+  // Every site must sit on a node of the index grid, one site per node
+  vector<int> ix(siteCount), iy(siteCount), iz(siteCount);
+  nx = ny = nz = 1;
+  for (int s = 0; s < siteCount; s++) {
+    Vector3 p = Vector3Scale(Vector3Subtract(positions[s], origin), 1 / step);
+    ix[s] = (int)lroundf(p.x);
+    iy[s] = (int)lroundf(p.y);
+    iz[s] = (int)lroundf(p.z);
+    if (fabsf(p.x - ix[s]) > 1e-3f || fabsf(p.y - iy[s]) > 1e-3f ||
+        fabsf(p.z - iz[s]) > 1e-3f)
+      return;
+    nx = max(nx, ix[s] + 1);
+    ny = max(ny, iy[s] + 1);
+    nz = max(nz, iz[s] + 1);
+  }
+  if ((double)nx * ny * nz > 64.0 * siteCount)
+    return; // Too sparse for a grid to pay off
+
+  int gx = periodic || nx == 1 ? nx : 2 * nx;
+  int gy = periodic || ny == 1 ? ny : 2 * ny;
+  int gz = periodic || nz == 1 ? nz : 2 * nz;
+  size_t gridSize = (size_t)gx * gy * gz;
+  vector<uint8_t> taken((size_t)nx * ny * nz, 0);
+  gridIndex.resize(siteCount);
+  for (int s = 0; s < siteCount; s++) {
+    uint8_t &node = taken[((size_t)ix[s] * ny + iy[s]) * nz + iz[s]];
+    if (node)
+      return;
+    node = 1;
+    gridIndex[s] = (ix[s] * gy + iy[s]) * gz + iz[s];
+  }
+  method = CorrelationMethod::GRID_FFT;
+  fft = FFT3D(gx, gy, gz);
+
+  // Pairs per displacement: autocorrelation of the occupancy
+  transform.assign(gridSize, Complex(0, 0));
+  for (int s = 0; s < siteCount; s++)
+    transform[gridIndex[s]] = Complex(1, 0);
+  fft.Forward(transform);
+  occupancy.resize(gridSize);
+  for (size_t n = 0; n < gridSize; n++) {
+    occupancy[n] = norm(transform[n]);
+    transform[n] = Complex((float)occupancy[n], 0);
+  }
+  fft.Inverse(transform);
+
+  for (int i = 0; i < gx; i++) {
+    int di = SignedOffset(i, gx);
+    for (int j = 0; j < gy; j++) {
+      int dj = SignedOffset(j, gy);
+      for (int k = 0; k < gz; k++) {
+        int dk = SignedOffset(k, gz);
+        double count = roundf(transform[((size_t)i * gy + j) * gz + k].real());
+        float r = step * sqrtf((float)(di * di + dj * dj + dk * dk));
+        if (count < 0.5 || r > maxRadius)
+          continue;
+        int bin = (int)(r / binWidth + 0.5f);
+        pairCounts[bin] += count;
+        radiusSums[bin] += count * r;
+      }
+    }
+  }
+
+  for (vector<Complex> &grid : packed)
+    grid.assign(gridSize, Complex(0, 0));
+  power.assign(gridSize, 0.0);
+}
+
+void CorrelationAnalyzer::SetupCells(const vector<Vector3> &positions,
+                                     Vector3 origin, Vector3 extent) {
+  float width = 0.5f * maxRadius;
+  cx = (int)(extent.x / width) + 1;
+  cy = (int)(extent.y / width) + 1;
+  cz = (int)(extent.z / width) + 1;
+  int cellCount = cx * cy * cz;
+  auto cellOf = [&](Vector3 p) {
+    int i = min((int)((p.x - origin.x) / width), cx - 1);
+    int j = min((int)((p.y - origin.y) / width), cy - 1);
+    int k = min((int)((p.z - origin.z) / width), cz - 1);
+    return (i * cy + j) * cz + k;
+  };
+
+  // Counting sort by cell: neighboring sites end up contiguous in memory
+  cellStart.assign(cellCount + 1, 0);
+  for (const Vector3 &p : positions)
+    cellStart[cellOf(p) + 1]++;
+  for (int c = 0; c < cellCount; c++)
+    cellStart[c + 1] += cellStart[c];
+  vector<int> fill(cellStart.begin(), cellStart.end() - 1);
+  cellSites.resize(siteCount);
+  sortedPositions.resize(siteCount);
+  for (int s = 0; s < siteCount; s++) {
+    int slot = fill[cellOf(positions[s])]++;
+    cellSites[slot] = s;
+    sortedPositions[slot] = positions[s];
+  }
+  sortedSpins.assign(siteCount, {0, 0, 0});
+
+  SharedThreadPool().ParallelFor(0, cellCount, [&](int first, int last) {
+    vector<double> counts(pairCounts.size(), 0.0), sums(pairCounts.size(), 0.0);
+    VisitPairs(cellStart, sortedPositions, cx, cy, cz, maxRadius, binWidth,
+               first, last, [&](int, int, int bin, float r) {
+                 counts[bin] += 2.0;
+                 sums[bin] += 2.0 * r;
+               });
+    counts[0] += last > first ? cellStart[last] - cellStart[first] : 0;
+    lock_guard<mutex> lock(mergeMutex);
+    for (size_t b = 0; b < counts.size(); b++) {
+      pairCounts[b] += counts[b];
+      radiusSums[b] += sums[b];
+    }
+  });
+}
+
+void CorrelationAnalyzer::Reset() {
+  samples = 0;
+  fill(begin(magnetizationSums), end(magnetizationSums), 0.0);
+  fill(power.begin(), power.end(), 0.0);
+  fill(products.begin(), products.end(), 0.0);
+  result = CorrelationResult();
+  dirty = false;
+}
+
+void CorrelationAnalyzer::Accumulate(const vector<Vector3> &spins) {
+  TRACE_SCOPE("CorrelationAnalyzer::Accumulate");
+  if (siteCount == 0 || (int)spins.size() != siteCount)
+    return;
+  Vector3 total = {0, 0, 0};
+  int components = 0; // Bit 0 : pack (x, y) used, bit 1 : z used
+  for (const Vector3 &s : spins) {
+    total = Vector3Add(total, s);
+    if (s.x != 0.0f || s.y != 0.0f)
+      components |= 1;
+    if (s.z != 0.0f)
+      components |= 2;
+  }
+  magnetizationSums[0] += total.x / (double)siteCount;
+  magnetizationSums[1] += total.y / (double)siteCount;
+  magnetizationSums[2] += total.z / (double)siteCount;
+  if (method == CorrelationMethod::GRID_FFT)
+    AccumulateGrid(spins, components);
+  else
+    AccumulateCells(spins);
+  samples++;
+  dirty = true;
+}
+
+void CorrelationAnalyzer::AccumulateGrid(const vector<Vector3> &spins,
+                                         int components) {
+  int gx = fft.NX(), gy = fft.NY(), gz = fft.NZ();
+  for (int p = 0; p < 2; p++) {
+    if (!(components & (1 << p)))
+      continue;
+    vector<Complex> &grid = packed[p];
+    // Two real components share one complex transform:
+    // |X(k)|² + |Y(k)|² = (|Z(k)|² + |Z(-k)|²) / 2 for Z = X + iY
+    fill(grid.begin(), grid.end(), Complex(0, 0));
+    SharedThreadPool().ParallelFor(0, siteCount, [&](int first, int last) {
+      for (int s = first; s < last; s++)
+        grid[gridIndex[s]] = p == 0 ? Complex(spins[s].x, spins[s].y)
+                                    : Complex(spins[s].z, 0);
+    });
+    fft.Forward(grid);
+    SharedThreadPool().ParallelFor(0, gx, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        int mi = (gx - i) % gx;
+        for (int j = 0; j < gy; j++) {
+          int mj = (gy - j) % gy;
+          size_t row = ((size_t)i * gy + j) * gz;
+          size_t mirror = ((size_t)mi * gy + mj) * gz;
+          for (int k = 0; k < gz; k++) {
+            int mk = (gz - k) % gz;
+            power[row + k] +=
+                0.5 * ((double)norm(grid[row + k]) + norm(grid[mirror + mk]));
+          }
+        }
+      }
+    });
+  }
+}
+
+// Partial sums of each thread, kept between samples
+static thread_local vector<double> threadSums;
+
+void CorrelationAnalyzer::AccumulateCells(const vector<Vector3> &spins) {
+  for (int s = 0; s < siteCount; s++)
+    sortedSpins[s] = spins[cellSites[s]];
+  SharedThreadPool().ParallelFor(0, cx * cy * cz, [&](int first, int last) {
+    vector<double> &sums = threadSums;
+    sums.assign(products.size(), 0.0);
+    VisitPairs(cellStart, sortedPositions, cx, cy, cz, maxRadius, binWidth,
+               first, last, [&](int a, int b, int bin, float) {
+                 sums[bin] += 2.0f * Dot(sortedSpins[a], sortedSpins[b]);
+               });
+    for (int s = cellStart[first]; s < cellStart[last]; s++)
+      sums[0] += Dot(sortedSpins[s], sortedSpins[s]);
+    lock_guard<mutex> lock(mergeMutex);
+    for (size_t b = 0; b < sums.size(); b++)
+      products[b] += sums[b];
+  });
+}
+
+const CorrelationResult &CorrelationAnalyzer::Result() {
+  TRACE_SCOPE("CorrelationAnalyzer::Result");
+  if (!dirty || samples == 0)
+    return result;
+  // Cleared in place so the arrays keep their capacity between samples
+  result.radii.clear();
+  result.correlation.clear();
+  result.wavenumbers.clear();
+  result.structureFactor.clear();
+  result.susceptibility = 0.0f;
+  result.correlationLength = 0.0f;
+  result.samples = samples;
+  // Connected part: |<s>|², the squared mean spin, is removed everywhere
+  double meanSquare = 0.0;
+  for (double sum : magnetizationSums)
+    meanSquare += (sum / samples) * (sum / samples);
+  if (method == CorrelationMethod::GRID_FFT)
+    ResultGrid(meanSquare);
+  else
+    ResultCells(meanSquare);
+
+  for (size_t b = 0; b < pairCounts.size(); b++) {
+    if (pairCounts[b] < 0.5)
+      continue;
+    result.radii.push_back((float)(radiusSums[b] / pairCounts[b]));
+    result.correlation.push_back(
+        (float)(products[b] / (samples * pairCounts[b]) - meanSquare));
+  }
+  dirty = false;
+  return result;
+}
+
+void CorrelationAnalyzer::ResultGrid(double meanSquare) {
+  int gx = fft.NX(), gy = fft.NY(), gz = fft.NZ();
+  double scale = 1.0 / ((double)samples * siteCount);
+  // The mean spin only shows in the spectrum of the occupied sites
+  auto connected = [&](size_t n) {
+    return (power[n] - samples * meanSquare * occupancy[n]) * scale;
+  };
+
+  // S(|k|): spherical average over shells of width 2 pi / (largest edge)
+  float kStep = 2.0f * PI / (max(gx, max(gy, gz)) * step);
+  float kx = PI / step * (gx > 1), ky = PI / step * (gy > 1),
+        kz = PI / step * (gz > 1);
+  int shellCount = (int)(sqrtf(kx * kx + ky * ky + kz * kz) / kStep + 0.5f) + 1;
+  // Same count on every call for a given Setup: assign keeps the capacity
+  shellSums.assign(shellCount, 0.0);
+  shellCounts.assign(shellCount, 0);
+  for (int i = 0; i < gx; i++) {
+    float qx = 2.0f * PI * SignedOffset(i, gx) / (gx * step);
+    for (int j = 0; j < gy; j++) {
+      float qy = 2.0f * PI * SignedOffset(j, gy) / (gy * step);
+      for (int k = 0; k < gz; k++) {
+        float qz = 2.0f * PI * SignedOffset(k, gz) / (gz * step);
+        int shell = (int)(sqrtf(qx * qx + qy * qy + qz * qz) / kStep + 0.5f);
+        shellSums[shell] += connected(((size_t)i * gy + j) * gz + k);
+        shellCounts[shell]++;
+      }
+    }
+  }
+  for (int s = 0; s < shellCount; s++) {
+    if (shellCounts[s] == 0)
+      continue;
+    result.wavenumbers.push_back(s * kStep);
+    result.structureFactor.push_back((float)(shellSums[s] / shellCounts[s]));
+  }
+
+  // Second-moment length from S(0) and S(k_min) along each axis:
+  // xi² = (S(0) / S(k_min) - 1) / (4 sin²(k_min / 2))
+  double chi = connected(0);
+  result.susceptibility = (float)chi;
+  int extents[3] = {nx, ny, nz}, sizes[3] = {gx, gy, gz};
+  size_t strides[3] = {(size_t)gy * gz, (size_t)gz, 1};
+  double lengthSum = 0.0;
+  int axes = 0;
+  for (int a = 0; a < 3; a++) {
+    if (extents[a] < 2)
+      continue;
+    int index = sizes[a] / extents[a]; // k_min = 2 pi / (extent * step)
+    double f = connected(index * strides[a]);
+    double sine = sin(PI / extents[a]);
+    if (f <= 0.0 || chi <= f)
+      continue;
+    lengthSum += (chi / f - 1.0) / (4.0 * sine * sine);
+    axes++;
+  }
+  if (axes > 0)
+    result.correlationLength = (float)(step * sqrt(lengthSum / axes));
+
+  // G(r): the inverse transform of the mean power is sum_i s_i.s_(i+d);
+  // Result removes |<s>|² per pair
+  for (size_t n = 0; n < transform.size(); n++)
+    transform[n] = Complex((float)(power[n] / samples), 0);
+  fft.Inverse(transform);
+  fill(products.begin(), products.end(), 0.0);
+  for (int i = 0; i < gx; i++) {
+    int di = SignedOffset(i, gx);
+    for (int j = 0; j < gy; j++) {
+      int dj = SignedOffset(j, gy);
+      for (int k = 0; k < gz; k++) {
+        int dk = SignedOffset(k, gz);
+        float r = step * sqrtf((float)(di * di + dj * dj + dk * dk));
+        if (r > maxRadius)
+          continue;
+        products[(int)(r / binWidth + 0.5f)] +=
+            transform[((size_t)i * gy + j) * gz + k].real() * (double)samples;
+      }
+    }
+  }
+}
+
+void CorrelationAnalyzer::ResultCells(double meanSquare) {
+  double scale = 1.0 / ((double)samples * siteCount);
+  vector<float> &radii = binRadii;
+  vector<double> &connected = binProducts;
+  fill(radii.begin(), radii.end(), 0.0f);
+  fill(connected.begin(), connected.end(), 0.0);
+  double total = 0.0, moment = 0.0;
+  for (size_t b = 0; b < pairCounts.size(); b++) {
+    if (pairCounts[b] < 0.5)
+      continue;
+    radii[b] = (float)(radiusSums[b] / pairCounts[b]);
+    connected[b] = (products[b] - samples * meanSquare * pairCounts[b]) * scale;
+    total += connected[b];
+    moment += connected[b] * radii[b] * radii[b];
+  }
+
+  // Debye formula: S(k) = 1/N sum_ij G_ij sin(k r_ij) / (k r_ij), with
+  // the pair sum truncated at maxRadius
+  int shellCount = (int)pairCounts.size();
+  float dk = PI / maxRadius;
+  for (int s = 0; s < shellCount; s++) {
+    float k = s * dk;
+    double sum = 0.0;
+    for (size_t b = 0; b < pairCounts.size(); b++) {
+      float x = k * radii[b];
+      sum += connected[b] * (x > 1e-6f ? sinf(x) / x : 1.0f);
+    }
+    result.wavenumbers.push_back(k);
+    result.structureFactor.push_back((float)sum);
+  }
+  result.susceptibility = (float)total;
+
+  // Real-space second moment: xi² = sum r² G(r) / (2d sum G(r)), d = 3
+  if (total > 0.0 && moment > 0.0)
+    result.correlationLength = (float)sqrt(moment / (6.0 * total));
+}
@@ -0,0 +1,192 @@
+#include "dipolar.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <cmath>
+
+// Basis site positions in cell units, same order as make_*_struc
+static vector<Vector3> BasisPositions(StructureType type) {
+  switch (type) {
+  case StructureType::CUBIC:
+    return {{0, 0, 0}};
+  case StructureType::BCC:
+    return {{0, 0, 0}, {0.5f, 0.5f, 0.5f}};
+  case StructureType::FCC:
+    return {{0, 0, 0}, {0.5f, 0.5f, 0}, {0.5f, 0, 0.5f}, {0, 0.5f, 0.5f}};
+  default:
+    return {};
+  }
+}
+
+// Pair energy per unit strength, moments along z
+static double DipolarPair(double x, double y, double z) {
+  double r2 = x * x + y * y + z * z;
+  if (r2 < 1e-12)
+    return 0.0;
+  double r = sqrt(r2);
+  return (1.0 - 3.0 * z * z / r2) / (r2 * r);
+}
+
+// Offset along one grid axis: open grids hold -(L-1)..L-1, periodic grids
+// any representative (NearestImage recenters it)
+static int GridOffset(int index, int size, int length, bool periodic) {
+  int offset = index <= size / 2 ? index : index - size;
+  if (periodic)
+    return offset;
+  return (offset > -length && offset < length) ? offset : size;
+}
+
+// Nearest image of a periodic pair offset, in [-L/2, L/2). Basis shifts
+// push grid offsets up to L/2 + 1/2: a truncated image sum centered there
+// is lopsided and breaks K(d) = K(-d). Exactly half a period away both
+// centerings agree, the pair energy being even in each coordinate
+static double NearestImage(double x, int length) {
+  return x - length * floor(x / length + 0.5);
+}
+
+static int PairIndex(int a, int b, int basisCount) {
+  // Row-major upper triangle: (0,0), (0,1), ..., (1,1), ...
+  return a * basisCount - a * (a - 1) / 2 + (b - a);
+}
+
+bool DipolarField::Setup(const StencilLattice &lattice,
+                         DipolarBoundary boundary) {
+  vector<Vector3> basis = BasisPositions(lattice.type);
+  if (basis.empty())
+    return false;
+  if (lattice.type == type && lattice.lx == lx && lattice.ly == ly &&
+      lattice.lz == lz && boundary == this->boundary && !kernels.empty())
+    return true;
+
+  type = lattice.type;
+  lx = lattice.lx;
+  ly = lattice.ly;
+  lz = lattice.lz;
+  basisCount = (int)basis.size();
+  this->boundary = boundary;
+  bool periodic = boundary == DipolarBoundary::PERIODIC;
+
+  // Open boundaries: zero padding to at least 2L-1 turns the cyclic
+  // convolution into a linear one; powers of two keep the radix-2 path
+  int nx = periodic ? lx : NextPowerOfTwo(2 * lx - 1);
+  int ny = periodic ? ly : NextPowerOfTwo(2 * ly - 1);
+  int nz = periodic ? lz : NextPowerOfTwo(2 * lz - 1);
+  fft = FFT3D(nx, ny, nz);
+  size_t gridSize = (size_t)nx * ny * nz;
+
+  kernels.assign(basisCount * (basisCount + 1) / 2, {});
+  for (int a = 0; a < basisCount; a++) {
+    for (int b = a; b < basisCount; b++) {
+      vector<Complex> &kernel = kernels[PairIndex(a, b, basisCount)];
+      kernel.assign(gridSize, Complex(0, 0));
+      // h_a(c) = sum_c' K(c' - c + b_b - b_a) s_b(c'), as a convolution
+      // over d = c - c' with the (even) pair kernel
+      Vector3 shift = Vector3Subtract(basis[a], basis[b]);
+      SharedThreadPool().ParallelFor(0, nx, [&](int first, int last) {
+        for (int gi = first; gi < last; gi++) {
+          int di = GridOffset(gi, nx, lx, periodic);
+          if (di == nx)
+            continue;
+          for (int gj = 0; gj < ny; gj++) {
+            int dj = GridOffset(gj, ny, ly, periodic);
+            if (dj == ny)
+              continue;
+            for (int gk = 0; gk < nz; gk++) {
+              int dk = GridOffset(gk, nz, lz, periodic);
+              if (dk == nz)
+                continue;
+              double x = di + shift.x, y = dj + shift.y, z = dk + shift.z;
+              double sum = 0.0;
+              if (!periodic) {
+                sum = DipolarPair(x, y, z);
+              } else {
+                // Truncated image sum around the nearest image; self
+                // images only add a constant
+                x = NearestImage(x, lx);
+                y = NearestImage(y, ly);
+                z = NearestImage(z, lz);
+                for (int px = -1; px <= 1; px++)
+                  for (int py = -1; py <= 1; py++)
+                    for (int pz = -1; pz <= 1; pz++)
+                      sum += DipolarPair(x + px * lx, y + py * ly,
+                                         z + pz * lz);
+                if (a == b && di == 0 && dj == 0 && dk == 0)
+                  sum = 0.0;
+              }
+              kernel[((size_t)gi * ny + gj) * nz + gk] = Complex((float)sum, 0);
+            }
+          }
+        }
+      });
+      fft.Forward(kernel);
+    }
+  }
+
+  spinGrids.assign(basisCount, vector<Complex>(gridSize));
+  accumulator.assign(gridSize, Complex(0, 0));
+  field.assign((size_t)lx * ly * lz * basisCount, 0.0f);
+  return true;
+}
+
+void DipolarField::Update(const StencilLattice &lattice, float strength) {
+  TRACE_SCOPE("DipolarField::Update");
+  int nx = fft.NX(), ny = fft.NY(), nz = fft.NZ();
+
+  for (int b = 0; b < basisCount; b++) {
+    vector<Complex> &grid = spinGrids[b];
+    fill(grid.begin(), grid.end(), Complex(0, 0));
+    SharedThreadPool().ParallelFor(0, lx, [&](int first, int last) {
+      for (int i = first; i < last; i++)
+        for (int j = 0; j < ly; j++)
+          for (int k = 0; k < lz; k++) {
+            size_t site = (((size_t)i * ly + j) * lz + k) * basisCount + b;
+            grid[((size_t)i * ny + j) * nz + k] =
+                Complex(lattice.spins[site], 0);
+          }
+    });
+    fft.Forward(grid);
+  }
+
+  for (int a = 0; a < basisCount; a++) {
+    // h_a = -g sum_b K_ab * s_b, with K_ab(r) = K_ba(-r): conjugate spectrum
+    SharedThreadPool().ParallelFor(0, nx, [&](int first, int last) {
+      size_t begin = (size_t)first * ny * nz, end = (size_t)last * ny * nz;
+      for (size_t n = begin; n < end; n++) {
+        Complex sum(0, 0);
+        for (int b = 0; b < basisCount; b++) {
+          Complex k = a <= b ? kernels[PairIndex(a, b, basisCount)][n]
+                             : conj(kernels[PairIndex(b, a, basisCount)][n]);
+          sum += k * spinGrids[b][n];
+        }
+        accumulator[n] = sum;
+      }
+    });
+    fft.Inverse(accumulator);
+    for (int i = 0; i < lx; i++)
+      for (int j = 0; j < ly; j++)
+        for (int k = 0; k < lz; k++) {
+          size_t site = (((size_t)i * ly + j) * lz + k) * basisCount + a;
+          field[site] =
+              -strength * accumulator[((size_t)i * ny + j) * nz + k].real();
+        }
+  }
+}
+
+float DipolarField::Energy(const StencilLattice &lattice) const {
+  double energy = 0.0;
+  for (size_t i = 0; i < field.size() && i < lattice.spins.size(); i++)
+    energy += lattice.spins[i] * field[i];
+  return (float)(-0.5 * energy);
+}
+
+int DipolarSweep(StencilLattice &lattice, DipolarField &dipolar,
+                 float strength, float temperature, float J, float B,
+                 mt19937 &rng) {
+  int accepted = 0;
+  int colors = StencilColorCount(lattice.type);
+  for (int color = 0; color < colors; color++) {
+    dipolar.Update(lattice, strength);
+    accepted += StencilSweepColor(lattice, color, temperature, J, B,
+                                  dipolar.Data(), rng);
+  }
+  return accepted;
+}
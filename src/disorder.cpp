@@ -0,0 +1,387 @@
+#include "disorder.h"
+#include "thread_pool.h"
+#include "trace.h"
+#include <chrono>
+
+// SplitMix64 finalizer: a well-mixed 64-bit hash
+static uint64_t Mix(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// Uniform in [0, 1) from (seed, key, channel), independent of visit order
+static double HashUnit(uint32_t seed, uint64_t key, uint64_t channel) {
+  uint64_t h = Mix(Mix(key ^ ((uint64_t)seed << 32)) + channel);
+  return (h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static uint64_t BondKey(int i, int j) {
+  uint64_t a = (uint32_t)min(i, j), b = (uint32_t)max(i, j);
+  return (a << 32) | b;
+}
+
+static const uint64_t vacancyChannel = 0xffffffffULL;
+
+bool HasDisorder(const DisorderParams &params) {
+  return params.bonds != BondDisorder::UNIFORM || params.vacancyFraction > 0;
+}
+
+DisorderedLattice MakeDisorderedLattice(const vector<Atome> &structure,
+                                        const DisorderParams &params) {
+  TRACE_SCOPE("MakeDisorderedLattice");
+  DisorderedLattice lattice;
+  bool shellCouplings = false;
+  for (const auto &atom : structure)
+    shellCouplings |= !atom.coupling.empty();
+  lattice.integerBonds =
+      params.bonds != BondDisorder::GAUSSIAN && !shellCouplings;
+
+  lattice.offsets.reserve(structure.size() + 1);
+  lattice.offsets.push_back(0);
+  lattice.spins.resize(structure.size());
+  for (int i = 0; i < (int)structure.size(); i++) {
+    const Atome &atom = structure[i];
+    bool vacant = HashUnit(params.seed, (uint64_t)i, vacancyChannel) <
+                  params.vacancyFraction;
+    lattice.spins[i] = vacant ? 0 : static_cast<int8_t>(atom.spin);
+
+    for (size_t n = 0; n < atom.neigh.size(); n++) {
+      int j = atom.neigh[n];
+      uint64_t key = BondKey(i, j);
+      float weight = 1.0f;
+      if (params.bonds == BondDisorder::PLUS_MINUS) {
+        weight = HashUnit(params.seed, key, 0) < params.antiferroFraction
+                     ? -1.0f
+                     : 1.0f;
+      } else if (params.bonds == BondDisorder::GAUSSIAN) {
+        // Box-Muller on two hashed uniforms of the bond
+        double u1 = max(HashUnit(params.seed, key, 0), 1e-300);
+        double u2 = HashUnit(params.seed, key, 1);
+        double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+        weight = params.mean + params.spread * (float)normal;
+      }
+      if (!atom.coupling.empty())
+        weight *= atom.coupling[n];
+
+      lattice.neighbors.push_back(j);
+      if (lattice.integerBonds)
+        lattice.signs.push_back(static_cast<int8_t>(weight));
+      else
+        lattice.weights.push_back(weight);
+    }
+    lattice.offsets.push_back((int)lattice.neighbors.size());
+    lattice.maxDegree = max(lattice.maxDegree, (int)atom.neigh.size());
+  }
+  CopyPinned(structure, lattice.pinned);
+  return lattice;
+}
+
+// Neighbors of every site in the order of StencilField, wrapped
+template <StructureType Type>
+static void AppendStencilNeighbors(const StencilLattice &stencil,
+                                   DisorderedLattice &lattice) {
+  using S = Stencil<Type>;
+  for (int i = 0; i < stencil.lx; i++)
+    for (int j = 0; j < stencil.ly; j++)
+      for (int k = 0; k < stencil.lz; k++)
+        for (int b = 0; b < S::basisCount; b++) {
+          for (const StencilOffset &o : S::offsets[b]) {
+            int ni = (i + o.dx + stencil.lx) % stencil.lx;
+            int nj = (j + o.dy + stencil.ly) % stencil.ly;
+            int nk = (k + o.dz + stencil.lz) % stencil.lz;
+            lattice.neighbors.push_back(
+                ((ni * stencil.ly + nj) * stencil.lz + nk) * S::basisCount +
+                o.basis);
+          }
+          lattice.offsets.push_back((int)lattice.neighbors.size());
+        }
+  lattice.maxDegree = S::neighborCount;
+}
+
+DisorderedLattice MakeDisorderedLattice(const StencilLattice &stencil) {
+  TRACE_SCOPE("MakeDisorderedLattice");
+  DisorderedLattice lattice;
+  lattice.offsets.reserve(stencil.spins.size() + 1);
+  lattice.offsets.push_back(0);
+  switch (stencil.type) {
+  case StructureType::CUBIC:
+    AppendStencilNeighbors<StructureType::CUBIC>(stencil, lattice);
+    break;
+  case StructureType::BCC:
+    AppendStencilNeighbors<StructureType::BCC>(stencil, lattice);
+    break;
+  case StructureType::FCC:
+    AppendStencilNeighbors<StructureType::FCC>(stencil, lattice);
+    break;
+  default:
+    return lattice;
+  }
+  lattice.signs.assign(lattice.neighbors.size(), 1);
+  lattice.spins = stencil.spins;
+  lattice.pinned = stencil.pinned;
+  return lattice;
+}
+
+// Integer local field: one table lookup, vacancies (s = 0) never count
+static int SweepIntegerBonds(DisorderedLattice &lattice, int first, int count,
+                             mt19937 &rng) {
+  const int *offsets = lattice.offsets.data();
+  const int *neighbors = lattice.neighbors.data();
+  const int8_t *signs = lattice.signs.data();
+  const uint8_t *pinned =
+      lattice.pinned.empty() ? nullptr : lattice.pinned.data();
+  int8_t *spins = lattice.spins.data();
+  int n = (int)lattice.spins.size();
+  int accepted = 0;
+  for (int step = 0; step < count; step++) {
+    int i = (first + step) % n;
+    int field = 0;
+    for (int k = offsets[i]; k < offsets[i + 1]; k++)
+      field += signs[k] * spins[neighbors[k]];
+    int spin = spins[i];
+    int accept = (spin != 0) & (rng() < lattice.table.Get(spin, field));
+    if (pinned)
+      accept &= !pinned[i];
+    spins[i] = static_cast<int8_t>(spin * (1 - 2 * accept));
+    accepted += accept;
+  }
+  return accepted;
+}
+
+// Real couplings: probability evaluated per update
+static int SweepRealBonds(DisorderedLattice &lattice, int first, int count,
+                          float temperature, float J, float B,
+                          mt19937 &rng) {
+  const int *offsets = lattice.offsets.data();
+  const int *neighbors = lattice.neighbors.data();
+  const float *weights = lattice.weights.data();
+  const uint8_t *pinned =
+      lattice.pinned.empty() ? nullptr : lattice.pinned.data();
+  int8_t *spins = lattice.spins.data();
+  int n = (int)lattice.spins.size();
+  int accepted = 0;
+  for (int step = 0; step < count; step++) {
+    int i = (first + step) % n;
+    float field = 0.0f;
+    for (int k = offsets[i]; k < offsets[i + 1]; k++)
+      field += weights[k] * spins[neighbors[k]];
+    int spin = spins[i];
+    float deltaE = 2.0f * spin * (J * field + B);
+    bool accept = deltaE <= 0.0f;
+    if (!accept && temperature > 0) {
+      float u = (rng() >> 8) * (1.0f / 16777216.0f);
+      accept = u < expf(-deltaE / temperature);
+    }
+    accept &= spin != 0;
+    if (pinned)
+      accept &= !pinned[i];
+    spins[i] = static_cast<int8_t>(accept ? -spin : spin);
+    accepted += accept;
+  }
+  return accepted;
+}
+
+int DisorderSweep(DisorderedLattice &lattice, int first, int count,
+                  float temperature, float J, float B, mt19937 &rng) {
+  TRACE_SCOPE("DisorderSweep");
+  if (lattice.spins.empty())
+    return 0;
+  if (!lattice.integerBonds)
+    return SweepRealBonds(lattice, first, count, temperature, J, B, rng);
+  if (temperature != lattice.tableT || J != lattice.tableJ ||
+      B != lattice.tableB || lattice.table.threshold.empty()) {
+    lattice.table.Build(lattice.maxDegree, temperature, J, B);
+    lattice.tableT = temperature;
+    lattice.tableJ = J;
+    lattice.tableB = B;
+  }
+  return SweepIntegerBonds(lattice, first, count, rng);
+}
+
+static float BondWeight(const DisorderedLattice &lattice, int k) {
+  return lattice.integerBonds ? lattice.signs[k] : lattice.weights[k];
+}
+
+void CopySpins(const vector<Atome> &structure, DisorderedLattice &lattice) {
+  for (size_t i = 0; i < structure.size() && i < lattice.spins.size(); i++) {
+    if (lattice.spins[i] != 0)
+      lattice.spins[i] = static_cast<int8_t>(structure[i].spin);
+  }
+  CopyPinned(structure, lattice.pinned);
+  if (lattice.pinned.size() != lattice.spins.size())
+    lattice.pinned.clear();
+}
+
+void CopySpins(const DisorderedLattice &lattice, vector<Atome> &structure,
+               float J, float B) {
+  for (size_t i = 0; i < structure.size() && i < lattice.spins.size(); i++) {
+    int spin = lattice.spins[i];
+    float field = 0.0f;
+    for (int k = lattice.offsets[i]; k < lattice.offsets[i + 1]; k++)
+      field += BondWeight(lattice, k) * lattice.spins[lattice.neighbors[k]];
+    if (spin != 0)
+      structure[i].spin = static_cast<Spin>(spin);
+    structure[i].energy = -J * spin * field - B * spin;
+  }
+}
+
+double DisorderEnergy(const DisorderedLattice &lattice, float J, float B) {
+  double energy = 0.0;
+  for (size_t i = 0; i < lattice.spins.size(); i++) {
+    int spin = lattice.spins[i];
+    double field = 0.0;
+    for (int k = lattice.offsets[i]; k < lattice.offsets[i + 1]; k++)
+      field += BondWeight(lattice, k) * lattice.spins[lattice.neighbors[k]];
+    energy += -0.5 * J * spin * field - B * spin;
+  }
+  return energy;
+}
+
+DisorderAverage AverageOverDisorder(const vector<Atome> &structure,
+                                    DisorderParams params, int realizations,
+                                    int sweeps, float temperature, float J,
+                                    float B) {
+  struct Sample {
+    double magnetization = 0, energy = 0, q2 = 0, q4 = 0;
+  };
+  vector<Sample> samples(max(realizations, 0));
+  int measured = max(1, sweeps - sweeps / 2);
+
+  SharedThreadPool().ParallelFor(
+      0, (int)samples.size(),
+      [&](int first, int last) {
+        for (int r = first; r < last; r++) {
+          DisorderParams realization = params;
+          realization.seed = params.seed + (uint32_t)r;
+          DisorderedLattice a = MakeDisorderedLattice(structure, realization);
+          mt19937 rng(Mix(realization.seed) & 0xffffffffu);
+          for (auto &s : a.spins)
+            s = s ? ((rng() & 1) ? 1 : -1) : 0;
+          DisorderedLattice b = a;
+          for (auto &s : b.spins)
+            s = s ? ((rng() & 1) ? 1 : -1) : 0;
+
+          int n = (int)a.spins.size();
+          int occupied = 0;
+          for (auto s : a.spins)
+            occupied += s != 0;
+          if (occupied == 0)
+            continue;
+
+          Sample &sample = samples[r];
+          for (int sweep = 0; sweep < sweeps; sweep++) {
+            DisorderSweep(a, 0, n, temperature, J, B, rng);
+            DisorderSweep(b, 0, n, temperature, J, B, rng);
+            if (sweep < sweeps - measured)
+              continue;
+            long ma = 0, mb = 0, overlap = 0;
+            for (int i = 0; i < n; i++) {
+              ma += a.spins[i];
+              mb += b.spins[i];
+              overlap += a.spins[i] * b.spins[i];
+            }
+            double q = (double)overlap / occupied;
+            sample.magnetization +=
+                0.5 * (labs(ma) + labs(mb)) / (double)occupied;
+            sample.energy +=
+                0.5 * (DisorderEnergy(a, J, B) + DisorderEnergy(b, J, B)) /
+                occupied;
+            sample.q2 += q * q;
+            sample.q4 += q * q * q * q;
+          }
+          sample.magnetization /= measured;
+          sample.energy /= measured;
+          sample.q2 /= measured;
+          sample.q4 /= measured;
+        }
+      },
+      (int)samples.size());
+
+  DisorderAverage average;
+  average.realizations = (int)samples.size();
+  if (samples.empty())
+    return average;
+  double m = 0, m2 = 0, e = 0, q2 = 0, q4 = 0;
+  for (const auto &sample : samples) {
+    m += sample.magnetization;
+    m2 += sample.magnetization * sample.magnetization;
+    e += sample.energy;
+    q2 += sample.q2;
+    q4 += sample.q4;
+  }
+  double count = (double)samples.size();
+  m /= count;
+  average.magnetization = (float)m;
+  average.magnetizationError =
+      count > 1 ? (float)sqrt(max(0.0, m2 / count - m * m) / (count - 1))
+                : 0.0f;
+  average.energy = (float)(e / count);
+  average.overlap2 = (float)(q2 / count);
+  average.binder =
+      q2 > 0 ? (float)(0.5 * (3.0 - (q4 / count) / ((q2 / count) *
+                                                      (q2 / count))))
+             : 0.0f;
+  return average;
+}
+
+// Runs sweeps until minSeconds elapsed, returns ns per site update
+template <class Sweep>
+static double TimeUpdates(int sitesPerSweep, Sweep sweep,
+                          double minSeconds = 0.15) {
+  using Clock = chrono::steady_clock;
+  sweep(); // Warm up caches and tables
+  long long updates = 0;
+  auto start = Clock::now();
+  double elapsed = 0.0;
+  do {
+    sweep();
+    updates += sitesPerSweep;
+    elapsed = chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < minSeconds);
+  return elapsed * 1e9 / (double)updates;
+}
+
+vector<KernelThroughput> MeasureDisorderPenalty(const vector<Atome> &structure,
+                                                StencilLattice stencil,
+                                                float temperature, float J,
+                                                float B) {
+  vector<KernelThroughput> results;
+  if (structure.empty())
+    return results;
+  mt19937 rng(12345);
+  int n = (int)structure.size();
+
+  if (stencil.spins.size() == structure.size()) {
+    int cells = n / stencil.basisCount;
+    results.push_back(
+        {"Stencil, uniform J", TimeUpdates(n, [&] {
+           StencilSweep(stencil, 0, cells, temperature, J, B, rng);
+         })});
+  }
+
+  struct Variant {
+    const char *name;
+    DisorderParams params;
+  };
+  DisorderParams uniform, plusMinus, diluted, gaussian;
+  plusMinus.bonds = BondDisorder::PLUS_MINUS;
+  diluted.bonds = BondDisorder::PLUS_MINUS;
+  diluted.vacancyFraction = 0.2f;
+  gaussian.bonds = BondDisorder::GAUSSIAN;
+  for (const Variant &variant : {Variant{"CSR, uniform J", uniform},
+                                 Variant{"CSR, +-J int8", plusMinus},
+                                 Variant{"CSR, +-J int8, 20% vacancies",
+                                         diluted},
+                                 Variant{"CSR, Gaussian float", gaussian}}) {
+    DisorderedLattice lattice = MakeDisorderedLattice(structure, variant.params);
+    results.push_back({variant.name, TimeUpdates(n, [&] {
+                         DisorderSweep(lattice, 0, n, temperature, J, B, rng);
+                       })});
+  }
+
+  for (auto &result : results)
+    result.penalty = result.nsPerUpdate / results.front().nsPerUpdate;
+  return results;
+}
@@ -0,0 +1,168 @@
+#include "fft.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+
+int NextPowerOfTwo(int n) {
+  int p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+FFTPlan::FFTPlan(int size) : size(size) {
+  powerOfTwo = size > 0 && (size & (size - 1)) == 0;
+  if (powerOfTwo) {
+    int bits = 0;
+    while ((1 << bits) < size)
+      bits++;
+    bitReverse.resize(size);
+    for (int i = 0; i < size; i++) {
+      int r = 0;
+      for (int b = 0; b < bits; b++)
+        r |= ((i >> b) & 1) << (bits - 1 - b);
+      bitReverse[i] = r;
+    }
+    twiddles.resize(size / 2);
+    for (int k = 0; k < size / 2; k++) {
+      double angle = -2.0 * M_PI * k / size;
+      twiddles[k] = Complex((float)cos(angle), (float)sin(angle));
+    }
+    return;
+  }
+
+  // Bluestein: X_k = w_k * sum_n (x_n w_n) conj(w_{k-n}), w_n = e^{-i pi n^2/N}
+  int m = NextPowerOfTwo(2 * size - 1);
+  padded.emplace_back(m);
+  chirp.resize(size);
+  for (int n = 0; n < size; n++) {
+    // n^2 mod 2N keeps the angle accurate for large n
+    long long n2 = (long long)n * n % (2LL * size);
+    double angle = -M_PI * n2 / size;
+    chirp[n] = Complex((float)cos(angle), (float)sin(angle));
+  }
+  chirpKernel.assign(m, Complex(0, 0));
+  chirpKernel[0] = conj(chirp[0]);
+  for (int n = 1; n < size; n++) {
+    chirpKernel[n] = conj(chirp[n]);
+    chirpKernel[m - n] = conj(chirp[n]);
+  }
+  padded[0].Radix2(chirpKernel.data(), false);
+}
+
+void FFTPlan::Radix2(Complex *data, bool inverse) const {
+  for (int i = 0; i < size; i++) {
+    if (i < bitReverse[i])
+      swap(data[i], data[bitReverse[i]]);
+  }
+  for (int length = 2; length <= size; length <<= 1) {
+    int half = length / 2;
+    int step = size / length;
+    for (int start = 0; start < size; start += length) {
+      for (int k = 0; k < half; k++) {
+        Complex w = twiddles[k * step];
+        if (inverse)
+          w = conj(w);
+        Complex even = data[start + k];
+        Complex odd = data[start + k + half] * w;
+        data[start + k] = even + odd;
+        data[start + k + half] = even - odd;
+      }
+    }
+  }
+}
+
+void FFTPlan::Transform(Complex *data, bool inverse,
+                        vector<Complex> &scratch) const {
+  if (powerOfTwo) {
+    Radix2(data, inverse);
+    return;
+  }
+
+  // The inverse transform is the conjugate of the forward one
+  const FFTPlan &inner = padded[0];
+  int m = inner.Size();
+  scratch.assign(m, Complex(0, 0));
+  for (int n = 0; n < size; n++) {
+    Complex x = inverse ? conj(data[n]) : data[n];
+    scratch[n] = x * chirp[n];
+  }
+  inner.Radix2(scratch.data(), false);
+  for (int k = 0; k < m; k++)
+    scratch[k] *= chirpKernel[k];
+  inner.Radix2(scratch.data(), true);
+  float norm = 1.0f / m;
+  for (int k = 0; k < size; k++) {
+    Complex y = scratch[k] * norm * chirp[k];
+    data[k] = inverse ? conj(y) : y;
+  }
+}
+
+FFT3D::FFT3D(int nx, int ny, int nz)
+    : nx(nx), ny(ny), nz(nz), planX(nx), planY(ny), planZ(nz) {}
+
+void FFT3D::Forward(vector<Complex> &grid) const { Apply(grid, false); }
+
+void FFT3D::Inverse(vector<Complex> &grid) const {
+  Apply(grid, true);
+  float norm = 1.0f / ((float)nx * ny * nz);
+  for (auto &value : grid)
+    value *= norm;
+}
+
+// Gather and Bluestein buffers of each thread, kept between calls so that
+// repeated transforms of the same grid do not allocate
+static thread_local vector<Complex> threadLines, threadScratch;
+
+void FFT3D::Apply(vector<Complex> &grid, bool inverse) const {
+  ThreadPool &pool = SharedThreadPool();
+  const int tile = 8; // Lines gathered together on strided axes
+
+  // z: contiguous rows
+  pool.ParallelFor(0, nx * ny, [&](int first, int last) {
+    vector<Complex> &scratch = threadScratch;
+    for (int row = first; row < last; row++)
+      planZ.Transform(&grid[(size_t)row * nz], inverse, scratch);
+  });
+
+  // y: stride nz, gather tiles of z columns for each x plane
+  pool.ParallelFor(0, nx, [&](int first, int last) {
+    vector<Complex> &lines = threadLines, &scratch = threadScratch;
+    lines.resize((size_t)tile * ny);
+    for (int i = first; i < last; i++) {
+      Complex *plane = &grid[(size_t)i * ny * nz];
+      for (int k0 = 0; k0 < nz; k0 += tile) {
+        int width = min(tile, nz - k0);
+        for (int j = 0; j < ny; j++)
+          for (int t = 0; t < width; t++)
+            lines[(size_t)t * ny + j] = plane[(size_t)j * nz + k0 + t];
+        for (int t = 0; t < width; t++)
+          planY.Transform(&lines[(size_t)t * ny], inverse, scratch);
+        for (int j = 0; j < ny; j++)
+          for (int t = 0; t < width; t++)
+            plane[(size_t)j * nz + k0 + t] = lines[(size_t)t * ny + j];
+      }
+    }
+  });
+
+  // x: stride ny*nz, gather tiles of z columns for each y
+  size_t strideX = (size_t)ny * nz;
+  pool.ParallelFor(0, ny, [&](int first, int last) {
+    vector<Complex> &lines = threadLines, &scratch = threadScratch;
+    lines.resize((size_t)tile * nx);
+    for (int j = first; j < last; j++) {
+      for (int k0 = 0; k0 < nz; k0 += tile) {
+        int width = min(tile, nz - k0);
+        size_t base = (size_t)j * nz + k0;
+        for (int i = 0; i < nx; i++)
+          for (int t = 0; t < width; t++)
+            lines[(size_t)t * nx + i] = grid[i * strideX + base + t];
+        for (int t = 0; t < width; t++)
+          planX.Transform(&lines[(size_t)t * nx], inverse, scratch);
+        for (int i = 0; i < nx; i++)
+          for (int t = 0; t < width; t++)
+            grid[i * strideX + base + t] = lines[(size_t)t * nx + i];
+      }
+    }
+  });
+}
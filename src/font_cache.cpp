@@ -0,0 +1,227 @@
+#include "font_cache.h"
+#include "imgui.h"
+#include "raylib.h"
+#include "rlImGui.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+// The atlas layout (ImFontAtlas texture fields, ImFont glyph table) is
+// stable from 1.89 to 1.91; 1.92 rasterizes glyphs on demand instead, so
+// there is nothing worth caching there
+#if IMGUI_VERSION_NUM >= 18900 && IMGUI_VERSION_NUM < 19200
+#define FONT_ATLAS_CACHE 1
+#endif
+
+static const char cacheMagic[8] = {'I', 'S', 'F', 'A', 'T', 'L', 'S', '1'};
+static const char *cacheFile = "font_atlas.cache";
+static const int oversample = 2;
+
+string FindAssetFile(const char *name) {
+  const string application = GetApplicationDirectory();
+  const string candidates[] = {application + "assets/",
+                               application + "../assets/", "assets/",
+                               "../assets/"};
+  for (const string &directory : candidates) {
+    string path = directory + name;
+    if (FileExists(path.c_str()))
+      return path;
+  }
+  return "";
+}
+
+static void ConfigureFont(ImFontConfig &config, float sizePixels) {
+  config.OversampleH = oversample;
+  config.OversampleV = oversample;
+  config.PixelSnapH = true; // Snap to pixel boundaries
+  config.SizePixels = sizePixels;
+}
+
+#ifdef FONT_ATLAS_CACHE
+
+// FNV-1a over everything that changes the rasterized atlas
+static uint64_t AtlasKey(const string &fontPath, float sizePixels) {
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](const void *data, size_t size) {
+    for (size_t i = 0; i < size; i++)
+      hash = (hash ^ ((const unsigned char *)data)[i]) * 1099511628211ull;
+  };
+  long modified = GetFileModTime(fontPath.c_str());
+  int length = GetFileLength(fontPath.c_str());
+  int version = IMGUI_VERSION_NUM;
+  mix(fontPath.data(), fontPath.size());
+  mix(&modified, sizeof(modified));
+  mix(&length, sizeof(length));
+  mix(&sizePixels, sizeof(sizePixels));
+  mix(&oversample, sizeof(oversample));
+  mix(&version, sizeof(version));
+  return hash;
+}
+
+// Glyph record as stored on disk, independent of ImFontGlyph bitfields
+struct CachedGlyph {
+  uint32_t codepoint;
+  float advanceX;
+  float x0, y0, x1, y1;
+  float u0, v0, u1, v1;
+};
+
+struct CachedHeader {
+  char magic[8];
+  uint64_t key;
+  int32_t width, height;
+  float uvScale[2], uvWhite[2];
+  float uvLines[IM_DRAWLIST_TEX_LINES_WIDTH_MAX + 1][4];
+  float fontSize, ascent, descent;
+  int32_t glyphCount;
+};
+
+static bool SaveAtlas(const string &path, uint64_t key) {
+  ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+  if (atlas->Fonts.Size != 1)
+    return false;
+  unsigned char *pixels = nullptr;
+  int width = 0, height = 0;
+  atlas->GetTexDataAsAlpha8(&pixels, &width, &height);
+  const ImFont *font = atlas->Fonts[0];
+
+  CachedHeader header = {};
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.key = key;
+  header.width = width;
+  header.height = height;
+  header.uvScale[0] = atlas->TexUvScale.x;
+  header.uvScale[1] = atlas->TexUvScale.y;
+  header.uvWhite[0] = atlas->TexUvWhitePixel.x;
+  header.uvWhite[1] = atlas->TexUvWhitePixel.y;
+  for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; i++) {
+    const ImVec4 &line = atlas->TexUvLines[i];
+    header.uvLines[i][0] = line.x;
+    header.uvLines[i][1] = line.y;
+    header.uvLines[i][2] = line.z;
+    header.uvLines[i][3] = line.w;
+  }
+  header.fontSize = font->FontSize;
+  header.ascent = font->Ascent;
+  header.descent = font->Descent;
+  header.glyphCount = font->Glyphs.Size;
+
+  vector<CachedGlyph> glyphs(font->Glyphs.Size);
+  for (int i = 0; i < font->Glyphs.Size; i++) {
+    const ImFontGlyph &glyph = font->Glyphs[i];
+    glyphs[i] = {glyph.Codepoint, glyph.AdvanceX, glyph.X0, glyph.Y0,
+                 glyph.X1,        glyph.Y1,       glyph.U0, glyph.V0,
+                 glyph.U1,        glyph.V1};
+  }
+
+  FILE *file = fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      fwrite(glyphs.data(), sizeof(CachedGlyph), glyphs.size(), file) ==
+          glyphs.size() &&
+      fwrite(pixels, 1, (size_t)width * height, file) ==
+          (size_t)width * height;
+  return fclose(file) == 0 && written;
+}
+
+static bool LoadAtlas(const string &path, uint64_t key, float sizePixels) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file)
+    return false;
+  CachedHeader header;
+  vector<CachedGlyph> glyphs;
+  vector<unsigned char> pixels;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               !memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) &&
+               header.key == key && header.width > 0 && header.height > 0 &&
+               header.width <= 16384 && header.height <= 16384 &&
+               header.glyphCount > 0 && header.glyphCount <= 1 << 20;
+  if (valid) {
+    glyphs.resize(header.glyphCount);
+    pixels.resize((size_t)header.width * header.height);
+    valid = fread(glyphs.data(), sizeof(CachedGlyph), glyphs.size(), file) ==
+                glyphs.size() &&
+            fread(pixels.data(), 1, pixels.size(), file) == pixels.size();
+  }
+  fclose(file);
+  if (!valid)
+    return false;
+
+  // Rebuild what ImFontAtlas::Build leaves behind, without the TTF
+  ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+  atlas->Clear();
+  ImFont *font = IM_NEW(ImFont)();
+  font->ContainerAtlas = atlas;
+  font->FontSize = header.fontSize;
+  font->Ascent = header.ascent;
+  font->Descent = header.descent;
+  ImFontConfig config;
+  ConfigureFont(config, sizePixels);
+  config.FontDataOwnedByAtlas = false;
+  config.DstFont = font;
+  snprintf(config.Name, sizeof(config.Name), "%s (cached)", cacheFile);
+  atlas->ConfigData.push_back(config);
+  atlas->Fonts.push_back(font);
+  font->ConfigData = &atlas->ConfigData.back();
+  font->ConfigDataCount = 1;
+  for (const CachedGlyph &glyph : glyphs) {
+    // Advances were already snapped when the atlas was built
+    font->AddGlyph(nullptr, (ImWchar)glyph.codepoint, glyph.x0, glyph.y0,
+                   glyph.x1, glyph.y1, glyph.u0, glyph.v0, glyph.u1,
+                   glyph.v1, glyph.advanceX);
+  }
+  font->BuildLookupTable();
+
+  atlas->TexWidth = header.width;
+  atlas->TexHeight = header.height;
+  atlas->TexUvScale = ImVec2(header.uvScale[0], header.uvScale[1]);
+  atlas->TexUvWhitePixel = ImVec2(header.uvWhite[0], header.uvWhite[1]);
+  for (int i = 0; i <= IM_DRAWLIST_TEX_LINES_WIDTH_MAX; i++) {
+    const float *line = header.uvLines[i];
+    atlas->TexUvLines[i] = ImVec4(line[0], line[1], line[2], line[3]);
+  }
+  atlas->TexPixelsAlpha8 = (unsigned char *)IM_ALLOC(pixels.size());
+  memcpy(atlas->TexPixelsAlpha8, pixels.data(), pixels.size());
+  atlas->TexReady = true;
+  return true;
+}
+
+#endif // FONT_ATLAS_CACHE
+
+FontAtlasStatus LoadInterfaceFont(const char *fileName, float sizePixels) {
+  auto start = chrono::steady_clock::now();
+  FontAtlasStatus status;
+  status.fontPath = FindAssetFile(fileName);
+  status.cachePath = string(GetApplicationDirectory()) + cacheFile;
+  if (status.fontPath.empty()) {
+    TraceLog(LOG_WARNING, "Font %s not found, keeping the default font",
+             fileName);
+    return status;
+  }
+
+  ImFontAtlas *atlas = ImGui::GetIO().Fonts;
+#ifdef FONT_ATLAS_CACHE
+  uint64_t key = AtlasKey(status.fontPath, sizePixels);
+  status.fromCache = LoadAtlas(status.cachePath, key, sizePixels);
+#endif
+  if (!status.fromCache) {
+    atlas->Clear();
+    ImFontConfig config;
+    ConfigureFont(config, sizePixels);
+    atlas->AddFontFromFileTTF(status.fontPath.c_str(), sizePixels, &config);
+    atlas->Build();
+#ifdef FONT_ATLAS_CACHE
+    if (!SaveAtlas(status.cachePath, key))
+      TraceLog(LOG_WARNING, "Cannot write %s", status.cachePath.c_str());
+#endif
+  }
+  rlImGuiReloadFonts(); // Uploads the new texture
+  status.milliseconds =
+      chrono::duration<double, milli>(chrono::steady_clock::now() - start)
+          .count();
+  return status;
+}
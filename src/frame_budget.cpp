@@ -0,0 +1,53 @@
+#include "frame_budget.h"
+#include <algorithm>
+
+using namespace std;
+
+static const double smoothing = 0.25;     // Weight of the newest frame
+static const double maxGrowth = 2.0;      // Per-frame growth of the plan
+static const int maxUpdates = 1 << 28;    // Keeps counts within an int
+static const double rateWindow = 1.0;     // Seconds per displayed rate
+
+int FrameBudget::Plan(int kernel, size_t siteCount, double budgetSeconds) {
+  if (kernel != this->kernel || siteCount != this->siteCount) {
+    // New cost model: start small and let Record ramp up
+    this->kernel = kernel;
+    this->siteCount = siteCount;
+    secondsPerUpdate = 0.0;
+    lastPlan = 1;
+    windowStart = -1.0;
+  }
+  if (secondsPerUpdate <= 0.0)
+    return lastPlan = max(1, min<int>((int)siteCount, 1000));
+  double target = budgetSeconds / secondsPerUpdate;
+  target = min(target, lastPlan * maxGrowth);
+  lastPlan = (int)clamp(target, 1.0, (double)maxUpdates);
+  return lastPlan;
+}
+
+void FrameBudget::Record(double updates, double seconds, double now) {
+  if (updates <= 0.0)
+    return;
+  double cost = seconds / updates;
+  secondsPerUpdate = secondsPerUpdate > 0.0
+                         ? (1.0 - smoothing) * secondsPerUpdate +
+                               smoothing * cost
+                         : cost;
+  blockSeconds = blockSeconds > 0.0
+                     ? (1.0 - smoothing) * blockSeconds + smoothing * seconds
+                     : seconds;
+  kernelRate = secondsPerUpdate > 0.0 ? 1.0 / secondsPerUpdate : 0.0;
+
+  // Wall-clock throughput, rendering and idle time included
+  if (windowStart < 0.0) {
+    windowStart = now; // These updates ran before the window opened
+    windowUpdates = 0.0;
+    return;
+  }
+  windowUpdates += updates;
+  if (now - windowStart >= rateWindow) {
+    achievedRate = windowUpdates / (now - windowStart);
+    windowStart = now;
+    windowUpdates = 0.0;
+  }
+}
@@ -0,0 +1,70 @@
+#include "frame_memory.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+
+static size_t Blocks(size_t bytes) {
+  return (bytes + sizeof(max_align_t) - 1) / sizeof(max_align_t);
+}
+
+static size_t AlignUp(const void *base, size_t offset, size_t alignment) {
+  uintptr_t address = (uintptr_t)base + offset;
+  return offset + (alignment - address % alignment) % alignment;
+}
+
+FrameArena::FrameArena(size_t capacity)
+    : block(new max_align_t[Blocks(capacity)]),
+      capacity(Blocks(capacity) * sizeof(max_align_t)) {}
+
+void FrameArena::Reset() {
+  if (!overflow.empty()) {
+    // Grow once to the high-water mark so the next frame fits in one block
+    size_t needed = capacity + overflowBytes;
+    overflow.clear();
+    block.reset(new max_align_t[Blocks(needed)]);
+    capacity = Blocks(needed) * sizeof(max_align_t);
+  }
+  used = 0;
+  overflowBytes = overflowUsed = overflowSize = 0;
+}
+
+void *FrameArena::Allocate(size_t size, size_t alignment) {
+  size_t offset = AlignUp(block.get(), used, alignment);
+  if (offset + size <= capacity) {
+    used = offset + size;
+    return (char *)block.get() + offset;
+  }
+
+  if (!overflow.empty()) {
+    offset = AlignUp(overflow.back().get(), overflowUsed, alignment);
+    if (offset + size <= overflowSize) {
+      overflowBytes += offset + size - overflowUsed;
+      overflowUsed = offset + size;
+      return (char *)overflow.back().get() + offset;
+    }
+  }
+  overflowSize = max(Blocks(size + alignment) * sizeof(max_align_t),
+                     capacity);
+  overflow.emplace_back(new max_align_t[overflowSize / sizeof(max_align_t)]);
+  offset = AlignUp(overflow.back().get(), 0, alignment);
+  overflowUsed = offset + size;
+  overflowBytes += overflowUsed;
+  return (char *)overflow.back().get() + offset;
+}
+
+const char *FrameArena::Format(const char *format, ...) {
+  va_list args;
+  va_start(args, format);
+  va_list measure;
+  va_copy(measure, args);
+  int length = vsnprintf(nullptr, 0, format, measure);
+  va_end(measure);
+  char *text = Allocate<char>(max(length, 0) + 1);
+  if (length >= 0)
+    vsnprintf(text, length + 1, format, args);
+  else
+    text[0] = '\0';
+  va_end(args);
+  return text;
+}
@@ -0,0 +1,59 @@
+#include "history_view.h"
+#include <algorithm>
+#include <cmath>
+
+static const size_t gatherFactor = 4; // Level points per pixel before LTTB
+
+void HistoryView::Draw(const char *label, const TimeSeries &series,
+                       float height, ImU32 color) {
+  if (series.Empty()) {
+    ImGui::Text("%s: no samples yet", label);
+    return;
+  }
+  uint64_t first = series.First(), last = series.Count();
+  SeriesRange range = series.Query(first, last);
+  ImGui::Text("%s: %.3f (min %.3f, max %.3f)", label, series.Last(),
+              range.min, range.max);
+
+  float width = max(ImGui::GetContentRegionAvail().x, 16.0f);
+  ImVec2 origin = ImGui::GetCursorScreenPos();
+  size_t pixels = (size_t)width;
+  series.Gather(first, last, pixels * gatherFactor, gathered);
+  DownsampleLTTB(gathered, pixels, line);
+
+  float padding = max((range.max - range.min) * 0.1f, 1e-3f);
+  float low = range.min - padding, high = range.max + padding;
+  double span = max<double>((double)(last - first - 1), 1.0);
+  auto toScreen = [&](double x, float y) {
+    return ImVec2(origin.x + (float)((x - first) / span) * (width - 1.0f),
+                  origin.y + height * (high - y) / (high - low));
+  };
+
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+  ImU32 envelope = (color & ~IM_COL32_A_MASK) | IM_COL32(0, 0, 0, 70);
+  polyline.clear();
+  for (const SeriesPoint &point : line) {
+    ImVec2 top = toScreen(point.x, point.max);
+    ImVec2 bottom = toScreen(point.x, point.min);
+    if (bottom.y - top.y >= 1.0f)
+      drawList->AddLine(top, bottom, envelope);
+    polyline.push_back(toScreen(point.x, point.y));
+  }
+  drawList->AddPolyline(polyline.data(), (int)polyline.size(), color, 0,
+                        1.5f);
+  drawList->AddRect(origin, ImVec2(origin.x + width, origin.y + height),
+                    ImGui::GetColorU32(ImGuiCol_Border));
+  ImGui::Dummy(ImVec2(width, height));
+
+  // Nearest drawn point under the mouse
+  if (ImGui::IsItemHovered() && !line.empty()) {
+    double x = first + (ImGui::GetMousePos().x - origin.x) / (width - 1.0f) *
+                           span;
+    auto nearest = min_element(line.begin(), line.end(),
+                               [x](const SeriesPoint &a, const SeriesPoint &b) {
+                                 return fabs(a.x - x) < fabs(b.x - x);
+                               });
+    ImGui::SetTooltip("Sample %.0f\nMean %.4f\nRange %.4f to %.4f", nearest->x,
+                      nearest->y, nearest->min, nearest->max);
+  }
+}
@@ -0,0 +1,249 @@
+#include "hysteresis.h"
+#include "trace.h"
+#include <algorithm>
+#include <cmath>
+
+float IntegratedAutocorrelationTime(const float *series, int count,
+                                    float window) {
+  if (count < 2)
+    return 0.5f;
+  double mean = 0.0;
+  for (int i = 0; i < count; i++)
+    mean += series[i];
+  mean /= count;
+  double c0 = 0.0;
+  for (int i = 0; i < count; i++)
+    c0 += (series[i] - mean) * (series[i] - mean);
+  c0 /= count;
+  if (c0 <= 1e-12)
+    return 0.5f;
+
+  double tau = 0.5;
+  for (int t = 1; t < count; t++) {
+    double ct = 0.0;
+    for (int i = 0; i + t < count; i++)
+      ct += (series[i] - mean) * (series[i + t] - mean);
+    tau += ct / ((count - t) * c0);
+    if (t >= window * tau)
+      break;
+  }
+  return (float)max(tau, 0.5);
+}
+
+// Field values of the schedule: +max down to -max, then back up, per cycle
+static vector<pair<float, bool>> FieldSchedule(const HysteresisSettings &s) {
+  vector<pair<float, bool>> schedule;
+  int steps = max(1, (int)lroundf(2.0f * s.maxField / s.fieldStep));
+  for (int cycle = 0; cycle < max(s.cycles, 1); cycle++) {
+    for (int i = cycle == 0 ? 0 : 1; i <= steps; i++)
+      schedule.push_back({s.maxField - 2.0f * s.maxField * i / steps, true});
+    for (int i = 1; i <= steps; i++)
+      schedule.push_back({-s.maxField + 2.0f * s.maxField * i / steps, false});
+  }
+  return schedule;
+}
+
+// Linear interpolation of y where x changes sign between consecutive points
+// of [first, last); false if x keeps its sign
+template <class X, class Y>
+static bool ZeroCrossing(const vector<HysteresisPoint> &points, int first,
+                         int last, X x, Y y, float &value) {
+  for (int i = first; i + 1 < last; i++) {
+    float x0 = x(points[i]), x1 = x(points[i + 1]);
+    if ((x0 > 0.0f) == (x1 > 0.0f))
+      continue;
+    float t = x0 == x1 ? 0.0f : x0 / (x0 - x1);
+    value = y(points[i]) + t * (y(points[i + 1]) - y(points[i]));
+    return true;
+  }
+  return false;
+}
+
+void ExtractLoopFeatures(HysteresisLoop &loop) {
+  const vector<HysteresisPoint> &points = loop.points;
+  auto field = [](const HysteresisPoint &p) { return p.field; };
+  auto magnetization = [](const HysteresisPoint &p) { return p.magnetization; };
+
+  // Last descending and last ascending branches
+  float coercive = 0.0f, remanence = 0.0f;
+  int coerciveCount = 0, remanenceCount = 0;
+  int end = (int)points.size();
+  for (int branch = 0; branch < 2 && end > 0; branch++) {
+    bool descending = points[end - 1].descending;
+    int begin = end - 1;
+    while (begin > 0 && points[begin - 1].descending == descending)
+      begin--;
+    // Include the turning point so each branch starts at its extreme field
+    int first = max(begin - 1, 0);
+    float value;
+    if (ZeroCrossing(points, first, end, magnetization, field, value)) {
+      coercive += fabsf(value);
+      coerciveCount++;
+    }
+    if (ZeroCrossing(points, first, end, field, magnetization, value)) {
+      remanence += fabsf(value);
+      remanenceCount++;
+    }
+    end = begin;
+  }
+  loop.coerciveField = coerciveCount ? coercive / coerciveCount : 0.0f;
+  loop.remanence = remanenceCount ? remanence / remanenceCount : 0.0f;
+}
+
+struct HysteresisSweep::LoopState {
+  DisorderedLattice lattice;
+  mt19937 rng;
+  int occupied = 0;
+  size_t next = 0; // Prochain point du programme
+  vector<float> series;
+};
+
+HysteresisSweep::HysteresisSweep() = default;
+
+HysteresisSweep::~HysteresisSweep() { Cancel(); }
+
+void HysteresisSweep::Start(const vector<Atome> &structure,
+                            const DisorderParams &disorder, float J,
+                            const vector<float> &temperatures,
+                            const HysteresisSettings &settings) {
+  Cancel();
+  this->structure = structure;
+  this->disorder = disorder;
+  coupling = J;
+  this->settings = settings;
+  schedule = FieldSchedule(settings);
+  states.clear();
+  for (size_t k = 0; k < temperatures.size(); k++)
+    states.push_back(make_unique<LoopState>());
+  {
+    lock_guard<mutex> lock(loopsMutex);
+    loops.assign(temperatures.size(), HysteresisLoop());
+    for (size_t k = 0; k < loops.size(); k++) {
+      loops[k].temperature = temperatures[k];
+      loops[k].seed = disorder.seed + (uint32_t)k;
+      loops[k].plannedPoints = (int)schedule.size();
+    }
+    activeLoops = (int)loops.size();
+    cancelled = false;
+  }
+  // One thread per loop, one core left to the render thread
+  unsigned cores = max(thread::hardware_concurrency(), 2u);
+  unsigned threads = max<unsigned>(
+      1, min<unsigned>((unsigned)temperatures.size(), cores - 1));
+  if (!pool || pool->Size() != threads)
+    pool = make_unique<ThreadPool>(threads);
+  for (int k = 0; k < (int)temperatures.size(); k++)
+    SubmitPoint(k);
+}
+
+void HysteresisSweep::Cancel() {
+  unique_lock<mutex> lock(loopsMutex);
+  cancelled = true;
+  loopsDone.wait(lock, [this] { return activeLoops == 0; });
+}
+
+bool HysteresisSweep::Running() const {
+  lock_guard<mutex> lock(loopsMutex);
+  return activeLoops > 0;
+}
+
+void HysteresisSweep::Snapshot(vector<HysteresisLoop> &out) const {
+  lock_guard<mutex> lock(loopsMutex);
+  out = loops; // Element-wise copy-assignment keeps the inner capacities
+}
+
+void HysteresisSweep::SubmitPoint(int index) {
+  pool->Submit([this, index] { RunPoint(index); });
+}
+
+void HysteresisSweep::FinishLoop() {
+  lock_guard<mutex> lock(loopsMutex);
+  activeLoops--;
+  loopsDone.notify_all();
+}
+
+void HysteresisSweep::RunPoint(int index) {
+  TRACE_SCOPE("Hysteresis point");
+  LoopState &state = *states[index];
+  float temperature;
+  uint32_t seed;
+  {
+    lock_guard<mutex> lock(loopsMutex);
+    temperature = loops[index].temperature;
+    seed = loops[index].seed;
+    if (cancelled) {
+      activeLoops--;
+      loopsDone.notify_all();
+      return;
+    }
+  }
+  DisorderedLattice &lattice = state.lattice;
+  if (state.next == 0) {
+    DisorderParams realization = disorder;
+    realization.seed = seed;
+    lattice = MakeDisorderedLattice(structure, realization);
+    for (auto &s : lattice.spins) {
+      s = s ? 1 : 0; // Saturated, as at +maxField
+      state.occupied += s;
+    }
+    seed_seq seeds{seed, (uint32_t)index};
+    state.rng.seed(seeds);
+    state.series.reserve(max(settings.maxSweeps, settings.minSweeps));
+  }
+  if (state.occupied == 0 || state.next >= schedule.size()) {
+    {
+      lock_guard<mutex> lock(loopsMutex);
+      loops[index].complete = true;
+    }
+    FinishLoop();
+    return;
+  }
+
+  // Warm start: the previous point's configuration is the initial state
+  auto [field, descending] = schedule[state.next++];
+  int n = (int)lattice.spins.size();
+  vector<float> &series = state.series;
+  series.clear();
+  float tau = 0.5f;
+  while (true) {
+    DisorderSweep(lattice, 0, n, temperature, coupling, field, state.rng);
+    long sum = 0;
+    for (int i = 0; i < n; i++)
+      sum += lattice.spins[i];
+    series.push_back((float)sum / state.occupied);
+
+    int count = (int)series.size();
+    if (count >= settings.maxSweeps)
+      break;
+    if (count < settings.minSweeps || count % 8 != 0)
+      continue;
+    int half = count / 2;
+    tau = IntegratedAutocorrelationTime(series.data() + half, count - half);
+    if (count - half >= 2.0f * tau * settings.independentSamples)
+      break;
+  }
+
+  int count = (int)series.size(), half = count / 2;
+  tau = IntegratedAutocorrelationTime(series.data() + half, count - half);
+  double mean = 0.0, square = 0.0;
+  for (int i = half; i < count; i++) {
+    mean += series[i];
+    square += series[i] * series[i];
+  }
+  mean /= count - half;
+  double variance = max(0.0, square / (count - half) - mean * mean);
+
+  HysteresisPoint point;
+  point.field = field;
+  point.magnetization = (float)mean;
+  point.error = (float)sqrt(2.0 * tau * variance / (count - half));
+  point.tau = tau;
+  point.sweeps = count;
+  point.descending = descending;
+  {
+    lock_guard<mutex> lock(loopsMutex);
+    loops[index].points.push_back(point);
+    ExtractLoopFeatures(loops[index]);
+  }
+  SubmitPoint(index);
+}
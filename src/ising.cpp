@@ -0,0 +1,196 @@
+#include "ising.h"
+#include "disorder.h"
+#include "stencil.h"
+#include <climits>
+#include <memory>
+#include <new>
+
+// One independent simulation: everything the sweeps touch lives here
+struct IsingSimulation {
+  IsingLatticeDesc desc;
+  bool periodic = false;
+  StencilLattice stencil;  // Periodic boundaries, implicit neighbors
+  DisorderedLattice graph; // Open boundaries, neighbors of make_*_struc
+  mt19937 rng;
+  float temperature = 2.5f;
+  float J = 1.0f;
+  float B = 0.0f;
+  uint64_t sweeps = 0;
+  uint64_t attempted = 0;
+  uint64_t accepted = 0;
+
+  const vector<int8_t> &Spins() const {
+    return periodic ? stencil.spins : graph.spins;
+  }
+  vector<int8_t> &Spins() { return periodic ? stencil.spins : graph.spins; }
+};
+
+static vector<Atome> BuildStructure(StructureType type, int x, int y, int z) {
+  switch (type) {
+  case StructureType::HEXAGONAL:
+    return make_hexagonal_struc(x, y, z, 1.0f);
+  case StructureType::FCC:
+    return make_fcc_struc(x, y, z, 1.0f);
+  case StructureType::BCC:
+    return make_bcc_struc(x, y, z, 1.0f);
+  default:
+    return make_cubic_struc(x, y, z, 1.0f);
+  }
+}
+
+// Site energies summed, so every bond counted twice
+static double StencilEnergySum(const StencilLattice &lattice, float J,
+                               float B) {
+  switch (lattice.type) {
+  case StructureType::FCC:
+    return StencilEnergies<StructureType::FCC>(lattice, J, B, nullptr);
+  case StructureType::BCC:
+    return StencilEnergies<StructureType::BCC>(lattice, J, B, nullptr);
+  default:
+    return StencilEnergies<StructureType::CUBIC>(lattice, J, B, nullptr);
+  }
+}
+
+extern "C" {
+
+int ising_api_version(void) { return ISING_API_VERSION; }
+
+IsingStatus ising_create(const IsingLatticeDesc *desc,
+                         IsingSimulation **simulation) {
+  if (!simulation)
+    return ISING_ERROR_ARGUMENT;
+  *simulation = nullptr;
+  if (!desc || desc->nx <= 0 || desc->ny <= 0 || desc->nz <= 0 ||
+      desc->lattice < ISING_LATTICE_CUBIC || desc->lattice > ISING_LATTICE_BCC)
+    return ISING_ERROR_ARGUMENT;
+  // Site indices are int in every kernel, FCC has 4 sites per cell
+  if ((long long)desc->nx * desc->ny * desc->nz * 4 > INT_MAX)
+    return ISING_ERROR_ARGUMENT;
+  StructureType type = static_cast<StructureType>(desc->lattice);
+  if (desc->periodic && !SupportsStencil(type))
+    return ISING_ERROR_UNSUPPORTED;
+
+  try {
+    // Owned until fully built: a throwing builder must not leak it
+    auto created = make_unique<IsingSimulation>();
+    created->desc = *desc;
+    created->periodic = desc->periodic != 0;
+    created->rng.seed((mt19937::result_type)(desc->seed ^ (desc->seed >> 32)));
+    if (created->periodic) {
+      created->stencil =
+          MakeStencilLattice(type, desc->nx, desc->ny, desc->nz);
+    } else {
+      // The atoms only carry the topology, the CSR copy is all we keep
+      created->graph = MakeDisorderedLattice(
+          BuildStructure(type, desc->nx, desc->ny, desc->nz),
+          DisorderParams());
+    }
+    *simulation = created.release();
+    return ISING_OK;
+  } catch (const bad_alloc &) {
+    return ISING_ERROR_MEMORY;
+  }
+}
+
+void ising_destroy(IsingSimulation *simulation) { delete simulation; }
+
+IsingStatus ising_set_parameters(IsingSimulation *simulation,
+                                 float temperature, float J, float B) {
+  if (!simulation || !(temperature >= 0.0f) || J != J || B != B)
+    return ISING_ERROR_ARGUMENT;
+  simulation->temperature = temperature;
+  simulation->J = J;
+  simulation->B = B;
+  return ISING_OK;
+}
+
+IsingStatus ising_randomize(IsingSimulation *simulation, float upFraction) {
+  if (!simulation || !(upFraction >= 0.0f && upFraction <= 1.0f))
+    return ISING_ERROR_ARGUMENT;
+  bernoulli_distribution up(upFraction);
+  for (int8_t &spin : simulation->Spins())
+    spin = up(simulation->rng) ? 1 : -1;
+  return ISING_OK;
+}
+
+IsingStatus ising_sweep(IsingSimulation *simulation, int sweeps,
+                        int64_t *accepted) {
+  if (!simulation || sweeps < 0)
+    return ISING_ERROR_ARGUMENT;
+  IsingSimulation &s = *simulation;
+  int sites = (int)s.Spins().size();
+  int64_t flips = 0;
+  for (int sweep = 0; sweep < sweeps; sweep++) {
+    if (s.periodic) {
+      int cells = s.stencil.lx * s.stencil.ly * s.stencil.lz;
+      flips += StencilSweep(s.stencil, 0, cells, s.temperature, s.J, s.B,
+                            s.rng);
+    } else {
+      flips += DisorderSweep(s.graph, 0, sites, s.temperature, s.J, s.B,
+                             s.rng);
+    }
+  }
+  s.sweeps += sweeps;
+  s.attempted += (uint64_t)sweeps * sites;
+  s.accepted += flips;
+  if (accepted)
+    *accepted = flips;
+  return ISING_OK;
+}
+
+IsingStatus ising_observables(const IsingSimulation *simulation,
+                              IsingObservables *observables) {
+  if (!simulation || !observables)
+    return ISING_ERROR_ARGUMENT;
+  const IsingSimulation &s = *simulation;
+  const vector<int8_t> &spins = s.Spins();
+  long long total = 0;
+  for (int8_t spin : spins)
+    total += spin;
+  IsingObservables result = {};
+  if (s.periodic) {
+    // Sum of -J s h - B s over sites counts bonds twice but B once
+    result.energy =
+        0.5 * (StencilEnergySum(s.stencil, s.J, s.B) - (double)s.B * total);
+  } else {
+    result.energy = DisorderEnergy(s.graph, s.J, s.B);
+  }
+  result.magnetization = spins.empty() ? 0.0 : (double)total / spins.size();
+  result.acceptance =
+      s.attempted ? (double)s.accepted / (double)s.attempted : 0.0;
+  result.sweeps = s.sweeps;
+  result.sites = (int64_t)spins.size();
+  *observables = result;
+  return ISING_OK;
+}
+
+IsingStatus ising_spins(const IsingSimulation *simulation,
+                        IsingSpinView *view) {
+  if (!simulation || !view)
+    return ISING_ERROR_ARGUMENT;
+  const IsingSimulation &s = *simulation;
+  view->data = s.Spins().data();
+  view->count = s.Spins().size();
+  view->stride = sizeof(int8_t);
+  view->cells[0] = s.desc.nx;
+  view->cells[1] = s.desc.ny;
+  view->cells[2] = s.desc.nz;
+  view->basis = s.Spins().size() / ((size_t)s.desc.nx * s.desc.ny * s.desc.nz);
+  return ISING_OK;
+}
+
+const char *ising_status_string(IsingStatus status) {
+  switch (status) {
+  case ISING_OK:
+    return "ok";
+  case ISING_ERROR_ARGUMENT:
+    return "invalid argument";
+  case ISING_ERROR_UNSUPPORTED:
+    return "periodic boundaries need a cubic, FCC or BCC lattice";
+  case ISING_ERROR_MEMORY:
+    return "out of memory";
+  }
+  return "unknown status";
+}
+
+} // extern "C"
@@ -0,0 +1,227 @@
+#include "ising_moves.h"
+#include "trace.h"
+#include <cmath>
+
+static float BondWeight(const DisorderedLattice &lattice, int k) {
+  return lattice.integerBonds ? lattice.signs[k] : lattice.weights[k];
+}
+
+int WolffUpdater::Step(DisorderedLattice &lattice, float temperature,
+                       float J, float B, mt19937 &rng, bool &flipped) {
+  flipped = false;
+  int n = (int)lattice.spins.size();
+  const uint8_t *pinned =
+      lattice.pinned.empty() ? nullptr : lattice.pinned.data();
+  int8_t *spins = lattice.spins.data();
+  int seed = (int)(rng() % (uint32_t)n);
+  int spin = spins[seed];
+  if (spin == 0 || (pinned && pinned[seed]))
+    return 1;
+
+  if (++generation == 0) {
+    // Stamps wrapped around: forget every old cluster
+    fill(mark.begin(), mark.end(), 0u);
+    generation = 1;
+  }
+  cluster.clear();
+  cluster.push_back(seed);
+  mark[seed] = generation;
+  // Field of what cannot join: B plus the pinned neighbors
+  double outsideField = 0.0;
+  for (size_t next = 0; next < cluster.size(); next++) {
+    int i = cluster[next];
+    outsideField += B;
+    for (int k = lattice.offsets[i]; k < lattice.offsets[i + 1]; k++) {
+      int j = lattice.neighbors[k];
+      float bond = J * BondWeight(lattice, k);
+      if (pinned && pinned[j]) {
+        outsideField += bond * spins[j];
+        continue;
+      }
+      if (mark[j] == generation || bond * spin * spins[j] <= 0.0f)
+        continue;
+      bool join;
+      if (temperature <= 0.0f)
+        join = true;
+      else if (lattice.integerBonds && fabsf(bond) == fabsf(J))
+        join = rng() < addThreshold;
+      else
+        join = (rng() >> 8) * (1.0f / 16777216.0f) <
+               1.0f - expf(-2.0f * fabsf(bond) / temperature);
+      if (join) {
+        mark[j] = generation;
+        cluster.push_back(j);
+      }
+    }
+  }
+
+  double deltaE = 2.0 * spin * outsideField;
+  bool accept = deltaE <= 0.0;
+  if (!accept && temperature > 0.0f)
+    accept = (rng() >> 8) * (1.0 / 16777216.0) < exp(-deltaE / temperature);
+  if (accept) {
+    for (int i : cluster)
+      spins[i] = static_cast<int8_t>(-spin);
+    flipped = true;
+  }
+  return (int)cluster.size();
+}
+
+long long WolffUpdater::Advance(DisorderedLattice &lattice, double updates,
+                                float temperature, float J, float B,
+                                mt19937 &rng) {
+  TRACE_SCOPE("WolffUpdater::Advance");
+  if (lattice.spins.empty())
+    return 0;
+  if (mark.size() != lattice.spins.size()) {
+    mark.assign(lattice.spins.size(), 0u);
+    generation = 0;
+    clusterCount = 0.0;
+  }
+  if (temperature != thresholdT || J != thresholdJ || B != thresholdB) {
+    double p = temperature > 0.0f ? 1.0 - exp(-2.0 * fabs(J) / temperature)
+                                  : 1.0;
+    addThreshold = (uint32_t)min(4294967295.0, p * 4294967296.0);
+    thresholdT = temperature;
+    thresholdJ = J;
+    thresholdB = B;
+    clusterCount = 0.0; // Cluster sizes depend on (T, J, B)
+  }
+  if (clusterCount == 0.0) {
+    clusterSites = 0.0;
+    pendingClusters = 0.0;
+  }
+
+  long long flips = 0;
+  bool flipped;
+  if (clusterCount < estimateClusters) {
+    // Estimating the mean size: clusters until updates sites are covered.
+    // This stopping rule favors small clusters, harmless while thermalizing
+    double visited = 0.0;
+    do {
+      int size = Step(lattice, temperature, J, B, rng, flipped);
+      flips += flipped ? size : 0;
+      visited += size;
+      clusterSites += size;
+      clusterCount++;
+    } while (visited < updates && clusterCount < estimateClusters);
+    return flips;
+  }
+  // Mean frozen: the cluster count no longer depends on the configurations
+  pendingClusters += updates * clusterCount / clusterSites;
+  long long count = (long long)pendingClusters;
+  pendingClusters -= (double)count;
+  for (long long c = 0; c < count; c++) {
+    int size = Step(lattice, temperature, J, B, rng, flipped);
+    flips += flipped ? size : 0;
+  }
+  return flips;
+}
+
+// Class (spin, field) as in AcceptanceTable, -1 when the site never flips
+int RejectionFreeUpdater::ClassOf(const DisorderedLattice &lattice,
+                                  int site) const {
+  int spin = lattice.spins[site];
+  if (spin == 0 || (!lattice.pinned.empty() && lattice.pinned[site]))
+    return -1;
+  int field = 0;
+  for (int k = lattice.offsets[site]; k < lattice.offsets[site + 1]; k++)
+    field += lattice.signs[k] * lattice.spins[lattice.neighbors[k]];
+  return (spin > 0) * (2 * maxField + 1) + field + maxField;
+}
+
+void RejectionFreeUpdater::Move(int site, int newClass) {
+  int old = classOf[site];
+  if (old == newClass)
+    return;
+  if (old >= 0) {
+    // Swap with the last member, O(1) removal
+    vector<int> &from = members[old];
+    int last = from.back();
+    from[position[site]] = last;
+    position[last] = position[site];
+    from.pop_back();
+  }
+  classOf[site] = newClass;
+  if (newClass >= 0) {
+    position[site] = (int)members[newClass].size();
+    members[newClass].push_back(site);
+  }
+}
+
+void RejectionFreeUpdater::Reset(const DisorderedLattice &lattice) {
+  maxField = lattice.maxDegree;
+  members.assign(2 * (2 * maxField + 1), vector<int>());
+  int n = (int)lattice.spins.size();
+  classOf.assign(n, -1);
+  position.assign(n, 0);
+  if (!lattice.integerBonds)
+    return;
+  for (int site = 0; site < n; site++)
+    Move(site, ClassOf(lattice, site));
+  ratesT = -1.0f;
+}
+
+long long RejectionFreeUpdater::Advance(DisorderedLattice &lattice,
+                                        double updates, float temperature,
+                                        float J, float B, mt19937 &rng) {
+  TRACE_SCOPE("RejectionFreeUpdater::Advance");
+  if (!lattice.integerBonds || lattice.spins.empty())
+    return 0;
+  if (classOf.size() != lattice.spins.size())
+    Reset(lattice);
+  if (temperature != ratesT || J != ratesJ || B != ratesB) {
+    rates.assign(members.size(), 0.0);
+    for (int spin = -1; spin <= 1; spin += 2)
+      for (int field = -maxField; field <= maxField; field++) {
+        double deltaE = 2.0 * spin * (J * field + B);
+        double rate = deltaE <= 0.0 ? 1.0
+                      : temperature > 0.0f ? exp(-deltaE / temperature)
+                                           : 0.0;
+        rates[(spin > 0) * (2 * maxField + 1) + field + maxField] = rate;
+      }
+    ratesT = temperature;
+    ratesJ = J;
+    ratesB = B;
+  }
+
+  const double sites = (double)lattice.spins.size();
+  long long flips = 0;
+  double elapsed = 0.0;
+  while (true) {
+    double total = 0.0;
+    for (size_t c = 0; c < members.size(); c++)
+      total += members[c].size() * rates[c];
+    if (total <= 0.0)
+      break; // Frozen: nothing can flip at this temperature
+    // Attempts before the next flip; memoryless, so the overshoot that
+    // ends the call is simply dropped
+    double u = ((rng() >> 5) + 1.0) * (1.0 / 134217729.0);
+    elapsed += -log(u) * sites / total;
+    if (elapsed > updates)
+      break;
+
+    double target = (rng() >> 5) * (1.0 / 134217728.0) * total;
+    int chosen = -1;
+    for (size_t c = 0; c < members.size(); c++) {
+      double weight = members[c].size() * rates[c];
+      if (weight <= 0.0)
+        continue;
+      chosen = (int)c;
+      if (target < weight)
+        break;
+      target -= weight;
+    }
+    const vector<int> &candidates = members[chosen];
+    int site = candidates[rng() % (uint32_t)candidates.size()];
+    lattice.spins[site] = static_cast<int8_t>(-lattice.spins[site]);
+    flips++;
+    Move(site, ClassOf(lattice, site));
+    for (int k = lattice.offsets[site]; k < lattice.offsets[site + 1]; k++) {
+      int j = lattice.neighbors[k];
+      if (classOf[j] >= 0)
+        Move(j, ClassOf(lattice, j));
+    }
+  }
+  return flips;
+}
@@ -0,0 +1,537 @@
+#include "lattice.h"
+#include "trace.h"
+#include <cstddef>
+#include <random>
+#include <unordered_map>
+
+bool ReportProgress(BuildProgress *progress, float fraction) {
+  if (!progress)
+    return false;
+  progress->fraction.store(
+      progress->phaseStart + progress->phaseSpan * fraction,
+      memory_order_relaxed);
+  return progress->cancelled.load(memory_order_relaxed);
+}
+
+/**
+ * @brief Crée un réseau cubique simple
+ * @param x,y,z Dimensions du réseau
+ * @param distance Distance interatomique
+ * @param progress Suivi optionnel (progression / annulation)
+ * @return Vecteur des atomes positionnés (spins à initialiser par l'appelant)
+ */
+
+vector<Atome> make_cubic_struc(int x, int y, int z, float distance,
+                               BuildProgress *progress) {
+  TRACE_SCOPE("make_cubic_struc");
+  vector<Atome> points(x * y * z);
+  auto getIndex = [=](int i, int j, int k) { return i * y * z + j * z + k; };
+
+  for (int i = 0; i < x; i++) {
+    if (ReportProgress(progress, (float)i / x))
+      return {};
+    for (int j = 0; j < y; j++) {
+      for (int k = 0; k < z; k++) {
+        int idx = getIndex(i, j, k);
+        points[idx].pos = {i * distance, j * distance, k * distance};
+
+        if (i > 0)
+          points[idx].neigh.push_back(getIndex(i - 1, j, k));
+        if (i < x - 1)
+          points[idx].neigh.push_back(getIndex(i + 1, j, k));
+        if (j > 0)
+          points[idx].neigh.push_back(getIndex(i, j - 1, k));
+        if (j < y - 1)
+          points[idx].neigh.push_back(getIndex(i, j + 1, k));
+        if (k > 0)
+          points[idx].neigh.push_back(getIndex(i, j, k - 1));
+        if (k < z - 1)
+          points[idx].neigh.push_back(getIndex(i, j, k + 1));
+      }
+    }
+  }
+  ReportProgress(progress, 1.0f);
+  return points;
+}
+
+vector<Atome> make_hexagonal_struc(int x, int y, int z, float distance,
+                                   BuildProgress *progress) {
+  TRACE_SCOPE("make_hexagonal_struc");
+  vector<Atome> points;
+  points.reserve(x * y * z);
+
+  float a = distance;
+  float c = a * 1.2f; // Ideal c/a ratio for HCP
+
+  for (int layer = 0; layer < z; layer++) {
+    if (ReportProgress(progress, 0.1f * layer / z))
+      return {};
+    // ABAB stacking pattern
+    bool isLayerB = (layer % 2 == 1);
+
+    for (int row = 0; row < y; row++) {
+      for (int col = 0; col < x; col++) {
+        Atome atom;
+
+        // Base position
+        atom.pos.x = col * a;
+        atom.pos.y = row * (a * sqrt(3.0f) / 2.0f);
+        atom.pos.z = layer * c;
+
+        // Apply offset for B layers
+        if (isLayerB) {
+          atom.pos.x += a / 2.0f;
+          atom.pos.y += (a * sqrt(3.0f) / 6.0f);
+        }
+
+        // Apply offset for even rows within each layer
+        if (row % 2 == 1) {
+          atom.pos.x += a / 2.0f;
+        }
+
+        points.push_back(atom);
+      }
+    }
+  }
+
+  // Establish neighbor connections
+  for (size_t i = 0; i < points.size(); i++) {
+    if (ReportProgress(progress, 0.1f + 0.9f * i / points.size()))
+      return {};
+    points[i].neigh.clear();
+
+    for (size_t j = 0; j < points.size(); j++) {
+      if (i == j)
+        continue;
+
+      float dist = Vector3Distance(points[i].pos, points[j].pos);
+      // In HCP, the nearest neighbor distance is exactly 'a'
+      if (dist <= a * 1.1f) {
+        points[i].neigh.push_back(static_cast<int>(j));
+      }
+    }
+  }
+
+  ReportProgress(progress, 1.0f);
+  return points;
+}
+
+vector<Atome> make_fcc_struc(int x, int y, int z, float distance,
+                             BuildProgress *progress) {
+  TRACE_SCOPE("make_fcc_struc");
+  vector<Atome> points;
+
+  // In FCC, we want to avoid duplicates at the boundaries
+  float a = distance; // lattice constant
+
+  // Create a 3D grid to track atom positions
+  const float tolerance = 0.01f * a;
+  auto isNearExistingAtom = [&points, tolerance](const Vector3 &pos) {
+    for (const auto &atom : points) {
+      if (Vector3Distance(atom.pos, pos) < tolerance) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Generate atoms for each unit cell
+  for (int i = 0; i < x; i++) {
+    if (ReportProgress(progress, 0.5f * i / x))
+      return {};
+    for (int j = 0; j < y; j++) {
+      for (int k = 0; k < z; k++) {
+        Vector3 basePos = {i * a, j * a, k * a};
+
+        // Corner atom (0,0,0)
+        Vector3 pos = basePos;
+        if (!isNearExistingAtom(pos)) {
+          Atome atom;
+          atom.pos = pos;
+          points.push_back(atom);
+        }
+
+        // Face centers
+        Vector3 facePositions[] = {
+            {basePos.x + a / 2, basePos.y + a / 2, basePos.z},
+            {basePos.x + a / 2, basePos.y, basePos.z + a / 2},
+            {basePos.x, basePos.y + a / 2, basePos.z + a / 2}};
+
+        for (const auto &facePos : facePositions) {
+          if (!isNearExistingAtom(facePos)) {
+            Atome atom;
+            atom.pos = facePos;
+            points.push_back(atom);
+          }
+        }
+      }
+    }
+  }
+
+  // Establish neighbor connections (each atom has 12 nearest neighbors in FCC)
+  for (size_t i = 0; i < points.size(); i++) {
+    if (ReportProgress(progress, 0.5f + 0.5f * i / points.size()))
+      return {};
+    points[i].neigh.clear();
+
+    for (size_t j = 0; j < points.size(); j++) {
+      if (i == j)
+        continue;
+
+      float dist = Vector3Distance(points[i].pos, points[j].pos);
+      // Nearest neighbor distance in FCC is a/√2 ≈ 0.707a
+      if (dist <= a * 0.75f) {
+        points[i].neigh.push_back(static_cast<int>(j));
+      }
+    }
+  }
+
+  ReportProgress(progress, 1.0f);
+  return points;
+}
+
+vector<Atome> make_bcc_struc(int x, int y, int z, float distance,
+                             BuildProgress *progress) {
+  TRACE_SCOPE("make_bcc_struc");
+  vector<Atome> points;
+
+  float a = distance; // lattice constant
+
+  // Create a 3D grid to track atom positions
+  const float tolerance = 0.01f * a;
+  auto isNearExistingAtom = [&points, tolerance](const Vector3 &pos) {
+    for (const auto &atom : points) {
+      if (Vector3Distance(atom.pos, pos) < tolerance) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  // Generate atoms for each unit cell
+  for (int i = 0; i < x; i++) {
+    if (ReportProgress(progress, 0.5f * i / x))
+      return {};
+    for (int j = 0; j < y; j++) {
+      for (int k = 0; k < z; k++) {
+        Vector3 basePos = {i * a, j * a, k * a};
+
+        // Corner atom (0,0,0)
+        Vector3 pos = basePos;
+        if (!isNearExistingAtom(pos)) {
+          Atome atom;
+          atom.pos = pos;
+          points.push_back(atom);
+        }
+
+        // Body center
+        Vector3 centerPos = {basePos.x + a / 2, basePos.y + a / 2,
+                             basePos.z + a / 2};
+        if (!isNearExistingAtom(centerPos)) {
+          Atome atom;
+          atom.pos = centerPos;
+          points.push_back(atom);
+        }
+      }
+    }
+  }
+
+  // Establish neighbor connections (each atom has 8 nearest neighbors in BCC)
+  for (size_t i = 0; i < points.size(); i++) {
+    if (ReportProgress(progress, 0.5f + 0.5f * i / points.size()))
+      return {};
+    points[i].neigh.clear();
+
+    for (size_t j = 0; j < points.size(); j++) {
+      if (i == j)
+        continue;
+
+      float dist = Vector3Distance(points[i].pos, points[j].pos);
+      // Nearest neighbor distance in BCC is a*√3/2 ≈ 0.866a
+      if (dist <= a * 0.9f) {
+        points[i].neigh.push_back(static_cast<int>(j));
+      }
+    }
+  }
+
+  ReportProgress(progress, 1.0f);
+  return points;
+}
+
+float NeighborCutoff(StructureType type, float distance) {
+  switch (type) {
+  case StructureType::FCC:
+    return distance * 0.75f;
+  case StructureType::BCC:
+    return distance * 0.9f;
+  default:
+    return distance * 1.1f;
+  }
+}
+
+vector<Vector3> MakeLatticeSites(StructureType type, int x, int y, int z,
+                                 float distance) {
+  vector<Vector3> sites;
+  float a = distance;
+
+  switch (type) {
+  case StructureType::CUBIC:
+    sites.reserve(x * y * z);
+    for (int i = 0; i < x; i++)
+      for (int j = 0; j < y; j++)
+        for (int k = 0; k < z; k++)
+          sites.push_back({i * a, j * a, k * a});
+    break;
+
+  case StructureType::HEXAGONAL:
+    // Same ABAB stacking as make_hexagonal_struc
+    sites.reserve(x * y * z);
+    for (int layer = 0; layer < z; layer++) {
+      for (int row = 0; row < y; row++) {
+        for (int col = 0; col < x; col++) {
+          Vector3 pos = {col * a, row * (a * sqrt(3.0f) / 2.0f),
+                         layer * (a * 1.2f)};
+          if (layer % 2 == 1) {
+            pos.x += a / 2.0f;
+            pos.y += (a * sqrt(3.0f) / 6.0f);
+          }
+          if (row % 2 == 1) {
+            pos.x += a / 2.0f;
+          }
+          sites.push_back(pos);
+        }
+      }
+    }
+    break;
+
+  case StructureType::FCC:
+    sites.reserve(4 * x * y * z);
+    for (int i = 0; i < x; i++) {
+      for (int j = 0; j < y; j++) {
+        for (int k = 0; k < z; k++) {
+          Vector3 base = {i * a, j * a, k * a};
+          sites.push_back(base);
+          sites.push_back({base.x + a / 2, base.y + a / 2, base.z});
+          sites.push_back({base.x + a / 2, base.y, base.z + a / 2});
+          sites.push_back({base.x, base.y + a / 2, base.z + a / 2});
+        }
+      }
+    }
+    break;
+
+  case StructureType::BCC:
+    sites.reserve(2 * x * y * z);
+    for (int i = 0; i < x; i++) {
+      for (int j = 0; j < y; j++) {
+        for (int k = 0; k < z; k++) {
+          Vector3 base = {i * a, j * a, k * a};
+          sites.push_back(base);
+          sites.push_back({base.x + a / 2, base.y + a / 2, base.z + a / 2});
+        }
+      }
+    }
+    break;
+
+  case StructureType::CUSTOM:
+    // Described by a unit cell file, see BuildUnitCellLattice
+    break;
+  }
+  return sites;
+}
+
+void RescaleStructure(vector<Atome> &structure, float factor) {
+  for (auto &atom : structure) {
+    atom.pos = Vector3Scale(atom.pos, factor);
+  }
+}
+
+// Lattice positions scaled to a unit distance, quantized finely enough to
+// tell sites apart while absorbing float rounding from earlier rescales
+static long long SiteKey(Vector3 pos, float distance) {
+  const float quantum = 0.01f * distance;
+  long long qx = llroundf(pos.x / quantum);
+  long long qy = llroundf(pos.y / quantum);
+  long long qz = llroundf(pos.z / quantum);
+  return (qx * 1000003LL + qy) * 1000003LL + qz;
+}
+
+vector<int> ResizeStructure(vector<Atome> &structure, float oldDistance,
+                            StructureType type, int x, int y, int z,
+                            float distance, BuildProgress *progress) {
+  TRACE_SCOPE("ResizeStructure");
+  vector<Vector3> sites = MakeLatticeSites(type, x, y, z, distance);
+
+  unordered_map<long long, int> oldIndex;
+  oldIndex.reserve(structure.size());
+  for (size_t i = 0; i < structure.size(); i++) {
+    oldIndex[SiteKey(structure[i].pos, oldDistance)] = static_cast<int>(i);
+  }
+  if (ReportProgress(progress, 0.2f))
+    return {};
+
+  // Carry over the overlapping atoms, remember where each one went
+  vector<Atome> resized(sites.size());
+  vector<int> previous(sites.size(), -1);
+  vector<int> remap(structure.size(), -1);
+  vector<int> added;
+  mt19937 rng(random_device{}());
+  bernoulli_distribution coin(0.5);
+  for (size_t i = 0; i < sites.size(); i++) {
+    auto it = oldIndex.find(SiteKey(sites[i], distance));
+    if (it != oldIndex.end()) {
+      previous[i] = it->second;
+      remap[it->second] = static_cast<int>(i);
+    } else {
+      resized[i].spin = coin(rng) ? Spin::UP : Spin::DOWN;
+      added.push_back(static_cast<int>(i));
+    }
+  }
+  for (size_t i = 0; i < sites.size(); i++) {
+    if (previous[i] >= 0) {
+      // structure is replaced below, its neighbor lists can be moved
+      Atome &kept = resized[i];
+      kept = std::move(structure[previous[i]]);
+      // Neighbors cut off by a shrink simply disappear from the list
+      size_t n = 0;
+      for (int neighborIdx : kept.neigh) {
+        if (remap[neighborIdx] >= 0)
+          kept.neigh[n++] = remap[neighborIdx];
+      }
+      kept.neigh.resize(n);
+    }
+    resized[i].pos = sites[i];
+  }
+  if (ReportProgress(progress, 0.5f))
+    return {};
+
+  // Only the added sites need a neighbor search, through a cell hash
+  if (!added.empty()) {
+    const float cutoff = NeighborCutoff(type, distance);
+    auto cellOf = [cutoff](Vector3 p, int dx, int dy, int dz) {
+      long long cx = (long long)floorf(p.x / cutoff) + dx;
+      long long cy = (long long)floorf(p.y / cutoff) + dy;
+      long long cz = (long long)floorf(p.z / cutoff) + dz;
+      return (cx * 1000003LL + cy) * 1000003LL + cz;
+    };
+    unordered_multimap<long long, int> cells;
+    cells.reserve(resized.size());
+    for (size_t i = 0; i < resized.size(); i++) {
+      cells.emplace(cellOf(resized[i].pos, 0, 0, 0), static_cast<int>(i));
+    }
+
+    for (size_t n = 0; n < added.size(); n++) {
+      if (n % 1024 == 0 &&
+          ReportProgress(progress, 0.5f + 0.5f * n / added.size()))
+        return {};
+      int i = added[n];
+      for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+          for (int dz = -1; dz <= 1; dz++) {
+            auto range = cells.equal_range(cellOf(resized[i].pos, dx, dy, dz));
+            for (auto it = range.first; it != range.second; ++it) {
+              int j = it->second;
+              if (j == i ||
+                  Vector3Distance(resized[i].pos, resized[j].pos) > cutoff)
+                continue;
+              resized[i].neigh.push_back(j);
+              // Added sites link back to themselves from their own search
+              if (previous[j] >= 0)
+                resized[j].neigh.push_back(i);
+            }
+          }
+        }
+      }
+    }
+  }
+
+  structure = std::move(resized);
+  ReportProgress(progress, 1.0f);
+  return previous;
+}
+
+float CalculateTotalEnergy(const vector<Atome> &structure) {
+  TRACE_SCOPE("CalculateTotalEnergy");
+  float totalEnergy = 0.0f;
+  for (const auto &atom : structure) {
+    totalEnergy += atom.energy;
+  }
+  return totalEnergy / 2.0f; // Divide by 2 to avoid double counting
+}
+
+/**
+ * @brief Met à jour les énergies de tous les atomes
+ * @param structure Vecteur des atomes
+ * @param params Paramètres de simulation
+ */
+// Sum of neighbor spins, weighted by the per-bond couplings if any
+static float LocalField(const vector<Atome> &structure, const Atome &atom) {
+  float field = 0.0f;
+  if (atom.coupling.empty()) {
+    for (int neighborIdx : atom.neigh) {
+      field += static_cast<int>(structure[neighborIdx].spin);
+    }
+  } else {
+    for (size_t n = 0; n < atom.neigh.size(); n++) {
+      field += atom.coupling[n] *
+               static_cast<int>(structure[atom.neigh[n]].spin);
+    }
+  }
+  return field;
+}
+
+void UpdateEnergies(vector<Atome> &structure, float J, float B) {
+  TRACE_SCOPE("UpdateEnergies");
+  for (auto &atom : structure) {
+    float interactionEnergy = LocalField(structure, atom);
+    atom.energy = -J * static_cast<int>(atom.spin) * interactionEnergy -
+                  B * static_cast<int>(atom.spin);
+  }
+}
+
+// Simulation MONTE CARLO //
+
+/**
+ * @brief Effectue un pas Monte Carlo
+ * @param structure Référence vers les atomes
+ * @param params Paramètres de simulation (température, champ B, etc.)
+ */
+bool MonteCarloStep(vector<Atome> &structure, float temperature, float J,
+                    float B, mt19937 &rng) {
+  int randomIdx = uniform_int_distribution<int>(
+      0, (int)structure.size() - 1)(rng);
+  auto &atom = structure[randomIdx];
+  if (atom.pinned)
+    return false;
+
+  float currentEnergy = LocalField(structure, atom);
+  currentEnergy = -J * static_cast<int>(atom.spin) * currentEnergy -
+                  B * static_cast<int>(atom.spin);
+
+  Spin newSpin = (atom.spin == Spin::UP) ? Spin::DOWN : Spin::UP;
+
+  float newEnergy = LocalField(structure, atom);
+  newEnergy = -J * static_cast<int>(newSpin) * newEnergy -
+              B * static_cast<int>(newSpin);
+
+  float deltaE = newEnergy - currentEnergy;
+
+  if (deltaE < 0 ||
+      (temperature > 0 && uniform_real_distribution<float>()(rng) <
+                              exp(-deltaE / temperature))) {
+    atom.spin = newSpin;
+    UpdateEnergies(structure, J, B);
+    return true;
+  }
+  return false;
+}
+
+void CopyPinned(const vector<Atome> &structure, vector<uint8_t> &pinned) {
+  pinned.assign(structure.size(), 0);
+  bool any = false;
+  for (size_t i = 0; i < structure.size(); i++) {
+    pinned[i] = structure[i].pinned;
+    any |= structure[i].pinned;
+  }
+  if (!any)
+    pinned.clear(); // Kernels skip the mask test entirely
+}
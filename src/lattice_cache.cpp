@@ -0,0 +1,266 @@
+#include "lattice_cache.h"
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char cacheMagic[4] = {'I', 'S', 'L', 'T'};
+static const uint32_t cacheVersion = 1;
+
+// Fixed-size header in front of the raw arrays of a cache file
+struct CacheHeader {
+  char magic[4];
+  uint32_t version;
+  int32_t type, x, y, z;
+  float distance;
+  int64_t siteCount;
+  int64_t neighborCount;
+};
+
+static const char *TypeName(StructureType type) {
+  switch (type) {
+  case StructureType::CUBIC:
+    return "cubic";
+  case StructureType::HEXAGONAL:
+    return "hcp";
+  case StructureType::FCC:
+    return "fcc";
+  case StructureType::BCC:
+    return "bcc";
+  case StructureType::CUSTOM:
+    return "custom";
+  }
+  return "unknown";
+}
+
+// Checks the header and the file size before any array is read
+static bool ValidHeader(const CacheHeader &header, const LatticeKey &key,
+                        size_t fileSize) {
+  if (memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 ||
+      header.version != cacheVersion ||
+      header.type != static_cast<int32_t>(key.type) || header.x != key.x ||
+      header.y != key.y || header.z != key.z ||
+      fabsf(header.distance - key.distance) > 1e-4f || header.siteCount < 0 ||
+      header.neighborCount < 0)
+    return false;
+  // Indices are int32 and no count can exceed the file: the sum below
+  // cannot overflow once both are bounded
+  if (header.siteCount >= INT32_MAX || header.neighborCount > INT32_MAX ||
+      (uint64_t)header.siteCount > fileSize / sizeof(Vector3) ||
+      (uint64_t)header.neighborCount > fileSize / sizeof(int32_t))
+    return false;
+  uint64_t expected = sizeof(CacheHeader) +
+                      (uint64_t)header.siteCount * sizeof(Vector3) +
+                      ((uint64_t)header.siteCount + 1) * sizeof(int32_t) +
+                      (uint64_t)header.neighborCount * sizeof(int32_t);
+  return fileSize == expected;
+}
+
+// CSR invariants ToAtoms and the kernels index with, unchecked
+static bool ValidTopology(const LatticeTopology &topology) {
+  const vector<int> &offsets = topology.offsets;
+  int sites = (int)topology.positions.size();
+  if (offsets.size() != topology.positions.size() + 1 || offsets[0] != 0 ||
+      offsets.back() != (int)topology.neighbors.size())
+    return false;
+  for (int i = 0; i < sites; i++)
+    if (offsets[i] > offsets[i + 1])
+      return false;
+  for (int neighbor : topology.neighbors)
+    if (neighbor < 0 || neighbor >= sites)
+      return false;
+  return true;
+}
+
+static shared_ptr<LatticeTopology> FromBytes(const char *bytes) {
+  CacheHeader header;
+  memcpy(&header, bytes, sizeof(header));
+  auto topology = make_shared<LatticeTopology>();
+  const char *cursor = bytes + sizeof(header);
+
+  const Vector3 *positions = reinterpret_cast<const Vector3 *>(cursor);
+  topology->positions.assign(positions, positions + header.siteCount);
+  cursor += header.siteCount * sizeof(Vector3);
+
+  const int32_t *offsets = reinterpret_cast<const int32_t *>(cursor);
+  topology->offsets.assign(offsets, offsets + header.siteCount + 1);
+  cursor += (header.siteCount + 1) * sizeof(int32_t);
+
+  const int32_t *neighbors = reinterpret_cast<const int32_t *>(cursor);
+  topology->neighbors.assign(neighbors, neighbors + header.neighborCount);
+  // A damaged file is a cache miss: the lattice is rebuilt and rewritten
+  return ValidTopology(*topology) ? topology : nullptr;
+}
+
+static shared_ptr<LatticeTopology> LoadFile(const string &path,
+                                            const LatticeKey &key) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return nullptr;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(CacheHeader)) {
+    close(fd);
+    return nullptr;
+  }
+  size_t size = info.st_size;
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED)
+    return nullptr;
+
+  shared_ptr<LatticeTopology> topology;
+  CacheHeader header;
+  memcpy(&header, mapped, sizeof(header));
+  if (ValidHeader(header, key, size))
+    topology = FromBytes(static_cast<const char *>(mapped));
+  munmap(mapped, size);
+  return topology;
+#else
+  // No mmap on Windows: read the whole file in one go instead
+  ifstream file(path, ios::binary | ios::ate);
+  if (!file)
+    return nullptr;
+  size_t size = file.tellg();
+  if (size < sizeof(CacheHeader))
+    return nullptr;
+  vector<char> bytes(size);
+  file.seekg(0);
+  file.read(bytes.data(), size);
+  CacheHeader header;
+  memcpy(&header, bytes.data(), sizeof(header));
+  if (!file || !ValidHeader(header, key, size))
+    return nullptr;
+  return FromBytes(bytes.data());
+#endif
+}
+
+static bool SaveFile(const string &path, const LatticeKey &key,
+                     const LatticeTopology &topology) {
+  CacheHeader header;
+  memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+  header.version = cacheVersion;
+  header.type = static_cast<int32_t>(key.type);
+  header.x = key.x;
+  header.y = key.y;
+  header.z = key.z;
+  header.distance = key.distance;
+  header.siteCount = topology.positions.size();
+  header.neighborCount = topology.neighbors.size();
+
+  // Write next to the target then rename, so readers never see half a file
+  string temporary = path + ".tmp";
+  {
+    ofstream file(temporary, ios::binary | ios::trunc);
+    if (!file)
+      return false;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(topology.positions.data()),
+               topology.positions.size() * sizeof(Vector3));
+    file.write(reinterpret_cast<const char *>(topology.offsets.data()),
+               topology.offsets.size() * sizeof(int32_t));
+    file.write(reinterpret_cast<const char *>(topology.neighbors.data()),
+               topology.neighbors.size() * sizeof(int32_t));
+    if (!file)
+      return false;
+  }
+  error_code error;
+  filesystem::rename(temporary, path, error);
+  return !error;
+}
+
+string LatticeKey::Name() const {
+  char name[96];
+  snprintf(name, sizeof(name), "%s-%dx%dx%d-d%ld", TypeName(type), x, y, z,
+           lroundf(distance * 1000.0f));
+  return name;
+}
+
+LatticeTopology ToTopology(const vector<Atome> &structure) {
+  LatticeTopology topology;
+  topology.positions.reserve(structure.size());
+  topology.offsets.reserve(structure.size() + 1);
+  topology.offsets.push_back(0);
+  for (const auto &atom : structure) {
+    topology.positions.push_back(atom.pos);
+    topology.neighbors.insert(topology.neighbors.end(), atom.neigh.begin(),
+                              atom.neigh.end());
+    topology.offsets.push_back(static_cast<int>(topology.neighbors.size()));
+  }
+  return topology;
+}
+
+vector<Atome> ToAtoms(const LatticeTopology &topology) {
+  vector<Atome> structure(topology.positions.size());
+  for (size_t i = 0; i < structure.size(); i++) {
+    structure[i].pos = topology.positions[i];
+    structure[i].neigh.assign(
+        topology.neighbors.begin() + topology.offsets[i],
+        topology.neighbors.begin() + topology.offsets[i + 1]);
+  }
+  return structure;
+}
+
+LatticeCache::LatticeCache(string directory, size_t capacity)
+    : directory(std::move(directory)), capacity(capacity) {}
+
+string LatticeCache::PathFor(const LatticeKey &key) const {
+  return directory + "/" + key.Name() + ".lat";
+}
+
+void LatticeCache::Touch(const string &name,
+                         shared_ptr<const LatticeTopology> topology) {
+  auto found = index.find(name);
+  if (found != index.end())
+    recent.erase(found->second);
+  recent.emplace_front(name, std::move(topology));
+  index[name] = recent.begin();
+
+  while (recent.size() > capacity) {
+    index.erase(recent.back().first);
+    recent.pop_back();
+  }
+}
+
+shared_ptr<const LatticeTopology> LatticeCache::Find(const LatticeKey &key) {
+  string name = key.Name();
+  {
+    lock_guard<mutex> lock(cacheMutex);
+    auto found = index.find(name);
+    if (found != index.end()) {
+      auto topology = found->second->second;
+      Touch(name, topology);
+      return topology;
+    }
+  }
+
+  shared_ptr<const LatticeTopology> topology = LoadFile(PathFor(key), key);
+  if (topology) {
+    lock_guard<mutex> lock(cacheMutex);
+    Touch(name, topology);
+  }
+  return topology;
+}
+
+void LatticeCache::Store(const LatticeKey &key,
+                         shared_ptr<const LatticeTopology> topology) {
+  {
+    lock_guard<mutex> lock(cacheMutex);
+    Touch(key.Name(), topology);
+  }
+
+  error_code error;
+  filesystem::create_directories(directory, error);
+  if (!error)
+    SaveFile(PathFor(key), key, *topology);
+}
@@ -0,0 +1,154 @@
+#include "lattice_job.h"
+#include "trace.h"
+#include <numeric>
+#include <random>
+
+LatticeBuildJob::~LatticeBuildJob() { Cancel(); }
+
+void LatticeBuildJob::Start(const LatticeRequest &request) {
+  Cancel();
+  progress = make_shared<BuildProgress>();
+  running = true;
+  worker = thread(&LatticeBuildJob::Run, this, request, progress);
+}
+
+void LatticeBuildJob::Cancel() {
+  if (progress)
+    progress->cancelled = true;
+  if (worker.joinable())
+    worker.join();
+
+  // A result that finished before the cancellation is simply dropped
+  lock_guard<mutex> lock(resultMutex);
+  if (result) {
+    for (auto &mesh : result->cylinderMeshes)
+      FreeMeshData(mesh);
+    result.reset();
+  }
+  running = false;
+}
+
+bool LatticeBuildJob::IsRunning() const { return running; }
+
+float LatticeBuildJob::Progress() const {
+  return progress ? progress->fraction.load(memory_order_relaxed) : 0.0f;
+}
+
+bool LatticeBuildJob::TakeResult(LatticeResult &out) {
+  lock_guard<mutex> lock(resultMutex);
+  if (!result)
+    return false;
+  out = std::move(*result);
+  result.reset();
+  running = false;
+  return true;
+}
+
+void LatticeBuildJob::Recycle(vector<Atome> &&structure,
+                              vector<Matrix> &&transforms) {
+  lock_guard<mutex> lock(resultMutex);
+  spareStructure = std::move(structure);
+  spareTransforms = std::move(transforms);
+}
+
+void LatticeBuildJob::Run(LatticeRequest request,
+                          shared_ptr<BuildProgress> tracker) {
+  TraceSetThreadName("Lattice build");
+  TRACE_SCOPE("Lattice build");
+  auto lattice = make_unique<LatticeResult>();
+  lattice->request = request;
+  {
+    lock_guard<mutex> lock(resultMutex);
+    lattice->structure = std::move(spareStructure);
+    lattice->sphereTransforms = std::move(spareTransforms);
+  }
+
+  tracker->phaseSpan = 0.8f;
+  if (request.previous) {
+    // Same topology family: grow/shrink in place and keep existing spins.
+    // Copy-assigning into the recycled atoms reuses their neighbor lists
+    lattice->structure = *request.previous;
+    lattice->previousIndex = ResizeStructure(
+        lattice->structure, request.previousDistance, request.type, request.x,
+        request.y, request.z, request.distance, tracker.get());
+  } else if (request.type == StructureType::CUSTOM) {
+    LatticeTopology topology = BuildUnitCellLattice(
+        *request.unitCell, request.x, request.y, request.z, request.distance,
+        request.periodic, tracker.get());
+    lattice->structure = ToAtoms(topology, *request.unitCell);
+    if (request.keepSites && !tracker->cancelled) {
+      // Sites only depend on the cell and the counts: map each one to itself
+      lattice->previousIndex.resize(lattice->structure.size());
+      iota(lattice->previousIndex.begin(), lattice->previousIndex.end(), 0);
+    }
+  } else {
+    LatticeKey key;
+    key.type = request.type;
+    key.x = request.x;
+    key.y = request.y;
+    key.z = request.z;
+    key.distance = request.distance;
+
+    if (auto cached = cache.Find(key)) {
+      lattice->structure = ToAtoms(*cached);
+    } else {
+      switch (request.type) {
+      case StructureType::CUBIC:
+        lattice->structure = make_cubic_struc(request.x, request.y, request.z,
+                                              request.distance, tracker.get());
+        break;
+      case StructureType::HEXAGONAL:
+        lattice->structure = make_hexagonal_struc(
+            request.x, request.y, request.z, request.distance, tracker.get());
+        break;
+      case StructureType::FCC:
+        lattice->structure = make_fcc_struc(request.x, request.y, request.z,
+                                            request.distance, tracker.get());
+        break;
+      case StructureType::BCC:
+        lattice->structure = make_bcc_struc(request.x, request.y, request.z,
+                                            request.distance, tracker.get());
+        break;
+      case StructureType::CUSTOM:
+        break;
+      }
+
+      if (!tracker->cancelled)
+        cache.Store(key, make_shared<const LatticeTopology>(
+                             ToTopology(lattice->structure)));
+    }
+  }
+
+  if (!request.previous && !request.keepSites) {
+    // GetRandomValue is not thread-safe, the worker owns its generator
+    mt19937 rng(random_device{}());
+    bernoulli_distribution coin(0.5);
+    for (auto &atom : lattice->structure) {
+      atom.spin = coin(rng) ? Spin::UP : Spin::DOWN;
+    }
+  }
+
+  lattice->sphereTransforms.clear();
+  lattice->sphereTransforms.reserve(lattice->structure.size());
+  for (const auto &atom : lattice->structure) {
+    lattice->sphereTransforms.push_back(
+        MatrixTranslate(atom.pos.x, atom.pos.y, atom.pos.z));
+  }
+
+  if (!tracker->cancelled) {
+    tracker->phaseStart = 0.8f;
+    tracker->phaseSpan = 0.2f;
+    lattice->cylinderMeshes =
+        BakeChunkedCylinderLines(lattice->structure, request.bondRadius,
+                                 request.segments, 1000, tracker.get());
+  }
+
+  if (tracker->cancelled) {
+    for (auto &mesh : lattice->cylinderMeshes)
+      FreeMeshData(mesh);
+    return;
+  }
+  tracker->fraction = 1.0f;
+  lock_guard<mutex> lock(resultMutex);
+  result = std::move(lattice);
+}
@@ -1,30 +1,28 @@
+#include "app.h"
 #include "auth.h"
-#include "raylib.h"
-#include "rlImGui.h"
 #include "simulation_ui.h"
 
 int main() {
-  // Initialisation fenêtre en plein écran
-  int monitor = GetCurrentMonitor();
-  int screenWidth = GetMonitorWidth(monitor);
-  int screenHeight = GetMonitorHeight(monitor);
+  // Une seule fenêtre et un seul contexte ImGui pour tous les écrans
+  InitApplication();
 
-  // Création fenêtre borderless
-  InitWindow(screenWidth, screenHeight, "3D Ising Model Simulation");
-  SetWindowPosition(screenWidth / 2, screenHeight / 2);
-  SetTargetFPS(60);
-  rlImGuiSetup(true);
-
-  // Authentification utilisateur
-  bool logged_in = runAuthentication();
-  // Nettoyage après authentification
-  rlImGuiShutdown();
-  CloseWindow();
-
-  // Si authentification réussie, lancer la simulation avec les paramètres
-  if (logged_in) {
-    runSimulation();
+  AppState state = AppState::LOGIN;
+  std::string user;
+  while (state != AppState::QUIT) {
+    switch (state) {
+    case AppState::LOGIN:
+      // Authentification utilisateur
+      state = runAuthentication(user) ? AppState::SIMULATION : AppState::QUIT;
+      break;
+    case AppState::SIMULATION:
+      runSimulation(user);
+      state = AppState::QUIT;
+      break;
+    case AppState::QUIT:
+      break;
+    }
   }
 
+  ShutdownApplication();
   return 0;
 }
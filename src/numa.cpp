@@ -0,0 +1,328 @@
+#include "numa.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <utility>
+#ifdef __linux__
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static const size_t hugePageBytes = 2u << 20;
+
+// "0-3,8-11" as in /sys cpulist files
+static vector<int> ParseCpuList(const string &text) {
+  vector<int> cpus;
+  stringstream stream(text);
+  string range;
+  while (getline(stream, range, ',')) {
+    int first = 0, last = 0;
+    int fields = sscanf(range.c_str(), "%d-%d", &first, &last);
+    if (fields < 1)
+      continue;
+    if (fields == 1)
+      last = first;
+    for (int cpu = first; cpu <= last; cpu++)
+      cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+vector<int> NumaTopology::CpuOrder() const {
+  vector<int> order;
+  for (const vector<int> &cpus : nodeCpus)
+    order.insert(order.end(), cpus.begin(), cpus.end());
+  return order;
+}
+
+NumaTopology ReadNumaTopology() {
+  NumaTopology topology;
+#ifdef __linux__
+  vector<pair<int, vector<int>>> nodes;
+  if (DIR *directory = opendir("/sys/devices/system/node")) {
+    while (dirent *entry = readdir(directory)) {
+      int node = 0;
+      if (sscanf(entry->d_name, "node%d", &node) != 1)
+        continue;
+      ifstream file(string("/sys/devices/system/node/") + entry->d_name +
+                    "/cpulist");
+      string text;
+      getline(file, text);
+      vector<int> cpus = ParseCpuList(text);
+      if (!cpus.empty()) // Memory-only nodes run no thread
+        nodes.emplace_back(node, move(cpus));
+    }
+    closedir(directory);
+  }
+  sort(nodes.begin(), nodes.end());
+  for (auto &node : nodes)
+    topology.nodeCpus.push_back(move(node.second));
+#endif
+  if (topology.nodeCpus.empty()) {
+    vector<int> cpus;
+    unsigned count = max(1u, thread::hardware_concurrency());
+    for (unsigned cpu = 0; cpu < count; cpu++)
+      cpus.push_back((int)cpu);
+    topology.nodeCpus.push_back(cpus);
+  }
+  return topology;
+}
+
+PageBuffer::PageBuffer(PageBuffer &&other) noexcept { *this = move(other); }
+
+PageBuffer &PageBuffer::operator=(PageBuffer &&other) noexcept {
+  if (this != &other) {
+    Release();
+    mapping = exchange(other.mapping, nullptr);
+    mappedBytes = exchange(other.mappedBytes, 0);
+    data = exchange(other.data, nullptr);
+    size = exchange(other.size, 0);
+    backing = exchange(other.backing, HugePages::NONE);
+  }
+  return *this;
+}
+
+PageBuffer::~PageBuffer() { Release(); }
+
+void PageBuffer::Release() {
+#ifdef __linux__
+  if (mapping)
+    munmap(mapping, mappedBytes);
+#else
+  free(mapping);
+#endif
+  mapping = data = nullptr;
+  mappedBytes = size = 0;
+}
+
+bool PageBuffer::Allocate(size_t bytes, HugePages mode, string &error) {
+  Release();
+  if (bytes == 0)
+    return true;
+#ifdef __linux__
+  size_t rounded = (bytes + hugePageBytes - 1) / hugePageBytes * hugePageBytes;
+  if (mode == HugePages::EXPLICIT) {
+    // Hugetlb mappings come aligned; fails without reserved pages
+    void *pages = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (pages != MAP_FAILED) {
+      mapping = data = pages;
+      mappedBytes = rounded;
+      size = bytes;
+      backing = HugePages::EXPLICIT;
+      return true;
+    }
+    mode = HugePages::TRANSPARENT;
+  }
+  // One extra huge page of address space to align the start
+  size_t reserved = rounded + hugePageBytes;
+  void *pages = mmap(nullptr, reserved, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (pages == MAP_FAILED) {
+    error = "Cannot map " + to_string(bytes >> 20) + " MB";
+    return false;
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(pages);
+  uintptr_t aligned = (start + hugePageBytes - 1) & ~(hugePageBytes - 1);
+  mapping = pages;
+  mappedBytes = reserved;
+  data = reinterpret_cast<void *>(aligned);
+  size = bytes;
+  backing = mode;
+  // Advice only: without THP support the pages stay small
+  madvise(data, rounded,
+          mode == HugePages::NONE ? MADV_NOHUGEPAGE : MADV_HUGEPAGE);
+  return true;
+#else
+  // No placement control: an untouched heap block is the closest
+  mapping = data = malloc(bytes);
+  if (!data) {
+    error = "Cannot allocate " + to_string(bytes >> 20) + " MB";
+    return false;
+  }
+  mappedBytes = size = bytes;
+  backing = HugePages::NONE;
+  (void)mode;
+  return true;
+#endif
+}
+
+// Huge-page bytes of the smaps entry holding address
+static size_t HugeBytesAt(const void *address) {
+  size_t total = 0;
+#ifdef __linux__
+  ifstream smaps("/proc/self/smaps");
+  uintptr_t target = reinterpret_cast<uintptr_t>(address);
+  bool inside = false;
+  string line;
+  while (getline(smaps, line)) {
+    uintptr_t first = 0, last = 0;
+    if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR, &first, &last) == 2 &&
+        line.find(':') > line.find(' ')) {
+      if (inside)
+        break;
+      inside = target >= first && target < last;
+      continue;
+    }
+    size_t kilobytes = 0;
+    if (!inside)
+      continue;
+    if (sscanf(line.c_str(), "AnonHugePages: %zu kB", &kilobytes) == 1 ||
+        sscanf(line.c_str(), "Private_Hugetlb: %zu kB", &kilobytes) == 1)
+      total += kilobytes << 10;
+  }
+#else
+  (void)address;
+#endif
+  return total;
+}
+
+NumaPlacement MeasurePlacement(const void *data, size_t bytes,
+                               size_t samples) {
+  NumaPlacement placement;
+  if (!data || bytes == 0)
+    return placement;
+#if defined(__linux__) && defined(SYS_move_pages)
+  size_t pageBytes = (size_t)sysconf(_SC_PAGESIZE);
+  size_t pageCount = (bytes + pageBytes - 1) / pageBytes;
+  samples = max<size_t>(1, samples);
+  size_t stride = max<size_t>(1, (pageCount + samples - 1) / samples);
+  vector<void *> pages;
+  for (size_t page = 0; page < pageCount; page += stride)
+    pages.push_back(const_cast<char *>(static_cast<const char *>(data)) +
+                    page * pageBytes);
+  vector<int> status(pages.size(), 0);
+  // No target nodes: only reports where each page lives
+  if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr,
+              status.data(), 0) == 0) {
+    placement.available = true;
+    double sampleBytes = (double)bytes / pages.size();
+    vector<double> nodeBytes;
+    double absent = 0.0;
+    for (int node : status) {
+      if (node < 0) {
+        absent += sampleBytes;
+        continue;
+      }
+      if ((size_t)node >= nodeBytes.size())
+        nodeBytes.resize(node + 1, 0.0);
+      nodeBytes[node] += sampleBytes;
+    }
+    for (double nodeTotal : nodeBytes)
+      placement.nodeBytes.push_back((size_t)nodeTotal);
+    placement.absentBytes = (size_t)absent;
+  }
+#endif
+  placement.hugeBytes = HugeBytesAt(data);
+  return placement;
+}
+
+bool NumaLattice::Create(ThreadPool &pool, int lx, int ly, int lz,
+                         uint32_t seed, const NumaOptions &options,
+                         string &error) {
+  if (lx <= 0 || ly <= 0 || lz <= 0 || lx % 2 || ly % 2 || lz % 2) {
+    error = "Dimensions must be positive and even (checkerboard)";
+    return false;
+  }
+  this->pool = &pool;
+  this->lx = lx;
+  this->ly = ly;
+  this->lz = lz;
+  tableT = -1.0f;
+  if (!buffer.Allocate(Sites(), options.hugePages, error))
+    return false;
+  if (options.pin && !pool.Pin(ReadNumaTopology().CpuOrder())) {
+    error = "Cannot pin the pool threads";
+    return false;
+  }
+
+  workers = vector<WorkerState>(pool.Size());
+  for (unsigned w = 0; w < workers.size(); w++) {
+    seed_seq streams = {seed, (uint32_t)w};
+    workers[w].rng.seed(streams);
+  }
+  auto fill = [this](unsigned w, int first, int last) {
+    mt19937 &rng = workers[w].rng;
+    int8_t *spins = Plane(first);
+    size_t count = (size_t)(last - first) * this->ly * this->lz;
+    for (size_t s = 0; s < count; s++)
+      spins[s] = (rng() >> 31) ? 1 : -1;
+  };
+  if (options.firstTouch) {
+    pool.ParallelForWorkers(0, lx, fill);
+  } else {
+    // Same spins, but every page lands on the node of the calling thread
+    unsigned count = pool.Size();
+    for (unsigned w = 0; w < count; w++)
+      fill(w, (int)((long long)lx * w / count),
+           (int)((long long)lx * (w + 1) / count));
+  }
+  return true;
+}
+
+long long NumaLattice::Sweep(float temperature, float J, float B) {
+  if (temperature != tableT || J != tableJ || B != tableB) {
+    table.Build(6, temperature, J, B);
+    tableT = temperature;
+    tableJ = J;
+    tableB = B;
+  }
+  for (int color = 0; color < 2; color++) {
+    // Same-color sites are not neighbors: slabs only read the other color
+    pool->ParallelForWorkers(0, lx, [this, color](unsigned w, int first,
+                                                  int last) {
+      long long accepted = 0;
+      for (int i = first; i < last; i++)
+        accepted += CubicPlaneSweep(
+            Plane(i), Plane(i == 0 ? lx - 1 : i - 1),
+            Plane(i + 1 == lx ? 0 : i + 1), ly, lz, i & 1, color, table,
+            workers[w].rng);
+      workers[w].sums[0] = color ? workers[w].sums[0] + accepted : accepted;
+    });
+  }
+  long long accepted = 0;
+  for (const WorkerState &worker : workers)
+    accepted += worker.sums[0];
+  return accepted;
+}
+
+NumaObservables NumaLattice::Measure(float J, float B) {
+  pool->ParallelForWorkers(0, lx, [this](unsigned w, int first, int last) {
+    // Bonds towards +x, +y and +z only, so each is counted once
+    long long bonds = 0, total = 0;
+    for (int i = first; i < last; i++) {
+      const int8_t *plane = Plane(i);
+      const int8_t *next = Plane(i + 1 == lx ? 0 : i + 1);
+      for (int j = 0; j < ly; j++) {
+        size_t row = (size_t)j * lz;
+        size_t up = (size_t)(j + 1 == ly ? 0 : j + 1) * lz;
+        for (int k = 0; k < lz; k++) {
+          int spin = plane[row + k];
+          bonds += spin * (next[row + k] + plane[up + k] +
+                           plane[row + (k + 1 == lz ? 0 : k + 1)]);
+          total += spin;
+        }
+      }
+    }
+    workers[w].sums[0] = bonds;
+    workers[w].sums[1] = total;
+  });
+  long long bonds = 0, total = 0;
+  for (const WorkerState &worker : workers) {
+    bonds += worker.sums[0];
+    total += worker.sums[1];
+  }
+  NumaObservables observables;
+  observables.energy = -(double)J * bonds - (double)B * total;
+  observables.magnetization = (double)total / Sites();
+  return observables;
+}
+
+NumaPlacement NumaLattice::Placement() const {
+  return MeasurePlacement(buffer.Data(), buffer.Size());
+}
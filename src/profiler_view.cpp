@@ -0,0 +1,182 @@
+#include "profiler_view.h"
+#include "imgui.h"
+#include <algorithm>
+#include <cstring>
+
+static const int64_t captureWindow = 500000000; // ns searched for a frame
+static const char *traceFile = "ising_trace.json";
+
+// Stable color per zone name, whatever the frame
+static ImU32 ZoneColor(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (const char *c = name; *c; c++)
+    hash = (hash ^ (uint8_t)*c) * 16777619u;
+  return ImColor::HSV((hash % 360) / 360.0f, 0.45f, 0.9f);
+}
+
+void ProfilerView::Capture() {
+  // Reuses the event arrays of the previous capture
+  TraceSnapshot(TraceNow() - captureWindow, threads);
+
+  // Last complete frame of the main thread, or the last 60 Hz period
+  const TraceEvent *frame = nullptr;
+  for (const TraceThread &thread : threads) {
+    if (thread.name != "Main")
+      continue;
+    for (const TraceEvent &event : thread.events)
+      if (!strcmp(event.name, "Frame"))
+        frame = &event;
+  }
+  if (frame) {
+    frameStart = frame->start;
+    frameEnd = frame->start + frame->duration;
+  } else {
+    frameEnd = TraceNow();
+    frameStart = frameEnd - 16666667;
+  }
+
+  for (TraceThread &thread : threads) {
+    auto outside = [this](const TraceEvent &event) {
+      return event.start >= frameEnd ||
+             event.start + event.duration <= frameStart;
+    };
+    thread.events.erase(
+        remove_if(thread.events.begin(), thread.events.end(), outside),
+        thread.events.end());
+  }
+  // Main thread first, the others keep their order
+  auto mainThread = find_if(threads.begin(), threads.end(),
+                            [](const TraceThread &thread) {
+                              return thread.name == "Main";
+                            });
+  if (mainThread != threads.end())
+    rotate(threads.begin(), mainThread, mainThread + 1);
+}
+
+void ProfilerView::Draw(bool *open) {
+  ImGui::SetNextWindowSize(ImVec2(900, 420), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler", open)) {
+    ImGui::End(); // Collapsed: no capture either
+    return;
+  }
+  if (!TraceEnabled()) {
+    ImGui::TextWrapped("Zones are compiled out. Configure with "
+                       "-DISING_TRACE=ON to record them.");
+    ImGui::End();
+    return;
+  }
+
+  if (!paused)
+    Capture();
+  ImGui::Checkbox("Pause", &paused);
+  ImGui::SameLine();
+  if (ImGui::Button("Export Chrome Trace")) {
+    exportStatus = WriteChromeTrace(traceFile)
+                       ? string("Saved ") + traceFile +
+                             " (chrome://tracing or Perfetto)"
+                       : string("Cannot write ") + traceFile;
+  }
+  if (!exportStatus.empty()) {
+    ImGui::SameLine();
+    ImGui::TextUnformatted(exportStatus.c_str());
+  }
+  ImGui::Text("Frame: %.2f ms", (frameEnd - frameStart) / 1e6);
+  // Threads without a zone in the frame keep their slot but no band
+  auto firstBand = find_if(threads.begin(), threads.end(),
+                           [](const TraceThread &thread) {
+                             return !thread.events.empty();
+                           });
+  if (firstBand == threads.end()) {
+    ImGui::Text("No zones recorded yet");
+    ImGui::End();
+    return;
+  }
+
+  // Timeline: one band per thread, one lane per nesting level
+  ImDrawList *drawList = ImGui::GetWindowDrawList();
+  float laneHeight = ImGui::GetTextLineHeight() + 4.0f;
+  float labelWidth = 8.0f * ImGui::GetFontSize();
+  float width = ImGui::GetContentRegionAvail().x;
+  float plotWidth = max(width - labelWidth, 50.0f);
+  double scale = plotWidth / (double)max<int64_t>(frameEnd - frameStart, 1);
+  ImVec2 origin = ImGui::GetCursorScreenPos();
+  ImVec2 mouse = ImGui::GetMousePos();
+  const TraceEvent *hovered = nullptr;
+  float y = origin.y;
+  for (const TraceThread &thread : threads) {
+    if (thread.events.empty())
+      continue;
+    int minDepth = thread.events[0].depth, maxDepth = minDepth;
+    for (const TraceEvent &event : thread.events) {
+      minDepth = min(minDepth, event.depth);
+      maxDepth = max(maxDepth, event.depth);
+    }
+    drawList->AddText(ImVec2(origin.x + 4.0f, y + 2.0f),
+                      ImGui::GetColorU32(ImGuiCol_Text), thread.name.c_str());
+    for (const TraceEvent &event : thread.events) {
+      float left = origin.x + labelWidth;
+      float x0 = left + (float)max(0.0, (event.start - frameStart) * scale);
+      float x1 = left + (float)min<double>(
+                            plotWidth,
+                            (event.start + event.duration - frameStart) * scale);
+      x1 = max(x1, x0 + 1.0f);
+      float y0 = y + (event.depth - minDepth) * laneHeight;
+      float y1 = y0 + laneHeight - 1.0f;
+      drawList->AddRectFilled(ImVec2(x0, y0), ImVec2(x1, y1),
+                              ZoneColor(event.name));
+      if (x1 - x0 > 3.0f * ImGui::GetFontSize()) {
+        drawList->PushClipRect(ImVec2(x0, y0), ImVec2(x1, y1), true);
+        drawList->AddText(ImVec2(x0 + 2.0f, y0 + 2.0f), IM_COL32(20, 20, 20, 255),
+                          event.name);
+        drawList->PopClipRect();
+      }
+      if (mouse.x >= x0 && mouse.x < x1 && mouse.y >= y0 && mouse.y < y1)
+        hovered = &event;
+    }
+    y += (maxDepth - minDepth + 1) * laneHeight + 4.0f;
+    drawList->AddLine(ImVec2(origin.x, y - 2.0f),
+                      ImVec2(origin.x + width, y - 2.0f),
+                      ImGui::GetColorU32(ImGuiCol_Border));
+  }
+  drawList->AddRect(origin, ImVec2(origin.x + width, y),
+                    ImGui::GetColorU32(ImGuiCol_Border));
+  ImGui::Dummy(ImVec2(width, y - origin.y));
+  if (hovered) {
+    ImGui::SetTooltip("%s\n%.3f ms", hovered->name, hovered->duration / 1e6);
+  }
+
+  // Inclusive time per zone of the first band, clipped to the frame
+  totals.clear();
+  for (const TraceEvent &event : firstBand->events) {
+    int64_t start = max(event.start, frameStart);
+    int64_t end = min(event.start + event.duration, frameEnd);
+    auto total = find_if(totals.begin(), totals.end(), [&](const ZoneTotal &t) {
+      return !strcmp(t.name, event.name);
+    });
+    if (total == totals.end())
+      total = totals.insert(totals.end(), {event.name, 0.0, 0});
+    total->milliseconds += (end - start) / 1e6;
+    total->calls++;
+  }
+  sort(totals.begin(), totals.end(), [](const ZoneTotal &a, const ZoneTotal &b) {
+    return a.milliseconds > b.milliseconds;
+  });
+  if (ImGui::BeginTable("Zones", 3,
+                        ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInner)) {
+    ImGui::TableSetupColumn("Zone");
+    ImGui::TableSetupColumn("ms");
+    ImGui::TableSetupColumn("Calls");
+    ImGui::TableHeadersRow();
+    for (const ZoneTotal &total : totals) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(total.name);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", total.milliseconds);
+      ImGui::TableNextColumn();
+      ImGui::Text("%d", total.calls);
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+}
@@ -1,23 +1,41 @@
 #include "simulation_ui.h"
+#include "alloc_stats.h"
+#include "app.h"
+#include "annealing.h"
+#include "atom_picker.h"
+#include "autotune.h"
+#include "checkpoint.h"
+#include "cluster.h"
+#include "correlation.h"
+#include "dipolar.h"
+#include "disorder.h"
+#include "frame_budget.h"
+#include "frame_memory.h"
+#include "history_view.h"
+#include "hysteresis.h"
 #include "imgui.h"
-#include "imgui_style.h"
+#include "ising_moves.h"
+#include "lattice_job.h"
+#include "numa.h"
+#include "profiler_view.h"
 #include "simulation.h"
+#include "site_inspector.h"
+#include "spin_model.h"
+#include "spin_view.h"
+#include "stencil.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "unit_cell.h"
+#include "workspace.h"
 #include <algorithm>
 #include <cstddef>
-#include <deque>
+#include <cstdlib>
+#include <future>
 using namespace std;
 
-int runSimulation() {
-  // Configuration de la fenêtre
-  int monitor = GetCurrentMonitor();
-  int screenWidth = GetMonitorWidth(monitor);
-  int screenHeight = GetMonitorHeight(monitor);
-
-  InitWindow(screenWidth, screenHeight, "3D Ising Model Simulation");
-  SetWindowPosition(screenWidth / 2, screenHeight / 2);
-
-  SetTargetFPS(60);
-  rlImGuiSetup(true);
+int runSimulation(const string &user) {
+  // The window, ImGui and the font already exist (InitApplication)
+  double screenStart = MillisecondsSinceLaunch();
 
   // Configuration de la caméra
   Camera3D camera = {0};
@@ -27,6 +45,16 @@ int runSimulation() {
   camera.fovy = 60.0f;
   camera.projection = CAMERA_PERSPECTIVE;
 
+  // État de la simulation, local à cette fenêtre
+  SimulationState simState = SimulationState::PAUSED;
+  float temperature = 2.5f;
+  float J = 1.0f;
+  float B = 0.0f;
+  int stepsPerFrame = 100;
+  bool showEnergy = false;
+  Color upColor = RED;    // Couleur spin up
+  Color downColor = BLUE; // Couleur spin down
+
   // Paramètres du système
   int N = 10, O = 10, P = 10;
   float distance = 2.0f;
@@ -35,22 +63,191 @@ int runSimulation() {
   int segments = 8;
   bool showGrid = true;
   bool needsRebuild = true;
+  double lastEditTime = 0.0;          // Dernière modification d'un paramètre
+  const double rebuildDebounce = 0.3; // Délai avant reconstruction (s)
+  LatticeBuildJob rebuildJob;
+  StructureType builtStructure = StructureType::CUBIC; // Type affiché
+  int builtX = 0, builtY = 0, builtZ = 0;              // Cellules affichées
+  string builtUnitCell;                                // Maille affichée
+  float shownDistance = distance; // Distance des positions affichées
+  float bakedDistance = distance; // Distance des liaisons précalculées
+  bool usePeriodic = false;       // Noyau à voisins implicites + bords PBC
+  StencilLattice periodicLattice;
+  mt19937 stencilRng(random_device{}());
+  int stencilCursor = 0; // Prochaine cellule à visiter
+  bool useDipolar = false; // Champ dipolaire (FFT), noyau périodique seul
+  float dipolarStrength = 0.1f;
+  int dipolarBoundary = 0; // Indice dans dipolarBoundaries
+  const char *dipolarBoundaries[] = {"Open (demagnetizing)", "Periodic"};
+  DipolarField dipolarField;
+  SpinModelType spinModel = SpinModelType::ISING;
+  const char *spinModels[] = {"Ising", "Potts", "XY", "Heisenberg"};
+  int pottsStates = 3;
+  SpinModelParams modelParams;         // Anisotropie, pas des propositions
+  unique_ptr<SpinSystem> spinSystem;   // Modèles autres qu'Ising
+  bool needsSpinSystem = false;        // Topologie ou modèle modifié
+  vector<int> spinCarryIndex; // Anciens sites après une reconstruction
+  int spinCursor = 0;                  // Prochain site à visiter
+  vector<float> siteEnergies;
+  SpinArrows spinArrows;
+  DisorderParams disorderParams;
+  const char *bondDisorders[] = {"Uniform", "+-J", "Gaussian"};
+  DisorderedLattice disorderedLattice; // Réalisation courante (Ising)
+  bool needsDisorder = false;
+  int disorderCursor = 0;
+  int disorderRealizations = 16, disorderSweeps = 200;
+  future<DisorderAverage> disorderAverageTask;
+  DisorderAverage disorderAverage;
+  future<vector<KernelThroughput>> kernelCostTask;
+  vector<KernelThroughput> kernelCosts;
+  bool autoEngine = false; // Algorithme choisi par CalibrateEngines (Ising)
+  TuneCache tuneCache(string(GetApplicationDirectory()) +
+                      "autotune_cache.txt");
+  future<TuneDecision> tuneTask;
+  TuneDecision tuneDecision;           // Choix de la dernière clé vue
+  string tuneLabel;                    // Name() de sa clé, refait au changement
+  TuneKey tunedFor;                    // Réseau des moteurs ci-dessous
+  UpdateEngine tunedKind = UpdateEngine::METROPOLIS_STENCIL;
+  int tunedThreads = 1;
+  DisorderedLattice tunedLattice;      // Voisins CSR, Wolff et temps continu
+  int tunedCursor = 0;
+  bool tunedStale = true; // Spins modifiés hors du moteur : à recopier
+  WolffUpdater wolffUpdater;
+  RejectionFreeUpdater rejectionFreeUpdater;
+  unique_ptr<ThreadPool> tunedPool;    // Threads du moteur parallèle
+  NumaLattice numaLattice;
+  bool analyzeClusters = false; // Étiquetage des amas à chaque image
+  bool colorByCluster = false;
+  ClusterAnalyzer clusterAnalyzer;
+  LatticeTopology clusterTopology; // Positions + voisins du réseau affiché
+  vector<int8_t> clusterStates;    // État par site, 0 : lacune
+  vector<float> clusterHistogram;
+  bool measureCorrelations = false; // G(r), S(k) accumulés en continu
+  bool needsCorrelationSetup = true;
+  int correlationInterval = 10;     // Images entre deux échantillons
+  int correlationFrame = 0;
+  CorrelationAnalyzer correlations;
+  vector<Vector3> correlationSpins;
+  Vector4 correlationParams = {0};  // T, J, B et modèle des échantillons
+  bool correlationPeriodic = false;
+  Annealer annealer;                // Protocole de température en cours
+  AnnealSettings annealSettings;
+  const char *annealSchedules[] = {"Linear", "Exponential", "Quench",
+                                   "Adaptive"};
+  bool useFrameBudget = true;       // Pas par image choisis selon le coût
+  float frameBudgetMs = 8.0f;       // Part de l'image laissée au Monte-Carlo
+  FrameBudget frameBudget;
+  double simulationSeconds = 0.0;   // Durée des balayages de l'image
+  float frameSweeps = 0.0f;         // Balayages effectués pendant l'image
+  bool showProfiler = false;        // Fenêtre des zones TRACE_SCOPE
+  ProfilerView profiler;
+  HysteresisSettings hysteresisSettings;
+  HysteresisSweep hysteresisSweep;  // Boucles M(B) en arrière-plan
+  vector<HysteresisLoop> hysteresisLoops;
+  int hysteresisLoopCount = 2;
+  float hysteresisSpread = 0.0f;    // Écart de température entre boucles
+  vector<ImVec2> loopPolyline;
   Vector2 cameraAngle = {0};
   float movementSpeed = 10.0f;
   float cameraSensitivity = 0.3f;
-  deque<float> energyHistory;
-  const size_t maxHistoryPoints = 500;
-  bool showEnergyGraph = false;
+  // Whole-run histories, one sample per simulated frame
+  TimeSeries energyHistory, magnetizationHistory, acceptanceHistory;
+  HistoryView historyView;
+  FrameArena frameArena;            // Libellés et listes de l'image
+  AllocationCounts frameAllocations;   // Image précédente, thread principal
+  AllocationCounts frameAllocationsAll; // Image précédente, tous threads
+  AllocationCounts frameMark, frameMarkAll;
+  bool showHistory = false;
+  AtomPicker picker;               // Grille des sphères pour la souris
+  bool needsPicker = true;         // Positions ou rayon modifiés
+  int hoveredSite = -1;            // Atome sous la souris
+  int selectedSite = -1;           // Atome de l'inspecteur
+  bool showInspector = false;
+  int pinnedCount = 0;             // Atomes figés (Atome::pinned)
+  TelemetryServer telemetry;       // HTTP local, arrêté par défaut
+  int telemetryPort = 8765;
+  float telemetryRate = 10.0f;     // Cadence par défaut de /stream (Hz)
+  string telemetryError;
+  bool checkpointRequested = false; // Bouton ou commande distante
+  string checkpointStatus;          // Dernière sauvegarde ou relecture
+  unsigned long long frameCount = 0; // Images simulées
+  float frameAcceptance = 0.0f;
+  if (const char *port = getenv("ISING_TELEMETRY_PORT")) {
+    telemetryPort = atoi(port);
+    if (!telemetry.Start(telemetryPort, telemetryError))
+      TraceLog(LOG_WARNING, "Telemetry: %s", telemetryError.c_str());
+  }
 
   // Structure type
   StructureType currentStructure = StructureType::CUBIC;
-  const char *structureTypes[] = {"Cubic", "Hexagonal", "Face-Centered Cubic",
-                                  "Body-Centered Cubic"};
+  vector<const char *> structureTypes = {"Cubic", "Hexagonal",
+                                         "Face-Centered Cubic",
+                                         "Body-Centered Cubic"};
+  const int builtinStructureCount = (int)structureTypes.size();
+
+  // Lattices described by unit cell files, appended to the combo
+  vector<shared_ptr<const UnitCell>> unitCells;
+  string unitCellDirectory = DirectoryExists("lattices") ? "lattices"
+                                                         : "../lattices";
+  for (const auto &path : ListUnitCellFiles(unitCellDirectory)) {
+    auto cell = make_shared<UnitCell>();
+    string error;
+    if (LoadUnitCell(path, *cell, error)) {
+      unitCells.push_back(cell);
+    } else {
+      TraceLog(LOG_WARNING, "%s", error.c_str());
+    }
+  }
+  for (const auto &cell : unitCells) {
+    structureTypes.push_back(cell->name.c_str());
+  }
   int currentStructureType = 0;
 
+  // Last session of this user; its spins are reloaded on the first lattice
+  string workspacePath = WorkspacePath("workspaces", user, ".workspace");
+  Workspace workspace;
+  string pendingCheckpoint;
+  string workspaceError;
+  if (ReadWorkspace(workspacePath, workspace, workspaceError)) {
+    int type = static_cast<int>(workspace.structure);
+    if (type >= 0 && type < builtinStructureCount) {
+      currentStructure = workspace.structure;
+      currentStructureType = type;
+    }
+    for (size_t i = 0; i < unitCells.size(); i++) {
+      if (workspace.structure == StructureType::CUSTOM &&
+          unitCells[i]->name == workspace.unitCell) {
+        currentStructure = StructureType::CUSTOM;
+        currentStructureType = builtinStructureCount + (int)i;
+      }
+    }
+    N = workspace.x;
+    O = workspace.y;
+    P = workspace.z;
+    distance = shownDistance = bakedDistance = workspace.distance;
+    temperature = workspace.temperature;
+    J = workspace.J;
+    B = workspace.B;
+    spinModel = static_cast<SpinModelType>(clamp(workspace.spinModel, 0, 3));
+    pottsStates = workspace.pottsStates;
+    usePeriodic = workspace.periodic;
+    camera.position = workspace.cameraPosition;
+    camera.target = workspace.cameraTarget;
+    // Same angles as a mouse drag toward this target
+    Vector3 forward =
+        Vector3Normalize(Vector3Subtract(camera.target, camera.position));
+    cameraAngle = {asinf(forward.y) * RAD2DEG,
+                   atan2f(forward.z, forward.x) * RAD2DEG};
+    pendingCheckpoint = workspace.checkpoint;
+  } else {
+    TraceLog(LOG_INFO, "%s", workspaceError.c_str());
+  }
+
   // Initialisation des structures
   vector<Atome> structure;
+  shared_ptr<vector<Atome>> rebuildSnapshot; // Lue par le redimensionnement
   vector<Matrix> sphereTransforms;
+  vector<Color> sphereColors; // Couleur de chaque sphère pour l'image
   vector<Mesh> cylinderMeshes;
 
   // Create default sphere mesh and material
@@ -64,9 +261,45 @@ int runSimulation() {
   Material lineMaterial = LoadMaterialDefault();
   lineMaterial.maps[MATERIAL_MAP_DIFFUSE].color = BLACK;
 
-  SetCustomImGuiStyle(1.5f);
+  TraceSetThreadName("Main");
   // Main game loop
   while (!WindowShouldClose()) {
+    TRACE_SCOPE("Frame");
+    // Heap traffic of the previous frame, shown in the stats panel
+    AllocationCounts now = ThreadAllocations(), nowAll = TotalAllocations();
+    frameAllocations = now - frameMark;
+    frameAllocationsAll = nowAll - frameMarkAll;
+    frameMark = now;
+    frameMarkAll = nowAll;
+    frameArena.Reset();
+    // Remote commands act like the matching controls
+    TelemetryCommand command;
+    while (telemetry.Running() && telemetry.PollCommand(command)) {
+      switch (command.action) {
+      case TelemetryAction::SET_TEMPERATURE:
+        if (!annealer.Active())
+          temperature = max(command.value, 0.0f);
+        break;
+      case TelemetryAction::SET_J:
+        J = command.value;
+        break;
+      case TelemetryAction::SET_B:
+        B = command.value;
+        break;
+      case TelemetryAction::RUN:
+        simState = SimulationState::RUNNING;
+        break;
+      case TelemetryAction::PAUSE:
+        simState = SimulationState::PAUSED;
+        break;
+      case TelemetryAction::STEP:
+        simState = SimulationState::STEP;
+        break;
+      case TelemetryAction::CHECKPOINT:
+        checkpointRequested = true;
+        break;
+      }
+    }
     // Get frame timing for consistent movement speed
     float deltaTime = GetFrameTime();
     float currentSpeed = movementSpeed * deltaTime;
@@ -134,48 +367,370 @@ int runSimulation() {
     } else {
       ShowCursor();
     }
-    // Rebuild structure if needed
-    if (needsRebuild) {
-      switch (currentStructure) {
-      case StructureType::CUBIC:
-        structure = make_cubic_struc(N, O, P, distance);
-        break;
-      case StructureType::HEXAGONAL:
-        structure = make_hexagonal_struc(N, O, P, distance);
-        break;
-      case StructureType::FCC:
-        structure = make_fcc_struc(N, O, P, distance);
-        break;
-      case StructureType::BCC:
-        structure = make_bcc_struc(N, O, P, distance);
-        break;
+    // Rebuild structure in the background once the parameters settle
+    if (needsRebuild && (!ImGui::IsAnyItemActive() ||
+                         GetTime() - lastEditTime > rebuildDebounce)) {
+      LatticeRequest request;
+      request.type = currentStructure;
+      request.x = N;
+      request.y = O;
+      request.z = P;
+      request.distance = distance;
+      request.bondRadius = cylinderRadius;
+      request.segments = segments;
+      if (currentStructure == StructureType::CUSTOM) {
+        request.unitCell = unitCells[currentStructureType -
+                                     builtinStructureCount];
+        request.periodic = usePeriodic;
+        // A new distance or periodicity leaves the sites where they were
+        request.keepSites = !structure.empty() &&
+                            builtStructure == StructureType::CUSTOM &&
+                            builtUnitCell == request.unitCell->name &&
+                            builtX == N && builtY == O && builtZ == P;
+      } else if (!structure.empty() && builtStructure == currentStructure) {
+        // Refill the snapshot in place unless an older job still reads it
+        if (rebuildSnapshot && rebuildSnapshot.use_count() == 1)
+          *rebuildSnapshot = structure;
+        else
+          rebuildSnapshot = make_shared<vector<Atome>>(structure);
+        request.previous = rebuildSnapshot;
+        request.previousDistance = shownDistance;
       }
+      rebuildJob.Start(request);
+      needsRebuild = false;
+    }
 
-      // Initialize spins and energies
-      for (auto &atom : structure) {
-        atom.spin = GetRandomValue(0, 1) ? Spin::UP : Spin::DOWN;
+    // Swap in the finished lattice, the old one stays drawn until then
+    LatticeResult rebuilt;
+    if (rebuildJob.TakeResult(rebuilt)) {
+      TRACE_SCOPE("Lattice swap");
+      // Spins kept the snapshot values, catch up with the live lattice
+      int selectedBefore = selectedSite;
+      selectedSite = -1;
+      for (size_t i = 0; i < rebuilt.previousIndex.size(); i++) {
+        int previous = rebuilt.previousIndex[i];
+        if (previous >= 0 && previous < (int)structure.size()) {
+          rebuilt.structure[i].spin = structure[previous].spin;
+          rebuilt.structure[i].pinned = structure[previous].pinned;
+          if (previous == selectedBefore)
+            selectedSite = (int)i;
+        }
+      }
+      // The replaced arrays go back to the job for the next rebuild
+      structure.swap(rebuilt.structure);
+      sphereTransforms.swap(rebuilt.sphereTransforms);
+      rebuildJob.Recycle(std::move(rebuilt.structure),
+                         std::move(rebuilt.sphereTransforms));
+      if (!pendingCheckpoint.empty()) {
+        // Resumed session: the spins the user left
+        CheckpointParams params;
+        string error;
+        if (!ReadCheckpoint(pendingCheckpoint, structure, params, error))
+          TraceLog(LOG_WARNING, "Workspace: %s", error.c_str());
+        pendingCheckpoint.clear();
       }
       UpdateEnergies(structure, J, B);
+      pinnedCount = (int)count_if(structure.begin(), structure.end(),
+                                  [](const Atome &atom) { return atom.pinned; });
+      needsPicker = true;
 
-      // Recreate transforms
-      sphereTransforms.clear();
-      for (const auto &atom : structure) {
-        sphereTransforms.push_back(
-            MatrixTranslate(atom.pos.x, atom.pos.y, atom.pos.z));
+      for (auto &mesh : cylinderMeshes) {
+        UnloadMesh(mesh);
       }
+      cylinderMeshes = std::move(rebuilt.cylinderMeshes);
+      UploadMeshes(cylinderMeshes);
 
-      // Recreate cylinder meshes
-      cylinderMeshes =
-          CreateChunkedCylinderLines(structure, cylinderRadius, segments);
+      // Same model on the new lattice: the generic engine keeps its spins
+      needsSpinSystem = true;
+      spinCarryIndex.swap(rebuilt.previousIndex);
+      needsDisorder = true;
+      clusterTopology = ToTopology(structure);
+      needsCorrelationSetup = true;
 
-      needsRebuild = false;
+      builtStructure = rebuilt.request.type;
+      builtX = rebuilt.request.x;
+      builtY = rebuilt.request.y;
+      builtZ = rebuilt.request.z;
+      builtUnitCell =
+          rebuilt.request.unitCell ? rebuilt.request.unitCell->name : "";
+      tunedFor = TuneKey(); // Couplings may differ at the same size
+      shownDistance = rebuilt.request.distance;
+      bakedDistance = rebuilt.request.distance;
+
+      // Same site order as the builder, so spins map one to one
+      periodicLattice = StencilLattice();
+      stencilCursor = 0;
+      if (SupportsStencil(builtStructure)) {
+        periodicLattice =
+            MakeStencilLattice(builtStructure, rebuilt.request.x,
+                               rebuilt.request.y, rebuilt.request.z);
+        CopySpins(structure, periodicLattice);
+        if (usePeriodic)
+          CopySpins(periodicLattice, structure, J, B);
+      }
     }
 
+    // Hover picking, not while the camera turns or ImGui has the mouse
+    if (needsPicker) {
+      TRACE_SCOPE("Picker build");
+      picker.Build(structure, sphereRadius);
+      needsPicker = false;
+    }
+    hoveredSite = -1;
+    if (!io.WantCaptureMouse && !IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
+      TRACE_SCOPE("Pick");
+      hoveredSite = picker.Pick(GetMouseRay(GetMousePosition(), camera));
+      if (hoveredSite >= 0 && IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
+        selectedSite = hoveredSite;
+        showInspector = true;
+      }
+    }
+
+    // Potts, XY and Heisenberg run on the generic engine
+    if (needsSpinSystem) {
+      TRACE_SCOPE("Spin system setup");
+      unique_ptr<SpinSystem> previous = std::move(spinSystem);
+      if (spinModel != SpinModelType::ISING && !structure.empty()) {
+        spinSystem = MakeSpinSystem(
+            spinModel, make_shared<SpinTopology>(MakeSpinTopology(structure)),
+            pottsStates);
+        // Random start for a new model or q, and for the sites a rebuild adds
+        spinSystem->Randomize(stencilRng);
+        if (previous && !spinCarryIndex.empty())
+          spinSystem->CarryOver(*previous, spinCarryIndex);
+      }
+      spinCarryIndex.clear();
+      spinCursor = 0;
+      needsSpinSystem = false;
+    }
+    bool disordered =
+        spinModel == SpinModelType::ISING && HasDisorder(disorderParams);
+    if (needsDisorder) {
+      TRACE_SCOPE("Disorder setup");
+      disorderedLattice = DisorderedLattice();
+      disorderCursor = 0;
+      if (disordered) {
+        disorderedLattice = MakeDisorderedLattice(structure, disorderParams);
+        CopySpins(disorderedLattice, structure, J, B);
+      } else if (spinModel == SpinModelType::ISING) {
+        if (usePeriodic && periodicLattice.spins.size() == structure.size()) {
+          CopySpins(structure, periodicLattice);
+          CopySpins(periodicLattice, structure, J, B);
+        } else {
+          UpdateEnergies(structure, J, B);
+        }
+      }
+      tunedStale = true;
+      needsDisorder = false;
+    }
+    disordered &= disorderedLattice.spins.size() == structure.size() &&
+                  !structure.empty();
+    modelParams.temperature = temperature;
+    modelParams.J = J;
+    modelParams.B = B;
+
+    bool advanced = simState == SimulationState::RUNNING ||
+                    simState == SimulationState::STEP;
+    if (annealer.Active()) {
+      // The protocol owns the temperature until it ends or is stopped
+      temperature = annealer.Temperature();
+    }
+
+    // Plain Ising: engine of the cached or freshly calibrated decision
+    if (tuneTask.valid() &&
+        tuneTask.wait_for(chrono::seconds(0)) == future_status::ready) {
+      tuneDecision = tuneTask.get();
+      tuneLabel = tuneDecision.key.Name();
+      if (!tuneCache.Store(tuneDecision))
+        TraceLog(LOG_WARNING, "Cannot write the autotune cache");
+    }
+    bool tunedEngine = false; // Run by the autotuner branch below
+    bool periodicRun = usePeriodic &&
+                       periodicLattice.spins.size() == structure.size();
+    if (autoEngine && spinModel == SpinModelType::ISING && !disordered &&
+        !(periodicRun && useDipolar) && !structure.empty()) {
+      TuneKey key = MakeTuneKey(builtStructure, builtX, builtY, builtZ,
+                                (int)structure.size(), periodicRun,
+                                temperature, J, B);
+      if (!(tuneDecision.key == key)) {
+        // Outside the bucket of the current decision: cache, else measure
+        if (const TuneDecision *cached = tuneCache.Find(key)) {
+          tuneDecision = *cached;
+          tuneLabel = tuneDecision.key.Name();
+        } else if (!tuneTask.valid())
+          tuneTask = async(launch::async, CalibrateEngines, structure,
+                           periodicRun ? periodicLattice : StencilLattice(),
+                           key, temperature, J, B, 0.3);
+      }
+      const TuneResult &best = tuneDecision.best;
+      // The plain stencil path already is the periodic Metropolis engine
+      tunedEngine = tuneDecision.key == key &&
+                    best.engine != UpdateEngine::METROPOLIS_STENCIL;
+      if (best.engine == UpdateEngine::PARALLEL_STENCIL)
+        tunedEngine &= periodicRun && periodicLattice.pinned.empty();
+      if (tunedEngine && (!tunedFor.SameLattice(key) ||
+                          tunedKind != best.engine ||
+                          tunedThreads != best.threads)) {
+        TRACE_SCOPE("Engine setup");
+        numaLattice = NumaLattice();
+        tunedPool.reset();
+        tunedLattice = DisorderedLattice();
+        wolffUpdater = WolffUpdater();
+        rejectionFreeUpdater = RejectionFreeUpdater();
+        tunedCursor = 0;
+        tunedStale = true;
+        if (best.engine == UpdateEngine::PARALLEL_STENCIL) {
+          tunedPool = make_unique<ThreadPool>(best.threads);
+          string error;
+          if (!numaLattice.Create(*tunedPool, periodicLattice.lx,
+                                  periodicLattice.ly, periodicLattice.lz,
+                                  stencilRng(), NumaOptions(), error)) {
+            TraceLog(LOG_WARNING, "Parallel engine: %s", error.c_str());
+            tunedPool.reset();
+          }
+        } else {
+          tunedLattice = periodicRun
+                             ? MakeDisorderedLattice(periodicLattice)
+                             : MakeDisorderedLattice(structure,
+                                                     DisorderParams());
+        }
+        tunedFor = key;
+        tunedKind = best.engine;
+        tunedThreads = best.threads;
+      }
+      tunedEngine &= best.engine == UpdateEngine::PARALLEL_STENCIL
+                         ? numaLattice.Sites() == structure.size()
+                         : tunedLattice.spins.size() == structure.size();
+    }
+    if (!tunedEngine && tunedFor.sites > 0) {
+      // Give the memory and the pinned threads back
+      numaLattice = NumaLattice();
+      tunedPool.reset();
+      tunedLattice = DisorderedLattice();
+      tunedFor = TuneKey();
+    }
+
+    if (useFrameBudget && advanced) {
+      // Each kernel and lattice size has its own cost per update
+      int kernel = static_cast<int>(spinModel) * 8 + (usePeriodic ? 4 : 0) +
+                   (useDipolar ? 2 : 0) + (disordered ? 1 : 0);
+      if (tunedEngine)
+        kernel += 32 * (1 + static_cast<int>(tunedKind));
+      stepsPerFrame = frameBudget.Plan(kernel, structure.size(),
+                                       frameBudgetMs / 1000.0);
+    }
+    double simulationStart = GetTime();
+    TRACE_BEGIN("Monte Carlo");
+    frameSweeps = (float)stepsPerFrame / max<size_t>(structure.size(), 1);
+    long long frameAccepted = 0; // Accepted moves, for the acceptance rate
+
     // Run simulation
-    if (simState == SimulationState::RUNNING ||
-        simState == SimulationState::STEP) {
-      for (int i = 0; i < stepsPerFrame; i++) {
-        MonteCarloStep(structure, temperature, J, B);
+    if (spinSystem && (simState == SimulationState::RUNNING ||
+                       simState == SimulationState::STEP)) {
+      int siteCount = (int)spinSystem->Size();
+      frameAccepted = spinSystem->Update(spinCursor, stepsPerFrame,
+                                         modelParams, stencilRng);
+      spinCursor = (spinCursor + stepsPerFrame) % siteCount;
+      if (simState == SimulationState::STEP) {
+        simState = SimulationState::PAUSED;
+      }
+    } else if (tunedEngine && (simState == SimulationState::RUNNING ||
+                               simState == SimulationState::STEP)) {
+      // The engine owns the spins; the atoms only mirror them for display,
+      // unless they were edited on screen since the last frame
+      if (tunedKind == UpdateEngine::PARALLEL_STENCIL) {
+        int8_t *spins = numaLattice.Spins();
+        if (tunedStale) {
+          for (size_t i = 0; i < structure.size(); i++)
+            spins[i] = static_cast<int8_t>(structure[i].spin);
+          tunedStale = false;
+        }
+        int sweeps = max(1, stepsPerFrame / (int)structure.size());
+        frameSweeps = (float)sweeps;
+        for (int i = 0; i < sweeps; i++)
+          frameAccepted += numaLattice.Sweep(temperature, J, B);
+        copy(spins, spins + structure.size(), periodicLattice.spins.begin());
+        CopySpins(periodicLattice, structure, J, B);
+      } else {
+        if (tunedStale) {
+          CopySpins(structure, tunedLattice);
+          if (tunedKind == UpdateEngine::REJECTION_FREE)
+            rejectionFreeUpdater.Reset(tunedLattice); // Classes of every site
+          tunedStale = false;
+        }
+        if (tunedKind == UpdateEngine::WOLFF) {
+          frameAccepted = wolffUpdater.Advance(tunedLattice, stepsPerFrame,
+                                               temperature, J, B, stencilRng);
+        } else if (tunedKind == UpdateEngine::REJECTION_FREE) {
+          frameAccepted = rejectionFreeUpdater.Advance(
+              tunedLattice, stepsPerFrame, temperature, J, B, stencilRng);
+        } else {
+          int siteCount = (int)tunedLattice.spins.size();
+          frameAccepted = DisorderSweep(tunedLattice, tunedCursor,
+                                        stepsPerFrame, temperature, J, B,
+                                        stencilRng);
+          tunedCursor = (tunedCursor + stepsPerFrame) % siteCount;
+        }
+        CopySpins(tunedLattice, structure, J, B);
+      }
+      if (simState == SimulationState::STEP) {
+        simState = SimulationState::PAUSED;
+      }
+    } else if (disordered && (simState == SimulationState::RUNNING ||
+                              simState == SimulationState::STEP)) {
+      int siteCount = (int)disorderedLattice.spins.size();
+      frameAccepted = DisorderSweep(disorderedLattice, disorderCursor,
+                                    stepsPerFrame, temperature, J, B,
+                                    stencilRng);
+      disorderCursor = (disorderCursor + stepsPerFrame) % siteCount;
+      CopySpins(disorderedLattice, structure, J, B);
+      if (simState == SimulationState::STEP) {
+        simState = SimulationState::PAUSED;
+      }
+    } else if (spinModel == SpinModelType::ISING &&
+               (simState == SimulationState::RUNNING ||
+                simState == SimulationState::STEP)) {
+      bool periodic = usePeriodic &&
+                      periodicLattice.spins.size() == structure.size() &&
+                      !structure.empty();
+      bool dipolar =
+          periodic && useDipolar &&
+          dipolarField.Setup(periodicLattice,
+                             static_cast<DipolarBoundary>(dipolarBoundary));
+      if (dipolar) {
+        // Whole checkerboard sweeps, the field is refreshed per color
+        int sweeps = max(1, stepsPerFrame / (int)periodicLattice.spins.size());
+        frameSweeps = (float)sweeps;
+        for (int i = 0; i < sweeps; i++) {
+          frameAccepted +=
+              DipolarSweep(periodicLattice, dipolarField, dipolarStrength,
+                           temperature, J, B, stencilRng);
+        }
+        CopySpins(periodicLattice, structure, J, B);
+        dipolarField.Update(periodicLattice, dipolarStrength);
+        for (size_t i = 0; i < structure.size(); i++) {
+          structure[i].energy -=
+              periodicLattice.spins[i] * dipolarField.Data()[i];
+        }
+      } else if (periodic) {
+        // Same number of spin updates, visited cell by cell
+        int cellCount = (int)periodicLattice.spins.size() /
+                        periodicLattice.basisCount;
+        int remaining = max(1, stepsPerFrame / periodicLattice.basisCount);
+        while (remaining > 0) {
+          int chunk = min(remaining, cellCount - stencilCursor);
+          frameAccepted += StencilSweep(periodicLattice, stencilCursor, chunk,
+                                        temperature, J, B, stencilRng);
+          stencilCursor = (stencilCursor + chunk) % cellCount;
+          remaining -= chunk;
+        }
+        CopySpins(periodicLattice, structure, J, B);
+      } else {
+        TRACE_SCOPE("MonteCarloStep");
+        for (int i = 0; i < stepsPerFrame; i++) {
+          frameAccepted +=
+              MonteCarloStep(structure, temperature, J, B, stencilRng);
+        }
       }
 
       if (simState == SimulationState::STEP) {
@@ -183,14 +738,104 @@ int runSimulation() {
       }
     }
 
-    // Rendering
-    BeginDrawing();
-    ClearBackground(RAYWHITE);
+    // Mirror the generic engine into the atoms for colors and stats
+    if (spinSystem && spinSystem->Size() == structure.size()) {
+      TRACE_SCOPE("Mirror spins");
+      siteEnergies.resize(structure.size());
+      spinSystem->SiteEnergies(modelParams, siteEnergies.data());
+      for (size_t i = 0; i < structure.size(); i++) {
+        int label = spinSystem->Label((int)i);
+        bool up = spinModel == SpinModelType::POTTS ? label == 0 : label > 0;
+        structure[i].spin = up ? Spin::UP : Spin::DOWN;
+        structure[i].energy = siteEnergies[i];
+      }
+    }
+    TRACE_END();
+    simulationSeconds = GetTime() - simulationStart;
+    if (advanced) {
+      frameBudget.Record(frameSweeps * structure.size(), simulationSeconds,
+                         GetTime());
+    }
 
-    BeginMode3D(camera);
-    // Draw spheres
-    for (size_t i = 0; i < structure.size(); i++) {
+    // Spin correlations, sampled while the simulation advances
+    if (measureCorrelations && !structure.empty()) {
+      TRACE_SCOPE("Correlations");
+      bool periodic = usePeriodic && spinModel == SpinModelType::ISING &&
+                      !disordered &&
+                      periodicLattice.spins.size() == structure.size();
+      if (needsCorrelationSetup || periodic != correlationPeriodic) {
+        // Cubic-based lattices sit on a grid of half the cell parameter
+        float step = builtStructure == StructureType::CUBIC ? shownDistance
+                     : builtStructure == StructureType::BCC ||
+                             builtStructure == StructureType::FCC
+                         ? 0.5f * shownDistance
+                         : 0.0f;
+        vector<Vector3> positions(structure.size());
+        for (size_t i = 0; i < structure.size(); i++)
+          positions[i] = structure[i].pos;
+        correlations.Setup(positions, step, periodic, 0.25f * shownDistance,
+                           step > 0.0f ? 0.0f : 4.0f * shownDistance);
+        correlationPeriodic = periodic;
+        needsCorrelationSetup = false;
+      }
+      Vector4 params = {temperature, J, B, (float)spinModel};
+      if (params.x != correlationParams.x || params.y != correlationParams.y ||
+          params.z != correlationParams.z || params.w != correlationParams.w) {
+        correlations.Reset();
+        correlationParams = params;
+      }
+      if (advanced && ++correlationFrame >= correlationInterval) {
+        correlationFrame = 0;
+        correlationSpins.resize(structure.size());
+        for (size_t i = 0; i < structure.size(); i++) {
+          if (spinSystem)
+            correlationSpins[i] = spinSystem->Direction((int)i);
+          else if (disordered)
+            correlationSpins[i] = {0, (float)disorderedLattice.spins[i], 0};
+          else
+            correlationSpins[i] = {0, (float)structure[i].spin, 0};
+        }
+        correlations.Accumulate(correlationSpins);
+      }
+    }
+
+    bool showArrows = spinSystem && (spinModel == SpinModelType::XY ||
+                                     spinModel == SpinModelType::HEISENBERG);
+
+    // Same-state domains of the displayed spins
+    bool clustersReady = analyzeClusters &&
+                         clusterTopology.positions.size() == structure.size() &&
+                         !structure.empty();
+    if (clustersReady) {
+      TRACE_SCOPE("Clusters");
+      clusterStates.resize(structure.size());
+      for (size_t i = 0; i < structure.size(); i++) {
+        if (spinSystem && spinModel == SpinModelType::POTTS)
+          clusterStates[i] = (int8_t)(spinSystem->Label((int)i) + 1);
+        else if (disordered)
+          clusterStates[i] = disorderedLattice.spins[i];
+        else
+          clusterStates[i] = (int8_t)structure[i].spin;
+      }
+      clusterAnalyzer.Analyze(clusterTopology, clusterStates.data());
+    }
+
+    // Sphere colors, computed apart from the draw calls
+    TRACE_BEGIN("Colors");
+    sphereColors.resize(structure.size());
+    for (size_t i = 0; i < structure.size() && !showArrows; i++) {
+      if (disordered && disorderedLattice.spins[i] == 0)
+        continue; // Vacancy
       Color color = (structure[i].spin == Spin::UP) ? upColor : downColor;
+      if (spinSystem && spinModel == SpinModelType::POTTS) {
+        color = ColorFromHSV(360.0f * spinSystem->Label((int)i) / pottsStates,
+                             0.75f, 0.9f);
+      }
+      if (clustersReady && colorByCluster) {
+        // Golden-ratio hue per cluster root, stable while the cluster lives
+        float hue = fmodf(clusterAnalyzer.Labels()[i] * 0.618034f, 1.0f);
+        color = ColorFromHSV(360.0f * hue, 0.65f, 0.9f);
+      }
       if (showEnergy) {
         // Calculate normalized energy (0-1 range)
         float minE = -fabsf(J) * structure[i].neigh.size() - fabsf(B);
@@ -221,20 +866,61 @@ int runSimulation() {
         }
         color.a = 255;
       }
-      sphereMaterial.maps[MATERIAL_MAP_DIFFUSE].color = color;
+      sphereColors[i] = color;
+    }
+    TRACE_END();
+
+    // Rendering
+    BeginDrawing();
+    ClearBackground(RAYWHITE);
+
+    BeginMode3D(camera);
+    // Draw spheres
+    TRACE_BEGIN("Draw spheres");
+    for (size_t i = 0; i < structure.size() && !showArrows; i++) {
+      if (disordered && disorderedLattice.spins[i] == 0)
+        continue; // Vacancy
+      sphereMaterial.maps[MATERIAL_MAP_DIFFUSE].color = sphereColors[i];
       DrawMesh(sphereMesh, sphereMaterial, sphereTransforms[i]);
     }
+    TRACE_END();
+
+    // Picked and pinned sites
+    if (hoveredSite >= 0)
+      DrawSphereWires(structure[hoveredSite].pos, 1.2f * sphereRadius, 8, 8,
+                      ORANGE);
+    if (showInspector && selectedSite >= 0 &&
+        selectedSite < (int)structure.size())
+      DrawSphereWires(structure[selectedSite].pos, 1.35f * sphereRadius, 8, 8,
+                      GREEN);
+    for (size_t i = 0; i < structure.size() && pinnedCount > 0; i++) {
+      if (structure[i].pinned) {
+        float side = 2.2f * sphereRadius;
+        DrawCubeWires(structure[i].pos, side, side, side, BLACK);
+      }
+    }
+
+    if (showArrows) {
+      TRACE_SCOPE("Draw arrows");
+      spinArrows.Draw(structure, *spinSystem, 2.0f * sphereRadius, upColor,
+                      downColor);
+    }
 
-    // Draw cylinders
+    // Draw cylinders (scaled until re-baked after a distance change)
+    float bondScale = shownDistance / bakedDistance;
+    Matrix bondTransform = MatrixScale(bondScale, bondScale, bondScale);
+    TRACE_BEGIN("Draw bonds");
     for (const auto &mesh : cylinderMeshes) {
-      DrawMesh(mesh, lineMaterial, MatrixIdentity());
+      DrawMesh(mesh, lineMaterial, bondTransform);
     }
+    TRACE_END();
 
     if (showGrid)
       DrawGrid(40, 1);
     EndMode3D();
 
     // UI
+    TRACE_BEGIN("ImGui");
     rlImGuiBegin();
     int screenWidth = GetScreenWidth();
     int screenHeight = GetScreenHeight();
@@ -253,19 +939,44 @@ int runSimulation() {
     ImGui::Begin("Controls", nullptr, drawerFlags);
 
     // Structure controls
-    if (ImGui::SliderInt("Grid Size X", &N, 1, 10))
-      needsRebuild = true;
-    if (ImGui::SliderInt("Grid Size Y", &O, 1, 10))
-      needsRebuild = true;
-    if (ImGui::SliderInt("Grid Size Z", &P, 1, 10))
-      needsRebuild = true;
-    if (ImGui::SliderFloat("Atom Distance", &distance, 1.0f, 5.0f))
-      needsRebuild = true;
+    bool latticeEdited = false;
+    latticeEdited |= ImGui::SliderInt("Grid Size X", &N, 1, 10);
+    latticeEdited |= ImGui::SliderInt("Grid Size Y", &O, 1, 10);
+    latticeEdited |= ImGui::SliderInt("Grid Size Z", &P, 1, 10);
+    if (ImGui::SliderFloat("Atom Distance", &distance, 1.0f, 5.0f)) {
+      // Distance is cosmetic: rescale in place, topology and spins stay
+      RescaleStructure(structure, distance / shownDistance);
+      needsPicker = true;
+      for (size_t i = 0; i < structure.size(); i++) {
+        sphereTransforms[i] = MatrixTranslate(
+            structure[i].pos.x, structure[i].pos.y, structure[i].pos.z);
+        if (i < clusterTopology.positions.size())
+          clusterTopology.positions[i] = structure[i].pos;
+      }
+      shownDistance = distance;
+      needsCorrelationSetup = true;
+      latticeEdited = true;
+    }
 
-    if (ImGui::Combo("Structure Type", &currentStructureType, structureTypes,
-                     IM_ARRAYSIZE(structureTypes))) {
-      currentStructure = static_cast<StructureType>(currentStructureType);
+    if (ImGui::Combo("Structure Type", &currentStructureType,
+                     structureTypes.data(), (int)structureTypes.size())) {
+      currentStructure =
+          currentStructureType < builtinStructureCount
+              ? static_cast<StructureType>(currentStructureType)
+              : StructureType::CUSTOM;
+      latticeEdited = true;
+    }
+    if (latticeEdited) {
       needsRebuild = true;
+      lastEditTime = GetTime();
+    }
+
+    if (rebuildJob.IsRunning()) {
+      ImGui::ProgressBar(rebuildJob.Progress(), ImVec2(-100.0f, 0.0f),
+                         "Rebuilding...");
+      ImGui::SameLine();
+      if (ImGui::Button("Cancel"))
+        rebuildJob.Cancel();
     }
 
     ImGui::Separator();
@@ -273,6 +984,7 @@ int runSimulation() {
     bool sphereSizeChanged = false;
     if (ImGui::SliderFloat("Sphere Radius", &sphereRadius, 0.1f, 1.0f)) {
       sphereSizeChanged = true;
+      needsPicker = true;
     }
     bool bondRadiusChanged = false;
     if (ImGui::SliderFloat("Bond Radius", &cylinderRadius, 0.01f, 0.2f)) {
@@ -294,12 +1006,360 @@ int runSimulation() {
     if (ImGui::Button("Single Step"))
       simState = SimulationState::STEP;
 
+    ImGui::BeginDisabled(annealer.Active());
     ImGui::SliderFloat("Temperature", &temperature, 0.0f, 5.0f);
+    ImGui::EndDisabled();
     ImGui::SliderFloat("Coupling (J)", &J, -2.0f, 2.0f);
     ImGui::SliderFloat("Magnetic Field (B)", &B, -2.0f, 2.0f);
-    ImGui::SliderInt("Steps/Frame", &stepsPerFrame, 1, 1000);
+    ImGui::Checkbox("Frame Budget", &useFrameBudget);
+    if (useFrameBudget) {
+      ImGui::SameLine();
+      ImGui::Text("%d steps/frame", stepsPerFrame);
+      ImGui::SliderFloat("Budget (ms)", &frameBudgetMs, 0.5f, 16.6f);
+    } else {
+      ImGui::SliderInt("Steps/Frame", &stepsPerFrame, 1, 1000);
+    }
+    int spinModelIndex = static_cast<int>(spinModel);
+    if (ImGui::Combo("Spin Model", &spinModelIndex, spinModels,
+                     IM_ARRAYSIZE(spinModels))) {
+      spinModel = static_cast<SpinModelType>(spinModelIndex);
+      needsSpinSystem = true;
+      // Back to the Ising paths, restart from a consistent state
+      needsDisorder = spinModel == SpinModelType::ISING;
+    }
+    if (spinModel == SpinModelType::POTTS &&
+        ImGui::SliderInt("Potts States (q)", &pottsStates, 2, 8)) {
+      needsSpinSystem = true;
+    }
+    if (spinModel == SpinModelType::XY ||
+        spinModel == SpinModelType::HEISENBERG) {
+      ImGui::SliderFloat("Anisotropy (D)", &modelParams.anisotropy, -2.0f,
+                         2.0f);
+      ImGui::SliderFloat("Proposal Step", &modelParams.stepSize, 0.05f, 2.0f);
+    }
+    // Implicit-neighbor kernels are Ising only; unit cells bake boundaries
+    ImGui::BeginDisabled((!SupportsStencil(builtStructure) ||
+                          spinModel != SpinModelType::ISING || disordered) &&
+                         builtStructure != StructureType::CUSTOM);
+    if (ImGui::Checkbox("Periodic Boundaries", &usePeriodic)) {
+      if (builtStructure == StructureType::CUSTOM) {
+        // Unit cell lattices bake the boundaries into their neighbor lists
+        needsRebuild = true;
+        lastEditTime = GetTime();
+      } else if (usePeriodic) {
+        CopySpins(structure, periodicLattice);
+        CopySpins(periodicLattice, structure, J, B);
+      } else {
+        UpdateEnergies(structure, J, B);
+      }
+      tunedStale = true;
+    }
+    ImGui::EndDisabled();
+    ImGui::BeginDisabled(!usePeriodic || !SupportsStencil(builtStructure) ||
+                         spinModel != SpinModelType::ISING || disordered);
+    ImGui::Checkbox("Dipolar Interactions", &useDipolar);
+    if (useDipolar) {
+      ImGui::SliderFloat("Dipolar Strength", &dipolarStrength, 0.0f, 1.0f);
+      ImGui::Combo("Dipolar Boundaries", &dipolarBoundary, dipolarBoundaries,
+                   IM_ARRAYSIZE(dipolarBoundaries));
+    }
+    ImGui::EndDisabled();
+
+    // Quenched disorder (Ising only)
+    ImGui::Separator();
+    ImGui::Text("Disorder");
+    ImGui::BeginDisabled(spinModel != SpinModelType::ISING);
+    bool disorderEdited = false;
+    int bondDisorder = static_cast<int>(disorderParams.bonds);
+    if (ImGui::Combo("Bond Disorder", &bondDisorder, bondDisorders,
+                     IM_ARRAYSIZE(bondDisorders))) {
+      disorderParams.bonds = static_cast<BondDisorder>(bondDisorder);
+      disorderEdited = true;
+    }
+    if (disorderParams.bonds == BondDisorder::PLUS_MINUS) {
+      disorderEdited |= ImGui::SliderFloat(
+          "Antiferro Fraction", &disorderParams.antiferroFraction, 0.0f, 1.0f);
+    } else if (disorderParams.bonds == BondDisorder::GAUSSIAN) {
+      disorderEdited |=
+          ImGui::SliderFloat("Bond Mean", &disorderParams.mean, -1.0f, 1.0f);
+      disorderEdited |= ImGui::SliderFloat(
+          "Bond Spread", &disorderParams.spread, 0.0f, 2.0f);
+    }
+    disorderEdited |= ImGui::SliderFloat(
+        "Vacancies", &disorderParams.vacancyFraction, 0.0f, 0.9f);
+    if (ImGui::Button("New Realization")) {
+      disorderParams.seed++;
+      disorderEdited = true;
+    }
+    ImGui::SameLine();
+    ImGui::Text("Seed %u", disorderParams.seed);
+    if (disorderEdited) {
+      needsDisorder = true;
+    }
+
+    ImGui::SliderInt("Realizations", &disorderRealizations, 1, 256);
+    ImGui::SliderInt("Sweeps", &disorderSweeps, 10, 2000);
+    bool averaging = disorderAverageTask.valid();
+    if (averaging && disorderAverageTask.wait_for(chrono::seconds(0)) ==
+                         future_status::ready) {
+      disorderAverage = disorderAverageTask.get();
+      averaging = false;
+    }
+    ImGui::BeginDisabled(averaging || structure.empty());
+    if (ImGui::Button(averaging ? "Averaging..." : "Average Over Disorder")) {
+      disorderAverageTask =
+          async(launch::async, AverageOverDisorder, structure, disorderParams,
+                disorderRealizations, disorderSweeps, temperature, J, B);
+    }
+    ImGui::EndDisabled();
+    if (disorderAverage.realizations > 0) {
+      ImGui::Text("%d realizations: <|m|> = %.3f +- %.3f, <E>/N = %.3f",
+                  disorderAverage.realizations, disorderAverage.magnetization,
+                  disorderAverage.magnetizationError, disorderAverage.energy);
+      ImGui::Text("<q^2> = %.3f, Binder g = %.3f", disorderAverage.overlap2,
+                  disorderAverage.binder);
+    }
+
+    bool measuring = kernelCostTask.valid();
+    if (measuring &&
+        kernelCostTask.wait_for(chrono::seconds(0)) == future_status::ready) {
+      kernelCosts = kernelCostTask.get();
+      for (const auto &cost : kernelCosts) {
+        TraceLog(LOG_INFO, "%s: %.2f ns/update (x%.2f)", cost.name.c_str(),
+                 cost.nsPerUpdate, cost.penalty);
+      }
+      measuring = false;
+    }
+    ImGui::BeginDisabled(measuring || structure.empty());
+    if (ImGui::Button(measuring ? "Measuring..." : "Measure Kernel Cost")) {
+      kernelCostTask = async(launch::async, MeasureDisorderPenalty, structure,
+                             periodicLattice, temperature, J, B);
+    }
+    ImGui::EndDisabled();
+    for (const auto &cost : kernelCosts) {
+      ImGui::Text("%-30s %6.2f ns  x%.2f", cost.name.c_str(), cost.nsPerUpdate,
+                  cost.penalty);
+    }
+    ImGui::EndDisabled();
+
+    // Algorithm, threads and kernel chosen per lattice and temperature range
+    ImGui::Separator();
+    ImGui::Text("Update Engine");
+    ImGui::BeginDisabled(spinModel != SpinModelType::ISING || disordered);
+    ImGui::Checkbox("Auto Engine", &autoEngine);
+    if (autoEngine) {
+      ImGui::SameLine();
+      if (tuneTask.valid())
+        ImGui::Text("Calibrating...");
+      else if (tuneDecision.key.sites > 0)
+        ImGui::Text("%s, %d thread(s)",
+                    UpdateEngineName(tuneDecision.best.engine),
+                    tuneDecision.best.threads);
+      if (tuneDecision.key.sites > 0) {
+        ImGui::Text("%s", tuneLabel.c_str());
+        ImGui::Text("%.3g samples/s, tau %.1f sweeps",
+                    tuneDecision.best.samplesPerSecond,
+                    tuneDecision.best.autocorrelation);
+      }
+      for (const auto &candidate : tuneDecision.candidates) {
+        ImGui::Text("%-18s x%-2d %9.3g upd/s  tau %6.1f  %8.3g /s",
+                    UpdateEngineName(candidate.engine), candidate.threads,
+                    candidate.updatesPerSecond, candidate.autocorrelation,
+                    candidate.samplesPerSecond);
+      }
+    }
+    ImGui::EndDisabled();
+
+    // Scripted temperature protocols, driven from the simulation loop
+    ImGui::Separator();
+    ImGui::Text("Annealing");
+    int annealSchedule = static_cast<int>(annealSettings.schedule);
+    if (ImGui::Combo("Schedule", &annealSchedule, annealSchedules,
+                     IM_ARRAYSIZE(annealSchedules))) {
+      annealSettings.schedule = static_cast<AnnealSchedule>(annealSchedule);
+    }
+    ImGui::SliderFloat("Start Temperature", &annealSettings.startTemperature,
+                       0.01f, 10.0f);
+    ImGui::SliderFloat("End Temperature", &annealSettings.endTemperature,
+                       0.01f, 10.0f);
+    if (annealSettings.schedule == AnnealSchedule::LINEAR ||
+        annealSettings.schedule == AnnealSchedule::EXPONENTIAL) {
+      ImGui::SliderInt("Cooling Sweeps", &annealSettings.coolingSweeps, 10,
+                       100000);
+    } else if (annealSettings.schedule == AnnealSchedule::ADAPTIVE) {
+      ImGui::SliderFloat("Thermodynamic Speed", &annealSettings.speed, 0.05f,
+                         5.0f);
+      ImGui::SliderInt("Stage Sweeps", &annealSettings.stageSweeps, 5, 1000);
+    }
+    ImGui::SliderInt("Hold Sweeps", &annealSettings.holdSweeps, 0, 10000);
+    ImGui::SliderFloat("Table Tolerance", &annealSettings.tableTolerance,
+                       0.0f, 0.1f);
+    if (annealer.Active()) {
+      if (ImGui::Button("Stop Protocol")) {
+        annealer.Stop();
+      }
+      ImGui::SameLine();
+      ImGui::ProgressBar(annealer.Progress(), ImVec2(-1.0f, 0.0f));
+    } else {
+      ImGui::BeginDisabled(structure.empty());
+      if (ImGui::Button("Start Protocol")) {
+        annealer.Start(annealSettings, (int)structure.size());
+        simState = SimulationState::RUNNING;
+      }
+      ImGui::EndDisabled();
+      if (!annealer.History().empty()) {
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Traces")) {
+          annealer.ClearHistory();
+        }
+      }
+    }
+    {
+      // Energy per site against Monte-Carlo time, one curve per protocol
+      size_t traceCount = annealer.History().size() + annealer.Active();
+      const AnnealTrace **traces =
+          frameArena.Allocate<const AnnealTrace *>(traceCount);
+      size_t filled = 0;
+      for (const AnnealTrace &trace : annealer.History())
+        traces[filled++] = &trace;
+      if (annealer.Active())
+        traces[filled++] = &annealer.Current();
+      float maxSweeps = 1.0f, minEnergy = 0.0f, maxEnergy = 0.0f;
+      bool first = true;
+      for (size_t t = 0; t < traceCount; t++) {
+        for (const AnnealSample &sample : traces[t]->samples) {
+          maxSweeps = max(maxSweeps, sample.sweeps);
+          minEnergy = first ? sample.energy : min(minEnergy, sample.energy);
+          maxEnergy = first ? sample.energy : max(maxEnergy, sample.energy);
+          first = false;
+        }
+      }
+      if (!first) {
+        float width = ImGui::GetContentRegionAvail().x;
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        ImVec2 size(width, min(width * 0.5f, 180.0f));
+        float energyRange = max(maxEnergy - minEnergy, 1e-3f);
+        ImDrawList *drawList = ImGui::GetWindowDrawList();
+        drawList->AddRect(origin,
+                          ImVec2(origin.x + size.x, origin.y + size.y),
+                          ImGui::GetColorU32(ImGuiCol_Border));
+        for (size_t t = 0; t < traceCount; t++) {
+          // At most one vertex per pixel column
+          const vector<AnnealSample> &samples = traces[t]->samples;
+          size_t stride = max<size_t>(1, samples.size() / (size_t)size.x);
+          loopPolyline.clear();
+          for (size_t i = 0; i < samples.size(); i += stride) {
+            loopPolyline.push_back(ImVec2(
+                origin.x + size.x * samples[i].sweeps / maxSweeps,
+                origin.y + size.y * (maxEnergy - samples[i].energy) /
+                               energyRange));
+          }
+          Color color =
+              ColorFromHSV(360.0f * t / traceCount, 0.6f, 0.95f);
+          drawList->AddPolyline(loopPolyline.data(), (int)loopPolyline.size(),
+                                IM_COL32(color.r, color.g, color.b, 255), 0,
+                                1.5f);
+        }
+        ImGui::Dummy(size);
+        ImGui::Text("E/N from %.3f to %.3f over %.0f sweeps", maxEnergy,
+                    minEnergy, maxSweeps);
+        for (size_t t = 0; t < traceCount; t++) {
+          const AnnealTrace *trace = traces[t];
+          if (trace->samples.empty())
+            continue;
+          const AnnealSample &last = trace->samples.back();
+          ImGui::Text("%s: E/N = %.4f after %.0f sweeps, %.1f s, %d tables%s",
+                      trace->label.c_str(), last.energy, last.sweeps,
+                      last.seconds, trace->tableChanges,
+                      trace->finished              ? ""
+                      : trace == &annealer.Current() ? " (running)"
+                                                     : " (stopped)");
+        }
+      }
+    }
+
+    // Field sweeps M(B), Ising on the current lattice and disorder
+    ImGui::Separator();
+    ImGui::Text("Hysteresis");
+    ImGui::SliderFloat("Max Field", &hysteresisSettings.maxField, 0.5f, 10.0f);
+    ImGui::SliderFloat("Field Step", &hysteresisSettings.fieldStep, 0.02f,
+                       1.0f);
+    ImGui::SliderInt("Cycles", &hysteresisSettings.cycles, 1, 5);
+    ImGui::SliderInt("Loops", &hysteresisLoopCount, 1, 8);
+    ImGui::SliderFloat("Temperature Spread", &hysteresisSpread, 0.0f, 2.0f);
+    bool sweeping = hysteresisSweep.Running();
+    if (sweeping) {
+      if (ImGui::Button("Cancel Sweep")) {
+        hysteresisSweep.Cancel();
+      }
+    } else {
+      ImGui::BeginDisabled(structure.empty());
+      if (ImGui::Button("Run Hysteresis Loops")) {
+        // Loop k: T + k * spread, disorder seed + k
+        vector<float> temperatures(hysteresisLoopCount);
+        for (int k = 0; k < hysteresisLoopCount; k++) {
+          temperatures[k] = max(0.01f, temperature + k * hysteresisSpread);
+        }
+        hysteresisSweep.Start(structure, disorderParams, J, temperatures,
+                              hysteresisSettings);
+      }
+      ImGui::EndDisabled();
+    }
+    hysteresisSweep.Snapshot(hysteresisLoops);
+    if (!hysteresisLoops.empty()) {
+      // M(B) canvas: field on x in [-max, max], magnetization in [-1, 1]
+      float width = ImGui::GetContentRegionAvail().x;
+      ImVec2 origin = ImGui::GetCursorScreenPos();
+      ImVec2 size(width, min(width * 0.6f, 220.0f));
+      ImDrawList *drawList = ImGui::GetWindowDrawList();
+      drawList->AddRect(origin, ImVec2(origin.x + size.x, origin.y + size.y),
+                        ImGui::GetColorU32(ImGuiCol_Border));
+      drawList->AddLine(ImVec2(origin.x + size.x / 2, origin.y),
+                        ImVec2(origin.x + size.x / 2, origin.y + size.y),
+                        ImGui::GetColorU32(ImGuiCol_Border));
+      drawList->AddLine(ImVec2(origin.x, origin.y + size.y / 2),
+                        ImVec2(origin.x + size.x, origin.y + size.y / 2),
+                        ImGui::GetColorU32(ImGuiCol_Border));
+      float fieldRange = max(hysteresisSettings.maxField, 0.01f);
+      for (size_t k = 0; k < hysteresisLoops.size(); k++) {
+        const HysteresisLoop &loop = hysteresisLoops[k];
+        loopPolyline.clear();
+        for (const HysteresisPoint &point : loop.points) {
+          float x = 0.5f + 0.5f * Clamp(point.field / fieldRange, -1, 1);
+          float y = 0.5f - 0.5f * Clamp(point.magnetization, -1, 1);
+          loopPolyline.push_back(
+              ImVec2(origin.x + x * size.x, origin.y + y * size.y));
+        }
+        Color color = ColorFromHSV(
+            360.0f * k / hysteresisLoops.size(), 0.6f, 0.95f);
+        drawList->AddPolyline(loopPolyline.data(), (int)loopPolyline.size(),
+                              IM_COL32(color.r, color.g, color.b, 255), 0,
+                              1.5f);
+      }
+      ImGui::Dummy(size);
+      for (const HysteresisLoop &loop : hysteresisLoops) {
+        ImGui::Text("T = %.2f, seed %u: %d/%d points, Hc = %.3f, Mr = %.3f",
+                    loop.temperature, loop.seed, (int)loop.points.size(),
+                    loop.plannedPoints, loop.coerciveField, loop.remanence);
+      }
+    }
+    ImGui::Separator();
+
     ImGui::Checkbox("Show Energy", &showEnergy);
-    ImGui::Checkbox("Show Energy Graph", &showEnergyGraph);
+    ImGui::Checkbox("Show History", &showHistory);
+    ImGui::Checkbox("Cluster Analysis", &analyzeClusters);
+    if (analyzeClusters) {
+      ImGui::SameLine();
+      ImGui::Checkbox("Color by Cluster", &colorByCluster);
+    }
+    ImGui::Checkbox("Correlations", &measureCorrelations);
+    if (measureCorrelations) {
+      ImGui::SameLine();
+      if (ImGui::Button("Reset Samples")) {
+        correlations.Reset();
+      }
+      ImGui::SliderInt("Sample Interval", &correlationInterval, 1, 60);
+    }
 
     // Color controls
     float upColorArray[3] = {upColor.r / 255.0f, upColor.g / 255.0f,
@@ -318,6 +1378,85 @@ int runSimulation() {
                         (unsigned char)(downColorArray[2] * 255), 255};
     }
 
+    // Checkpoints and the local telemetry server
+    ImGui::Separator();
+    if (ImGui::Button("Save Checkpoint"))
+      checkpointRequested = true;
+    ImGui::SameLine();
+    if (ImGui::Button("Load Last Checkpoint")) {
+      string path = LatestCheckpointPath("checkpoints");
+      CheckpointParams params;
+      string error;
+      if (spinModel != SpinModelType::ISING) {
+        checkpointStatus = "Checkpoints hold Ising spins only";
+      } else if (path.empty()) {
+        checkpointStatus = "No checkpoint in checkpoints/";
+      } else if (!ReadCheckpoint(path, structure, params, error)) {
+        checkpointStatus = error;
+      } else {
+        if (!annealer.Active())
+          temperature = params.temperature;
+        J = params.J;
+        B = params.B;
+        pinnedCount =
+            (int)count_if(structure.begin(), structure.end(),
+                          [](const Atome &atom) { return atom.pinned; });
+        if (disordered) {
+          CopySpins(structure, disorderedLattice);
+          CopySpins(disorderedLattice, structure, J, B);
+        } else if (usePeriodic &&
+                   periodicLattice.spins.size() == structure.size()) {
+          CopySpins(structure, periodicLattice);
+          CopySpins(periodicLattice, structure, J, B);
+        } else {
+          UpdateEnergies(structure, J, B);
+        }
+        tunedStale = true;
+        checkpointStatus = "Loaded " + path;
+      }
+    }
+    if (checkpointRequested) {
+      checkpointRequested = false;
+      CheckpointParams params;
+      params.temperature = temperature;
+      params.J = J;
+      params.B = B;
+      params.frame = frameCount;
+      string path = NextCheckpointPath("checkpoints", frameCount);
+      string error;
+      if (spinModel != SpinModelType::ISING)
+        checkpointStatus = "Checkpoints hold Ising spins only";
+      else if (WriteCheckpoint(path, structure, params, error))
+        checkpointStatus = "Saved " + path;
+      else
+        checkpointStatus = error;
+    }
+    if (!checkpointStatus.empty())
+      ImGui::TextUnformatted(checkpointStatus.c_str());
+
+    bool telemetryOn = telemetry.Running();
+    if (ImGui::Checkbox("Telemetry Server", &telemetryOn)) {
+      telemetryError.clear();
+      if (telemetryOn)
+        telemetry.Start(telemetryPort, telemetryError);
+      else
+        telemetry.Stop();
+    }
+    ImGui::BeginDisabled(telemetry.Running());
+    ImGui::SameLine();
+    ImGui::SetNextItemWidth(100.0f);
+    ImGui::InputInt("Port", &telemetryPort, 0);
+    ImGui::EndDisabled();
+    if (ImGui::SliderFloat("Stream Rate (Hz)", &telemetryRate, 1.0f, 60.0f))
+      telemetry.SetStreamRate(telemetryRate);
+    if (telemetry.Running()) {
+      ImGui::Text("Listening on http://127.0.0.1:%d, %d stream(s)",
+                  telemetry.Port(), telemetry.StreamCount());
+    } else if (!telemetryError.empty()) {
+      ImGui::TextColored(ImVec4(1, 0.4f, 0.4f, 1), "%s",
+                         telemetryError.c_str());
+    }
+
     ImGui::Separator();
     ImGui::Text("Camera Settings");
     ImGui::Separator();
@@ -326,79 +1465,209 @@ int runSimulation() {
 
     // Simulation stats
     float totalEnergy = CalculateTotalEnergy(structure);
-    if (simState == SimulationState::RUNNING ||
-        simState == SimulationState::STEP) {
-      UpdateEnergyHistory(energyHistory, totalEnergy, maxHistoryPoints);
+    if (advanced && annealer.Active()) {
+      annealer.Advance(frameSweeps,
+                       totalEnergy / max<size_t>(structure.size(), 1),
+                       (float)simulationSeconds);
     }
     int upSpins = 0, downSpins = 0;
-    for (const auto &atom : structure) {
-      if (atom.spin == Spin::UP)
+    for (size_t i = 0; i < structure.size(); i++) {
+      if (disordered && disorderedLattice.spins[i] == 0)
+        continue;
+      if (structure[i].spin == Spin::UP)
         upSpins++;
       else
         downSpins++;
     }
-    if (showEnergyGraph && !energyHistory.empty()) {
+    float magnetization =
+        spinSystem ? spinSystem->OrderParameter()
+        : upSpins + downSpins == 0
+            ? 0.0f
+            : (upSpins - downSpins) / (float)(upSpins + downSpins);
+    if (advanced) {
+      frameAcceptance =
+          frameAccepted / max(frameSweeps * structure.size(), 1.0f);
+      energyHistory.Append(totalEnergy);
+      magnetizationHistory.Append(magnetization);
+      acceptanceHistory.Append(frameAcceptance);
+      frameCount++;
+    }
+    if (telemetry.Running()) {
+      TelemetrySnapshot snapshot;
+      snapshot.frame = frameCount;
+      snapshot.time = GetTime();
+      snapshot.temperature = temperature;
+      snapshot.J = J;
+      snapshot.B = B;
+      snapshot.energy = totalEnergy;
+      snapshot.magnetization = magnetization;
+      snapshot.acceptance = frameAcceptance;
+      snapshot.sweepsPerSecond = frameBudget.SweepsPerSecond();
+      snapshot.fps = GetFPS();
+      snapshot.atoms = (int64_t)structure.size();
+      snapshot.pinned = pinnedCount;
+      snapshot.running = simState == SimulationState::RUNNING;
+      snapshot.model = static_cast<int64_t>(spinModel);
+      telemetry.Publish(snapshot);
+    }
+    if (showHistory) {
       ImGui::Separator();
-      ImGui::Text("Energy Evolution");
-      // Only update min/max if simulation is running
-      static float pausedMinEnergy = 0;
-      static float pausedMaxEnergy = 0;
-
-      if (simState == SimulationState::RUNNING ||
-          simState == SimulationState::STEP) {
-        if (!energyHistory.empty()) {
-          pausedMinEnergy =
-              *std::min_element(energyHistory.begin(), energyHistory.end());
-          pausedMaxEnergy =
-              *std::max_element(energyHistory.begin(), energyHistory.end());
-        }
-      }
-
-      float rangePadding = (pausedMaxEnergy - pausedMinEnergy) * 0.1f;
-      float graphMin = pausedMinEnergy - rangePadding;
-      float graphMax = pausedMaxEnergy + rangePadding;
-
-      // Convert deque to vector for plotting
-      std::vector<float> plotData(energyHistory.begin(), energyHistory.end());
-
-      // Create axis labels
-      std::string yLabel = "Energy (" + std::to_string((int)graphMin) + " to " +
-                           std::to_string((int)graphMax) + ")";
-
-      // Draw the plot
-      ImGui::PlotLines(yLabel.c_str(),  // Y-axis label with range
-                       plotData.data(), // Data
-                       plotData.size(), // Count
-                       0,               // Offset
-                       nullptr,         // Overlay text
-                       graphMin,        // Scale min
-                       graphMax,        // Scale max
-                       ImVec2(0, 150)   // Larger size for better visibility
-      );
-
-      // Add X-axis label
-      ImGui::Text("Simulation Steps");
-
-      // Display current values
-      if (!energyHistory.empty()) {
-        ImGui::Text("Current: %.2f | Min: %.2f | Max: %.2f",
-                    energyHistory.back(), pausedMinEnergy, pausedMaxEnergy);
+      ImGui::Text("History: %llu frames, %.1f MB",
+                  (unsigned long long)energyHistory.Count(),
+                  (energyHistory.MemoryBytes() +
+                   magnetizationHistory.MemoryBytes() +
+                   acceptanceHistory.MemoryBytes()) /
+                      1048576.0);
+      ImGui::SameLine();
+      if (ImGui::Button("Clear History")) {
+        energyHistory.Clear();
+        magnetizationHistory.Clear();
+        acceptanceHistory.Clear();
       }
-
-      // Show pause status
+      historyView.Draw("Energy", energyHistory, 100.0f,
+                       IM_COL32(235, 111, 146, 255));
+      historyView.Draw(spinSystem ? "Order Parameter" : "Magnetization",
+                       magnetizationHistory, 70.0f,
+                       IM_COL32(156, 207, 216, 255));
+      historyView.Draw("Acceptance Rate", acceptanceHistory, 70.0f,
+                       IM_COL32(246, 193, 119, 255));
       if (simState == SimulationState::PAUSED) {
         ImGui::TextColored(ImVec4(1, 1, 0, 1), "(PAUSED)");
       }
     }
 
     ImGui::Text("Total Energy: %.2f", totalEnergy);
+    ImGui::Text("Sweeps/s: %.1f (MC steps per site per second)",
+                frameBudget.SweepsPerSecond());
+    ImGui::Text("Updates/s: %.3g achieved, %.3g kernel, block %.2f ms",
+                frameBudget.AchievedRate(), frameBudget.KernelRate(),
+                1000.0 * frameBudget.BlockSeconds());
     ImGui::Text("Up Spins: %d, Down Spins: %d", upSpins, downSpins);
-    ImGui::Text("Magnetization: %.2f",
-                (upSpins - downSpins) / (float)structure.size());
+    ImGui::Text("%s: %.2f", spinSystem ? "Order Parameter" : "Magnetization",
+                magnetization);
+    if (clustersReady) {
+      const ClusterStats &clusters = clusterAnalyzer.Stats();
+      ImGui::Separator();
+      ImGui::Text("Clusters: %d, Largest: %d (%.1f%%)%s",
+                  clusters.clusterCount, clusters.largestSize,
+                  100.0f * clusters.largestFraction,
+                  clusters.percolates ? ", percolating" : "");
+      clusterHistogram.assign(clusters.sizeHistogram.begin(),
+                              clusters.sizeHistogram.end());
+      ImGui::PlotHistogram("Sizes (log2 bins)", clusterHistogram.data(),
+                           (int)clusterHistogram.size(), 0, nullptr, 0.0f,
+                           FLT_MAX, ImVec2(0, 80));
+      for (size_t c = 0; c < clusters.largest.size() && c < 3; c++) {
+        const ClusterGeometry &g = clusters.largest[c];
+        Vector3 extent = Vector3Subtract(g.max, g.min);
+        ImGui::Text("#%zu: %d sites at (%.1f, %.1f, %.1f), extent %.1f x "
+                    "%.1f x %.1f%s%s%s",
+                    c + 1, g.size, g.centroid.x, g.centroid.y, g.centroid.z,
+                    extent.x, extent.y, extent.z, g.spans[0] ? " [x]" : "",
+                    g.spans[1] ? " [y]" : "", g.spans[2] ? " [z]" : "");
+      }
+    }
+    if (measureCorrelations && correlations.Samples() > 0) {
+      const CorrelationResult &corr = correlations.Result();
+      ImGui::Separator();
+      ImGui::Text("Correlations: %d samples (%s)", corr.samples,
+                  correlations.Method() == CorrelationMethod::GRID_FFT
+                      ? "3D FFT"
+                      : "cell list");
+      ImGui::Text("Correlation Length: %.2f, S(0): %.2f",
+                  corr.correlationLength, corr.susceptibility);
+      if (!corr.radii.empty()) {
+        const char *label = frameArena.Format(
+            "G(r), r up to %d", (int)ceilf(corr.radii.back()));
+        ImGui::PlotLines(label, corr.correlation.data(),
+                         (int)corr.correlation.size(), 0, nullptr, FLT_MAX,
+                         FLT_MAX, ImVec2(0, 80));
+      }
+      if (!corr.wavenumbers.empty()) {
+        const char *label = frameArena.Format(
+            "S(k), k up to %d", (int)ceilf(corr.wavenumbers.back()));
+        ImGui::PlotLines(label, corr.structureFactor.data(),
+                         (int)corr.structureFactor.size(), 0, nullptr, 0.0f,
+                         FLT_MAX, ImVec2(0, 80));
+      }
+    }
     ImGui::Text("FPS: %d", GetFPS());
+    const StartupReport &startup = Startup();
+    ImGui::Text("Startup: %.0f ms to login, %.0f ms to simulation",
+                startup.interactiveMs, startup.simulationMs);
+    if (!startup.font.fontPath.empty()) {
+      ImGui::Text("Font atlas: %s in %.1f ms",
+                  startup.font.fromCache ? "cached" : "rasterized",
+                  startup.font.milliseconds);
+    }
+    if (AllocationStatsEnabled()) {
+      ImGui::Text("Allocations/frame: %llu (%.1f KiB) main, %llu all threads",
+                  (unsigned long long)frameAllocations.count,
+                  frameAllocations.bytes / 1024.0,
+                  (unsigned long long)frameAllocationsAll.count);
+    }
+    ImGui::Checkbox("Profiler", &showProfiler);
+    ImGui::SameLine();
+    ImGui::Checkbox("Inspector", &showInspector);
 
     ImGui::End();
+    if (showProfiler)
+      profiler.Draw(&showProfiler);
+
+    // Site inspector and hover tooltip
+    SiteContext siteContext;
+    siteContext.structure = &structure;
+    siteContext.spinSystem =
+        spinSystem && spinSystem->Size() == structure.size() ? spinSystem.get()
+                                                             : nullptr;
+    siteContext.editable = spinModel == SpinModelType::ISING && !spinSystem;
+    siteContext.pinnedCount = pinnedCount;
+    auto isVacancy = [&](int site) {
+      return disordered && site >= 0 && site < (int)structure.size() &&
+             disorderedLattice.spins[site] == 0;
+    };
+    if (hoveredSite >= 0 && hoveredSite < (int)structure.size()) {
+      siteContext.site = hoveredSite;
+      siteContext.vacancy = isVacancy(hoveredSite);
+      DrawSiteTooltip(siteContext);
+    }
+    if (showInspector) {
+      siteContext.site = selectedSite;
+      siteContext.vacancy = isVacancy(selectedSite);
+      InspectorAction action = DrawSiteInspector(&showInspector, siteContext);
+      if (action.select >= 0)
+        selectedSite = action.select;
+      bool edited = action.flip || action.togglePin || action.unpinAll;
+      if (action.flip) {
+        Atome &atom = structure[selectedSite];
+        atom.spin = atom.spin == Spin::UP ? Spin::DOWN : Spin::UP;
+      }
+      if (action.togglePin)
+        structure[selectedSite].pinned = !structure[selectedSite].pinned;
+      if (action.unpinAll) {
+        for (auto &atom : structure)
+          atom.pinned = false;
+      }
+      if (edited) {
+        pinnedCount =
+            (int)count_if(structure.begin(), structure.end(),
+                          [](const Atome &atom) { return atom.pinned; });
+        // Hand spins and pins to the kernel that owns them
+        if (disordered) {
+          CopySpins(structure, disorderedLattice);
+          CopySpins(disorderedLattice, structure, J, B);
+        } else if (usePeriodic &&
+                   periodicLattice.spins.size() == structure.size()) {
+          CopySpins(structure, periodicLattice);
+          CopySpins(periodicLattice, structure, J, B);
+        } else {
+          UpdateEnergies(structure, J, B);
+        }
+        tunedStale = true;
+      }
+    }
     rlImGuiEnd();
+    TRACE_END();
 
     if (sphereSizeChanged) {
       UnloadMesh(sphereMesh);
@@ -406,21 +1675,63 @@ int runSimulation() {
       sphereSizeChanged = false;
     }
     if (bondRadiusChanged) {
+      for (auto &mesh : cylinderMeshes) {
+        UnloadMesh(mesh);
+      }
       cylinderMeshes =
           CreateChunkedCylinderLines(structure, cylinderRadius, segments);
+      bakedDistance = shownDistance;
+    }
+    TRACE_BEGIN("EndDrawing");
+    EndDrawing(); // Presents the frame, waits for vsync / target FPS
+    TRACE_END();
+    if (Startup().simulationMs == 0.0)
+      Startup().simulationMs = MillisecondsSinceLaunch() - screenStart;
+  }
+
+  // Shown lattice, parameters and spins, resumed at the next login
+  if (!structure.empty()) {
+    workspace.structure = builtStructure;
+    workspace.unitCell = builtUnitCell;
+    workspace.x = builtX;
+    workspace.y = builtY;
+    workspace.z = builtZ;
+    workspace.distance = shownDistance;
+    workspace.temperature = temperature;
+    workspace.J = J;
+    workspace.B = B;
+    workspace.spinModel = static_cast<int>(spinModel);
+    workspace.pottsStates = pottsStates;
+    workspace.periodic = usePeriodic;
+    workspace.cameraPosition = camera.position;
+    workspace.cameraTarget = camera.target;
+    workspace.checkpoint.clear();
+    CheckpointParams params;
+    params.temperature = temperature;
+    params.J = J;
+    params.B = B;
+    params.frame = frameCount;
+    string path = WorkspacePath("workspaces", user, ".ising");
+    string error;
+    if (spinModel == SpinModelType::ISING) {
+      if (WriteCheckpoint(path, structure, params, error))
+        workspace.checkpoint = path;
+      else
+        TraceLog(LOG_WARNING, "Workspace: %s", error.c_str());
     }
-    EndDrawing();
+    if (!WriteWorkspace(workspacePath, workspace, error))
+      TraceLog(LOG_WARNING, "Workspace: %s", error.c_str());
   }
 
   // Cleanup
-  rlImGuiShutdown();
+  rebuildJob.Cancel();
+  spinArrows.Unload();
   UnloadMesh(sphereMesh);
   for (auto &mesh : cylinderMeshes) {
     UnloadMesh(mesh);
   }
   UnloadMaterial(sphereMaterial);
   UnloadMaterial(lineMaterial);
-  CloseWindow();
 
   return 0;
 }
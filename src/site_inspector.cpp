@@ -0,0 +1,121 @@
+#include "site_inspector.h"
+#include "imgui.h"
+#include <cstdio>
+
+// Spin as shown for the active engine
+static void SpinText(const SiteContext &context, int site, char *text,
+                     size_t size) {
+  if (context.spinSystem) {
+    Vector3 d = context.spinSystem->Direction(site);
+    snprintf(text, size, "%d (%.2f, %.2f, %.2f)",
+             context.spinSystem->Label(site), d.x, d.y, d.z);
+  } else {
+    bool up = (*context.structure)[site].spin == Spin::UP;
+    snprintf(text, size, "%s", up ? "+1 (up)" : "-1 (down)");
+  }
+}
+
+void DrawSiteTooltip(const SiteContext &context) {
+  const Atome &atom = (*context.structure)[context.site];
+  char spin[64];
+  SpinText(context, context.site, spin, sizeof(spin));
+  ImGui::BeginTooltip();
+  ImGui::Text("Site %d%s", context.site, atom.pinned ? " (pinned)" : "");
+  if (context.vacancy) {
+    ImGui::TextUnformatted("Vacancy");
+  } else {
+    ImGui::Text("Spin %s", spin);
+    ImGui::Text("Energy %.3f", atom.energy);
+  }
+  ImGui::TextDisabled("Right click to inspect");
+  ImGui::EndTooltip();
+}
+
+InspectorAction DrawSiteInspector(bool *open, const SiteContext &context) {
+  InspectorAction action;
+  ImGui::SetNextWindowSize(ImVec2(420, 480), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Inspector", open)) {
+    ImGui::End();
+    return action;
+  }
+  const vector<Atome> &structure = *context.structure;
+  if (context.site < 0 || context.site >= (int)structure.size()) {
+    ImGui::TextUnformatted("Right click an atom to inspect it.");
+    ImGui::End();
+    return action;
+  }
+
+  const Atome &atom = structure[context.site];
+  ImGui::Text("Site %d", context.site);
+  ImGui::Text("Position (%.2f, %.2f, %.2f)", atom.pos.x, atom.pos.y,
+              atom.pos.z);
+  if (context.vacancy) {
+    ImGui::TextUnformatted("Vacancy: no spin on this site");
+  } else {
+    char spin[64];
+    SpinText(context, context.site, spin, sizeof(spin));
+    ImGui::Text("Spin %s", spin);
+    ImGui::Text("Energy %.4f", atom.energy);
+    if (!context.spinSystem) {
+      // Site energy is -s h, whatever kernel produced it
+      int s = static_cast<int>(atom.spin);
+      float field = -atom.energy * s;
+      ImGui::Text("Local field h %.4f", field);
+      ImGui::Text("Flip cost dE = 2 s h = %.4f", 2.0f * s * field);
+    }
+  }
+
+  ImGui::Separator();
+  ImGui::BeginDisabled(!context.editable || context.vacancy);
+  if (ImGui::Button("Flip Spin"))
+    action.flip = true;
+  ImGui::SameLine();
+  bool pinned = atom.pinned;
+  if (ImGui::Checkbox("Pinned", &pinned))
+    action.togglePin = true;
+  ImGui::EndDisabled();
+  ImGui::SameLine();
+  ImGui::BeginDisabled(context.pinnedCount == 0);
+  if (ImGui::Button("Unpin All"))
+    action.unpinAll = true;
+  ImGui::EndDisabled();
+  ImGui::Text("%d pinned site(s)", context.pinnedCount);
+  if (!context.editable)
+    ImGui::TextDisabled("Flip and pin apply to the Ising kernels only");
+
+  ImGui::Separator();
+  ImGui::Text("Neighbors (%d)", (int)atom.neigh.size());
+  if (ImGui::BeginTable("Neighbors", 4,
+                        ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInner |
+                            ImGuiTableFlags_ScrollY)) {
+    ImGui::TableSetupColumn("Site");
+    ImGui::TableSetupColumn("Spin");
+    ImGui::TableSetupColumn("J factor");
+    ImGui::TableSetupColumn("Distance");
+    ImGui::TableHeadersRow();
+    for (size_t n = 0; n < atom.neigh.size(); n++) {
+      int j = atom.neigh[n];
+      if (j < 0 || j >= (int)structure.size())
+        continue;
+      char spin[64];
+      SpinText(context, j, spin, sizeof(spin));
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      char label[32];
+      snprintf(label, sizeof(label), "%d%s", j,
+               structure[j].pinned ? " *" : "");
+      if (ImGui::Selectable(label, false,
+                            ImGuiSelectableFlags_SpanAllColumns))
+        action.select = j;
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(spin);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", atom.coupling.empty() ? 1.0f : atom.coupling[n]);
+      ImGui::TableNextColumn();
+      ImGui::Text("%.3f", Vector3Distance(atom.pos, structure[j].pos));
+    }
+    ImGui::EndTable();
+  }
+  ImGui::End();
+  return action;
+}
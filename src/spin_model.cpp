@@ -0,0 +1,46 @@
+#include "spin_model.h"
+
+SpinTopology MakeSpinTopology(const vector<Atome> &structure) {
+  SpinTopology topology;
+  topology.offsets.reserve(structure.size() + 1);
+  topology.offsets.push_back(0);
+  bool weighted = false;
+  for (const auto &atom : structure) {
+    topology.neighbors.insert(topology.neighbors.end(), atom.neigh.begin(),
+                              atom.neigh.end());
+    topology.offsets.push_back((int)topology.neighbors.size());
+    weighted |= !atom.coupling.empty();
+  }
+  if (weighted) {
+    topology.coupling.reserve(topology.neighbors.size());
+    for (const auto &atom : structure) {
+      if (atom.coupling.empty())
+        topology.coupling.insert(topology.coupling.end(), atom.neigh.size(),
+                                 1.0f);
+      else
+        topology.coupling.insert(topology.coupling.end(),
+                                 atom.coupling.begin(), atom.coupling.end());
+    }
+  }
+  return topology;
+}
+
+unique_ptr<SpinSystem> MakeSpinSystem(SpinModelType type,
+                                      shared_ptr<const SpinTopology> topology,
+                                      int pottsStates) {
+  switch (type) {
+  case SpinModelType::POTTS: {
+    PottsModel model;
+    model.q = max(2, min(pottsStates, 255));
+    return make_unique<SpinSystemOf<PottsModel>>(std::move(topology), model);
+  }
+  case SpinModelType::XY:
+    return make_unique<SpinSystemOf<XYModel>>(std::move(topology), XYModel());
+  case SpinModelType::HEISENBERG:
+    return make_unique<SpinSystemOf<HeisenbergModel>>(std::move(topology),
+                                                      HeisenbergModel());
+  default:
+    return make_unique<SpinSystemOf<IsingModel>>(std::move(topology),
+                                                 IsingModel());
+  }
+}
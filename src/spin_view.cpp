@@ -0,0 +1,172 @@
+#include "spin_view.h"
+
+// Per-instance model matrix in an attribute, flat directional lighting
+static const char *arrowVertexShader = R"(#version 330
+in vec3 vertexPosition;
+in vec3 vertexNormal;
+in mat4 instanceTransform;
+uniform mat4 mvp;
+out vec3 fragNormal;
+void main() {
+  fragNormal = normalize(mat3(instanceTransform) * vertexNormal);
+  gl_Position = mvp * instanceTransform * vec4(vertexPosition, 1.0);
+}
+)";
+
+static const char *arrowFragmentShader = R"(#version 330
+in vec3 fragNormal;
+uniform vec4 colDiffuse;
+out vec4 finalColor;
+void main() {
+  float light = 0.55 + 0.45 * max(dot(fragNormal, normalize(vec3(0.4, 1.0, 0.6))), 0.0);
+  finalColor = vec4(colDiffuse.rgb * light, colDiffuse.a);
+}
+)";
+
+Mesh GenMeshArrow(int slices) {
+  const float shaftRadius = 0.05f, headRadius = 0.14f;
+  const float bottom = -0.5f, neck = 0.15f, tip = 0.5f;
+
+  // Shaft side (2 triangles), bottom cap, head base ring, head side
+  Mesh mesh = {0};
+  mesh.triangleCount = slices * 5;
+  mesh.vertexCount = mesh.triangleCount * 3;
+  mesh.vertices = (float *)RL_MALLOC(mesh.vertexCount * 3 * sizeof(float));
+  mesh.normals = (float *)RL_MALLOC(mesh.vertexCount * 3 * sizeof(float));
+  mesh.texcoords = (float *)RL_CALLOC(mesh.vertexCount * 2, sizeof(float));
+
+  int v = 0;
+  auto emit = [&](Vector3 p, Vector3 n) {
+    mesh.vertices[v * 3 + 0] = p.x;
+    mesh.vertices[v * 3 + 1] = p.y;
+    mesh.vertices[v * 3 + 2] = p.z;
+    mesh.normals[v * 3 + 0] = n.x;
+    mesh.normals[v * 3 + 1] = n.y;
+    mesh.normals[v * 3 + 2] = n.z;
+    v++;
+  };
+  float slope = headRadius / (tip - neck);
+  for (int i = 0; i < slices; i++) {
+    float a0 = 2.0f * PI * i / slices, a1 = 2.0f * PI * (i + 1) / slices;
+    Vector3 d0 = {cosf(a0), 0.0f, sinf(a0)}, d1 = {cosf(a1), 0.0f, sinf(a1)};
+    auto ring = [](Vector3 d, float r, float y) {
+      return Vector3{d.x * r, y, d.z * r};
+    };
+
+    // Counter-clockwise seen from outside
+    emit(ring(d0, shaftRadius, bottom), d0);
+    emit(ring(d0, shaftRadius, neck), d0);
+    emit(ring(d1, shaftRadius, neck), d1);
+    emit(ring(d0, shaftRadius, bottom), d0);
+    emit(ring(d1, shaftRadius, neck), d1);
+    emit(ring(d1, shaftRadius, bottom), d1);
+
+    Vector3 down = {0.0f, -1.0f, 0.0f};
+    emit({0.0f, bottom, 0.0f}, down);
+    emit(ring(d0, shaftRadius, bottom), down);
+    emit(ring(d1, shaftRadius, bottom), down);
+
+    emit({0.0f, neck, 0.0f}, down);
+    emit(ring(d0, headRadius, neck), down);
+    emit(ring(d1, headRadius, neck), down);
+
+    Vector3 n0 = Vector3Normalize({d0.x, slope, d0.z});
+    Vector3 n1 = Vector3Normalize({d1.x, slope, d1.z});
+    emit(ring(d0, headRadius, neck), n0);
+    emit({0.0f, tip, 0.0f}, Vector3Normalize(Vector3Add(n0, n1)));
+    emit(ring(d1, headRadius, neck), n1);
+  }
+
+  UploadMesh(&mesh, false);
+  return mesh;
+}
+
+// Rotation taking +Y to direction, uniform scale, then translation
+static Matrix ArrowTransform(Vector3 position, Vector3 direction,
+                             float length) {
+  Vector3 d = Vector3Normalize(direction);
+  Vector3 reference = fabsf(d.y) < 0.99f ? Vector3{0, 1, 0} : Vector3{1, 0, 0};
+  Vector3 u = Vector3Normalize(Vector3CrossProduct(d, reference));
+  Vector3 w = Vector3CrossProduct(u, d);
+  Matrix m = {0};
+  m.m0 = u.x * length, m.m1 = u.y * length, m.m2 = u.z * length;
+  m.m4 = d.x * length, m.m5 = d.y * length, m.m6 = d.z * length;
+  m.m8 = w.x * length, m.m9 = w.y * length, m.m10 = w.z * length;
+  m.m12 = position.x, m.m13 = position.y, m.m14 = position.z;
+  m.m15 = 1.0f;
+  return m;
+}
+
+void SpinArrows::Load() {
+  if (loaded)
+    return;
+  arrow = GenMeshArrow();
+  shader = LoadShaderFromMemory(arrowVertexShader, arrowFragmentShader);
+  shader.locs[SHADER_LOC_MATRIX_MVP] = GetShaderLocation(shader, "mvp");
+  shader.locs[SHADER_LOC_COLOR_DIFFUSE] =
+      GetShaderLocation(shader, "colDiffuse");
+  shader.locs[SHADER_LOC_MATRIX_MODEL] =
+      GetShaderLocationAttrib(shader, "instanceTransform");
+  instanced = shader.locs[SHADER_LOC_MATRIX_MODEL] >= 0;
+  if (!instanced)
+    TraceLog(LOG_WARNING, "Arrow instancing shader unavailable, drawing "
+                          "arrows one by one");
+  material = LoadMaterialDefault();
+  if (instanced)
+    material.shader = shader;
+  loaded = true;
+}
+
+void SpinArrows::Unload() {
+  if (!loaded)
+    return;
+  UnloadMesh(arrow);
+  UnloadMaterial(material); // Also unloads the arrow shader when in use
+  if (!instanced)
+    UnloadShader(shader);
+  loaded = false;
+}
+
+void SpinArrows::Draw(const vector<Atome> &structure, const SpinSystem &system,
+                      float length, Color upColor, Color downColor) {
+  if (!loaded)
+    Load();
+  for (auto &bin : bins)
+    bin.clear();
+
+  size_t count = min(structure.size(), system.Size());
+  bool planar = system.Type() == SpinModelType::XY;
+  for (size_t i = 0; i < count; i++) {
+    Vector3 direction = system.Direction((int)i);
+    int bin;
+    if (planar) {
+      float angle = atan2f(direction.y, direction.x) + PI;
+      bin = (int)(angle / (2.0f * PI) * colorBins);
+    } else {
+      bin = (int)((direction.z + 1.0f) * 0.5f * colorBins);
+    }
+    bin = max(0, min(bin, colorBins - 1));
+    bins[bin].push_back(ArrowTransform(structure[i].pos, direction, length));
+  }
+
+  for (int b = 0; b < colorBins; b++) {
+    if (bins[b].empty())
+      continue;
+    float t = (b + 0.5f) / colorBins;
+    Color color;
+    if (planar) {
+      color = ColorFromHSV(360.0f * t, 0.75f, 0.9f);
+    } else {
+      color = Color{(unsigned char)Lerp(downColor.r, upColor.r, t),
+                    (unsigned char)Lerp(downColor.g, upColor.g, t),
+                    (unsigned char)Lerp(downColor.b, upColor.b, t), 255};
+    }
+    material.maps[MATERIAL_MAP_DIFFUSE].color = color;
+    if (instanced) {
+      DrawMeshInstanced(arrow, material, bins[b].data(), (int)bins[b].size());
+    } else {
+      for (const Matrix &transform : bins[b])
+        DrawMesh(arrow, material, transform);
+    }
+  }
+}
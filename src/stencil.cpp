@@ -0,0 +1,142 @@
+#include "stencil.h"
+#include "trace.h"
+#include <algorithm>
+
+void AcceptanceTable::Build(int neighborCount, float temperature, float J,
+                            float B) {
+  maxField = neighborCount;
+  threshold.assign(2 * (2 * neighborCount + 1), 0);
+  for (int s = 0; s < 2; s++) {
+    int spin = s ? 1 : -1;
+    for (int field = -neighborCount; field <= neighborCount; field++) {
+      // Flipping s costs 2 s (J h + B)
+      float deltaE = 2.0f * spin * (J * field + B);
+      double probability = 1.0;
+      if (deltaE > 0)
+        probability = temperature > 0 ? exp(-deltaE / temperature) : 0.0;
+      threshold[s * (2 * neighborCount + 1) + field + neighborCount] =
+          static_cast<uint32_t>(min(probability * 4294967296.0, 4294967295.0));
+    }
+  }
+}
+
+bool SupportsStencil(StructureType type) {
+  return type == StructureType::CUBIC || type == StructureType::BCC ||
+         type == StructureType::FCC;
+}
+
+int StencilNeighborCount(StructureType type) {
+  switch (type) {
+  case StructureType::BCC:
+    return Stencil<StructureType::BCC>::neighborCount;
+  case StructureType::FCC:
+    return Stencil<StructureType::FCC>::neighborCount;
+  default:
+    return Stencil<StructureType::CUBIC>::neighborCount;
+  }
+}
+
+StencilLattice MakeStencilLattice(StructureType type, int x, int y, int z) {
+  StencilLattice lattice;
+  lattice.type = type;
+  lattice.lx = x;
+  lattice.ly = y;
+  lattice.lz = z;
+  switch (type) {
+  case StructureType::BCC:
+    lattice.basisCount = Stencil<StructureType::BCC>::basisCount;
+    break;
+  case StructureType::FCC:
+    lattice.basisCount = Stencil<StructureType::FCC>::basisCount;
+    break;
+  default:
+    lattice.basisCount = Stencil<StructureType::CUBIC>::basisCount;
+    break;
+  }
+  lattice.spins.assign((size_t)x * y * z * lattice.basisCount, 1);
+  return lattice;
+}
+
+int StencilSweep(StencilLattice &lattice, int firstCell, int cellCount,
+                 float temperature, float J, float B, mt19937 &rng) {
+  TRACE_SCOPE("StencilSweep");
+  if (temperature != lattice.tableT || J != lattice.tableJ ||
+      B != lattice.tableB || lattice.table.threshold.empty()) {
+    lattice.table.Build(StencilNeighborCount(lattice.type), temperature, J, B);
+    lattice.tableT = temperature;
+    lattice.tableJ = J;
+    lattice.tableB = B;
+  }
+  const AcceptanceTable &table = lattice.table;
+  switch (lattice.type) {
+  case StructureType::CUBIC:
+    return StencilSweepCells<StructureType::CUBIC>(lattice, firstCell,
+                                                   cellCount, table, rng);
+  case StructureType::BCC:
+    return StencilSweepCells<StructureType::BCC>(lattice, firstCell,
+                                                 cellCount, table, rng);
+  case StructureType::FCC:
+    return StencilSweepCells<StructureType::FCC>(lattice, firstCell,
+                                                 cellCount, table, rng);
+  default:
+    return 0;
+  }
+}
+
+int StencilColorCount(StructureType type) {
+  return type == StructureType::FCC ? Stencil<StructureType::FCC>::basisCount
+                                    : 2;
+}
+
+int StencilSweepColor(StencilLattice &lattice, int color, float temperature,
+                      float J, float B, const float *extraField,
+                      mt19937 &rng) {
+  TRACE_SCOPE("StencilSweepColor");
+  switch (lattice.type) {
+  case StructureType::CUBIC:
+    return StencilSweepColorCells<StructureType::CUBIC>(
+        lattice, color, temperature, J, B, extraField, rng);
+  case StructureType::BCC:
+    return StencilSweepColorCells<StructureType::BCC>(
+        lattice, color, temperature, J, B, extraField, rng);
+  case StructureType::FCC:
+    return StencilSweepColorCells<StructureType::FCC>(
+        lattice, color, temperature, J, B, extraField, rng);
+  default:
+    return 0;
+  }
+}
+
+void CopySpins(const vector<Atome> &structure, StencilLattice &lattice) {
+  for (size_t i = 0; i < structure.size() && i < lattice.spins.size(); i++) {
+    lattice.spins[i] = static_cast<int8_t>(structure[i].spin);
+  }
+  CopyPinned(structure, lattice.pinned);
+  if (lattice.pinned.size() != lattice.spins.size())
+    lattice.pinned.clear();
+}
+
+// Site energies of CopySpins, kept per thread: it runs every frame
+static thread_local vector<float> copyEnergies;
+
+void CopySpins(const StencilLattice &lattice, vector<Atome> &structure,
+               float J, float B) {
+  copyEnergies.resize(lattice.spins.size());
+  switch (lattice.type) {
+  case StructureType::CUBIC:
+    StencilEnergies<StructureType::CUBIC>(lattice, J, B, copyEnergies.data());
+    break;
+  case StructureType::BCC:
+    StencilEnergies<StructureType::BCC>(lattice, J, B, copyEnergies.data());
+    break;
+  case StructureType::FCC:
+    StencilEnergies<StructureType::FCC>(lattice, J, B, copyEnergies.data());
+    break;
+  default:
+    break;
+  }
+  for (size_t i = 0; i < structure.size() && i < lattice.spins.size(); i++) {
+    structure[i].spin = static_cast<Spin>(lattice.spins[i]);
+    structure[i].energy = copyEnergies[i];
+  }
+}
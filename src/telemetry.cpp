@@ -0,0 +1,438 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(TelemetrySnapshot) % 8 == 0,
+              "TelemetrySnapshot is copied as 64-bit words");
+
+static const size_t maxRequestBytes = 16 * 1024;
+static const size_t maxStreamBacklog = 64 * 1024; // Slow reader: drop samples
+static const size_t maxClients = 32;
+
+TelemetryServer::~TelemetryServer() { Stop(); }
+
+void TelemetryServer::Publish(const TelemetrySnapshot &snapshot) {
+  uint64_t raw[wordCount];
+  memcpy(raw, &snapshot, sizeof(raw));
+  uint64_t start = sequence.load(memory_order_relaxed);
+  sequence.store(start + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  for (size_t i = 0; i < wordCount; i++)
+    words[i].store(raw[i], memory_order_relaxed);
+  sequence.store(start + 2, memory_order_release);
+}
+
+bool TelemetryServer::ReadSnapshot(TelemetrySnapshot &snapshot) const {
+  uint64_t raw[wordCount];
+  while (true) {
+    uint64_t before = sequence.load(memory_order_acquire);
+    if (before & 1) {
+      this_thread::yield(); // Publication in progress, a few stores long
+      continue;
+    }
+    for (size_t i = 0; i < wordCount; i++)
+      raw[i] = words[i].load(memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (sequence.load(memory_order_relaxed) == before) {
+      memcpy(&snapshot, raw, sizeof(raw));
+      return before != 0;
+    }
+  }
+}
+
+bool TelemetryServer::PushCommand(const TelemetryCommand &command) {
+  uint32_t head = commandHead.load(memory_order_relaxed);
+  if (head - commandTail.load(memory_order_acquire) == commandCapacity)
+    return false;
+  commands[head % commandCapacity] = command;
+  commandHead.store(head + 1, memory_order_release);
+  return true;
+}
+
+bool TelemetryServer::PollCommand(TelemetryCommand &command) {
+  uint32_t tail = commandTail.load(memory_order_relaxed);
+  if (tail == commandHead.load(memory_order_acquire))
+    return false;
+  command = commands[tail % commandCapacity];
+  commandTail.store(tail + 1, memory_order_release);
+  return true;
+}
+
+#ifdef _WIN32
+
+bool TelemetryServer::Start(int, string &error) {
+  error = "Telemetry needs POSIX sockets";
+  return false;
+}
+
+void TelemetryServer::Stop() {}
+
+void TelemetryServer::Serve() {}
+
+#else
+
+static string SnapshotJson(const TelemetrySnapshot &s) {
+  char text[768];
+  snprintf(text, sizeof(text),
+           "{\"frame\":%llu,\"time\":%.6f,\"temperature\":%.9g,\"J\":%.9g,"
+           "\"B\":%.9g,\"energy\":%.9g,\"magnetization\":%.9g,"
+           "\"acceptance\":%.9g,\"sweepsPerSecond\":%.9g,\"fps\":%.9g,"
+           "\"atoms\":%lld,\"pinned\":%lld,\"running\":%s,\"model\":%lld}",
+           (unsigned long long)s.frame, s.time, s.temperature, s.J, s.B,
+           s.energy, s.magnetization, s.acceptance, s.sweepsPerSecond, s.fps,
+           (long long)s.atoms, (long long)s.pinned,
+           s.running ? "true" : "false", (long long)s.model);
+  return text;
+}
+
+static string Response(const char *status, const char *type,
+                       const string &body) {
+  return string("HTTP/1.1 ") + status + "\r\nContent-Type: " + type +
+         "\r\nContent-Length: " + to_string(body.size()) +
+         "\r\nCache-Control: no-cache\r\nConnection: close\r\n\r\n" + body;
+}
+
+static string Decode(const string &text) {
+  string out;
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '+') {
+      out += ' ';
+    } else if (text[i] == '%' && i + 2 < text.size()) {
+      out += (char)strtol(text.substr(i + 1, 2).c_str(), nullptr, 16);
+      i += 2;
+    } else {
+      out += text[i];
+    }
+  }
+  return out;
+}
+
+// "a=1&b=2" into (key, value) pairs
+static vector<pair<string, string>> ParseForm(const string &text) {
+  vector<pair<string, string>> fields;
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find('&', start);
+    if (end == string::npos)
+      end = text.size();
+    string field = text.substr(start, end - start);
+    size_t equal = field.find('=');
+    if (!field.empty())
+      fields.emplace_back(Decode(field.substr(0, equal)),
+                          equal == string::npos
+                              ? string()
+                              : Decode(field.substr(equal + 1)));
+    start = end + 1;
+  }
+  return fields;
+}
+
+static string HeaderValue(const string &headers, const char *name) {
+  size_t length = strlen(name);
+  size_t line = headers.find("\r\n");
+  while (line != string::npos && line + 2 < headers.size()) {
+    size_t begin = line + 2, end = headers.find("\r\n", begin);
+    if (end == string::npos)
+      end = headers.size();
+    if (end - begin > length && headers[begin + length] == ':' &&
+        strncasecmp(headers.c_str() + begin, name, length) == 0) {
+      size_t value = headers.find_first_not_of(' ', begin + length + 1);
+      return value < end ? headers.substr(value, end - value) : string();
+    }
+    line = end;
+  }
+  return "";
+}
+
+namespace {
+struct Client {
+  int socket = -1;
+  string input;
+  string output;
+  bool streaming = false;
+  bool closeWhenSent = false;
+  chrono::steady_clock::duration period{};
+  chrono::steady_clock::time_point next;
+};
+} // namespace
+
+bool TelemetryServer::Start(int port, string &error) {
+  Stop();
+  int listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0) {
+    error = string("socket: ") + strerror(errno);
+    return false;
+  }
+  int yes = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // Never off the machine
+  address.sin_port = htons((uint16_t)port);
+  socklen_t size = sizeof(address);
+  if (bind(listener, (sockaddr *)&address, sizeof(address)) < 0 ||
+      listen(listener, 16) < 0 ||
+      getsockname(listener, (sockaddr *)&address, &size) < 0 ||
+      pipe(wakePipe) < 0) {
+    error = "Port " + to_string(port) + ": " + strerror(errno);
+    close(listener);
+    return false;
+  }
+  fcntl(listener, F_SETFL, fcntl(listener, F_GETFL) | O_NONBLOCK);
+  listenSocket = listener;
+  boundPort = ntohs(address.sin_port);
+  stopping = false;
+  running = true;
+  worker = thread(&TelemetryServer::Serve, this);
+  return true;
+}
+
+void TelemetryServer::Stop() {
+  if (!worker.joinable())
+    return;
+  stopping = true;
+  char byte = 0;
+  if (write(wakePipe[1], &byte, 1) < 0) {
+    // The pipe is never full, poll() wakes up anyway on the next timeout
+  }
+  worker.join();
+  close(listenSocket);
+  close(wakePipe[0]);
+  close(wakePipe[1]);
+  listenSocket = wakePipe[0] = wakePipe[1] = -1;
+  boundPort = 0;
+  streams = 0;
+  running = false;
+}
+
+void TelemetryServer::Serve() {
+  using Clock = chrono::steady_clock;
+  vector<Client> clients;
+  vector<pollfd> fds;
+  TelemetrySnapshot snapshot;
+
+  // One complete request: answer it, or switch the client to streaming
+  auto handle = [&](Client &client, const string &headers,
+                    const string &body) {
+    size_t space1 = headers.find(' ');
+    size_t space2 = headers.find(' ', space1 + 1);
+    string method = headers.substr(0, space1);
+    string target = headers.substr(space1 + 1, space2 - space1 - 1);
+    size_t question = target.find('?');
+    string path = target.substr(0, question);
+    string query =
+        question == string::npos ? string() : target.substr(question + 1);
+    client.closeWhenSent = true;
+
+    if (method != "GET" && method != "POST") {
+      client.output = Response("405 Method Not Allowed", "text/plain",
+                               "GET or POST\n");
+    } else if (path == "/observables") {
+      if (ReadSnapshot(snapshot))
+        client.output =
+            Response("200 OK", "application/json", SnapshotJson(snapshot));
+      else
+        client.output = Response("503 Service Unavailable", "text/plain",
+                                 "No frame published yet\n");
+    } else if (path == "/stream") {
+      float hz = streamRate.load();
+      for (const auto &field : ParseForm(query))
+        if (field.first == "hz")
+          hz = (float)atof(field.second.c_str());
+      hz = min(max(hz, 0.1f), 1000.0f);
+      client.streaming = true;
+      client.closeWhenSent = false;
+      client.period = chrono::duration_cast<Clock::duration>(
+          chrono::duration<double>(1.0 / hz));
+      client.next = Clock::now();
+      client.output = "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\n"
+                      "Cache-Control: no-cache\r\nConnection: keep-alive\r\n"
+                      "\r\n";
+      streams++;
+    } else if (path == "/control") {
+      // POST only, and not from a web page: browsers always send Origin
+      if (method != "POST" || !HeaderValue(headers, "Origin").empty()) {
+        client.output = Response("403 Forbidden", "text/plain",
+                                 "POST without Origin header only\n");
+        return;
+      }
+      vector<TelemetryCommand> parsed;
+      string fields = query + (query.empty() || body.empty() ? "" : "&") +
+                      body;
+      for (const auto &field : ParseForm(fields)) {
+        TelemetryCommand command;
+        const string &key = field.first, &value = field.second;
+        char *end = nullptr;
+        command.value = strtof(value.c_str(), &end);
+        bool number = !value.empty() && *end == '\0';
+        if ((key == "temperature" || key == "T") && number)
+          command.action = TelemetryAction::SET_TEMPERATURE;
+        else if (key == "J" && number)
+          command.action = TelemetryAction::SET_J;
+        else if (key == "B" && number)
+          command.action = TelemetryAction::SET_B;
+        else if (key == "action" && value == "run")
+          command.action = TelemetryAction::RUN;
+        else if (key == "action" && value == "pause")
+          command.action = TelemetryAction::PAUSE;
+        else if (key == "action" && value == "step")
+          command.action = TelemetryAction::STEP;
+        else if (key == "action" && value == "checkpoint")
+          command.action = TelemetryAction::CHECKPOINT;
+        else {
+          client.output = Response("400 Bad Request", "text/plain",
+                                   "Bad field: " + key + "=" + value + "\n");
+          return;
+        }
+        parsed.push_back(command);
+      }
+      int queued = 0;
+      for (const TelemetryCommand &command : parsed)
+        queued += PushCommand(command);
+      bool complete = queued == (int)parsed.size();
+      client.output = Response(
+          complete ? "200 OK" : "503 Service Unavailable", "application/json",
+          "{\"queued\":" + to_string(queued) + ",\"dropped\":" +
+              to_string(parsed.size() - queued) + "}");
+    } else if (path == "/") {
+      client.output = Response(
+          "200 OK", "text/plain",
+          "GET  /observables   latest frame as JSON\n"
+          "GET  /stream?hz=10  Server-Sent Events, one JSON per sample\n"
+          "POST /control       temperature=, J=, B=, "
+          "action=run|pause|step|checkpoint\n");
+    } else {
+      client.output = Response("404 Not Found", "text/plain", "Not found\n");
+    }
+  };
+
+  while (!stopping) {
+    // Sleep until a request, a writable socket or the next stream sample
+    int timeout = -1;
+    Clock::time_point now = Clock::now();
+    for (const Client &client : clients) {
+      if (!client.streaming)
+        continue;
+      auto wait = chrono::duration_cast<chrono::milliseconds>(client.next -
+                                                              now);
+      timeout = timeout < 0 ? max<int>(0, (int)wait.count())
+                            : min(timeout, max<int>(0, (int)wait.count()));
+    }
+    fds.clear();
+    fds.push_back({wakePipe[0], POLLIN, 0});
+    fds.push_back({listenSocket, POLLIN, 0});
+    for (const Client &client : clients)
+      fds.push_back({client.socket,
+                     (short)(POLLIN | (client.output.empty() ? 0 : POLLOUT)),
+                     0});
+    if (poll(fds.data(), fds.size(), timeout) < 0 && errno != EINTR)
+      break;
+    if (fds[0].revents)
+      break;
+
+    if (fds[1].revents & POLLIN) {
+      int socket;
+      while ((socket = accept(listenSocket, nullptr, nullptr)) >= 0) {
+        if (clients.size() >= maxClients) {
+          close(socket);
+          continue;
+        }
+        fcntl(socket, F_SETFL, fcntl(socket, F_GETFL) | O_NONBLOCK);
+        Client client;
+        client.socket = socket;
+        clients.push_back(move(client));
+      }
+    }
+
+    now = Clock::now();
+    for (size_t c = 0; c < clients.size(); c++) {
+      Client &client = clients[c];
+      short events = c + 2 < fds.size() ? fds[c + 2].revents : 0;
+      bool closed = events & (POLLERR | POLLNVAL);
+      if (events & (POLLIN | POLLHUP)) {
+        char buffer[4096];
+        ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+          closed = true;
+        } else if (!client.streaming) {
+          client.input.append(buffer, received);
+          size_t end = client.input.find("\r\n\r\n");
+          if (end != string::npos) {
+            string headers = client.input.substr(0, end);
+            // Checked before the sum below, which a huge value would wrap
+            string declared = HeaderValue(headers, "Content-Length");
+            declared.erase(declared.find_last_not_of(" \t") + 1);
+            unsigned long length = strtoul(declared.c_str(), nullptr, 10);
+            if (declared.find_first_not_of("0123456789") != string::npos) {
+              client.output = Response("400 Bad Request", "text/plain",
+                                       "Invalid Content-Length\n");
+              client.closeWhenSent = true;
+              client.input.clear();
+            } else if (length > maxRequestBytes ||
+                       end + 4 + length > maxRequestBytes) {
+              client.output = Response("413 Payload Too Large", "text/plain",
+                                       "Request too large\n");
+              client.closeWhenSent = true;
+              client.input.clear();
+            } else if (client.input.size() >= end + 4 + length) {
+              handle(client, headers, client.input.substr(end + 4, length));
+              client.input.erase(0, end + 4 + length);
+            }
+            // Otherwise the body is still on its way: keep the headers
+          } else if (client.input.size() > maxRequestBytes) {
+            closed = true;
+          }
+        }
+      }
+      // New samples for the subscribers that are due
+      if (client.streaming && !closed && now >= client.next) {
+        if (client.output.size() < maxStreamBacklog &&
+            ReadSnapshot(snapshot))
+          client.output += "data: " + SnapshotJson(snapshot) + "\n\n";
+        client.next += client.period;
+        if (client.next < now)
+          client.next = now + client.period; // Do not burst after a stall
+      }
+      if (!closed && !client.output.empty()) {
+        ssize_t sent = send(client.socket, client.output.data(),
+                            client.output.size(), MSG_NOSIGNAL);
+        if (sent > 0)
+          client.output.erase(0, sent);
+        else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+          closed = true;
+      }
+      if (client.closeWhenSent && client.output.empty())
+        closed = true;
+      if (closed) {
+        close(client.socket);
+        client.socket = -1;
+        if (client.streaming)
+          streams--;
+      }
+    }
+    clients.erase(remove_if(clients.begin(), clients.end(),
+                            [](const Client &client) {
+                              return client.socket < 0;
+                            }),
+                  clients.end());
+  }
+  for (Client &client : clients)
+    close(client.socket);
+}
+
+#endif // _WIN32
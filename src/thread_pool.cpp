@@ -0,0 +1,221 @@
+#include "thread_pool.h"
+#include "trace.h"
+#include <algorithm>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// Pool whose WorkerLoop runs on this thread, if any
+static thread_local const ThreadPool *currentPool = nullptr;
+
+ThreadPool::ThreadPool(unsigned threadCount) {
+  if (threadCount == 0)
+    threadCount = max(1u, thread::hardware_concurrency());
+  workerDone.assign(threadCount, 0);
+  workers.reserve(threadCount);
+  for (unsigned i = 0; i < threadCount; i++) {
+    workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    lock_guard<mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueReady.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+future<void> ThreadPool::Submit(function<void()> task) {
+  packaged_task<void()> packaged(std::move(task));
+  future<void> done = packaged.get_future();
+  {
+    lock_guard<mutex> lock(queueMutex);
+    tasks.push(std::move(packaged));
+  }
+  queueReady.notify_one();
+  return done;
+}
+
+void ThreadPool::Unlink(SliceJob &job) {
+  SliceJob **link = &jobs;
+  while (*link && *link != &job)
+    link = &(*link)->next;
+  if (*link)
+    *link = job.next;
+}
+
+// Called with queueMutex held, which it releases while the body runs
+void ThreadPool::RunSlice(SliceJob &job, int slice) {
+  int first = job.begin + (int)((long long)job.count * slice / job.slices);
+  int last = job.begin + (int)((long long)job.count * (slice + 1) / job.slices);
+  queueMutex.unlock();
+  job.run(job.body, first, last);
+  queueMutex.lock();
+  if (++job.finished == job.slices)
+    sliceDone.notify_all();
+}
+
+void ThreadPool::RunSlices(int begin, int end, int sliceCount,
+                           const void *body,
+                           void (*run)(const void *, int, int)) {
+  int count = end - begin;
+  if (count <= 0)
+    return;
+  if (sliceCount <= 0)
+    sliceCount = static_cast<int>(Size());
+  SliceJob job;
+  job.body = body;
+  job.run = run;
+  job.begin = begin;
+  job.count = count;
+  job.slices = min(sliceCount, count);
+
+  unique_lock<mutex> lock(queueMutex);
+  if (job.slices > 1) {
+    // Newest first: a nested call is finished before the outer one resumes
+    job.next = jobs;
+    jobs = &job;
+    queueReady.notify_all();
+  }
+  // The calling thread takes slices instead of idling. It only ever waits
+  // for slices already running, so a call from a task of this pool (even
+  // nested) cannot deadlock
+  while (job.claimed < job.slices) {
+    int slice = job.claimed++;
+    if (job.claimed == job.slices)
+      Unlink(job);
+    RunSlice(job, slice);
+  }
+  sliceDone.wait(lock, [&job] { return job.finished == job.slices; });
+}
+
+void ThreadPool::RunWorkerSlices(int begin, int end, const void *body,
+                                 void (*run)(const void *, unsigned, int,
+                                             int)) {
+  unsigned count = Size();
+  auto bound = [begin, end, count](unsigned w) {
+    return begin + (int)((long long)(end - begin) * w / count);
+  };
+  if (OnWorker()) {
+    // Slice w would wait behind this very task: run every slice here
+    for (unsigned w = 0; w < count; w++)
+      run(body, w, bound(w), bound(w + 1));
+    return;
+  }
+  WorkerJob job;
+  job.body = body;
+  job.run = run;
+  job.begin = begin;
+  job.count = end - begin;
+
+  unique_lock<mutex> lock(queueMutex);
+  // Oldest first, so every worker runs the calls in the order they came
+  job.sequence = ++workerJobCount;
+  WorkerJob **tail = &workerJobs;
+  while (*tail)
+    tail = &(*tail)->next;
+  *tail = &job;
+  queueReady.notify_all();
+  sliceDone.wait(lock, [&job, count] { return job.finished == count; });
+  WorkerJob **link = &workerJobs;
+  while (*link != &job)
+    link = &(*link)->next;
+  *link = job.next;
+}
+
+// Oldest call whose slice this worker has not run yet; queueMutex held
+ThreadPool::WorkerJob *ThreadPool::NextWorkerJob(unsigned index) const {
+  for (WorkerJob *job = workerJobs; job; job = job->next)
+    if (job->sequence > workerDone[index])
+      return job;
+  return nullptr;
+}
+
+bool ThreadPool::Pin(const vector<int> &cpus) {
+#ifdef __linux__
+  // Only the CPUs the process may use (taskset, cgroup cpuset)
+  cpu_set_t allowed;
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+    return false;
+  vector<int> usable;
+  for (int cpu : cpus)
+    if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed))
+      usable.push_back(cpu);
+  bool pinned = true;
+  for (size_t i = 0; i < workers.size(); i++) {
+    cpu_set_t set = allowed;
+    if (!usable.empty()) {
+      CPU_ZERO(&set);
+      CPU_SET(usable[i % usable.size()], &set);
+    }
+    pinned &= pthread_setaffinity_np(workers[i].native_handle(), sizeof(set),
+                                     &set) == 0;
+  }
+  return pinned;
+#else
+  return cpus.empty();
+#endif
+}
+
+bool ThreadPool::OnWorker() const { return currentPool == this; }
+
+void ThreadPool::WorkerLoop(unsigned index) {
+  TraceSetThreadName("Pool worker");
+  currentPool = this;
+  // workers may still be filling up; workerDone was sized before any start
+  unsigned count = (unsigned)workerDone.size();
+  while (true) {
+    packaged_task<void()> task;
+    {
+      unique_lock<mutex> lock(queueMutex);
+      WorkerJob *own = nullptr;
+      queueReady.wait(lock, [this, index, &own] {
+        own = NextWorkerJob(index);
+        return stopping || !tasks.empty() || own || jobs;
+      });
+      // Slices bound to this thread first, they hold up a ParallelForWorkers;
+      // then ParallelFor slices, whose callers are waiting
+      if (own) {
+        WorkerJob &job = *own;
+        workerDone[index] = job.sequence;
+        int first = job.begin + (int)((long long)job.count * index / count);
+        int last =
+            job.begin + (int)((long long)job.count * (index + 1) / count);
+        lock.unlock();
+        {
+          TRACE_SCOPE("Pool worker slice");
+          job.run(job.body, index, first, last);
+        }
+        lock.lock();
+        if (++job.finished == count)
+          sliceDone.notify_all();
+        continue;
+      }
+      if (jobs) {
+        SliceJob &job = *jobs;
+        int slice = job.claimed++;
+        if (job.claimed == job.slices)
+          Unlink(job);
+        TRACE_SCOPE("Pool slice");
+        RunSlice(job, slice);
+        continue;
+      }
+      if (stopping && tasks.empty())
+        return;
+      task = std::move(tasks.front());
+      tasks.pop();
+    }
+    TRACE_SCOPE("Pool task");
+    task();
+  }
+}
+
+ThreadPool &SharedThreadPool() {
+  static ThreadPool pool;
+  return pool;
+}
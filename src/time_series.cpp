@@ -0,0 +1,188 @@
+#include "time_series.h"
+#include <algorithm>
+#include <cmath>
+
+TimeSeries::TimeSeries(size_t capacity, int levelCount)
+    : pending(max(levelCount, 1)), hasPending(max(levelCount, 1), false) {
+  // Two buckets per level at least, so a level always holds the part of
+  // the history its parent has not completed yet
+  capacity = max<size_t>(capacity, 2);
+  levels.reserve(pending.size());
+  for (size_t k = 0; k < pending.size(); k++)
+    levels.emplace_back(capacity);
+}
+
+void TimeSeries::Append(float value) {
+  Bucket bucket = {value, value, value};
+  levels[0].Push(bucket);
+  count++;
+  // Each completed bucket either waits for its sibling or merges upward
+  for (size_t k = 1; k < levels.size(); k++) {
+    if (!hasPending[k]) {
+      pending[k] = bucket;
+      hasPending[k] = true;
+      break;
+    }
+    const Bucket &left = pending[k];
+    bucket = {min(left.min, bucket.min), max(left.max, bucket.max),
+              0.5f * (left.mean + bucket.mean)};
+    hasPending[k] = false;
+    levels[k].Push(bucket);
+  }
+}
+
+void TimeSeries::Clear() {
+  for (auto &level : levels)
+    level.Clear();
+  fill(hasPending.begin(), hasPending.end(), false);
+  count = 0;
+}
+
+uint64_t TimeSeries::First() const {
+  int top = (int)levels.size() - 1;
+  uint64_t complete = count >> top;
+  return (complete - levels[top].Size()) << top;
+}
+
+bool TimeSeries::Holds(int level, uint64_t bucket) const {
+  uint64_t complete = count >> level;
+  return bucket < complete && complete - bucket <= levels[level].Size();
+}
+
+const TimeSeries::Bucket &TimeSeries::At(int level, uint64_t bucket) const {
+  uint64_t oldest = (count >> level) - levels[level].Size();
+  return levels[level][bucket - oldest];
+}
+
+SeriesRange TimeSeries::Query(uint64_t first, uint64_t last) const {
+  SeriesRange range;
+  first = max(first, First());
+  last = min(last, count);
+  int top = (int)levels.size() - 1;
+  double sum = 0.0;
+  uint64_t i = first;
+  while (i < last) {
+    // Largest aligned block starting at i that stays inside the range
+    int k = 0;
+    while (k < top && (i & ((2ull << k) - 1)) == 0 && i + (2ull << k) <= last)
+      k++;
+    // Fine levels forget first: fall back on the enclosing coarse bucket
+    while (k < top && !Holds(k, i >> k))
+      k++;
+    if (!Holds(k, i >> k))
+      break;
+    const Bucket &bucket = At(k, i >> k);
+    uint64_t end = min(((i >> k) + 1) << k, last);
+    uint64_t weight = end - i;
+    range.min = range.count ? min(range.min, bucket.min) : bucket.min;
+    range.max = range.count ? max(range.max, bucket.max) : bucket.max;
+    sum += (double)bucket.mean * weight;
+    range.count += weight;
+    i = end;
+  }
+  if (range.count)
+    range.mean = (float)(sum / range.count);
+  return range;
+}
+
+void TimeSeries::Gather(uint64_t first, uint64_t last, size_t maxPoints,
+                        vector<SeriesPoint> &out) const {
+  out.clear();
+  first = max(first, First());
+  last = min(last, count);
+  if (first >= last)
+    return;
+
+  // Finest level with few enough buckets that still remembers the start
+  int top = (int)levels.size() - 1;
+  maxPoints = max<size_t>(maxPoints, 1);
+  int k = 0;
+  while (k < top && (((last - 1) >> k) - (first >> k) + 1 > maxPoints ||
+                     !Holds(k, first >> k)))
+    k++;
+
+  uint64_t size = 1ull << k;
+  for (uint64_t j = first >> k; j < (last >> k); j++) {
+    if (!Holds(k, j))
+      continue;
+    const Bucket &bucket = At(k, j);
+    SeriesPoint point;
+    point.x = (double)(j * size) + 0.5 * (double)(size - 1);
+    point.y = bucket.mean;
+    point.min = bucket.min;
+    point.max = bucket.max;
+    out.push_back(point);
+  }
+
+  // Samples after the last complete bucket come from the finer levels
+  uint64_t tail = max(first, (last >> k) << k);
+  if (tail < last) {
+    SeriesRange range = Query(tail, last);
+    if (range.count) {
+      SeriesPoint point;
+      point.x = 0.5 * (double)(tail + last - 1);
+      point.y = range.mean;
+      point.min = range.min;
+      point.max = range.max;
+      out.push_back(point);
+    }
+  }
+}
+
+size_t TimeSeries::MemoryBytes() const {
+  size_t bytes = 0;
+  for (const auto &level : levels)
+    bytes += level.Capacity() * sizeof(Bucket);
+  return bytes;
+}
+
+void DownsampleLTTB(const vector<SeriesPoint> &points, size_t target,
+                    vector<SeriesPoint> &out) {
+  out.clear();
+  size_t n = points.size();
+  if (target >= n || target < 3) {
+    out.assign(points.begin(), points.end());
+    return;
+  }
+
+  // Interior points split into target - 2 buckets of equal width
+  double every = (double)(n - 2) / (target - 2);
+  size_t previous = 0;
+  out.push_back(points[0]);
+  for (size_t b = 0; b < target - 2; b++) {
+    size_t start = (size_t)(b * every) + 1;
+    size_t end = min((size_t)((b + 1) * every) + 1, n - 1);
+    size_t nextStart = end;
+    size_t nextEnd = min((size_t)((b + 2) * every) + 1, n);
+
+    double averageX = 0.0, averageY = 0.0;
+    for (size_t i = nextStart; i < nextEnd; i++) {
+      averageX += points[i].x;
+      averageY += points[i].y;
+    }
+    size_t nextCount = max<size_t>(nextEnd - nextStart, 1);
+    averageX /= nextCount;
+    averageY /= nextCount;
+
+    const SeriesPoint &a = points[previous];
+    double bestArea = -1.0;
+    size_t best = start;
+    float low = points[start].min, high = points[start].max;
+    for (size_t i = start; i < end; i++) {
+      double area = fabs((a.x - averageX) * (points[i].y - a.y) -
+                         (a.x - points[i].x) * (averageY - a.y));
+      if (area > bestArea) {
+        bestArea = area;
+        best = i;
+      }
+      low = min(low, points[i].min);
+      high = max(high, points[i].max);
+    }
+    SeriesPoint chosen = points[best];
+    chosen.min = low;
+    chosen.max = high;
+    out.push_back(chosen);
+    previous = best;
+  }
+  out.push_back(points[n - 1]);
+}
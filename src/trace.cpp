@@ -0,0 +1,222 @@
+#include "trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#ifdef ISING_TRACE
+#include <atomic>
+#include <memory>
+#include <mutex>
+#endif
+
+int64_t TraceNow() {
+  using Clock = chrono::steady_clock;
+  static const Clock::time_point epoch = Clock::now();
+  return chrono::duration_cast<chrono::nanoseconds>(Clock::now() - epoch)
+      .count();
+}
+
+#ifdef ISING_TRACE
+
+static const uint64_t capacity = 1 << 15; // Zones kept per thread
+static const uint64_t mask = capacity - 1;
+
+struct TraceSlot {
+  atomic<const char *> name{nullptr};
+  atomic<int64_t> start{0};
+  atomic<int64_t> duration{0};
+  atomic<int> depth{0};
+};
+
+// Single writer (the owning thread), any number of readers. The writer
+// bumps claimed before overwriting a slot and head once it is complete;
+// readers copy slots first and check claimed afterwards (seqlock order),
+// dropping any slot the writer may have reached in the meantime.
+struct TraceBuffer {
+  int id = 0;
+  string name; // Guarded by the registry mutex
+  atomic<bool> owned{true};
+  atomic<uint64_t> claimed{0};
+  atomic<uint64_t> head{0};
+  TraceSlot slots[capacity];
+};
+
+struct TraceRegistry {
+  mutex lock;
+  vector<unique_ptr<TraceBuffer>> buffers; // Never freed, reused by id
+};
+
+// Leaked on purpose: pool threads may still close zones while statics
+// are destroyed at exit
+static TraceRegistry &Registry() {
+  static TraceRegistry *registry = new TraceRegistry;
+  return *registry;
+}
+
+// Buffers outlive their thread so the export still shows finished jobs;
+// a new thread takes over a released buffer before allocating one
+static TraceBuffer *AcquireBuffer() {
+  TraceRegistry &registry = Registry();
+  lock_guard<mutex> guard(registry.lock);
+  for (auto &buffer : registry.buffers) {
+    bool released = false;
+    if (buffer->owned.compare_exchange_strong(released, true)) {
+      buffer->name = "Thread " + to_string(buffer->id);
+      return buffer.get();
+    }
+  }
+  auto buffer = make_unique<TraceBuffer>();
+  buffer->id = (int)registry.buffers.size() + 1;
+  buffer->name = "Thread " + to_string(buffer->id);
+  registry.buffers.push_back(std::move(buffer));
+  return registry.buffers.back().get();
+}
+
+struct BufferOwner {
+  TraceBuffer *buffer = nullptr;
+  ~BufferOwner() {
+    if (buffer)
+      buffer->owned.store(false, memory_order_release);
+  }
+};
+
+static thread_local BufferOwner localOwner;
+// Open zones of the calling thread; deeper ones are counted, not timed
+static const int maxDepth = 64;
+struct OpenZone {
+  const char *name;
+  int64_t start;
+};
+static thread_local OpenZone openZones[maxDepth];
+static thread_local int localDepth = 0;
+
+static TraceBuffer &LocalBuffer() {
+  if (!localOwner.buffer)
+    localOwner.buffer = AcquireBuffer();
+  return *localOwner.buffer;
+}
+
+void TraceBegin(const char *name) {
+  if (localDepth < maxDepth)
+    openZones[localDepth] = {name, TraceNow()};
+  localDepth++;
+}
+
+void TraceEnd() {
+  int depth = --localDepth;
+  if (depth < 0 || depth >= maxDepth) {
+    localDepth = max(localDepth, 0);
+    return;
+  }
+  int64_t end = TraceNow();
+  const OpenZone &zone = openZones[depth];
+  TraceBuffer &buffer = LocalBuffer();
+  uint64_t index = buffer.head.load(memory_order_relaxed);
+  buffer.claimed.store(index + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  TraceSlot &slot = buffer.slots[index & mask];
+  slot.name.store(zone.name, memory_order_relaxed);
+  slot.start.store(zone.start, memory_order_relaxed);
+  slot.duration.store(end - zone.start, memory_order_relaxed);
+  slot.depth.store(depth, memory_order_relaxed);
+  buffer.head.store(index + 1, memory_order_release);
+}
+
+void TraceSetThreadName(const char *name) {
+  TraceBuffer &buffer = LocalBuffer();
+  lock_guard<mutex> guard(Registry().lock);
+  buffer.name = name;
+}
+
+void TraceSnapshot(int64_t since, vector<TraceThread> &threads) {
+  TraceRegistry &registry = Registry();
+  lock_guard<mutex> guard(registry.lock);
+  threads.resize(registry.buffers.size());
+  for (size_t b = 0; b < registry.buffers.size(); b++) {
+    TraceBuffer *buffer = registry.buffers[b].get();
+    uint64_t head = buffer->head.load(memory_order_acquire);
+    uint64_t first = head > capacity ? head - capacity : 0;
+    TraceThread &thread = threads[b];
+    thread.id = buffer->id;
+    thread.name = buffer->name;
+    thread.events.clear();
+
+    // Newest first: zones end in order, so stop at the first older one
+    uint64_t index = head;
+    while (index > first) {
+      const TraceSlot &slot = buffer->slots[(index - 1) & mask];
+      TraceEvent event;
+      event.name = slot.name.load(memory_order_relaxed);
+      event.start = slot.start.load(memory_order_relaxed);
+      event.duration = slot.duration.load(memory_order_relaxed);
+      event.depth = slot.depth.load(memory_order_relaxed);
+      if (event.start + event.duration < since)
+        break;
+      thread.events.push_back(event);
+      index--;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t claimed = buffer->claimed.load(memory_order_relaxed);
+    uint64_t valid = claimed > capacity ? claimed - capacity : 0;
+    // events[k] was read from slot head - 1 - k
+    while (!thread.events.empty() && head - thread.events.size() < valid)
+      thread.events.pop_back();
+    reverse(thread.events.begin(), thread.events.end());
+  }
+}
+
+#else
+
+void TraceSetThreadName(const char *) {}
+
+void TraceSnapshot(int64_t, vector<TraceThread> &threads) { threads.clear(); }
+
+#endif // ISING_TRACE
+
+static string JsonString(const char *text) {
+  string quoted = "\"";
+  for (const char *c = text ? text : ""; *c; c++) {
+    if (*c == '"' || *c == '\\')
+      quoted += '\\';
+    if ((unsigned char)*c >= 0x20)
+      quoted += *c;
+  }
+  return quoted + "\"";
+}
+
+bool WriteChromeTrace(const string &path) {
+  vector<TraceThread> threads;
+  TraceSnapshot(0, threads);
+  threads.erase(remove_if(threads.begin(), threads.end(),
+                          [](const TraceThread &thread) {
+                            return thread.events.empty();
+                          }),
+                threads.end());
+  if (threads.empty())
+    return false;
+  FILE *file = fopen(path.c_str(), "w");
+  if (!file)
+    return false;
+
+  fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+  bool first = true;
+  for (const TraceThread &thread : threads) {
+    fprintf(file,
+            "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+            "\"tid\": %d, \"args\": {\"name\": %s}}",
+            first ? "" : ",\n", thread.id,
+            JsonString(thread.name.c_str()).c_str());
+    first = false;
+    for (const TraceEvent &event : thread.events) {
+      // Timestamps in microseconds, as the format expects
+      fprintf(file,
+              ",\n{\"name\": %s, \"ph\": \"X\", \"pid\": 1, \"tid\": %d, "
+              "\"ts\": %.3f, \"dur\": %.3f}",
+              JsonString(event.name).c_str(), thread.id, event.start / 1e3,
+              event.duration / 1e3);
+    }
+  }
+  fprintf(file, "\n]}\n");
+  return fclose(file) == 0;
+}
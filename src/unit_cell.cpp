@@ -0,0 +1,243 @@
+#include "unit_cell.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+bool LoadUnitCell(const string &path, UnitCell &cell, string &error) {
+  ifstream file(path);
+  if (!file) {
+    error = "Cannot open " + path;
+    return false;
+  }
+
+  UnitCell parsed;
+  parsed.name = filesystem::path(path).stem().string();
+  int vectorCount = 0;
+  string line;
+  int lineNumber = 0;
+  while (getline(file, line)) {
+    lineNumber++;
+    size_t comment = line.find('#');
+    if (comment != string::npos)
+      line.erase(comment);
+
+    istringstream fields(line);
+    string directive;
+    if (!(fields >> directive))
+      continue;
+
+    bool ok = true;
+    if (directive == "name") {
+      getline(fields >> ws, parsed.name);
+    } else if (directive == "vector") {
+      Vector3 v;
+      ok = vectorCount < 3 && (fields >> v.x >> v.y >> v.z);
+      if (ok)
+        parsed.vectors[vectorCount++] = v;
+    } else if (directive == "basis") {
+      Vector3 b;
+      ok = static_cast<bool>(fields >> b.x >> b.y >> b.z);
+      if (ok)
+        parsed.basis.push_back(b);
+    } else if (directive == "shell") {
+      float radius, coupling = 1.0f;
+      ok = static_cast<bool>(fields >> radius) && radius > 0.0f;
+      fields >> coupling;
+      if (ok) {
+        parsed.shellDistance.push_back(radius);
+        parsed.shellCoupling.push_back(coupling);
+      }
+    } else {
+      ok = false;
+    }
+
+    if (!ok) {
+      error = path + ":" + to_string(lineNumber) + ": invalid '" + directive +
+              "' line";
+      return false;
+    }
+  }
+
+  if (vectorCount != 3 || parsed.basis.empty() ||
+      parsed.shellDistance.empty() || parsed.shellDistance.size() > 255) {
+    error = path + ": needs 3 vectors, at least one basis and 1-255 shells";
+    return false;
+  }
+
+  DeriveNeighborOffsets(parsed);
+  cell = std::move(parsed);
+  return true;
+}
+
+vector<string> ListUnitCellFiles(const string &directory) {
+  vector<string> files;
+  error_code error;
+  for (const auto &entry : filesystem::directory_iterator(directory, error)) {
+    if (entry.path().extension() == ".cell")
+      files.push_back(entry.path().string());
+  }
+  sort(files.begin(), files.end());
+  return files;
+}
+
+// Cartesian position of basis site b in cell (i, j, k), unscaled
+static Vector3 CellPosition(const UnitCell &cell, float i, float j, float k,
+                            int b) {
+  Vector3 f = {i + cell.basis[b].x, j + cell.basis[b].y, k + cell.basis[b].z};
+  return Vector3Add(
+      Vector3Add(Vector3Scale(cell.vectors[0], f.x),
+                 Vector3Scale(cell.vectors[1], f.y)),
+      Vector3Scale(cell.vectors[2], f.z));
+}
+
+void DeriveNeighborOffsets(UnitCell &cell) {
+  const float tolerance = 1e-3f;
+  float maxShell =
+      *max_element(cell.shellDistance.begin(), cell.shellDistance.end());
+  float minVector = min({Vector3Length(cell.vectors[0]),
+                         Vector3Length(cell.vectors[1]),
+                         Vector3Length(cell.vectors[2])});
+  // Enough neighboring cells to contain the outermost shell
+  int reach = static_cast<int>(ceilf(maxShell / minVector)) + 1;
+
+  int basisCount = static_cast<int>(cell.basis.size());
+  cell.neighbors.assign(basisCount, {});
+  for (int b = 0; b < basisCount; b++) {
+    Vector3 origin = CellPosition(cell, 0, 0, 0, b);
+    for (int dx = -reach; dx <= reach; dx++) {
+      for (int dy = -reach; dy <= reach; dy++) {
+        for (int dz = -reach; dz <= reach; dz++) {
+          for (int target = 0; target < basisCount; target++) {
+            if (dx == 0 && dy == 0 && dz == 0 && target == b)
+              continue;
+            float d = Vector3Distance(
+                origin, CellPosition(cell, dx, dy, dz, target));
+            for (size_t shell = 0; shell < cell.shellDistance.size();
+                 shell++) {
+              if (fabsf(d - cell.shellDistance[shell]) < tolerance) {
+                cell.neighbors[b].push_back(
+                    {dx, dy, dz, target, static_cast<int>(shell)});
+                break;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+LatticeTopology BuildUnitCellLattice(const UnitCell &cell, int x, int y,
+                                     int z, float distance, bool periodic,
+                                     BuildProgress *progress) {
+  LatticeTopology topology;
+  const int basisCount = static_cast<int>(cell.basis.size());
+  const long long cellCount = (long long)x * y * z;
+  const size_t siteCount = cellCount * basisCount;
+  if (siteCount == 0 || siteCount > (size_t)INT32_MAX)
+    return topology;
+
+  // Neighbor site of (i, j, k, b) through offset n, or -1 past an open edge
+  auto neighborSite = [&](int i, int j, int k, const CellNeighbor &n) {
+    int ni = i + n.dx, nj = j + n.dy, nk = k + n.dz;
+    if (periodic) {
+      ni = ((ni % x) + x) % x;
+      nj = ((nj % y) + y) % y;
+      nk = ((nk % z) + z) % z;
+    } else if (ni < 0 || ni >= x || nj < 0 || nj >= y || nk < 0 ||
+               nk >= z) {
+      return -1;
+    }
+    return static_cast<int>(((long long)(ni * y + nj) * z + nk) * basisCount +
+                            n.basis);
+  };
+  auto site = [&](int i, int j, int k, int b) {
+    return static_cast<int>(((long long)(i * y + j) * z + k) * basisCount + b);
+  };
+  auto cancelled = [&] { return progress && progress->cancelled.load(); };
+
+  ThreadPool &pool = SharedThreadPool();
+  topology.positions.resize(siteCount);
+  topology.offsets.assign(siteCount + 1, 0);
+
+  // Pass 1: positions and neighbor counts, slab by slab along x
+  pool.ParallelFor(0, x, [&](int first, int last) {
+    for (int i = first; i < last && !cancelled(); i++) {
+      for (int j = 0; j < y; j++) {
+        for (int k = 0; k < z; k++) {
+          for (int b = 0; b < basisCount; b++) {
+            int s = site(i, j, k, b);
+            topology.positions[s] =
+                Vector3Scale(CellPosition(cell, i, j, k, b), distance);
+            int count = 0;
+            for (const auto &n : cell.neighbors[b]) {
+              int target = neighborSite(i, j, k, n);
+              count += (target >= 0 && target != s);
+            }
+            topology.offsets[s + 1] = count;
+          }
+        }
+      }
+    }
+  });
+  if (cancelled())
+    return {};
+  if (progress)
+    progress->fraction = progress->phaseStart + 0.4f * progress->phaseSpan;
+
+  for (size_t s = 0; s < siteCount; s++) {
+    topology.offsets[s + 1] += topology.offsets[s];
+  }
+  topology.neighbors.resize(topology.offsets[siteCount]);
+  if (cell.shellDistance.size() > 1)
+    topology.shells.resize(topology.offsets[siteCount]);
+
+  // Pass 2: each site writes its own CSR row, no synchronisation needed
+  pool.ParallelFor(0, x, [&](int first, int last) {
+    for (int i = first; i < last && !cancelled(); i++) {
+      for (int j = 0; j < y; j++) {
+        for (int k = 0; k < z; k++) {
+          for (int b = 0; b < basisCount; b++) {
+            int s = site(i, j, k, b);
+            int slot = topology.offsets[s];
+            for (const auto &n : cell.neighbors[b]) {
+              int target = neighborSite(i, j, k, n);
+              if (target < 0 || target == s)
+                continue;
+              if (!topology.shells.empty())
+                topology.shells[slot] = static_cast<uint8_t>(n.shell);
+              topology.neighbors[slot++] = target;
+            }
+          }
+        }
+      }
+    }
+  });
+  if (cancelled())
+    return {};
+  if (progress)
+    progress->fraction = progress->phaseStart + progress->phaseSpan;
+  return topology;
+}
+
+vector<Atome> ToAtoms(const LatticeTopology &topology, const UnitCell &cell) {
+  vector<Atome> structure = ToAtoms(topology);
+  bool uniform = all_of(cell.shellCoupling.begin(), cell.shellCoupling.end(),
+                        [](float c) { return c == 1.0f; });
+  if (uniform)
+    return structure;
+
+  for (size_t i = 0; i < structure.size(); i++) {
+    auto &atom = structure[i];
+    atom.coupling.resize(atom.neigh.size());
+    for (size_t n = 0; n < atom.neigh.size(); n++) {
+      int shell =
+          topology.shells.empty() ? 0 : topology.shells[topology.offsets[i] + n];
+      atom.coupling[n] = cell.shellCoupling[shell];
+    }
+  }
+  return structure;
+}
@@ -0,0 +1,633 @@
+#include "user_store.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+static const char storeMagic[4] = {'I', 'S', 'U', 'S'};
+static const uint32_t storeVersion = 1;
+static const size_t initialCapacity = 64;
+static const size_t maxCapacity = size_t(1) << 24;
+static const int maxKdfLogN = 20;
+static const uint64_t maxKdfBytes = uint64_t(1) << 30; // ROMix table
+
+// Fixed-size header in front of the slots of users.db
+struct StoreHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t recordBytes; // Guards against a layout change
+  uint32_t capacity;
+  uint32_t count;
+};
+
+// SHA-256 (FIPS 180-4), only what HMAC and PBKDF2 need
+class Sha256 {
+public:
+  Sha256() { Reset(); }
+
+  void Reset() {
+    static const uint32_t initial[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372,
+                                        0xa54ff53a, 0x510e527f, 0x9b05688c,
+                                        0x1f83d9ab, 0x5be0cd19};
+    memcpy(state, initial, sizeof(state));
+    used = 0;
+    total = 0;
+  }
+
+  void Update(const uint8_t *data, size_t size) {
+    total += size;
+    while (size > 0) {
+      size_t chunk = min(size, sizeof(block) - used);
+      memcpy(block + used, data, chunk);
+      used += chunk;
+      data += chunk;
+      size -= chunk;
+      if (used == sizeof(block)) {
+        Compress(block);
+        used = 0;
+      }
+    }
+  }
+
+  void Final(uint8_t digest[32]) {
+    uint64_t bits = total * 8;
+    uint8_t pad = 0x80;
+    Update(&pad, 1);
+    pad = 0;
+    while (used != 56)
+      Update(&pad, 1);
+    uint8_t length[8];
+    for (int i = 0; i < 8; i++)
+      length[i] = static_cast<uint8_t>(bits >> (56 - 8 * i));
+    Update(length, 8);
+    for (int i = 0; i < 8; i++)
+      for (int b = 0; b < 4; b++)
+        digest[4 * i + b] = static_cast<uint8_t>(state[i] >> (24 - 8 * b));
+  }
+
+private:
+  static uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+  void Compress(const uint8_t *chunk) {
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1,
+        0x923f82a4, 0xab1c5ed5, 0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174, 0xe49b69c1, 0xefbe4786,
+        0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147,
+        0x06ca6351, 0x14292967, 0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85, 0xa2bfe8a1, 0xa81a664b,
+        0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a,
+        0x5b9cca4f, 0x682e6ff3, 0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+      w[i] = (uint32_t)chunk[4 * i] << 24 | (uint32_t)chunk[4 * i + 1] << 16 |
+             (uint32_t)chunk[4 * i + 2] << 8 | chunk[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+      uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+      uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+      w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t v[8];
+    memcpy(v, state, sizeof(v));
+    for (int i = 0; i < 64; i++) {
+      uint32_t s1 = Rotr(v[4], 6) ^ Rotr(v[4], 11) ^ Rotr(v[4], 25);
+      uint32_t choose = (v[4] & v[5]) ^ (~v[4] & v[6]);
+      uint32_t t1 = v[7] + s1 + choose + k[i] + w[i];
+      uint32_t s0 = Rotr(v[0], 2) ^ Rotr(v[0], 13) ^ Rotr(v[0], 22);
+      uint32_t majority = (v[0] & v[1]) ^ (v[0] & v[2]) ^ (v[1] & v[2]);
+      memmove(v + 1, v, 7 * sizeof(uint32_t));
+      v[4] += t1;
+      v[0] = t1 + s0 + majority;
+    }
+    for (int i = 0; i < 8; i++)
+      state[i] += v[i];
+  }
+
+  uint32_t state[8];
+  uint8_t block[64];
+  size_t used;
+  uint64_t total;
+};
+
+// PBKDF2-HMAC-SHA256 with a single iteration, the only count scrypt uses.
+// The padded key states are hashed once and copied for every output block
+static void Pbkdf2Once(const string &password, const uint8_t *salt,
+                       size_t saltBytes, uint8_t *out, size_t outBytes) {
+  uint8_t key[64] = {0};
+  if (password.size() > sizeof(key)) {
+    Sha256 hash;
+    hash.Update(reinterpret_cast<const uint8_t *>(password.data()),
+                password.size());
+    hash.Final(key);
+  } else {
+    memcpy(key, password.data(), password.size());
+  }
+  uint8_t pad[64];
+  Sha256 inner, outer;
+  for (int i = 0; i < 64; i++)
+    pad[i] = key[i] ^ 0x36;
+  inner.Update(pad, sizeof(pad));
+  for (int i = 0; i < 64; i++)
+    pad[i] = key[i] ^ 0x5c;
+  outer.Update(pad, sizeof(pad));
+
+  for (uint32_t index = 1; outBytes > 0; index++) {
+    uint8_t counter[4] = {static_cast<uint8_t>(index >> 24),
+                          static_cast<uint8_t>(index >> 16),
+                          static_cast<uint8_t>(index >> 8),
+                          static_cast<uint8_t>(index)};
+    uint8_t digest[32];
+    Sha256 hash = inner;
+    hash.Update(salt, saltBytes);
+    hash.Update(counter, sizeof(counter));
+    hash.Final(digest);
+    hash = outer;
+    hash.Update(digest, sizeof(digest));
+    hash.Final(digest);
+    size_t chunk = min(outBytes, sizeof(digest));
+    memcpy(out, digest, chunk);
+    out += chunk;
+    outBytes -= chunk;
+  }
+}
+
+static uint32_t Rotl(uint32_t x, int n) { return (x << n) | (x >> (32 - n)); }
+
+static void QuarterRound(uint32_t *x, int a, int b, int c, int d) {
+  x[b] ^= Rotl(x[a] + x[d], 7);
+  x[c] ^= Rotl(x[b] + x[a], 9);
+  x[d] ^= Rotl(x[c] + x[b], 13);
+  x[a] ^= Rotl(x[d] + x[c], 18);
+}
+
+// Salsa20/8 core, in place on one 64-byte block
+static void Salsa20_8(uint32_t block[16]) {
+  uint32_t x[16];
+  memcpy(x, block, sizeof(x));
+  for (int round = 0; round < 8; round += 2) {
+    QuarterRound(x, 0, 4, 8, 12); // Columns
+    QuarterRound(x, 5, 9, 13, 1);
+    QuarterRound(x, 10, 14, 2, 6);
+    QuarterRound(x, 15, 3, 7, 11);
+    QuarterRound(x, 0, 1, 2, 3); // Rows
+    QuarterRound(x, 5, 6, 7, 4);
+    QuarterRound(x, 10, 11, 8, 9);
+    QuarterRound(x, 15, 12, 13, 14);
+  }
+  for (int i = 0; i < 16; i++)
+    block[i] += x[i];
+}
+
+// BlockMix: 2r blocks chained through Salsa20/8, even outputs first
+static void BlockMix(const uint32_t *in, uint32_t *out, int r) {
+  uint32_t x[16];
+  memcpy(x, in + (2 * r - 1) * 16, sizeof(x));
+  for (int i = 0; i < 2 * r; i++) {
+    for (int w = 0; w < 16; w++)
+      x[w] ^= in[i * 16 + w];
+    Salsa20_8(x);
+    memcpy(out + ((i % 2) * r + i / 2) * 16, x, sizeof(x));
+  }
+}
+
+// ROMix on 32r words: N sequential states, then N data-dependent reads
+static void RoMix(uint32_t *block, int r, uint64_t n, vector<uint32_t> &v,
+                  vector<uint32_t> &scratch) {
+  size_t words = 32 * (size_t)r;
+  v.resize(words * n);
+  scratch.resize(words);
+  uint32_t *x = block;
+  for (uint64_t i = 0; i < n; i++) {
+    memcpy(&v[words * i], x, words * sizeof(uint32_t));
+    BlockMix(x, scratch.data(), r);
+    memcpy(x, scratch.data(), words * sizeof(uint32_t));
+  }
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t j = x[(2 * r - 1) * 16] & (n - 1); // Integerify
+    for (size_t w = 0; w < words; w++)
+      x[w] ^= v[words * j + w];
+    BlockMix(x, scratch.data(), r);
+    memcpy(x, scratch.data(), words * sizeof(uint32_t));
+  }
+}
+
+bool ValidKdfCost(const KdfCost &cost) {
+  return cost.logN >= 1 && cost.logN <= maxKdfLogN && cost.r >= 1 &&
+         cost.r <= 16 && cost.p >= 1 && cost.p <= 16 &&
+         (128ull * cost.r << cost.logN) <= maxKdfBytes;
+}
+
+bool Scrypt(const string &password, const uint8_t *salt, size_t saltBytes,
+            const KdfCost &cost, uint8_t *key, size_t keyBytes) {
+  if (!ValidKdfCost(cost))
+    return false;
+  int r = cost.r, p = cost.p;
+  uint64_t n = 1ull << cost.logN;
+  size_t blockBytes = 128 * (size_t)r;
+  vector<uint8_t> bytes(blockBytes * p);
+  Pbkdf2Once(password, salt, saltBytes, bytes.data(), bytes.size());
+
+  // Words are little-endian in the specification
+  vector<uint32_t> words(bytes.size() / 4), v, scratch;
+  for (size_t i = 0; i < words.size(); i++)
+    words[i] = (uint32_t)bytes[4 * i] | (uint32_t)bytes[4 * i + 1] << 8 |
+               (uint32_t)bytes[4 * i + 2] << 16 |
+               (uint32_t)bytes[4 * i + 3] << 24;
+  for (int i = 0; i < p; i++)
+    RoMix(&words[i * blockBytes / 4], r, n, v, scratch);
+  for (size_t i = 0; i < words.size(); i++)
+    for (int b = 0; b < 4; b++)
+      bytes[4 * i + b] = static_cast<uint8_t>(words[i] >> (8 * b));
+  Pbkdf2Once(password, bytes.data(), bytes.size(), key, keyBytes);
+  return true;
+}
+
+KdfCost KdfCostFromEnvironment() {
+  KdfCost cost;
+  if (const char *value = getenv("ISING_SCRYPT_LOGN")) {
+    int logN = atoi(value);
+    if (logN >= 10 && logN <= maxKdfLogN)
+      cost.logN = static_cast<uint8_t>(logN);
+  }
+  return cost;
+}
+
+string LegacyPasswordHash(const string &input) {
+  // Rotate-multiply hash of the original users.txt, seed 131
+  unsigned int hash = 0;
+  for (char c : input) {
+    hash = (hash * 131u) + c;
+    hash = (hash << 3) | (hash >> 29);
+  }
+  char hex[9];
+  snprintf(hex, sizeof(hex), "%08x", hash);
+  return string(hex);
+}
+
+// No early exit: the time does not tell how many bytes matched
+static bool SameBytes(const uint8_t *a, const uint8_t *b, size_t size) {
+  uint8_t difference = 0;
+  for (size_t i = 0; i < size; i++)
+    difference |= a[i] ^ b[i];
+  return difference == 0;
+}
+
+static bool Weaker(const KdfCost &stored, const KdfCost &wanted) {
+  return stored.logN < wanted.logN || stored.r < wanted.r ||
+         stored.p < wanted.p;
+}
+
+// Advisory lock on path.lock, a file that is never replaced: the store
+// itself is renamed over when the table grows
+class StoreLock {
+public:
+  StoreLock(const string &path, bool exclusive) {
+#ifndef _WIN32
+    fd = open((path + ".lock").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd >= 0 && flock(fd, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+      close(fd);
+      fd = -1;
+    }
+#else
+    fd = 0; // No lock: a single instance is assumed
+#endif
+  }
+  StoreLock(const StoreLock &) = delete;
+  StoreLock &operator=(const StoreLock &) = delete;
+  ~StoreLock() {
+#ifndef _WIN32
+    if (fd >= 0)
+      close(fd); // Releases the flock
+#endif
+  }
+
+  bool Held() const { return fd >= 0; }
+
+private:
+  int fd = -1;
+};
+
+static bool ValidHeader(const StoreHeader &header) {
+  return memcmp(header.magic, storeMagic, sizeof(storeMagic)) == 0 &&
+         header.version == storeVersion && header.capacity > 0 &&
+         header.capacity <= maxCapacity &&
+         (header.capacity & (header.capacity - 1)) == 0 &&
+         (size_t)header.count * 2 <= header.capacity;
+}
+
+bool UserStore::ValidRecord(Record &record) {
+  record.name[maxNameBytes] = '\0';
+  switch (record.kind) {
+  case FREE:
+    return true;
+  case LEGACY:
+    return record.name[0] != '\0';
+  case SCRYPT:
+    return record.name[0] != '\0' && ValidKdfCost(record.cost);
+  }
+  return false;
+}
+
+size_t UserStore::Home(const string &name) const {
+  uint64_t hash = 1469598103934665603ull; // FNV-1a
+  for (char c : name)
+    hash = (hash ^ (uint8_t)c) * 1099511628211ull;
+  return hash & (records.size() - 1);
+}
+
+// Load and Refresh guarantee a free slot, so the probe ends
+size_t UserStore::Slot(const string &name) const {
+  size_t mask = records.size() - 1;
+  size_t slot = Home(name);
+  while (records[slot].kind != FREE &&
+         strncmp(records[slot].name, name.c_str(), sizeof(Record::name)) != 0)
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+void UserStore::Hash(Record &record, const string &password) const {
+  random_device device;
+  for (uint8_t &byte : record.salt)
+    byte = static_cast<uint8_t>(device());
+  record.kind = SCRYPT;
+  record.cost = cost;
+  Scrypt(password, record.salt, sizeof(record.salt), cost, record.hash,
+         sizeof(record.hash));
+}
+
+void UserStore::Insert(const Record &record) {
+  if ((count + 1) * 2 > records.size()) {
+    // Keep the table at most half full: short probe sequences
+    vector<Record> old = move(records);
+    records.assign(old.size() * 2, Record{});
+    count = 0;
+    for (const Record &kept : old)
+      if (kept.kind != FREE)
+        Insert(kept);
+  }
+  records[Slot(record.name)] = record;
+  count++;
+}
+
+bool UserStore::Load(string &error) {
+  ifstream file(path, ios::binary);
+  StoreHeader header;
+  if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.recordBytes != sizeof(Record) || !ValidHeader(header)) {
+    error = path + " is not a user store";
+    return false;
+  }
+  vector<Record> loaded(header.capacity);
+  if (!file.read(reinterpret_cast<char *>(loaded.data()),
+                 loaded.size() * sizeof(Record))) {
+    error = path + " is truncated";
+    return false;
+  }
+  size_t used = 0;
+  for (Record &record : loaded) {
+    if (!ValidRecord(record)) {
+      error = path + " is corrupt";
+      return false;
+    }
+    used += record.kind != FREE;
+  }
+  // The header bound then also leaves a free slot for every probe
+  if (used != header.count) {
+    error = path + " is corrupt";
+    return false;
+  }
+  records = move(loaded);
+  count = used;
+  return true;
+}
+
+bool UserStore::Refresh(const string &name, string &error) {
+  ifstream file(path, ios::binary);
+  StoreHeader header;
+  if (!file || !file.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+      header.recordBytes != sizeof(Record) || !ValidHeader(header)) {
+    error = path + " is not a user store";
+    return false;
+  }
+  if (header.capacity != records.size())
+    return Load(error); // Grown by another instance: every slot moved
+  // Only the probe sequence of name can have changed for this lookup
+  size_t mask = records.size() - 1;
+  size_t slot = Home(name);
+  for (size_t probe = 0; probe < records.size(); probe++) {
+    Record record;
+    file.seekg(sizeof(header) + slot * sizeof(Record));
+    if (!file.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+      error = path + " is truncated";
+      return false;
+    }
+    if (!ValidRecord(record)) {
+      error = path + " is corrupt";
+      return false;
+    }
+    records[slot] = record;
+    if (record.kind == FREE ||
+        strncmp(record.name, name.c_str(), sizeof(Record::name)) == 0) {
+      count = header.count;
+      return true;
+    }
+    slot = (slot + 1) & mask;
+  }
+  error = path + " has no free slot";
+  return false;
+}
+
+bool UserStore::WriteAll(const string &target, string &error) const {
+  string temporary = target + ".tmp";
+  {
+    ofstream file(temporary, ios::binary);
+    StoreHeader header;
+    memcpy(header.magic, storeMagic, sizeof(storeMagic));
+    header.version = storeVersion;
+    header.recordBytes = sizeof(Record);
+    header.capacity = (uint32_t)records.size();
+    header.count = (uint32_t)count;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(records.data()),
+               records.size() * sizeof(Record));
+    if (!file.flush()) {
+      error = "Cannot write " + temporary;
+      return false;
+    }
+  }
+  std::error_code code;
+  filesystem::rename(temporary, target, code);
+  if (code) {
+    error = "Cannot rename " + temporary + ": " + code.message();
+    return false;
+  }
+  return true;
+}
+
+bool UserStore::WriteRecord(size_t slot, string &error) {
+  fstream file(path, ios::in | ios::out | ios::binary);
+  StoreHeader header;
+  if (!file ||
+      !file.read(reinterpret_cast<char *>(&header), sizeof(header))) {
+    error = "Cannot update " + path;
+    return false;
+  }
+  header.count = (uint32_t)count;
+  file.seekp(0);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  file.seekp(sizeof(header) + slot * sizeof(Record));
+  file.write(reinterpret_cast<const char *>(&records[slot]), sizeof(Record));
+  if (!file.flush()) {
+    error = "Cannot update " + path;
+    return false;
+  }
+  return true;
+}
+
+bool UserStore::Open(const string &storePath, const string &legacyPath,
+                     string &error) {
+  path = storePath;
+  records.assign(initialCapacity, Record{});
+  count = 0;
+  // Exclusive: two first starts must not both import users.txt
+  StoreLock lock(path, true);
+  if (!lock.Held()) {
+    error = "Cannot lock " + path;
+    return false;
+  }
+  if (ifstream(path, ios::binary))
+    return Load(error);
+
+  // First start: import the text file of the previous versions
+  ifstream legacy(legacyPath);
+  string line;
+  while (getline(legacy, line)) {
+    if (!line.empty() && line.back() == '\r')
+      line.pop_back();
+    size_t colon = line.rfind(':');
+    string name = line.substr(0, colon == string::npos ? 0 : colon);
+    string hash = colon == string::npos ? "" : line.substr(colon + 1);
+    if (name.empty() || name.size() > maxNameBytes || hash.size() != 8 ||
+        records[Slot(name)].kind != FREE)
+      continue; // Malformed, or a duplicate: the first line wins
+    Record record{};
+    memcpy(record.name, name.data(), name.size());
+    record.kind = LEGACY;
+    memcpy(record.hash, hash.data(), hash.size());
+    Insert(record);
+  }
+  return WriteAll(path, error);
+}
+
+size_t UserStore::LegacyCount() const {
+  size_t legacy = 0;
+  for (const Record &record : records)
+    legacy += record.kind == LEGACY;
+  return legacy;
+}
+
+bool UserStore::Verify(const string &name, const string &password,
+                       string &error) {
+  error = "Invalid username or password!";
+  if (name.empty() || name.size() > maxNameBytes || records.empty()) {
+    return false;
+  }
+  Record record;
+  {
+    // Accounts registered by another instance since Open are visible
+    StoreLock lock(path, false);
+    string readError;
+    if (!lock.Held() || !Refresh(name, readError)) {
+      error = lock.Held() ? readError : "Cannot lock " + path;
+      return false;
+    }
+    record = records[Slot(name)];
+  }
+  uint8_t derived[sizeof(Record::hash)];
+  bool valid = false;
+  if (record.kind == LEGACY) {
+    string legacy = LegacyPasswordHash(password);
+    valid = SameBytes(reinterpret_cast<const uint8_t *>(legacy.data()),
+                      record.hash, legacy.size());
+  } else {
+    // Unknown names cost the same as known ones
+    static const uint8_t decoy[16] = {0};
+    bool known = record.kind == SCRYPT;
+    valid = Scrypt(password, known ? record.salt : decoy, sizeof(record.salt),
+                   known ? record.cost : cost, derived, sizeof(derived)) &&
+            known && SameBytes(derived, record.hash, sizeof(derived));
+  }
+  if (!valid)
+    return false;
+  error.clear();
+  if (record.kind == LEGACY || Weaker(record.cost, cost)) {
+    // Upgrade; the login stands even if it cannot be written
+    Record upgraded = record;
+    Hash(upgraded, password);
+    StoreLock lock(path, true);
+    string writeError;
+    if (lock.Held() && Refresh(name, writeError)) {
+      size_t slot = Slot(name);
+      // Unless another instance changed this account in the meantime
+      if (records[slot].kind == record.kind &&
+          memcmp(records[slot].hash, record.hash, sizeof(record.hash)) == 0) {
+        records[slot] = upgraded;
+        if (!WriteRecord(slot, writeError))
+          records[slot] = record;
+      }
+    }
+  }
+  return true;
+}
+
+bool UserStore::Add(const string &name, const string &password,
+                    string &error) {
+  if (name.empty() || password.empty()) {
+    error = "Username and password required!";
+    return false;
+  }
+  if (name.size() > maxNameBytes) {
+    error = "Username too long!";
+    return false;
+  }
+  if (records.empty()) {
+    error = "No user store";
+    return false;
+  }
+  // Hashed before taking the lock, which other instances may be waiting on
+  Record record{};
+  memcpy(record.name, name.data(), name.size());
+  Hash(record, password);
+
+  StoreLock lock(path, true);
+  if (!lock.Held()) {
+    error = "Cannot lock " + path;
+    return false;
+  }
+  // The table read at Open may miss what other instances added since
+  if (!Refresh(name, error))
+    return false;
+  if ((count + 1) * 2 > records.size() && !Load(error))
+    return false; // Growing rewrites every slot: all of them must be current
+  if (records[Slot(name)].kind != FREE) {
+    error = "Username already taken!";
+    return false;
+  }
+  size_t capacity = records.size();
+  Insert(record);
+  // A grown table moves every slot: rewrite the file
+  if (records.size() != capacity)
+    return WriteAll(path, error);
+  return WriteRecord(Slot(name), error);
+}
@@ -0,0 +1,113 @@
+#include "workspace.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+static const char *workspaceHeader = "ising-workspace 1";
+
+string WorkspacePath(const string &directory, const string &user,
+                     const char *extension) {
+  std::error_code code;
+  filesystem::create_directories(directory, code);
+  static const char digits[] = "0123456789abcdef";
+  string name;
+  for (unsigned char c : user) {
+    name += digits[c >> 4];
+    name += digits[c & 15];
+  }
+  return directory + "/" + name + extension;
+}
+
+bool ReadWorkspace(const string &path, Workspace &workspace, string &error) {
+  ifstream file(path, ios::binary);
+  string line;
+  if (!file) {
+    error = "No workspace " + path;
+    return false;
+  }
+  if (!getline(file, line) || line != workspaceHeader) {
+    error = path + " is not a workspace";
+    return false;
+  }
+  Workspace read;
+  while (getline(file, line)) {
+    istringstream fields(line);
+    string key;
+    fields >> key;
+    int type = 0;
+    if (key == "structure" && fields >> type)
+      read.structure = static_cast<StructureType>(type);
+    else if (key == "unitcell")
+      getline(fields >> ws, read.unitCell);
+    else if (key == "size")
+      fields >> read.x >> read.y >> read.z;
+    else if (key == "distance")
+      fields >> read.distance;
+    else if (key == "temperature")
+      fields >> read.temperature;
+    else if (key == "J")
+      fields >> read.J;
+    else if (key == "B")
+      fields >> read.B;
+    else if (key == "model")
+      fields >> read.spinModel;
+    else if (key == "potts")
+      fields >> read.pottsStates;
+    else if (key == "periodic")
+      fields >> read.periodic;
+    else if (key == "camera")
+      fields >> read.cameraPosition.x >> read.cameraPosition.y >>
+          read.cameraPosition.z >> read.cameraTarget.x >>
+          read.cameraTarget.y >> read.cameraTarget.z;
+    else if (key == "checkpoint")
+      getline(fields >> ws, read.checkpoint);
+  }
+  if (read.x <= 0 || read.y <= 0 || read.z <= 0) {
+    error = path + ": invalid lattice size";
+    return false;
+  }
+  workspace = read;
+  return true;
+}
+
+bool WriteWorkspace(const string &path, const Workspace &workspace,
+                    string &error) {
+  string temporary = path + ".tmp";
+  {
+    ofstream file(temporary, ios::binary);
+    if (!file) {
+      error = "Cannot write " + temporary;
+      return false;
+    }
+    file << workspaceHeader << "\n";
+    file << "structure " << static_cast<int>(workspace.structure) << "\n";
+    if (!workspace.unitCell.empty())
+      file << "unitcell " << workspace.unitCell << "\n";
+    file << "size " << workspace.x << " " << workspace.y << " "
+         << workspace.z << "\n";
+    file << "distance " << workspace.distance << "\n";
+    file << "temperature " << workspace.temperature << "\n";
+    file << "J " << workspace.J << "\n";
+    file << "B " << workspace.B << "\n";
+    file << "model " << workspace.spinModel << "\n";
+    file << "potts " << workspace.pottsStates << "\n";
+    file << "periodic " << workspace.periodic << "\n";
+    file << "camera " << workspace.cameraPosition.x << " "
+         << workspace.cameraPosition.y << " " << workspace.cameraPosition.z
+         << " " << workspace.cameraTarget.x << " " << workspace.cameraTarget.y
+         << " " << workspace.cameraTarget.z << "\n";
+    if (!workspace.checkpoint.empty())
+      file << "checkpoint " << workspace.checkpoint << "\n";
+    if (!file.flush()) {
+      error = "Cannot write " + temporary;
+      return false;
+    }
+  }
+  std::error_code code;
+  filesystem::rename(temporary, path, code);
+  if (code) {
+    error = "Cannot rename " + temporary + ": " + code.message();
+    return false;
+  }
+  return true;
+}
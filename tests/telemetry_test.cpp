@@ -0,0 +1,137 @@
+#include "telemetry.h"
+#include <arpa/inet.h>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// TelemetryServer through a local client: snapshot JSON, SSE stream and
+// commands reaching the simulation side. Returns the number of failures
+
+static int failures = 0;
+
+static void Check(bool passed, const string &what) {
+  printf("%s %s\n", passed ? "ok  " : "FAIL", what.c_str());
+  failures += !passed;
+}
+
+static int Connect(int port) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+    return -1;
+  timeval timeout = {5, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_port = htons((uint16_t)port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+      0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// Sends one request and reads until the server closes or until marker
+static string Exchange(int port, const string &request,
+                       const char *marker = nullptr) {
+  int fd = Connect(port);
+  if (fd < 0)
+    return "";
+  send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+  string reply;
+  char buffer[4096];
+  ssize_t got;
+  while ((got = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    reply.append(buffer, (size_t)got);
+    if (marker && reply.find(marker) != string::npos)
+      break;
+  }
+  close(fd);
+  return reply;
+}
+
+static string Post(int port, const string &body, const string &extra = "") {
+  return Exchange(port, "POST /control HTTP/1.1\r\nHost: localhost\r\n" +
+                            extra + "Content-Length: " +
+                            to_string(body.size()) + "\r\n\r\n" + body);
+}
+
+static bool Contains(const string &text, const char *part) {
+  return text.find(part) != string::npos;
+}
+
+int main() {
+  TelemetryServer server;
+  string error;
+  Check(server.Start(0, error) && server.Port() > 0,
+        "server listens on an ephemeral port");
+  int port = server.Port();
+
+  TelemetrySnapshot snapshot;
+  snapshot.frame = 42;
+  snapshot.temperature = 2.25;
+  snapshot.J = 1.0;
+  snapshot.B = -0.5;
+  snapshot.energy = -1234.5;
+  snapshot.magnetization = 0.75;
+  snapshot.atoms = 1000;
+  snapshot.pinned = 3;
+  snapshot.running = 1;
+  server.Publish(snapshot);
+
+  string reply = Exchange(port, "GET /observables HTTP/1.1\r\n"
+                                "Host: localhost\r\n\r\n");
+  Check(Contains(reply, "200 OK") && Contains(reply, "application/json"),
+        "GET /observables answers JSON");
+  Check(Contains(reply, "\"frame\":42") &&
+            Contains(reply, "\"temperature\":2.25") &&
+            Contains(reply, "\"B\":-0.5") &&
+            Contains(reply, "\"energy\":-1234.5") &&
+            Contains(reply, "\"magnetization\":0.75") &&
+            Contains(reply, "\"atoms\":1000") &&
+            Contains(reply, "\"pinned\":3") &&
+            Contains(reply, "\"running\":true"),
+        "snapshot fields match the published frame");
+
+  reply = Exchange(port, "GET /stream?hz=50 HTTP/1.1\r\nHost: localhost\r\n\r\n",
+                   "\n\n");
+  Check(Contains(reply, "text/event-stream") &&
+            Contains(reply, "data: {\"frame\":42"),
+        "GET /stream sends the snapshot as an event");
+
+  reply = Post(port, "temperature=1.5&action=pause");
+  Check(Contains(reply, "200 OK") && Contains(reply, "\"queued\":2"),
+        "POST /control queues two commands");
+  TelemetryCommand first, second, none;
+  bool polled = server.PollCommand(first) && server.PollCommand(second);
+  Check(polled && first.action == TelemetryAction::SET_TEMPERATURE &&
+            first.value == 1.5f && second.action == TelemetryAction::PAUSE &&
+            !server.PollCommand(none),
+        "the simulation side receives the commands in order");
+
+  reply = Post(port, "action=run", "Origin: http://example.com\r\n");
+  Check(Contains(reply, "403") && !server.PollCommand(none),
+        "a POST from a web page is refused and queues nothing");
+  reply = Post(port, "J=abc");
+  Check(Contains(reply, "400") && !server.PollCommand(none),
+        "a malformed value is refused");
+
+  // The queue holds a bounded number of commands; the rest are reported
+  string many;
+  for (int i = 0; i < 100; i++)
+    many += (i ? "&" : "") + string("action=step");
+  reply = Post(port, many);
+  int drained = 0;
+  while (server.PollCommand(none))
+    drained++;
+  Check(Contains(reply, "503") && drained > 0 && drained < 100,
+        "a full queue drops commands and says so");
+
+  server.Stop();
+  Check(!server.Running() && Connect(port) < 0, "Stop closes the port");
+  return failures;
+}
@@ -0,0 +1,117 @@
+#include "user_store.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+// Scrypt against the RFC 7914 section 12 vectors, and UserStore against
+// tables it must refuse. Returns the number of failures
+
+struct KnownAnswer {
+  const char *password;
+  const char *salt;
+  KdfCost cost;
+  const char *key; // 64 bytes in hex
+};
+
+static const KnownAnswer knownAnswers[] = {
+    {"", "", {4, 1, 1},
+     "77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+     "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906"},
+    {"password", "NaCl", {10, 8, 16},
+     "fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+     "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640"},
+    {"pleaseletmein", "SodiumChloride", {14, 8, 1},
+     "7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+     "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887"}};
+
+static int failures = 0;
+
+static void Check(bool passed, const string &what) {
+  printf("%s %s\n", passed ? "ok  " : "FAIL", what.c_str());
+  failures += !passed;
+}
+
+static string Hex(const uint8_t *bytes, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  string hex;
+  for (size_t i = 0; i < size; i++) {
+    hex += digits[bytes[i] >> 4];
+    hex += digits[bytes[i] & 15];
+  }
+  return hex;
+}
+
+// Header and slots in the layout of users.db, for hand-made tables
+static void WriteTable(const string &path, uint32_t capacity, uint32_t count,
+                       const vector<string> &names, uint8_t logN) {
+  ofstream file(path, ios::binary);
+  uint32_t header[5] = {0, 1, 84, capacity, count};
+  memcpy(header, "ISUS", 4);
+  file.write(reinterpret_cast<const char *>(header), sizeof(header));
+  for (uint32_t slot = 0; slot < capacity && slot < 1024; slot++) {
+    char record[84] = {0};
+    if (slot < names.size()) {
+      strncpy(record, names[slot].c_str(), 31);
+      record[32] = 2; // SCRYPT
+      record[33] = logN;
+      record[34] = 8;
+      record[35] = 1;
+    }
+    file.write(record, sizeof(record));
+  }
+}
+
+static bool Refused(const string &path) {
+  UserStore store;
+  string error;
+  return !store.Open(path, "", error) && !error.empty();
+}
+
+int main() {
+  for (const KnownAnswer &answer : knownAnswers) {
+    uint8_t key[64];
+    bool done = Scrypt(answer.password,
+                       reinterpret_cast<const uint8_t *>(answer.salt),
+                       strlen(answer.salt), answer.cost, key, sizeof(key));
+    Check(done && Hex(key, sizeof(key)) == answer.key,
+          string("scrypt \"") + answer.password + "\" \"" + answer.salt +
+              "\" logN=" + to_string(answer.cost.logN));
+  }
+  uint8_t key[32];
+  Check(!Scrypt("x", key, 1, {64, 8, 1}, key, sizeof(key)),
+        "scrypt refuses logN=64");
+  Check(!Scrypt("x", key, 1, {20, 16, 1}, key, sizeof(key)),
+        "scrypt refuses 2 GB of ROMix");
+
+  const string path = "user_store_test.db";
+  WriteTable(path, 64, 1, {"alice"}, 200);
+  Check(Refused(path), "store refuses an on-disk logN of 200");
+  WriteTable(path, 2, 1, {"alice", "bob"}, 4);
+  Check(Refused(path), "store refuses a table with no free slot");
+  WriteTable(path, 64, 3, {"alice"}, 4);
+  Check(Refused(path), "store refuses a count that disagrees with the slots");
+  WriteTable(path, 0x80000000u, 0, {}, 4);
+  Check(Refused(path), "store refuses a capacity of 2^31");
+
+  remove(path.c_str());
+  UserStore first, second;
+  string error;
+  first.SetCost({4, 1, 1});
+  second.SetCost({4, 1, 1});
+  Check(first.Open(path, "", error) && second.Open(path, "", error),
+        "two instances open one store");
+  // Enough accounts to grow the table under the second instance
+  bool added = true;
+  for (int i = 0; i < 40; i++)
+    added &= first.Add("user" + to_string(i), "pw", error);
+  Check(added && second.Verify("user39", "pw", error),
+        "an account added by one instance logs in through the other");
+  Check(!second.Add("user7", "other", error),
+        "a name taken by the other instance is refused");
+  Check(second.Add("late", "pw", error) && first.Verify("user0", "pw", error) &&
+            first.Verify("late", "pw", error),
+        "growth through a stale instance keeps every account");
+  remove(path.c_str());
+  remove((path + ".lock").c_str());
+  return failures;
+}